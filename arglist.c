@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "arglist.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -21,9 +23,6 @@
 #include "context.h"
 
 
-static char* arglistToString(const ArgList* arglist, char** argstrs);
-
-
 ArgList* ArgList_new(unsigned count) {
 	ArgList* ret = fmalloc(sizeof(*ret));
 	
@@ -39,8 +38,8 @@ void ArgList_free(ArgList* arglist) {
 		Value_free(arglist->args[i]);
 	}
 	
-	free(arglist->args);
-	free(arglist);
+	ffree(arglist->args);
+	ffree(arglist);
 }
 
 ArgList* ArgList_create(unsigned count, ...) {
@@ -107,7 +106,7 @@ double* ArgList_toReals(const ArgList* arglist, const Context* ctx) {
 	for(i = 0; i < arglist->count; i++) {
 		double real = Value_asReal(arglist->args[i]);
 		if(isnan(real)) {
-			free(ret);
+			ffree(ret);
 			return NULL;
 		}
 		
@@ -117,7 +116,7 @@ double* ArgList_toReals(const ArgList* arglist, const Context* ctx) {
 	return ret;
 }
 
-ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb) {
+ArgList* ArgList_parse(const char** expr, char sep, char end, const parser_cb* cb) {
 	/* Since most funcs take at most 2 args, 2 is a good starting size */
 	unsigned size = 2;
 	unsigned count = 0;
@@ -149,9 +148,9 @@ ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb) {
 	
 	if(arg && arg->type == VAL_ERR) {
 		for(i = 0; i < count; i++) {
-			free(args[i]);
+			ffree(args[i]);
 		}
-		free(args);
+		ffree(args);
 		
 		Error_raise(arg->err, false);
 		Value_free(arg);
@@ -165,9 +164,9 @@ ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb) {
 	if(**expr && **expr != end) {
 		/* Not NUL and not end means invalid char */
 		for(i = 0; i < count; i++) {
-			free(args[i]);
+			ffree(args[i]);
 		}
-		free(args);
+		ffree(args);
 		
 		RAISE(badChar(**expr), false);
 		return NULL;
@@ -176,7 +175,7 @@ ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb) {
 	ArgList* ret = ArgList_new(count);
 	memcpy(ret->args, args, count * sizeof(*args));
 	
-	free(args);
+	ffree(args);
 	
 	if(**expr == end) {
 		(*expr)++;
@@ -185,92 +184,44 @@ ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb) {
 	return ret;
 }
 
-static char* arglistToString(const ArgList* arglist, char** argstrs) {
-	char* ret;
+void ArgList_repr(const ArgList* arglist, StrBuf* sb, bool pretty) {
 	unsigned i;
 	for(i = 0; i < arglist->count; i++) {
-		if(i == 0) {
-			ret = argstrs[i];
+		if(i > 0) {
+			StrBuf_append(sb, ", ");
 		}
-		else {
-			char* tmp;
-			asprintf(&tmp,
-					 "%s, %s",
-					 ret, argstrs[i]);
-			free(ret);
-			free(argstrs[i]);
-			ret = tmp;
-		}
-	}
-	
-	free(argstrs);
-	return ret;
-}
-
-char* ArgList_repr(const ArgList* arglist, bool pretty) {
-	if(arglist->count == 0) {
-		return strdup("");
-	}
-	
-	char** argstrs = fmalloc(arglist->count * sizeof(*argstrs));
-	
-	unsigned i;
-	for(i = 0; i < arglist->count; i++) {
-		argstrs[i] = Value_repr(arglist->args[i], pretty, false);
+		
+		Value_repr(arglist->args[i], sb, pretty, false);
 	}
-	
-	return arglistToString(arglist, argstrs);
 }
 
-char* ArgList_wrap(const ArgList* arglist) {
-	if(arglist->count == 0) {
-		return strdup("");
-	}
-	
-	char** argstrs = fmalloc(arglist->count * sizeof(*argstrs));
-	
+void ArgList_wrap(const ArgList* arglist, StrBuf* sb) {
 	unsigned i;
 	for(i = 0; i < arglist->count; i++) {
-		argstrs[i] = Value_wrap(arglist->args[i], false);
+		if(i > 0) {
+			StrBuf_append(sb, ", ");
+		}
+		
+		Value_wrap(arglist->args[i], sb, false);
 	}
-	
-	return arglistToString(arglist, argstrs);
 }
 
-char* ArgList_verbose(const ArgList* arglist, unsigned indent) {
-	char* ret;
-	const char* current = indentation(indent);
-	
+void ArgList_verbose(const ArgList* arglist, StrBuf* sb, unsigned indent) {
 	unsigned i;
 	for(i = 0; i < arglist->count; i++) {
-		char* argstr = Value_verbose(arglist->args[i], indent);
-		
-		if(i == 0) {
-			asprintf(&ret,
-					 "[%d] %s",
-					 i, argstr);
-		}
-		else {
-			char* tmp;
-			asprintf(&tmp,
-					 "%s\n"
-					 "%s[%d] %s",
-					 ret,
-					 current, i, argstr);
-			free(ret);
-			ret = tmp;
+		if(i > 0) {
+			StrBuf_newline(sb, indent);
 		}
 		
-		free(argstr);
+		StrBuf_printf(sb, "[%u] ", i);
+		Value_verbose(arglist->args[i], sb, indent);
 	}
-	
-	return ret;
 }
 
-char* ArgList_xml(const ArgList* arglist, unsigned indent) {
+void ArgList_xml(const ArgList* arglist, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x logbase(22/7, 0.5pi)
-	 
+	
 	 <call>
 	   <callee>
 	     <var name="logbase"/>
@@ -287,36 +238,29 @@ char* ArgList_xml(const ArgList* arglist, unsigned indent) {
 	   </args>
 	 </call>
 	*/
-	if(arglist->count == 0) {
-		return NULL;
+	unsigned i;
+	for(i = 0; i < arglist->count; i++) {
+		if(i > 0) {
+			StrBuf_putc(sb, '\n');
+		}
+		
+		StrBuf_append(sb, indentation(indent));
+		Value_xml(arglist->args[i], sb, indent);
 	}
-	
-	char* ret;
-	const char* spacing = indentation(indent);
+}
+
+void ArgList_json(const ArgList* arglist, StrBuf* sb) {
+	StrBuf_putc(sb, '[');
 	
 	unsigned i;
 	for(i = 0; i < arglist->count; i++) {
-		char* arg = Value_xml(arglist->args[i], indent);
-		
-		if(i == 0) {
-			asprintf(&ret,
-					 "%s%s", /* first arg */
-					 spacing, arg);
-		}
-		else {
-			char* tmp;
-			asprintf(&tmp,
-					 "%s\n"  /* preceding args */
-					 "%s%s", /* current arg */
-					 ret,
-					 spacing, arg);
-			free(ret);
-			ret = tmp;
+		if(i > 0) {
+			StrBuf_putc(sb, ',');
 		}
 		
-		free(arg);
+		Value_json(arglist->args[i], sb);
 	}
 	
-	return ret;
+	StrBuf_putc(sb, ']');
 }
 
@@ -39,12 +39,13 @@ ArgList* ArgList_eval(const ArgList* arglist, const Context* ctx);
 double* ArgList_toReals(const ArgList* arglist, const Context* ctx);
 
 /* Parsing */
-ArgList* ArgList_parse(const char** expr, char sep, char end, parser_cb* cb);
+ArgList* ArgList_parse(const char** expr, char sep, char end, const parser_cb* cb);
 
 /* Printing */
-char* ArgList_repr(const ArgList* arglist, bool pretty);
-char* ArgList_wrap(const ArgList* arglist);
-char* ArgList_verbose(const ArgList* arglist, unsigned indent);
-char* ArgList_xml(const ArgList* arglist, unsigned indent);
+void ArgList_repr(const ArgList* arglist, StrBuf* sb, bool pretty);
+void ArgList_wrap(const ArgList* arglist, StrBuf* sb);
+void ArgList_verbose(const ArgList* arglist, StrBuf* sb, unsigned indent);
+void ArgList_xml(const ArgList* arglist, StrBuf* sb, unsigned indent);
+void ArgList_json(const ArgList* arglist, StrBuf* sb);
 
 #endif
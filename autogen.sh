@@ -1,2 +1,2 @@
 #!/bin/sh
-aclocal && automake --add-missing && autoconf
+mkdir -p m4 && libtoolize --copy && aclocal && automake --add-missing && autoconf
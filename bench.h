@@ -0,0 +1,30 @@
+/*
+  bench.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_BENCH_H_
+#define _SC_BENCH_H_
+
+#include <time.h>
+
+/* Helpers for the benchmarks, which are each built as a program of their own */
+
+
+/* Seconds on a clock that never goes backwards */
+static inline double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Stores a result as if it were read later, so the loop computing it can't be optimized away */
+static inline void sink(double val) {
+	static volatile double dest;
+	dest = val;
+}
+
+#endif /* _SC_BENCH_H_ */
@@ -0,0 +1,127 @@
+/*
+  bench_builtins.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures how long it takes to create an instance, and how long looking up
+ and calling builtins takes, both in a fresh instance and in one with many
+ user-defined globals.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "context.h"
+#include "value.h"
+#include "bench.h"
+
+/* Each measurement runs for about this long */
+#define BENCH_SECONDS 0.5
+#define USER_GLOBALS  1000
+
+static const char* const names[] = {
+	"sqrt", "sin", "acoth", "atan2", "pi", "phi", "norm", "logbase"
+};
+
+
+static double benchNew(void);
+static double benchLookup(const SuperCalc* sc);
+static double benchCall(const SuperCalc* sc);
+
+
+/* Returns microseconds per SC_new and SC_free */
+static double benchNew(void) {
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 100; i++) {
+			SC_free(SC_new(NULL));
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	return elapsed / count * 1e6;
+}
+
+/* Returns nanoseconds per lookup */
+static double benchLookup(const SuperCalc* sc) {
+	unsigned long count = 0;
+	unsigned long found = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 10000; i++) {
+			found += Context_get(sc->ctx, names[i % ARRSIZE(names)]) != NULL;
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	if(found != count) {
+		fprintf(stderr, "Lookup failed\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	return elapsed / count * 1e9;
+}
+
+/* Returns nanoseconds per evaluation of an already parsed call */
+static double benchCall(const SuperCalc* sc) {
+	const char* expr = "sin(0.5)";
+	Value* call = Value_parse(&expr, 0, 0, &default_cb);
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 1000; i++) {
+			Value_free(Value_eval(call, sc->ctx));
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	Value_free(call);
+	return elapsed / count * 1e9;
+}
+
+int main(void) {
+	printf("%-32s %10.2f us\n", "SC_new + SC_free", benchNew());
+	
+	SuperCalc* sc = SC_new(NULL);
+	printf("%-32s %10.1f ns\n", "builtin lookup", benchLookup(sc));
+	printf("%-32s %10.1f ns\n", "sin(0.5)", benchCall(sc));
+	
+	/* New globals are searched before older ones, so builtins get slower to find */
+	char code[64];
+	unsigned i;
+	for(i = 0; i < USER_GLOBALS; i++) {
+		snprintf(code, sizeof(code), "user%u = %u", i, i);
+		SC_exec(sc, code, NULL, NULL);
+	}
+	
+	char label[64];
+	snprintf(label, sizeof(label), "builtin lookup, %u globals", USER_GLOBALS);
+	printf("%-32s %10.1f ns\n", label, benchLookup(sc));
+	snprintf(label, sizeof(label), "sin(0.5), %u globals", USER_GLOBALS);
+	printf("%-32s %10.1f ns\n", label, benchCall(sc));
+	
+	SC_free(sc);
+	return 0;
+}
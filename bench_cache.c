@@ -0,0 +1,82 @@
+/*
+  bench_cache.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures a dashboard-like workload, where the same handful of expressions is
+ submitted over and over through SC_exec, with and without the parse cache.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "parsecache.h"
+#include "bench.h"
+
+/* Each measurement runs for about this long */
+#define BENCH_SECONDS 0.5
+
+/* Distinct expressions in the rotation */
+#define EXPRS 64
+
+
+static double benchLines(unsigned capacity, ParseCacheStats* stats);
+
+
+/* Returns nanoseconds per line */
+static double benchLines(unsigned capacity, ParseCacheStats* stats) {
+	SuperCalc* sc = SC_new(NULL);
+	ParseCache_setCapacity(sc->cache, capacity);
+	SC_exec(sc, "rate = 0.05", NULL, NULL);
+	SC_exec(sc, "f(x, y) = (1 + rate)^x * y - sqrt(x^2 + y^2) / 3", NULL, NULL);
+	
+	char code[EXPRS][96];
+	unsigned i;
+	for(i = 0; i < EXPRS; i++) {
+		snprintf(code[i], sizeof(code[i]),
+		         "f(%u, 1200.5) + dot(<%u, 2, 3>, <4, 5, %u>) * 7/3 - (%u - 1) * rate", i, i, i, i);
+	}
+	
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		for(i = 0; i < 1000; i++) {
+			double result;
+			if(SC_exec(sc, code[i % EXPRS], &result, NULL) != SC_OK) {
+				fprintf(stderr, "Failed to evaluate '%s'\n", code[i % EXPRS]);
+				exit(EXIT_FAILURE);
+			}
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	ParseCache_stats(sc->cache, stats);
+	SC_free(sc);
+	return elapsed / count * 1e9;
+}
+
+int main(void) {
+	ParseCacheStats stats;
+	
+	double uncached = benchLines(0, &stats);
+	printf("%-24s %10.1f ns\n", "no parse cache", uncached);
+	
+	double cached = benchLines(256, &stats);
+	printf("%-24s %10.1f ns   (%lu hits, %lu misses)\n", "parse cache", cached, stats.hits, stats.misses);
+	
+	/* Fewer entries than expressions in the rotation, so every line misses */
+	double thrashing = benchLines(EXPRS / 2, &stats);
+	printf("%-24s %10.1f ns   (%lu hits, %lu misses)\n", "parse cache too small", thrashing, stats.hits, stats.misses);
+	
+	return 0;
+}
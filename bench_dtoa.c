@@ -0,0 +1,107 @@
+/*
+  bench_dtoa.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures how many reals per second can be printed, comparing formatShortest
+ with the C library's %.15g, which results used to be printed with, and %.17g,
+ which is the shortest printf format that always reads back.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "dtoa.h"
+#include "generic.h"
+#include "bench.h"
+
+#define COUNT 10000000
+
+typedef enum {
+	FMT_SHORTEST,
+	FMT_G15,
+	FMT_G17
+} FORMAT;
+
+static const char* const format_names[] = {"formatShortest", "%.15g", "%.17g"};
+
+
+static void fillRandomBits(double* vals);
+static void fillResults(double* vals);
+static double timeFormat(const double* vals, FORMAT fmt);
+
+
+/* Any finite double, with exponents spread evenly */
+static void fillRandomBits(double* vals) {
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	
+	unsigned i;
+	for(i = 0; i < COUNT; i++) {
+		double val;
+		do {
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			uint64_t bits = state * 0x2545f4914f6cdd1dULL;
+			memcpy(&val, &bits, sizeof(val));
+		} while(!isfinite(val));
+		
+		vals[i] = val;
+	}
+}
+
+/* Quotients like the ones a calculator prints */
+static void fillResults(double* vals) {
+	srand(1);
+	
+	unsigned i;
+	for(i = 0; i < COUNT; i++) {
+		vals[i] = (double)(rand() % 100000) / (rand() % 999 + 1);
+	}
+}
+
+/* Returns millions of reals per second */
+static double timeFormat(const double* vals, FORMAT fmt) {
+	char buf[SHORTEST_MAX];
+	size_t total = 0;
+	double start = now();
+	
+	unsigned i;
+	for(i = 0; i < COUNT; i++) {
+		switch(fmt) {
+			case FMT_SHORTEST: total += formatShortest(buf, vals[i]); break;
+			case FMT_G15:      total += snprintf(buf, sizeof(buf), "%.15g", vals[i]); break;
+			case FMT_G17:      total += snprintf(buf, sizeof(buf), "%.17g", vals[i]); break;
+		}
+	}
+	
+	double elapsed = now() - start;
+	sink(total);
+	
+	return COUNT / elapsed / 1e6;
+}
+
+int main(void) {
+	double* vals = fmalloc(COUNT * sizeof(*vals));
+	
+	printf("%-16s %16s %16s\n", "", "random bits", "quotients");
+	
+	unsigned fmt;
+	for(fmt = FMT_SHORTEST; fmt <= FMT_G17; fmt++) {
+		fillRandomBits(vals);
+		double bits = timeFormat(vals, fmt);
+		fillResults(vals);
+		double results = timeFormat(vals, fmt);
+		printf("%-16s %11.2f M/s %11.2f M/s\n", format_names[fmt], bits, results);
+	}
+	
+	free(vals);
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+  bench_errors.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures workloads where most evaluations fail: a builtin called outside of
+ its domain, an undefined variable, and a sweep through SC_exec where every
+ other line is a domain error.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "context.h"
+#include "value.h"
+#include "bench.h"
+
+/* Each measurement runs for about this long */
+#define BENCH_SECONDS 0.5
+
+
+static double benchEval(const SuperCalc* sc, const char* code);
+static double benchSweep(SuperCalc* sc);
+
+
+/* Returns nanoseconds per evaluation of an already parsed expression */
+static double benchEval(const SuperCalc* sc, const char* code) {
+	const char* expr = code;
+	Value* val = Value_parse(&expr, 0, 0, &default_cb);
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 1000; i++) {
+			Value* ret = Value_eval(val, sc->ctx);
+			if(ret->type != VAL_ERR) {
+				fprintf(stderr, "Expected '%s' to fail\n", code);
+				exit(EXIT_FAILURE);
+			}
+			
+			Value_free(ret);
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	Value_free(val);
+	return elapsed / count * 1e9;
+}
+
+/* Returns nanoseconds per line, with errors fetched through the API */
+static double benchSweep(SuperCalc* sc) {
+	char code[64];
+	SCError err;
+	unsigned long count = 0;
+	unsigned long failed = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 1000; i++) {
+			snprintf(code, sizeof(code), "asin(%g)", (i % 4) - 1.5);
+			failed += SC_exec(sc, code, NULL, &err) != SC_OK;
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	if(failed != count / 2) {
+		fprintf(stderr, "Sweep failed %lu of %lu lines\n", failed, count);
+		exit(EXIT_FAILURE);
+	}
+	
+	return elapsed / count * 1e9;
+}
+
+int main(void) {
+	SuperCalc* sc = SC_new(NULL);
+	
+	printf("%-32s %10.1f ns\n", "asin(2)", benchEval(sc, "asin(2)"));
+	printf("%-32s %10.1f ns\n", "undefined variable", benchEval(sc, "nothing + 1"));
+	printf("%-32s %10.1f ns\n", "asin sweep through SC_exec", benchSweep(sc));
+	
+	SC_free(sc);
+	return 0;
+}
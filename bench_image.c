@@ -0,0 +1,189 @@
+/*
+  bench_image.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Compares starting a session from a script of definitions against loading an
+ image saved from the same session. Loading only maps and checks the image,
+ so it's timed both alone and followed by using every definition once. When
+ run from the build directory, it also times whole `sc` processes from startup
+ to their first result, with the image made by `sc --compile`.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "supercalc.h"
+#include "generic.h"
+#include "bench.h"
+
+#define DEFINITIONS 10000
+#define ROUNDS      5
+
+static const char* script_path = "bench_image.sc";
+static const char* image_path = "bench_image.sci";
+static FILE* devnull;
+
+
+static void writeScript(void);
+static SuperCalc* runScript(void);
+static void useAll(SuperCalc* sc);
+static double timeScript(void);
+static double timeImage(bool use);
+static double timeProcess(const char* cmd);
+static void compareProcesses(void);
+
+
+/* A mix of plain values, fractions, vectors and functions calling each other */
+static void writeScript(void) {
+	FILE* fp = fopen(script_path, "w");
+	if(fp == NULL) {
+		perror(script_path);
+		exit(EXIT_FAILURE);
+	}
+	
+	unsigned i;
+	for(i = 0; i < DEFINITIONS; i++) {
+		switch(i % 4) {
+			case 0: fprintf(fp, "c%u = %u.25 * 3\n", i, i); break;
+			case 1: fprintf(fp, "c%u = %u / 7\n", i, i + 1); break;
+			case 2: fprintf(fp, "c%u = <%u, 2, c%u>\n", i, i, i - 2); break;
+			case 3: fprintf(fp, "c%u(x, y) = x^2 + c%u * y - sqrt(x + %u)\n", i, i - 3, i); break;
+		}
+	}
+	
+	fclose(fp);
+}
+
+/* Assignments print their values, so output is thrown away */
+static SuperCalc* runScript(void) {
+	FILE* fp = fopen(script_path, "r");
+	SuperCalc* sc = SC_new(devnull);
+	
+	Value* ret = SC_runFile(sc, fp, "");
+	if(ret) {
+		Value_free(ret);
+	}
+	
+	fclose(fp);
+	return sc;
+}
+
+static void useAll(SuperCalc* sc) {
+	char code[64];
+	unsigned i;
+	
+	for(i = 0; i < DEFINITIONS; i++) {
+		if(i % 4 == 3) {
+			snprintf(code, sizeof(code), "c%u(2, 3)", i);
+		}
+		else {
+			snprintf(code, sizeof(code), "c%u", i);
+		}
+		
+		SC_exec(sc, code, NULL, NULL);
+	}
+}
+
+static double timeScript(void) {
+	double start = now();
+	SuperCalc* sc = runScript();
+	double elapsed = now() - start;
+	SC_free(sc);
+	return elapsed;
+}
+
+static double timeImage(bool use) {
+	double start = now();
+	
+	SuperCalc* sc = SC_new(NULL);
+	if(!SC_loadImage(sc, image_path)) {
+		exit(EXIT_FAILURE);
+	}
+	
+	if(use) {
+		useAll(sc);
+	}
+	
+	double elapsed = now() - start;
+	SC_free(sc);
+	return elapsed;
+}
+
+/* Includes starting a shell, which costs the same either way */
+static double timeProcess(const char* cmd) {
+	double start = now();
+	if(system(cmd) != 0) {
+		fprintf(stderr, "Failed to run: %s\n", cmd);
+		exit(EXIT_FAILURE);
+	}
+	return now() - start;
+}
+
+static void compareProcesses(void) {
+	if(access("./sc", X_OK) != 0) {
+		return;
+	}
+	
+	char compile[128], script[128], image[128];
+	snprintf(compile, sizeof(compile), "./sc --compile %s -o %s", script_path, image_path);
+	snprintf(script, sizeof(script), "(cat %s; echo 'c3(2, 3)') | ./sc > /dev/null", script_path);
+	snprintf(image, sizeof(image), "echo 'c3(2, 3)' | ./sc --image %s > /dev/null", image_path);
+	
+	timeProcess(compile);
+	
+	double fromScript = 1e9, fromImage = 1e9;
+	unsigned i;
+	for(i = 0; i < ROUNDS; i++) {
+		fromScript = MIN(fromScript, timeProcess(script));
+		fromImage = MIN(fromImage, timeProcess(image));
+	}
+	
+	printf("%-28s %10.3f ms\n", "sc reading the script", fromScript * 1e3);
+	printf("%-28s %10.3f ms %8.0fx\n", "sc --image", fromImage * 1e3, fromScript / fromImage);
+}
+
+int main(void) {
+	writeScript();
+	
+	devnull = fopen("/dev/null", "w");
+	
+	/* Build the image from the script */
+	SuperCalc* sc = runScript();
+	
+	char save[64];
+	snprintf(save, sizeof(save), "save \"%s\"", image_path);
+	SCError err;
+	if(SC_exec(sc, save, NULL, &err) != SC_OK) {
+		fprintf(stderr, "Unable to save: %s\n", err.msg);
+		return EXIT_FAILURE;
+	}
+	SC_free(sc);
+	
+	/* Best of several rounds, to keep noise from other processes out */
+	double script = 1e9, image = 1e9, used = 1e9;
+	unsigned i;
+	for(i = 0; i < ROUNDS; i++) {
+		script = MIN(script, timeScript());
+		image = MIN(image, timeImage(false));
+		used = MIN(used, timeImage(true));
+	}
+	
+	printf("%u definitions\n", DEFINITIONS);
+	printf("%-28s %10.3f ms\n", "parse script", script * 1e3);
+	printf("%-28s %10.3f ms %8.0fx\n", "load image", image * 1e3, script / image);
+	printf("%-28s %10.3f ms\n", "load image, use everything", used * 1e3);
+	
+	compareProcesses();
+	
+	remove(script_path);
+	remove(image_path);
+	fclose(devnull);
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+  bench_lex.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures numeric literals per second in a 100MB vector literal of integers,
+ decimals and exponents. Compares lexNumber with calling strtod and strtoll on
+ every literal, which is how they used to be parsed, and then parses the whole
+ vector with Value_parse.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "supercalc.h"
+#include "value.h"
+#include "vector.h"
+#include "numlex.h"
+#include "bench.h"
+
+#define TEXT_SIZE (100 * 1024 * 1024)
+
+
+static char* makeVector(unsigned* count);
+static double timeLex(const char* text, bool old);
+
+
+/* <12, 3.25, 0.0078125, 6.02e23, ...> */
+static char* makeVector(unsigned* count) {
+	char* text = fmalloc(TEXT_SIZE + 64);
+	char* p = text;
+	*p++ = '<';
+	*count = 0;
+	srand(1);
+	
+	while(p - text < TEXT_SIZE) {
+		if(*count > 0) {
+			*p++ = ',';
+			*p++ = ' ';
+		}
+		
+		switch(rand() % 4) {
+			case 0: p += sprintf(p, "%d", rand() % 100000); break;
+			case 1: p += sprintf(p, "%d.%02d", rand() % 1000, rand() % 100); break;
+			case 2: p += sprintf(p, "0.%06d", rand() % 1000000); break;
+			case 3: p += sprintf(p, "%d.%de%d", rand() % 10, rand() % 1000, rand() % 40 - 20); break;
+		}
+		
+		++*count;
+	}
+	
+	strcpy(p, ">");
+	return text;
+}
+
+/* Returns literals per second, lexing each literal after the '<' or ", " before it */
+static double timeLex(const char* text, bool old) {
+	const char* p = text + 1;
+	unsigned long count = 0;
+	double sum = 0;
+	double start = now();
+	
+	while(*p != '>') {
+		long long ival;
+		double rval;
+		
+		if(old) {
+			char* end1;
+			char* end2;
+			errno = 0;
+			rval = strtod(p, &end1);
+			ival = strtoll(p, &end2, 10);
+			p = end1 > end2 ? end1 : end2;
+			sum += end1 > end2 ? rval : ival;
+		}
+		else {
+			sum += lexNumber(&p, &ival, &rval) == NUM_INT ? ival : rval;
+		}
+		
+		count++;
+		if(*p == ',') {
+			p += 2;
+		}
+	}
+	
+	double elapsed = now() - start;
+	sink(sum);
+	
+	return count / elapsed;
+}
+
+int main(void) {
+	unsigned count;
+	char* text = makeVector(&count);
+	printf("%u literals in %.0f MB\n", count, strlen(text) / 1048576.0);
+	
+	double old = timeLex(text, true);
+	double lex = timeLex(text, false);
+	printf("%-24s %8.2f M literals/s\n", "strtod + strtoll", old / 1e6);
+	printf("%-24s %8.2f M literals/s\n", "lexNumber", lex / 1e6);
+	
+	const char* expr = text + 1;
+	double start = now();
+	Value* vec = Vector_parse(&expr, &default_cb);
+	double elapsed = now() - start;
+	
+	if(vec->type != VAL_VEC) {
+		fprintf(stderr, "Failed to parse the vector\n");
+		return EXIT_FAILURE;
+	}
+	
+	printf("%-24s %8.2f M literals/s (%.0f MB/s)\n", "Vector_parse", count / elapsed / 1e6,
+	       strlen(text) / 1048576.0 / elapsed);
+	
+	Value_free(vec);
+	free(text);
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+  bench_prepared.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures evaluations per second of prepared handles, compared to running the
+ same expression through SC_exec, which parses and looks up names every time.
+ Only uses the public interface, the same way an embedding program would.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libsupercalc.h"
+#include "bench.h"
+
+/* Each measurement runs for about this long */
+#define BENCH_SECONDS 0.5
+
+typedef struct Case {
+	const char* name;
+	const char* expr;
+} Case;
+
+static const Case cases[] = {
+	{"polynomial",    "3x^2 + 2x*y - y/7"},
+	{"user function", "f(x, y) + f(y, x)"},
+	{"builtins",      "sqrt(x^2 + y^2) * sin(x) * cos(y)"},
+	{"vector",        "mag(<x, y, x + y>)"}
+};
+
+static const char* params[] = {"x", "y"};
+
+
+static double benchPrepared(const Prepared* prep);
+static double benchExec(SuperCalc* sc, const char* expr);
+
+
+static double benchPrepared(const Prepared* prep) {
+	unsigned long count = 0;
+	double sum = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		/* Check the clock every so often rather than after each evaluation */
+		unsigned i;
+		for(i = 0; i < 1000; i++) {
+			double args[] = {count % 100 + 0.5, count % 7 + 1.25};
+			double result;
+			
+			if(Prepared_eval(prep, args, &result, NULL) == SC_OK) {
+				sum += result;
+			}
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	/* Keep the compiler from discarding the results */
+	if(sum == 0.1234) {
+		putchar(' ');
+	}
+	
+	return count / elapsed;
+}
+
+static double benchExec(SuperCalc* sc, const char* expr) {
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	char code[256];
+	
+	do {
+		unsigned i;
+		for(i = 0; i < 100; i++) {
+			double result;
+			
+			snprintf(code, sizeof(code), "x = %g", count % 100 + 0.5);
+			SC_exec(sc, code, NULL, NULL);
+			snprintf(code, sizeof(code), "y = %g", count % 7 + 1.25);
+			SC_exec(sc, code, NULL, NULL);
+			SC_exec(sc, expr, &result, NULL);
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	return count / elapsed;
+}
+
+int main(void) {
+	SuperCalc* sc = SC_new(NULL);
+	SCError err;
+	
+	if(SC_exec(sc, "f(a, b) = a^2 / (b + 1) + 3a", NULL, &err) != SC_OK) {
+		fprintf(stderr, "Setup failed: %s\n", err.msg);
+		return EXIT_FAILURE;
+	}
+	
+	printf("%-16s %16s %16s %8s\n", "case", "prepared/sec", "reparsed/sec", "speedup");
+	
+	unsigned i;
+	for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		Prepared* prep = SC_prepare(sc, cases[i].expr, params, 2, &err);
+		if(prep == NULL) {
+			fprintf(stderr, "Unable to prepare '%s': %s\n", cases[i].expr, err.msg);
+			return EXIT_FAILURE;
+		}
+		
+		double prepared = benchPrepared(prep);
+		double reparsed = benchExec(sc, cases[i].expr);
+		
+		printf("%-16s %16.0f %16.0f %7.1fx\n",
+		       cases[i].name, prepared, reparsed, prepared / reparsed);
+		
+		Prepared_free(prep);
+	}
+	
+	SC_free(sc);
+	return 0;
+}
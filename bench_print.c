@@ -0,0 +1,178 @@
+/*
+  bench_print.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures printing large vectors and long sums, both built up in memory and
+ streamed to /dev/null the way `?r`, `?x` and `?j` print them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "value.h"
+#include "strbuf.h"
+#include "bench.h"
+
+/* Sums are parsed recursively, so they're kept shorter than vectors */
+#define MAX_TERMS 10000
+
+/* Best of several rounds, to keep noise from other processes out */
+#define ROUNDS    3
+
+static const unsigned sizes[] = {1000, 10000, 100000};
+static FILE* devnull;
+
+
+static Value* parseVector(unsigned count);
+static Value* parseSum(unsigned count);
+static double timeRepr(const Value* val, bool stream);
+static double timeXml(const Value* val, bool stream);
+static double timeJson(const Value* val, bool stream);
+
+
+/* <1/7, 2/7, 3/7, ...> */
+static Value* parseVector(unsigned count) {
+	char* code = fmalloc(count * 16 + 3);
+	char* p = code;
+	*p++ = '<';
+	
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		p += sprintf(p, "%s%u/7", i ? ", " : "", i + 1);
+	}
+	strcpy(p, ">");
+	
+	const char* expr = code;
+	Value* ret = Value_parse(&expr, 0, 0, &default_cb);
+	free(code);
+	return ret;
+}
+
+/* x * 1 + x * 2 + x * 3 + ... */
+static Value* parseSum(unsigned count) {
+	char* code = fmalloc(count * 16 + 1);
+	char* p = code;
+	
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		p += sprintf(p, "%sx * %u", i ? " + " : "", i + 1);
+	}
+	
+	const char* expr = code;
+	Value* ret = Value_parse(&expr, 0, 0, &default_cb);
+	free(code);
+	return ret;
+}
+
+static double timeRepr(const Value* val, bool stream) {
+	double best = 1e9;
+	
+	unsigned i;
+	for(i = 0; i < ROUNDS; i++) {
+		StrBuf sb;
+		double start = now();
+		
+		if(stream) {
+			StrBuf_initFile(&sb, devnull);
+			Value_repr(val, &sb, false, false);
+		}
+		else {
+			StrBuf_init(&sb);
+			Value_repr(val, &sb, false, false);
+			free(StrBuf_finish(&sb));
+		}
+		
+		best = MIN(best, now() - start);
+	}
+	
+	return best;
+}
+
+static double timeXml(const Value* val, bool stream) {
+	double best = 1e9;
+	
+	unsigned i;
+	for(i = 0; i < ROUNDS; i++) {
+		StrBuf sb;
+		double start = now();
+		
+		if(stream) {
+			StrBuf_initFile(&sb, devnull);
+			Value_xml(val, &sb, 0);
+		}
+		else {
+			StrBuf_init(&sb);
+			Value_xml(val, &sb, 0);
+			free(StrBuf_finish(&sb));
+		}
+		
+		best = MIN(best, now() - start);
+	}
+	
+	return best;
+}
+
+static double timeJson(const Value* val, bool stream) {
+	double best = 1e9;
+	
+	unsigned i;
+	for(i = 0; i < ROUNDS; i++) {
+		StrBuf sb;
+		double start = now();
+		
+		if(stream) {
+			StrBuf_initFile(&sb, devnull);
+			Value_json(val, &sb);
+		}
+		else {
+			StrBuf_init(&sb);
+			Value_json(val, &sb);
+			free(StrBuf_finish(&sb));
+		}
+		
+		best = MIN(best, now() - start);
+	}
+	
+	return best;
+}
+
+int main(void) {
+	devnull = fopen("/dev/null", "w");
+	
+	printf("%-24s %12s %12s %12s %12s %12s %12s\n", "",
+	       "repr", "repr stream", "xml", "xml stream", "json", "json stream");
+	
+	unsigned i;
+	for(i = 0; i < ARRSIZE(sizes); i++) {
+		char label[32];
+		Value* vec = parseVector(sizes[i]);
+		snprintf(label, sizeof(label), "vector of %u", sizes[i]);
+		printf("%-24s %9.2f ms %9.2f ms %9.2f ms %9.2f ms %9.2f ms %9.2f ms\n", label,
+		       timeRepr(vec, false) * 1e3, timeRepr(vec, true) * 1e3,
+		       timeXml(vec, false) * 1e3, timeXml(vec, true) * 1e3,
+		       timeJson(vec, false) * 1e3, timeJson(vec, true) * 1e3);
+		Value_free(vec);
+		
+		if(sizes[i] > MAX_TERMS) {
+			continue;
+		}
+		
+		Value* sum = parseSum(sizes[i]);
+		snprintf(label, sizeof(label), "sum of %u terms", sizes[i]);
+		printf("%-24s %9.2f ms %9.2f ms %9.2f ms %9.2f ms %9.2f ms %9.2f ms\n", label,
+		       timeRepr(sum, false) * 1e3, timeRepr(sum, true) * 1e3,
+		       timeXml(sum, false) * 1e3, timeXml(sum, true) * 1e3,
+		       timeJson(sum, false) * 1e3, timeJson(sum, true) * 1e3);
+		Value_free(sum);
+	}
+	
+	fclose(devnull);
+	return 0;
+}
@@ -0,0 +1,91 @@
+/*
+  bench_results.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures the dashboard workload from bench_cache, with and without the result
+ cache, and with an input that every expression reads changing now and then.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "resultcache.h"
+#include "bench.h"
+
+/* Each measurement runs for about this long */
+#define BENCH_SECONDS 0.5
+
+/* Distinct expressions in the rotation */
+#define EXPRS 64
+
+
+static double benchLines(unsigned capacity, unsigned changeEvery, ResultCacheStats* stats);
+
+
+/* Returns nanoseconds per line. `rate` is assigned again every `changeEvery` lines, unless it's 0 */
+static double benchLines(unsigned capacity, unsigned changeEvery, ResultCacheStats* stats) {
+	SuperCalc* sc = SC_new(NULL);
+	ResultCache_setCapacity(sc->results, capacity);
+	SC_exec(sc, "rate = 0.05", NULL, NULL);
+	SC_exec(sc, "f(x, y) = (1 + rate)^x * y - sqrt(x^2 + y^2) / 3", NULL, NULL);
+	
+	char code[EXPRS][96];
+	unsigned i;
+	for(i = 0; i < EXPRS; i++) {
+		snprintf(code[i], sizeof(code[i]),
+		         "f(%u, 1200.5) + dot(<%u, 2, 3>, <4, 5, %u>) * 7/3 - (%u - 1) * rate", i, i, i, i);
+	}
+	
+	unsigned long count = 0;
+	double start = now();
+	double elapsed;
+	
+	do {
+		for(i = 0; i < 1000; i++) {
+			if(changeEvery != 0 && count % changeEvery == 0) {
+				SC_exec(sc, count % (2 * changeEvery) ? "rate = 0.05" : "rate = 0.06", NULL, NULL);
+			}
+			
+			double result;
+			if(SC_exec(sc, code[i % EXPRS], &result, NULL) != SC_OK) {
+				fprintf(stderr, "Failed to evaluate '%s'\n", code[i % EXPRS]);
+				exit(EXIT_FAILURE);
+			}
+			count++;
+		}
+		
+		elapsed = now() - start;
+	} while(elapsed < BENCH_SECONDS);
+	
+	ResultCache_stats(sc->results, stats);
+	SC_free(sc);
+	return elapsed / count * 1e9;
+}
+
+int main(void) {
+	ResultCacheStats stats;
+	
+	double uncached = benchLines(0, 0, &stats);
+	printf("%-28s %10.1f ns\n", "no result cache", uncached);
+	
+	double cached = benchLines(256, 0, &stats);
+	printf("%-28s %10.1f ns   (%lu hits, %lu misses)\n", "result cache", cached, stats.hits, stats.misses);
+	
+	/* Each change makes one pass over the rotation miss */
+	double changing = benchLines(256, EXPRS * 16, &stats);
+	printf("%-28s %10.1f ns   (%lu hits, %lu misses, %lu stale)\n", "input changes every 16 rounds",
+	       changing, stats.hits, stats.misses, stats.stale);
+	
+	double always = benchLines(256, 1, &stats);
+	printf("%-28s %10.1f ns   (%lu hits, %lu misses, %lu stale)\n", "input changes every line",
+	       always, stats.hits, stats.misses, stats.stale);
+	
+	return 0;
+}
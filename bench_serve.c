@@ -0,0 +1,252 @@
+/*
+  bench_serve.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Load generator for `sc --serve`. Each connection runs on its own thread and
+ keeps a window of pipelined requests in flight, timing every response.
+
+ Usage: bench_serve ADDRESS [connections] [requests] [window]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bench.h"
+
+typedef struct Client {
+	pthread_t thread;
+	unsigned requests;
+	unsigned window;
+	
+	/* Latency of every request in seconds, filled in by the thread */
+	double* latencies;
+	unsigned errors;
+	int failed;
+} Client;
+
+static const char* address;
+
+static const char* const exprs[] = {
+	"3x^2 + 2x*y - y/7",
+	"f(x, y) + f(y, x)",
+	"sqrt(x^2 + y^2) * sin(x) * cos(y)",
+	"mag(<x, y, x + y>)"
+};
+
+
+static int connectServer(void);
+static int sendAll(int fd, const char* data, size_t len);
+static void* runClient(void* data);
+static int compareDoubles(const void* a, const void* b);
+
+
+static int connectServer(void) {
+	int fd;
+	
+	if(strncmp(address, "unix:", 5) == 0) {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, address + 5, sizeof(addr.sun_path) - 1);
+		
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	else {
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		
+		const char* port = strrchr(address, ':');
+		if(port != NULL) {
+			char host[64];
+			snprintf(host, sizeof(host), "%.*s", (int)(port - address), address);
+			if(strcmp(host, "localhost") != 0) {
+				inet_pton(AF_INET, host, &addr.sin_addr);
+			}
+			port++;
+		}
+		else {
+			port = address;
+		}
+		addr.sin_port = htons((uint16_t)atoi(port));
+		
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	
+	return fd;
+}
+
+static int sendAll(int fd, const char* data, size_t len) {
+	while(len > 0) {
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+		if(n <= 0) {
+			return -1;
+		}
+		
+		data += n;
+		len -= n;
+	}
+	
+	return 0;
+}
+
+static void* runClient(void* data) {
+	Client* c = data;
+	int fd = connectServer();
+	if(fd < 0) {
+		perror(address);
+		c->failed = 1;
+		return NULL;
+	}
+	
+	/* Each connection gets its own session, so it needs its own definitions */
+	static const char setup[] = "x = 4.5\ny = 2.25\nf(a, b) = a^2 / (b + 1) + 3a\n";
+	unsigned pending = 3;
+	if(sendAll(fd, setup, sizeof(setup) - 1) < 0) {
+		c->failed = 1;
+		close(fd);
+		return NULL;
+	}
+	
+	double* sentAt = malloc(c->window * sizeof(*sentAt));
+	char buf[16384];
+	size_t buflen = 0;
+	unsigned sent = 0;
+	unsigned received = 0;
+	
+	while(received < c->requests) {
+		/* Keep the window full */
+		while(sent < c->requests && sent - received < c->window) {
+			char line[128];
+			int len = snprintf(line, sizeof(line), "%s\n", exprs[sent % (sizeof(exprs) / sizeof(exprs[0]))]);
+			sentAt[sent % c->window] = now();
+			if(sendAll(fd, line, len) < 0) {
+				c->failed = 1;
+				goto done;
+			}
+			sent++;
+		}
+		
+		ssize_t n = recv(fd, buf + buflen, sizeof(buf) - buflen, 0);
+		if(n <= 0) {
+			c->failed = 1;
+			goto done;
+		}
+		buflen += n;
+		
+		double t = now();
+		char* line = buf;
+		char* nl;
+		while((nl = memchr(line, '\n', buf + buflen - line)) != NULL) {
+			if(pending > 0) {
+				/* Responses to the setup lines aren't timed */
+				pending--;
+			}
+			else {
+				if(strncmp(line, "ok ", 3) != 0) {
+					c->errors++;
+				}
+				
+				c->latencies[received] = t - sentAt[received % c->window];
+				received++;
+			}
+			
+			line = nl + 1;
+		}
+		
+		buflen -= line - buf;
+		memmove(buf, line, buflen);
+	}
+
+done:
+	free(sentAt);
+	close(fd);
+	return NULL;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+	if(argc < 2 || argc > 5) {
+		fprintf(stderr, "Usage: %s ADDRESS [connections] [requests] [window]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	address = argv[1];
+	unsigned connections = argc > 2 ? (unsigned)atoi(argv[2]) : 8;
+	unsigned requests = argc > 3 ? (unsigned)atoi(argv[3]) : 20000;
+	unsigned window = argc > 4 ? (unsigned)atoi(argv[4]) : 16;
+	if(connections == 0 || requests == 0 || window == 0) {
+		fprintf(stderr, "Counts must be positive\n");
+		return EXIT_FAILURE;
+	}
+	
+	Client* clients = calloc(connections, sizeof(*clients));
+	double start = now();
+	
+	unsigned i;
+	for(i = 0; i < connections; i++) {
+		clients[i].requests = requests;
+		clients[i].window = window;
+		clients[i].latencies = calloc(requests, sizeof(double));
+		pthread_create(&clients[i].thread, NULL, &runClient, &clients[i]);
+	}
+	
+	unsigned long total = 0;
+	unsigned long errors = 0;
+	double* all = malloc((size_t)connections * requests * sizeof(*all));
+	
+	for(i = 0; i < connections; i++) {
+		pthread_join(clients[i].thread, NULL);
+		if(clients[i].failed) {
+			fprintf(stderr, "Connection %u failed\n", i);
+			return EXIT_FAILURE;
+		}
+		
+		memcpy(all + total, clients[i].latencies, requests * sizeof(*all));
+		total += requests;
+		errors += clients[i].errors;
+		free(clients[i].latencies);
+	}
+	
+	double elapsed = now() - start;
+	qsort(all, total, sizeof(*all), &compareDoubles);
+	
+	printf("connections %u, window %u, requests %lu, errors %lu\n",
+	       connections, window, total, errors);
+	printf("%.0f requests/sec, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+	       total / elapsed,
+	       all[total / 2] * 1e6,
+	       all[total * 99 / 100] * 1e6,
+	       all[total - 1] * 1e6);
+	
+	free(all);
+	free(clients);
+	return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
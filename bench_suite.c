@@ -0,0 +1,941 @@
+/*
+  bench_suite.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Microbenchmarks of the parser, the evaluator, the printer, matrix products
+ and linear systems, plus whole generated scripts, run by `make bench`. Each
+ benchmark is timed as a number of samples, where every sample repeats the
+ operation enough times to take about a millisecond. One line of JSON is
+ printed per benchmark:
+
+   {"bench":"binop/int+int","unit":"ns","samples":31,"min":21.4,"median":21.9,"p90":22.6,"p99":24.1,"max":24.3}
+
+ Times are per operation, which is one line for the script benchmarks. Passing
+ `--compare FILE` with the output of an earlier run adds that run's median and
+ the ratio of the new median to it, so regressions stand out between commits.
+ `--filter TEXT` only runs benchmarks whose names contain TEXT.
+ `--perf-counters` adds a "perf" object with the cycles, instructions, cache
+ misses and branch misses per operation over all samples, left out when the
+ hardware counters can't be read.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "value.h"
+#include "binop.h"
+#include "function.h"
+#include "arglist.h"
+#include "fraction.h"
+#include "vector.h"
+#include "matrix.h"
+#include "strbuf.h"
+#include "perf.h"
+#include "bench.h"
+
+/* Target length of one sample */
+#define SAMPLE_SECONDS 0.001
+
+#define DEFAULT_SAMPLES 31
+
+/* Lines in each generated script */
+#define SCRIPT_LINES 2000
+
+/* Fractions past this could overflow in the next operation, so the baseline gives up */
+#define FRACTION_LIMIT (1LL << 31)
+
+/* Expressions and values that benchmarks read, created once */
+typedef struct Fixture {
+	SuperCalc* sc;
+	const Context* ctx;
+	
+	Value* parsed;
+	Value* a;
+	Value* b;
+	BinOp* op;
+	Function* func;
+	ArgList* args;
+	char* script;
+	size_t scriptLen;
+	Matrix* ma;
+	Matrix* mb;
+	double* scratch;
+} Fixture;
+
+typedef struct Bench {
+	const char* name;
+	
+	/* Creates whatever `run` needs. May be NULL */
+	void (*setup)(Fixture* fx, const void* arg);
+	
+	/* Performs the operation once */
+	void (*run)(Fixture* fx, const void* arg);
+	
+	const void* arg;
+	
+	/* Operations performed by one call of `run` */
+	unsigned ops;
+} Bench;
+
+/* A binary operation between two values given as expressions */
+typedef struct BinArg {
+	BINTYPE type;
+	const char* a;
+	const char* b;
+} BinArg;
+
+/* Random n x n matrices */
+typedef struct MatArg {
+	unsigned n;
+	MATKIND kind;
+} MatArg;
+
+/* An n x n system with a whole number solution */
+typedef struct SolveArg {
+	unsigned n;
+	Matrix* (*make)(unsigned n);
+} SolveArg;
+
+typedef struct Baseline {
+	char name[64];
+	double median;
+} Baseline;
+
+
+static Value* evalText(const Context* ctx, const char* text);
+static void releaseFixture(Fixture* fx);
+static int compareDoubles(const void* a, const void* b);
+static double percentile(const double* sorted, unsigned count, double p);
+static Baseline* readBaseline(const char* path, unsigned* count);
+static const Baseline* findBaseline(const Baseline* base, unsigned count, const char* name);
+static void runBench(const Bench* bench, unsigned samples, bool perf, const Baseline* base, unsigned nbase);
+
+static void runParse(Fixture* fx, const void* arg);
+static void setupBinOp(Fixture* fx, const void* arg);
+static void runBinOp(Fixture* fx, const void* arg);
+static void setupCall(Fixture* fx, const void* arg);
+static void runCall(Fixture* fx, const void* arg);
+static void setupEval(Fixture* fx, const void* arg);
+static void runEval(Fixture* fx, const void* arg);
+static void setupFrac(Fixture* fx, const void* arg);
+static void runFracAdd(Fixture* fx, const void* arg);
+static void runFracPow(Fixture* fx, const void* arg);
+static void setupVectors(Fixture* fx, const void* arg);
+static void runDot(Fixture* fx, const void* arg);
+static void setupPrint(Fixture* fx, const void* arg);
+static void runPrint(Fixture* fx, const void* arg);
+static void setupScript(Fixture* fx, const void* arg);
+static void runScript(Fixture* fx, const void* arg);
+static Matrix* randomMatrix(unsigned n, MATKIND kind);
+static Value* asVectors(const Matrix* mat, bool columns);
+static void setupMatrices(Fixture* fx, const void* arg);
+static void runProduct(Fixture* fx, const void* arg);
+static void runNaive(Fixture* fx, const void* arg);
+static void setupVectorRows(Fixture* fx, const void* arg);
+static void runVectorRows(Fixture* fx, const void* arg);
+static Matrix* randomSystem(unsigned n);
+static Matrix* unimodularSystem(unsigned n);
+static Value* solutionFor(const Matrix* a, const Context* ctx, Value** expected);
+static bool sameValues(const Value* a, const Value* b);
+static bool tooBig(const Value* val);
+static Value* fractionSolve(const Matrix* a, const Value* rhs, const Context* ctx);
+static void setupSolve(Fixture* fx, const void* arg);
+static void runSolve(Fixture* fx, const void* arg);
+static void setupRealSolve(Fixture* fx, const void* arg);
+static void setupFractionSolve(Fixture* fx, const void* arg);
+static void runFractionSolve(Fixture* fx, const void* arg);
+
+
+static Value* evalText(const Context* ctx, const char* text) {
+	const char* p = text;
+	Value* tree = Value_parse(&p, 0, 0, &default_cb);
+	Value* ret = Value_eval(tree, ctx);
+	Value_free(tree);
+	
+	if(ret->type == VAL_ERR) {
+		fprintf(stderr, "Failed to evaluate '%s'\n", text);
+		exit(EXIT_FAILURE);
+	}
+	
+	return ret;
+}
+
+static void releaseFixture(Fixture* fx) {
+	if(fx->parsed) Value_free(fx->parsed);
+	if(fx->a) Value_free(fx->a);
+	if(fx->b) Value_free(fx->b);
+	if(fx->op) BinOp_free(fx->op);
+	if(fx->func) Function_free(fx->func);
+	if(fx->args) ArgList_free(fx->args);
+	if(fx->ma) Matrix_free(fx->ma);
+	if(fx->mb) Matrix_free(fx->mb);
+	free(fx->script);
+	free(fx->scratch);
+	SC_free(fx->sc);
+}
+
+
+/* Value_parse of a line of text */
+static void runParse(Fixture* fx, const void* arg) {
+	(void)fx;
+	const char* p = arg;
+	Value_free(Value_parse(&p, 0, 0, &default_cb));
+}
+
+/* BinOp_eval on a node whose operands are already values */
+static void setupBinOp(Fixture* fx, const void* arg) {
+	const BinArg* ba = arg;
+	fx->op = BinOp_new(ba->type, evalText(fx->ctx, ba->a), evalText(fx->ctx, ba->b));
+}
+
+static void runBinOp(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(BinOp_eval(fx->op, fx->ctx));
+}
+
+/* Function_eval of a user function with two arguments */
+static void setupCall(Fixture* fx, const void* arg) {
+	(void)arg;
+	
+	char** names = fmalloc(2 * sizeof(*names));
+	names[0] = strdup("x");
+	names[1] = strdup("y");
+	
+	const char* p = "x^2 + 3x*y - y/2";
+	fx->func = Function_new(2, names, Value_parse(&p, 0, 0, &default_cb));
+	fx->args = ArgList_create(2, ValInt(7), ValReal(2.5));
+}
+
+static void runCall(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Function_eval(fx->func, fx->ctx, fx->args));
+}
+
+/* Value_eval of a parsed expression, in a context with a function `f` and vectors `v` and `w` */
+static void setupEval(Fixture* fx, const void* arg) {
+	SC_exec(fx->sc, "v = <1, 2, 3, 4, 5, 6, 7, 8, 9, 10>", NULL, NULL);
+	SC_exec(fx->sc, "v = v * 10 - 5", NULL, NULL);
+	SC_exec(fx->sc, "f(x) = 2x + 1", NULL, NULL);
+	
+	unsigned i;
+	StrBuf sb;
+	StrBuf_init(&sb);
+	StrBuf_append(&sb, "w = <");
+	for(i = 0; i < 100; i++) {
+		StrBuf_printf(&sb, i ? ", %u" : "%u", i);
+	}
+	StrBuf_putc(&sb, '>');
+	char* code = StrBuf_finish(&sb);
+	SC_exec(fx->sc, code, NULL, NULL);
+	free(code);
+	
+	const char* p = arg;
+	fx->parsed = Value_parse(&p, 0, 0, &default_cb);
+}
+
+static void runEval(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Value_eval(fx->parsed, fx->ctx));
+}
+
+/* Fraction_add and Fraction_pow with exact operands */
+static void setupFrac(Fixture* fx, const void* arg) {
+	(void)arg;
+	fx->a = evalText(fx->ctx, "355/113");
+	fx->b = evalText(fx->ctx, "22/7");
+}
+
+static void runFracAdd(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Fraction_add(fx->a->frac, fx->b));
+}
+
+static void runFracPow(Fixture* fx, const void* arg) {
+	Value* exp = ValInt(*(const int*)arg);
+	Value_free(Fraction_pow(fx->b->frac, exp));
+	Value_free(exp);
+}
+
+/* Vector_dot of two vectors with `arg` elements */
+static void setupVectors(Fixture* fx, const void* arg) {
+	unsigned count = *(const unsigned*)arg;
+	
+	StrBuf sa, sb;
+	StrBuf_init(&sa);
+	StrBuf_init(&sb);
+	StrBuf_putc(&sa, '<');
+	StrBuf_putc(&sb, '<');
+	
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		StrBuf_printf(&sa, i ? ", %u" : "%u", i + 1);
+		StrBuf_printf(&sb, i ? ", %u.5" : "%u.5", count - i);
+	}
+	
+	StrBuf_putc(&sa, '>');
+	StrBuf_putc(&sb, '>');
+	char* texta = StrBuf_finish(&sa);
+	char* textb = StrBuf_finish(&sb);
+	fx->a = evalText(fx->ctx, texta);
+	fx->b = evalText(fx->ctx, textb);
+	free(texta);
+	free(textb);
+}
+
+static void runDot(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Vector_dot(fx->a->vec, fx->b->vec, fx->ctx));
+}
+
+/* Value_repr of an evaluated value into memory */
+static void setupPrint(Fixture* fx, const void* arg) {
+	fx->a = evalText(fx->ctx, arg);
+}
+
+static void runPrint(Fixture* fx, const void* arg) {
+	(void)arg;
+	StrBuf sb;
+	StrBuf_init(&sb);
+	Value_repr(fx->a, &sb, false, true);
+	free(StrBuf_finish(&sb));
+}
+
+/*
+ Scripts of SCRIPT_LINES lines run from start to finish by a new instance.
+ "defs" is blocks of definitions and calls like bench_watch's, and "exprs" is
+ standalone expressions mixing fractions, reals, vectors and builtins.
+*/
+static void setupScript(Fixture* fx, const void* arg) {
+	StrBuf sb;
+	StrBuf_init(&sb);
+	
+	unsigned i;
+	if(strcmp(arg, "defs") == 0) {
+		StrBuf_append(&sb, "rate = 0.05\n");
+		for(i = 0; i < SCRIPT_LINES / 4; i++) {
+			StrBuf_printf(&sb, "a%u = %u\n", i, i);
+			StrBuf_printf(&sb, "b%u = a%u * 2 + a%u * rate\n", i, i, i ? i - 1 : 0);
+			StrBuf_printf(&sb, "f%u(x) = x^2 + b%u\n", i, i);
+			StrBuf_printf(&sb, "f%u(3) - b%u\n", i, i);
+		}
+	}
+	else {
+		for(i = 0; i < SCRIPT_LINES; i++) {
+			switch(i % 4) {
+				case 0: StrBuf_printf(&sb, "%u/7 + 3/%u - %u^2\n", i, i + 1, i % 13); break;
+				case 1: StrBuf_printf(&sb, "sqrt(%u) * sin(%u.25) + ln(%u)\n", i, i, i + 1); break;
+				case 2: StrBuf_printf(&sb, "dot(<%u, 2, 3>, <4, %u, 6>) * <1, 2, 3>\n", i, i); break;
+				case 3: StrBuf_printf(&sb, "(%u.5 - 2)^3 / (1 + %u%%7)\n", i, i); break;
+			}
+		}
+	}
+	
+	fx->script = StrBuf_finish(&sb);
+	fx->scriptLen = strlen(fx->script);
+}
+
+static void runScript(Fixture* fx, const void* arg) {
+	(void)arg;
+	FILE* fin = fmemopen(fx->script, fx->scriptLen, "r");
+	FILE* devnull = fopen("/dev/null", "w");
+	
+	SuperCalc* sc = SC_new(devnull);
+	Value_free(SC_runFile(sc, fin, ""));
+	SC_free(sc);
+	
+	fclose(devnull);
+	fclose(fin);
+}
+
+static Matrix* randomMatrix(unsigned n, MATKIND kind) {
+	Matrix* ret = Matrix_new(n, n, kind);
+	
+	size_t i;
+	for(i = 0; i < (size_t)n * n; i++) {
+		if(kind == MAT_INT) {
+			ret->ints[i] = rand() % 201 - 100;
+		}
+		else {
+			ret->reals[i] = rand() / (double)RAND_MAX - 0.5;
+		}
+	}
+	
+	return ret;
+}
+
+/* <<row 0>, <row 1>, ...>, or the columns instead */
+static Value* asVectors(const Matrix* mat, bool columns) {
+	ArgList* outer = ArgList_new(mat->rows);
+	
+	unsigned i, j;
+	for(i = 0; i < mat->rows; i++) {
+		ArgList* inner = ArgList_new(mat->cols);
+		for(j = 0; j < mat->cols; j++) {
+			inner->args[j] = columns ? Matrix_get(mat, j, i) : Matrix_get(mat, i, j);
+		}
+		
+		outer->args[i] = ValVec(Vector_new(inner));
+	}
+	
+	return ValVec(Vector_new(outer));
+}
+
+/* Matrix_product, which uses the blocked kernel for reals */
+static void setupMatrices(Fixture* fx, const void* arg) {
+	const MatArg* ma = arg;
+	srand(1);
+	fx->ma = randomMatrix(ma->n, ma->kind);
+	fx->mb = randomMatrix(ma->n, ma->kind);
+	fx->scratch = fmalloc((size_t)ma->n * ma->n * sizeof(*fx->scratch));
+}
+
+static void runProduct(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Matrix_product(fx->ma, fx->mb, fx->ctx));
+}
+
+/* A plain triple loop over the same reals, to compare the kernel with */
+static void runNaive(Fixture* fx, const void* arg) {
+	unsigned n = ((const MatArg*)arg)->n;
+	const double* a = fx->ma->reals;
+	const double* b = fx->mb->reals;
+	
+	unsigned i, j, k;
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++) {
+			double sum = 0;
+			for(k = 0; k < n; k++) {
+				sum += a[(size_t)i * n + k] * b[(size_t)k * n + j];
+			}
+			fx->scratch[(size_t)i * n + j] = sum;
+		}
+	}
+	
+	sink(fx->scratch[0]);
+}
+
+/* The same product of whole numbers done the old way, as a dot product of boxed vectors per element */
+static void setupVectorRows(Fixture* fx, const void* arg) {
+	setupMatrices(fx, arg);
+	fx->a = asVectors(fx->ma, false);
+	fx->b = asVectors(fx->mb, true);
+}
+
+static void runVectorRows(Fixture* fx, const void* arg) {
+	unsigned n = ((const MatArg*)arg)->n;
+	const ArgList* rows = fx->a->vec->vals;
+	const ArgList* cols = fx->b->vec->vals;
+	
+	unsigned i, j;
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++) {
+			Value_free(Vector_dot(rows->args[i]->vec, cols->args[j]->vec, fx->ctx));
+		}
+	}
+}
+
+/* Entries from -9 to 9 */
+static Matrix* randomSystem(unsigned n) {
+	Matrix* ret = Matrix_new(n, n, MAT_INT);
+	
+	size_t i;
+	for(i = 0; i < (size_t)n * n; i++) {
+		ret->ints[i] = rand() % 19 - 9;
+	}
+	
+	return ret;
+}
+
+/* L*U, where L and U have ones on the diagonal and -1, 0 or 1 elsewhere */
+static Matrix* unimodularSystem(unsigned n) {
+	long long* l = fcalloc((size_t)n * n, sizeof(*l));
+	long long* u = fcalloc((size_t)n * n, sizeof(*u));
+	Matrix* ret = Matrix_new(n, n, MAT_INT);
+	unsigned i, j, k;
+	
+	for(i = 0; i < n; i++) {
+		l[(size_t)i * n + i] = u[(size_t)i * n + i] = 1;
+		for(j = 0; j < i; j++) {
+			l[(size_t)i * n + j] = rand() % 3 - 1;
+			u[(size_t)j * n + i] = rand() % 3 - 1;
+		}
+	}
+	
+	for(i = 0; i < n; i++) {
+		for(k = 0; k < n; k++) {
+			for(j = 0; j < n; j++) {
+				ret->ints[(size_t)i * n + j] += l[(size_t)i * n + k] * u[(size_t)k * n + j];
+			}
+		}
+	}
+	
+	free(l);
+	free(u);
+	return ret;
+}
+
+/* Picks a whole number solution from -9 to 9 and returns A times it */
+static Value* solutionFor(const Matrix* a, const Context* ctx, Value** expected) {
+	ArgList* args = ArgList_new(a->cols);
+	
+	unsigned i;
+	for(i = 0; i < a->cols; i++) {
+		args->args[i] = ValInt(rand() % 19 - 9);
+	}
+	
+	*expected = ValVec(Vector_new(args));
+	Value* mat = ValMat(Matrix_copy(a));
+	Value* ret = BinOp_apply(BIN_MUL, ctx, mat, *expected);
+	Value_free(mat);
+	return ret;
+}
+
+static bool sameValues(const Value* a, const Value* b) {
+	if(a->type != VAL_VEC || b->type != VAL_VEC) {
+		return false;
+	}
+	
+	unsigned i;
+	for(i = 0; i < a->vec->vals->count; i++) {
+		const Value* x = a->vec->vals->args[i];
+		const Value* y = b->vec->vals->args[i];
+		if(x->type != VAL_INT || y->type != VAL_INT || x->ival != y->ival) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+static bool tooBig(const Value* val) {
+	switch(val->type) {
+		case VAL_INT:
+			return val->ival <= -FRACTION_LIMIT || val->ival >= FRACTION_LIMIT;
+		
+		case VAL_FRAC:
+			return val->frac->n <= -FRACTION_LIMIT || val->frac->n >= FRACTION_LIMIT || val->frac->d >= FRACTION_LIMIT;
+		
+		default:
+			return true;
+	}
+}
+
+/*
+ Gaussian elimination and back substitution on boxed fractions. Returns NULL
+ instead of overflowing.
+*/
+static Value* fractionSolve(const Matrix* a, const Value* rhs, const Context* ctx) {
+	unsigned n = a->rows;
+	unsigned width = n + 1;
+	Value** m = fmalloc((size_t)n * width * sizeof(*m));
+	bool ok = true;
+	unsigned p, i, j;
+	
+	for(i = 0; i < n; i++) {
+		for(j = 0; j < n; j++) {
+			m[(size_t)i * width + j] = Matrix_get(a, i, j);
+		}
+		m[(size_t)i * width + n] = Value_copy(rhs->vec->vals->args[i]);
+	}
+	
+	for(p = 0; p < n && ok; p++) {
+		Value** pivotRow = m + (size_t)p * width;
+		
+		for(i = p; i < n; i++) {
+			const Value* val = m[(size_t)i * width + p];
+			if(val->type != VAL_INT || val->ival != 0) {
+				break;
+			}
+		}
+		
+		if(i == n) {
+			break;
+		}
+		
+		if(i != p) {
+			Value** row = m + (size_t)i * width;
+			for(j = 0; j < width; j++) {
+				Value* tmp = row[j];
+				row[j] = pivotRow[j];
+				pivotRow[j] = tmp;
+			}
+		}
+		
+		for(i = p + 1; i < n && ok; i++) {
+			Value** row = m + (size_t)i * width;
+			Value* factor = BinOp_apply(BIN_DIV, ctx, row[p], pivotRow[p]);
+			ok = !tooBig(factor);
+			
+			for(j = p; j < width && ok; j++) {
+				Value* prod = BinOp_apply(BIN_MUL, ctx, factor, pivotRow[j]);
+				Value* diff = BinOp_apply(BIN_SUB, ctx, row[j], prod);
+				ok = !tooBig(prod) && !tooBig(diff);
+				Value_free(prod);
+				Value_free(row[j]);
+				row[j] = diff;
+			}
+			
+			Value_free(factor);
+		}
+	}
+	
+	ArgList* args = ArgList_new(n);
+	for(i = n; i-- > 0 && ok;) {
+		Value** row = m + (size_t)i * width;
+		Value* sum = Value_copy(row[n]);
+		
+		for(j = i + 1; j < n && ok; j++) {
+			Value* prod = BinOp_apply(BIN_MUL, ctx, row[j], args->args[j]);
+			Value* diff = BinOp_apply(BIN_SUB, ctx, sum, prod);
+			ok = !tooBig(prod) && !tooBig(diff);
+			Value_free(prod);
+			Value_free(sum);
+			sum = diff;
+		}
+		
+		args->args[i] = BinOp_apply(BIN_DIV, ctx, sum, row[i]);
+		ok = ok && !tooBig(args->args[i]);
+		Value_free(sum);
+	}
+	
+	for(i = 0; i < n * width; i++) {
+		Value_free(m[i]);
+	}
+	free(m);
+	
+	Value* ret = ValVec(Vector_new(args));
+	if(!ok) {
+		Value_free(ret);
+		return NULL;
+	}
+	
+	return ret;
+}
+
+/*
+ Matrix_solve, which has to stay exact for the system to count. Random entries
+ overflow Bareiss past about 10x10 and are solved modulo primes instead, while
+ L*U systems with small factors keep every minor small enough for Bareiss.
+*/
+static void setupSolve(Fixture* fx, const void* arg) {
+	const SolveArg* sa = arg;
+	srand(1);
+	fx->ma = sa->make(sa->n);
+	fx->a = solutionFor(fx->ma, fx->ctx, &fx->b);
+	
+	Value* exact = Matrix_solve(fx->ma, fx->a, fx->ctx);
+	bool same = sameValues(exact, fx->b);
+	Value_free(exact);
+	
+	if(!same) {
+		fprintf(stderr, "Solving a %ux%u system wasn't exact\n", sa->n, sa->n);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void runSolve(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(Matrix_solve(fx->ma, fx->a, fx->ctx));
+}
+
+/* The same system as reals, which always uses LU */
+static void setupRealSolve(Fixture* fx, const void* arg) {
+	setupSolve(fx, arg);
+	
+	Matrix* reals = Matrix_new(fx->ma->rows, fx->ma->cols, MAT_REAL);
+	size_t i;
+	for(i = 0; i < (size_t)fx->ma->rows * fx->ma->cols; i++) {
+		reals->reals[i] = fx->ma->ints[i];
+	}
+	
+	Matrix_free(fx->ma);
+	fx->ma = reals;
+}
+
+/* Gaussian elimination on fractions, the way det and inv used to work */
+static void setupFractionSolve(Fixture* fx, const void* arg) {
+	setupSolve(fx, arg);
+	
+	Value* fractions = fractionSolve(fx->ma, fx->a, fx->ctx);
+	bool same = fractions != NULL && sameValues(fractions, fx->b);
+	if(fractions) Value_free(fractions);
+	
+	if(!same) {
+		fprintf(stderr, "Solving with fractions overflowed\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void runFractionSolve(Fixture* fx, const void* arg) {
+	(void)arg;
+	Value_free(fractionSolve(fx->ma, fx->a, fx->ctx));
+}
+
+
+static const BinArg binIntInt   = {BIN_ADD, "123456", "654321"};
+static const BinArg binIntReal  = {BIN_MUL, "12", "3.75"};
+static const BinArg binRealReal = {BIN_ADD, "1.25", "2.5e3"};
+static const BinArg binFracFrac = {BIN_SUB, "3/7", "5/11"};
+static const BinArg binFracInt  = {BIN_MUL, "3/7", "14"};
+static const BinArg binIntPow   = {BIN_POW, "3", "17"};
+static const BinArg binRealPow  = {BIN_POW, "2.5", "0.5"};
+static const BinArg binVecVec   = {BIN_ADD, "<1, 2, 3>", "<4.5, 5, 6/7>"};
+static const BinArg binVecInt   = {BIN_MUL, "<1, 2, 3>", "4"};
+
+static const int fracExp = 5;
+static const unsigned smallVec = 3;
+static const unsigned largeVec = 1000;
+
+static const MatArg matReal64  = {64, MAT_REAL};
+static const MatArg matReal256 = {256, MAT_REAL};
+static const MatArg matInt32   = {32, MAT_INT};
+static const MatArg matInt256  = {256, MAT_INT};
+
+static const SolveArg solveRandom5      = {5, &randomSystem};
+static const SolveArg solveRandom50     = {50, &randomSystem};
+static const SolveArg solveUnimodular50 = {50, &unimodularSystem};
+
+static const Bench benches[] = {
+	{"parse/number",     NULL,        &runParse, "3.14159265358979", 1},
+	{"parse/expr",       NULL,        &runParse, "8 - 9(6^2 + 3/7)^3 + sqrt(2) * f(x, y)", 1},
+	{"parse/vector",     NULL,        &runParse, "<1, 2.5, 3/4, -4, 5e3, 6, 7, 8>", 1},
+	
+	{"binop/int+int",    &setupBinOp, &runBinOp, &binIntInt,   1},
+	{"binop/int*real",   &setupBinOp, &runBinOp, &binIntReal,  1},
+	{"binop/real+real",  &setupBinOp, &runBinOp, &binRealReal, 1},
+	{"binop/frac-frac",  &setupBinOp, &runBinOp, &binFracFrac, 1},
+	{"binop/frac*int",   &setupBinOp, &runBinOp, &binFracInt,  1},
+	{"binop/int^int",    &setupBinOp, &runBinOp, &binIntPow,   1},
+	{"binop/real^real",  &setupBinOp, &runBinOp, &binRealPow,  1},
+	{"binop/vec+vec",    &setupBinOp, &runBinOp, &binVecVec,   1},
+	{"binop/vec*int",    &setupBinOp, &runBinOp, &binVecInt,   1},
+	
+	{"call/user",        &setupCall, &runCall, NULL, 1},
+	{"call/builtin",     &setupEval, &runEval, "sqrt(2) + sin(1)", 1},
+	{"call/nested",      &setupEval, &runEval, "f(f(f(f(3))))", 1},
+	
+	{"frac/add",         &setupFrac, &runFracAdd, NULL, 1},
+	{"frac/pow",         &setupFrac, &runFracPow, &fracExp, 1},
+	
+	{"vector/dot3",      &setupVectors, &runDot, &smallVec, 1},
+	{"vector/dot1000",   &setupVectors, &runDot, &largeVec, 1},
+	{"vector/map100",    &setupEval, &runEval, "map(f, w)", 1},
+	{"vector/scale10",   &setupEval, &runEval, "v * 2 + 1", 1},
+	
+	{"print/int",        &setupPrint, &runPrint, "1234567890", 1},
+	{"print/real",       &setupPrint, &runPrint, "sqrt(2)", 1},
+	{"print/frac",       &setupPrint, &runPrint, "355/113", 1},
+	{"print/vector",     &setupPrint, &runPrint, "<1, 2.5, 3/7, 1e300, 0.1, 42>", 1},
+	
+	{"matrix/real64",    &setupMatrices,   &runProduct,    &matReal64,  1},
+	{"matrix/real256",   &setupMatrices,   &runProduct,    &matReal256, 1},
+	{"matrix/naive256",  &setupMatrices,   &runNaive,      &matReal256, 1},
+	{"matrix/int256",    &setupMatrices,   &runProduct,    &matInt256,  1},
+	{"matrix/int32",     &setupMatrices,   &runProduct,    &matInt32,   1},
+	{"matrix/vectors32", &setupVectorRows, &runVectorRows, &matInt32,   1},
+	
+	{"solve/random5",      &setupSolve,         &runSolve,         &solveRandom5,      1},
+	{"solve/fractions5",   &setupFractionSolve, &runFractionSolve, &solveRandom5,      1},
+	{"solve/random50",     &setupSolve,         &runSolve,         &solveRandom50,     1},
+	{"solve/unimodular50", &setupSolve,         &runSolve,         &solveUnimodular50, 1},
+	{"solve/reals50",      &setupRealSolve,     &runSolve,         &solveRandom50,     1},
+	
+	{"script/defs",      &setupScript, &runScript, "defs", SCRIPT_LINES},
+	{"script/exprs",     &setupScript, &runScript, "exprs", SCRIPT_LINES}
+};
+
+
+static int compareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* Nearest rank */
+static double percentile(const double* sorted, unsigned count, double p) {
+	unsigned rank = (unsigned)(p / 100 * count + 0.5);
+	if(rank > 0) {
+		rank--;
+	}
+	
+	return sorted[MIN(rank, count - 1)];
+}
+
+/* Reads the name and median from each line written by an earlier run */
+static Baseline* readBaseline(const char* path, unsigned* count) {
+	FILE* fp = fopen(path, "r");
+	if(fp == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	
+	unsigned cap = 64;
+	Baseline* ret = fmalloc(cap * sizeof(*ret));
+	*count = 0;
+	
+	char line[512];
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		Baseline b;
+		const char* median = strstr(line, "\"median\":");
+		if(median == NULL || sscanf(line, "{\"bench\":\"%63[^\"]\"", b.name) != 1
+		   || sscanf(median, "\"median\":%lf", &b.median) != 1) {
+			continue;
+		}
+		
+		if(*count == cap) {
+			cap *= 2;
+			ret = frealloc(ret, cap * sizeof(*ret));
+		}
+		ret[(*count)++] = b;
+	}
+	
+	fclose(fp);
+	return ret;
+}
+
+static const Baseline* findBaseline(const Baseline* base, unsigned count, const char* name) {
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		if(strcmp(base[i].name, name) == 0) {
+			return &base[i];
+		}
+	}
+	
+	return NULL;
+}
+
+static void runBench(const Bench* bench, unsigned samples, bool perf, const Baseline* base, unsigned nbase) {
+	Fixture fx;
+	memset(&fx, 0, sizeof(fx));
+	fx.sc = SC_new(NULL);
+	fx.ctx = fx.sc->ctx;
+	
+	if(bench->setup) {
+		bench->setup(&fx, bench->arg);
+	}
+	
+	/* Find how many repetitions fill a sample, which also warms up caches */
+	unsigned long reps = 1;
+	for(;;) {
+		double start = now();
+		unsigned long i;
+		for(i = 0; i < reps; i++) {
+			bench->run(&fx, bench->arg);
+		}
+		
+		double elapsed = now() - start;
+		if(elapsed >= SAMPLE_SECONDS || reps >= 1UL << 30) {
+			break;
+		}
+		
+		reps = elapsed > 0 ? (unsigned long)(reps * SAMPLE_SECONDS / elapsed) + 1 : reps * 2;
+	}
+	
+	double* times = fmalloc(samples * sizeof(*times));
+	PerfCounts total;
+	memset(&total, 0, sizeof(total));
+	
+	unsigned s;
+	for(s = 0; s < samples; s++) {
+		PerfCounts before;
+		if(perf) {
+			Perf_read(&before);
+		}
+		
+		double start = now();
+		unsigned long i;
+		for(i = 0; i < reps; i++) {
+			bench->run(&fx, bench->arg);
+		}
+		
+		times[s] = (now() - start) / (reps * bench->ops) * 1e9;
+		
+		if(perf) {
+			PerfCounts after, diff;
+			Perf_read(&after);
+			Perf_diff(&before, &after, &diff);
+			Perf_add(&total, &diff);
+		}
+	}
+	
+	qsort(times, samples, sizeof(*times), &compareDoubles);
+	double median = percentile(times, samples, 50);
+	
+	printf("{\"bench\":\"%s\",\"unit\":\"ns\",\"samples\":%u,\"min\":%.1f,\"median\":%.1f,"
+	       "\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f",
+	       bench->name, samples, times[0], median,
+	       percentile(times, samples, 90), percentile(times, samples, 99), times[samples - 1]);
+	
+	const Baseline* b = findBaseline(base, nbase, bench->name);
+	if(b != NULL && b->median > 0) {
+		printf(",\"baseline\":%.1f,\"ratio\":%.3f", b->median, median / b->median);
+	}
+	
+	if(total.valid) {
+		StrBuf sb;
+		StrBuf_init(&sb);
+		Perf_print(&total, (double)samples * reps * bench->ops, &sb, true);
+		char* counts = StrBuf_finish(&sb);
+		printf(",\"perf\":{%s}", counts);
+		free(counts);
+	}
+	
+	printf("}\n");
+	fflush(stdout);
+	
+	free(times);
+	releaseFixture(&fx);
+}
+
+int main(int argc, char* argv[]) {
+	unsigned samples = DEFAULT_SAMPLES;
+	const char* filter = NULL;
+	Baseline* base = NULL;
+	unsigned nbase = 0;
+	bool perf = false;
+	
+	int i;
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--perf-counters") == 0) {
+			perf = true;
+		}
+		else if(i + 1 == argc) {
+			/* Every other option takes an argument */
+			break;
+		}
+		else if(strcmp(argv[i], "--samples") == 0) {
+			samples = (unsigned)atoi(argv[++i]);
+		}
+		else if(strcmp(argv[i], "--filter") == 0) {
+			filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--compare") == 0) {
+			base = readBaseline(argv[++i], &nbase);
+		}
+		else {
+			break;
+		}
+	}
+	
+	if(i != argc || samples == 0) {
+		fprintf(stderr, "Usage: %s [--samples N] [--filter TEXT] [--compare FILE] [--perf-counters]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	unsigned b;
+	for(b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+		if(filter == NULL || strstr(benches[b].name, filter) != NULL) {
+			runBench(&benches[b], samples, perf, base, nbase);
+		}
+	}
+	
+	free(base);
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+  bench_watch.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Measures how long a watched 20,000 line script takes to update after an edit,
+ compared with evaluating all of it again. The script is made of blocks like:
+
+   a123 = 123
+   b123 = a123 * 2 + a122 * rate
+   f123(x) = x^2 + b123
+   f123(3) - b123
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "supercalc.h"
+#include "watch.h"
+#include "bench.h"
+
+#define BLOCKS 5000
+
+/* Only some blocks read `rate`, so editing it has a bounded fan-out */
+#define RATE_EVERY 100
+
+
+static char* makeScript(unsigned blocks, unsigned edited, const char* rate);
+static double timeUpdate(Watch* w, const char* code, unsigned* evaluated);
+
+
+/* Block number `edited` gets a different value of a */
+static char* makeScript(unsigned blocks, unsigned edited, const char* rate) {
+	char* code = fmalloc(blocks * 128 + 64);
+	char* p = code;
+	p += sprintf(p, "rate = %s\n", rate);
+	
+	unsigned i;
+	for(i = 0; i < blocks; i++) {
+		p += sprintf(p, "a%u = %u\n", i, i == edited ? i + 1 : i);
+		p += sprintf(p, "b%u = a%u * 2 + a%u%s\n", i, i, i ? i - 1 : 0,
+		             i % RATE_EVERY == 0 ? " * rate" : "");
+		p += sprintf(p, "f%u(x) = x^2 + b%u\n", i, i);
+		p += sprintf(p, "f%u(3) - b%u\n", i, i);
+	}
+	
+	return code;
+}
+
+static double timeUpdate(Watch* w, const char* code, unsigned* evaluated) {
+	double start = now();
+	*evaluated = Watch_update(w, code);
+	return now() - start;
+}
+
+int main(void) {
+	FILE* devnull = fopen("/dev/null", "w");
+	SuperCalc* sc = SC_new(devnull);
+	Watch* w = Watch_new(sc);
+	
+	char* original = makeScript(BLOCKS, -1, "0.05");
+	char* edited = makeScript(BLOCKS, BLOCKS / 2, "0.05");
+	char* rate = makeScript(BLOCKS, -1, "0.06");
+	char* comment = fmalloc(strlen(rate) + 32);
+	sprintf(comment, "rate = 0.06 # per year%s", strchr(rate, '\n'));
+	
+	/* Everything between two edits far apart is still matched up */
+	char* ends = makeScript(BLOCKS, 0, "0.06");
+	strcat(ends, "b0 + 1\n");
+	
+	unsigned evaluated;
+	double full = timeUpdate(w, original, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "full evaluation", full * 1e3, evaluated);
+	
+	double one = timeUpdate(w, edited, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "edit one definition", one * 1e3, evaluated);
+	
+	double back = timeUpdate(w, original, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "undo the edit", back * 1e3, evaluated);
+	
+	double shared = timeUpdate(w, rate, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "edit a shared parameter", shared * 1e3, evaluated);
+	
+	double remark = timeUpdate(w, comment, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "edit comments only", remark * 1e3, evaluated);
+	
+	double apart = timeUpdate(w, ends, &evaluated);
+	printf("%-32s %10.2f ms %8u lines\n", "edit the top and append a line", apart * 1e3, evaluated);
+	
+	free(original);
+	free(edited);
+	free(rate);
+	free(comment);
+	free(ends);
+	Watch_free(w);
+	SC_free(sc);
+	fclose(devnull);
+	return 0;
+}
@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "binop.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,6 +23,7 @@
 #include "value.h"
 #include "fraction.h"
 #include "vector.h"
+#include "matrix.h"
 
 typedef Value* (*binop_t)(const Context*, const Value*, const Value*);
 
@@ -33,7 +36,7 @@ static Value* binop_mod(const Context* ctx, const Value* a, const Value* b);
 static Value* binop_pow(const Context* ctx, const Value* a, const Value* b);
 static BINTYPE nextSpecialOp(const char** expr);
 
-static binop_t _binop_table[BIN_COUNT] = {
+static const binop_t _binop_table[BIN_COUNT] = {
 	&binop_add,
 	&binop_sub,
 	&binop_mul,
@@ -54,13 +57,13 @@ static const int _binop_cmp[BIN_COUNT+1][BIN_COUNT+1] = {
 	/* HIGHEST */ {   1,   1,   1,   1,   1,   1,   1}
 };
 
-static const char* _binop_pretty[BIN_COUNT] = {
+static const char* const _binop_pretty[BIN_COUNT] = {
 	"+", "-", "×", "÷", "%", "^"
 };
-static const char* _binop_repr[BIN_COUNT] = {
+static const char* const _binop_repr[BIN_COUNT] = {
 	"+", "-", "*", "/", "%", "^"
 };
-static const char* _binop_xml[BIN_COUNT] = {
+static const char* const _binop_xml[BIN_COUNT] = {
 	"add", "sub", "mul", "div", "mod", "pow"
 };
 
@@ -87,7 +90,14 @@ static Value* val_ipow(long long base, long long exp) {
 static Value* binop_add(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_VEC) {
+	if(a->type == VAL_MAT) {
+		/* Checked before vectors, since a matrix times a vector is a matrix operation */
+		ret = Matrix_add(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = Matrix_add(b->mat, a, ctx);
+	}
+	else if(a->type == VAL_VEC) {
 		/* Let the vector class handle the operation */
 		ret = Vector_add(a->vec, b, ctx);
 	}
@@ -137,7 +147,13 @@ static Value* binop_add(const Context* ctx, const Value* a, const Value* b) {
 static Value* binop_sub(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_VEC) {
+	if(a->type == VAL_MAT) {
+		ret = Matrix_sub(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = Matrix_rsub(b->mat, a, ctx);
+	}
+	else if(a->type == VAL_VEC) {
 		ret = Vector_sub(a->vec, b, ctx);
 	}
 	else if(b->type == VAL_VEC) {
@@ -189,7 +205,13 @@ static Value* binop_sub(const Context* ctx, const Value* a, const Value* b) {
 static Value* binop_mul(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_VEC) {
+	if(a->type == VAL_MAT) {
+		ret = Matrix_mul(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = Matrix_rmul(b->mat, a, ctx);
+	}
+	else if(a->type == VAL_VEC) {
 		ret = Vector_mul(a->vec, b, ctx);
 	}
 	else if(b->type == VAL_VEC) {
@@ -237,7 +259,13 @@ static Value* binop_mul(const Context* ctx, const Value* a, const Value* b) {
 static Value* binop_div(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_VEC) {
+	if(a->type == VAL_MAT) {
+		ret = Matrix_div(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = Matrix_rdiv(b->mat, a, ctx);
+	}
+	else if(a->type == VAL_VEC) {
 		ret = Vector_div(a->vec, b, ctx);
 	}
 	else if(b->type == VAL_VEC) {
@@ -302,7 +330,13 @@ static Value* binop_div(const Context* ctx, const Value* a, const Value* b) {
 static Value* binop_mod(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_VEC || b->type == VAL_VEC) {
+	if(a->type == VAL_MAT) {
+		ret = Matrix_mod(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = Matrix_rmod(b->mat, a, ctx);
+	}
+	else if(a->type == VAL_VEC || b->type == VAL_VEC) {
 		ret = ValErr(typeError("Modulus is not supported for vectors."));
 	}
 	else if(a->type == VAL_INT && b->type == VAL_INT) {
@@ -361,7 +395,13 @@ static Value* binop_mod(const Context* ctx, const Value* a, const Value* b) {
 static Value* binop_pow(const Context* ctx, const Value* a, const Value* b) {
 	Value* ret;
 	
-	if(a->type == VAL_INT && b->type == VAL_INT) {
+	if(a->type == VAL_MAT) {
+		ret = Matrix_pow(a->mat, b, ctx);
+	}
+	else if(b->type == VAL_MAT) {
+		ret = ValErr(typeError("Cannot raise to the power of a matrix."));
+	}
+	else if(a->type == VAL_INT && b->type == VAL_INT) {
 		ret = val_ipow(a->ival, b->ival);
 	}
 	else if(a->type == VAL_VEC) {
@@ -429,7 +469,7 @@ void BinOp_free(BinOp* node) {
 	Value_free(node->b);
 	
 	/* Free self */
-	free(node);
+	ffree(node);
 }
 
 BinOp* BinOp_copy(const BinOp* node) {
@@ -452,7 +492,7 @@ Value* BinOp_eval(const BinOp* node, const Context* ctx) {
 		return b;
 	}
 	
-	Value* ret = _binop_table[node->type](ctx, a, b);
+	Value* ret = BinOp_apply(node->type, ctx, a, b);
 	
 	Value_free(a);
 	Value_free(b);
@@ -460,6 +500,10 @@ Value* BinOp_eval(const BinOp* node, const Context* ctx) {
 	return ret;
 }
 
+Value* BinOp_apply(BINTYPE type, const Context* ctx, const Value* a, const Value* b) {
+	return _binop_table[type](ctx, a, b);
+}
+
 /* Like Rambo */
 static BINTYPE nextSpecialOp(const char** expr) {
 	unsigned i;
@@ -530,94 +574,81 @@ int BinOp_cmp(BINTYPE a, BINTYPE b) {
 	return _binop_cmp[a][b];
 }
 
-char* BinOp_repr(const BinOp* node, bool pretty) {
-	char* ret;
+void BinOp_repr(const BinOp* node, StrBuf* sb, bool pretty) {
 	const char* opstr = (pretty ? _binop_pretty : _binop_repr)[node->type];
+	const Value* vals[2] = {node->a, node->b};
 	
-	char* strs[2] = {Value_repr(node->a, pretty, false), Value_repr(node->b, pretty, false)};
-	BINTYPE types[2] = {BIN_HIGHEST, BIN_HIGHEST};
-	
-	/* Determine expr type of a */
-	if(node->a->type == VAL_FRAC) {
-		types[0] = BIN_DIV;
-	}
-	else if(node->a->type == VAL_EXPR) {
-		types[0] = node->a->expr->type;
-	}
-	
-	/* Determine expr type of b */
-	if(node->b->type == VAL_FRAC) {
-		types[1] = BIN_DIV;
-	}
-	else if(node->b->type == VAL_EXPR) {
-		types[1] = node->b->expr->type;
-	}
-	
-	/* Determine whether the subexpression needs to be parenthesized */
 	unsigned i;
 	for(i = 0; i < 2; i++) {
-		if(BinOp_cmp(node->type, types[i]) > 0) {
-			char* tmp;
-			asprintf(&tmp, "(%s)", strs[i]);
-			free(strs[i]);
-			strs[i] = tmp;
+		/* Determine expr type of the operand */
+		BINTYPE type = BIN_HIGHEST;
+		if(vals[i]->type == VAL_FRAC) {
+			type = BIN_DIV;
+		}
+		else if(vals[i]->type == VAL_EXPR) {
+			type = vals[i]->expr->type;
+		}
+		
+		if(i == 1) {
+			StrBuf_printf(sb, " %s ", opstr);
+		}
+		
+		/* Determine whether the subexpression needs to be parenthesized */
+		bool paren = BinOp_cmp(node->type, type) > 0;
+		if(paren) {
+			StrBuf_putc(sb, '(');
+		}
+		
+		Value_repr(vals[i], sb, pretty, false);
+		
+		if(paren) {
+			StrBuf_putc(sb, ')');
 		}
 	}
-	
-	asprintf(&ret, "%s %s %s", strs[0], opstr, strs[1]);
-	
-	free(strs[0]);
-	free(strs[1]);
-	return ret;
 }
 
-char* BinOp_wrap(const BinOp* node) {
-	char* ret;
-	Value* nodes[2] = {node->a, node->b};
-	char* strs[2] = {Value_wrap(node->a, false), Value_wrap(node->b, false)};
+void BinOp_wrap(const BinOp* node, StrBuf* sb) {
+	const Value* vals[2] = {node->a, node->b};
 	
-	/* Always parenthesize subexpressions */
 	unsigned i;
 	for(i = 0; i < 2; i++) {
-		if(nodes[i]->type == VAL_EXPR) {
-			char* tmp;
-			asprintf(&tmp, "(%s)", strs[i]);
-			free(strs[i]);
-			strs[i] = tmp;
+		if(i == 1) {
+			StrBuf_printf(sb, " %s ", _binop_repr[node->type]);
+		}
+		
+		/* Always parenthesize subexpressions */
+		bool paren = vals[i]->type == VAL_EXPR;
+		if(paren) {
+			StrBuf_putc(sb, '(');
+		}
+		
+		Value_wrap(vals[i], sb, false);
+		
+		if(paren) {
+			StrBuf_putc(sb, ')');
 		}
 	}
-	
-	asprintf(&ret, "%s %s %s", strs[0], _binop_repr[node->type], strs[1]);
-	
-	free(strs[0]);
-	free(strs[1]);
-	return ret;
 }
 
-char* BinOp_verbose(const BinOp* node, unsigned indent) {
-	char* ret;
-	char* a = Value_verbose(node->a, indent + 1);
-	char* b = Value_verbose(node->b, indent + 1);
-	
-	asprintf(&ret,
-			 "%3$s (\n"           /* BinOp type */
-				 "%2$s[a] %4$s\n" /* a */
-				 "%2$s[b] %5$s\n" /* b */
-			 "%1$s)",
-			 indentation(indent), indentation(indent + 1),
-			 _binop_repr[node->type],
-			 a,
-			 b);
-	
-	free(b);
-	free(a);
-	return ret;
+void BinOp_verbose(const BinOp* node, StrBuf* sb, unsigned indent) {
+	StrBuf_printf(sb, "%s (", _binop_repr[node->type]);
+	
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "[a] ");
+	Value_verbose(node->a, sb, indent + 1);
+	
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "[b] ");
+	Value_verbose(node->b, sb, indent + 1);
+	
+	StrBuf_newline(sb, indent);
+	StrBuf_putc(sb, ')');
 }
 
-char* BinOp_xml(const BinOp* node, unsigned indent) {
+void BinOp_xml(const BinOp* node, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x 4 + 1 - 3 * 7
-	 
+	
 	 <sub>
 	   <add>
 	     <int>4</int>
@@ -628,25 +659,32 @@ char* BinOp_xml(const BinOp* node, unsigned indent) {
 	     <int>7</int>
 	   </mul>
 	 </sub>
-	 
+	
 	 -16
 	*/
-	char* ret;
-	char* a = Value_xml(node->a, indent + 1);
-	char* b = Value_xml(node->b, indent + 1);
-	
-	asprintf(&ret,
-			 "<%3$s>\n"
-				 "%2$s%4$s\n" /* a */
-				 "%2$s%5$s\n" /* b */
-			 "%1$s</%3$s>",
-			 indentation(indent), indentation(indent + 1),
-			 _binop_xml[node->type],
-			 a,
-			 b);
-	
-	free(b);
-	free(a);
-	return ret;
+	const char* tag = _binop_xml[node->type];
+	StrBuf_printf(sb, "<%s>", tag);
+	
+	StrBuf_newline(sb, indent + 1);
+	Value_xml(node->a, sb, indent + 1);
+	
+	StrBuf_newline(sb, indent + 1);
+	Value_xml(node->b, sb, indent + 1);
+	
+	StrBuf_newline(sb, indent);
+	StrBuf_printf(sb, "</%s>", tag);
+}
+
+void BinOp_json(const BinOp* node, StrBuf* sb) {
+	/*
+	 sc> ?jt 4 + 1 - 3 * 7
+	 {"tree":{"op":"sub","a":{"op":"add","a":4,"b":1},"b":{"op":"mul","a":3,"b":7}}}
+	 {"result":-16}
+	*/
+	StrBuf_printf(sb, "{\"op\":\"%s\",\"a\":", _binop_xml[node->type]);
+	Value_json(node->a, sb);
+	StrBuf_append(sb, ",\"b\":");
+	Value_json(node->b, sb);
+	StrBuf_putc(sb, '}');
 }
 
@@ -53,6 +53,9 @@ BinOp* BinOp_copy(const BinOp* node);
 /* Evaluation */
 Value* BinOp_eval(const BinOp* node, const Context* ctx);
 
+/* Applies the operator to operands that are already evaluated */
+Value* BinOp_apply(BINTYPE type, const Context* ctx, const Value* a, const Value* b);
+
 /* Tokenizer */
 BINTYPE BinOp_nextType(const char** expr, char sep, char end);
 
@@ -60,9 +63,10 @@ BINTYPE BinOp_nextType(const char** expr, char sep, char end);
 int BinOp_cmp(BINTYPE a, BINTYPE b);
 
 /* Printing */
-char* BinOp_repr(const BinOp* node, bool pretty);
-char* BinOp_wrap(const BinOp* node);
-char* BinOp_verbose(const BinOp* node, unsigned indent);
-char* BinOp_xml(const BinOp* node, unsigned indent);
+void BinOp_repr(const BinOp* node, StrBuf* sb, bool pretty);
+void BinOp_wrap(const BinOp* node, StrBuf* sb);
+void BinOp_verbose(const BinOp* node, StrBuf* sb, unsigned indent);
+void BinOp_xml(const BinOp* node, StrBuf* sb, unsigned indent);
+void BinOp_json(const BinOp* node, StrBuf* sb);
 
 #endif
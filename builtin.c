@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "builtin.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,61 +22,104 @@
 #include "context.h"
 #include "arglist.h"
 #include "variable.h"
+#include "defaults.h"
+#include "builtin_hash.h"
+#include "stats.h"
+#include "trace.h"
+#include "profile.h"
+
+/* Generated at build time by gen_builtins */
+#include "builtins_table.h"
+
+
+/* Indices of each builtin in the tables below */
+enum {
+#define BUILTIN(name, isFunction) BLT_##name,
+#include "builtins.def"
+#undef BUILTIN
+	BLT_COUNT
+};
+
+static const Builtin builtins[BLT_COUNT] = {
+#define BUILTIN(name, isFunction) {#name, &eval_##name, isFunction, false},
+#define VOLATILE_BUILTIN(name) {#name, &eval_##name, true, true},
+#include "builtins.def"
+#undef BUILTIN
+};
+
+/* What Context_get returns for builtins, so instances don't need their own copies */
+static const Variable builtin_vars[BLT_COUNT] = {
+#define BUILTIN(name, isFunction) {VAR_BUILTIN, #name, {.blt = (Builtin*)&builtins[BLT_##name]}},
+#include "builtins.def"
+#undef BUILTIN
+};
 
 
 Builtin* Builtin_new(const char* name, builtin_eval_t evaluator, bool isFunction) {
 	Builtin* ret = fmalloc(sizeof(*ret));
 	
-	ret->name = strdup(name);
+	ret->name = fstrdup(name);
 	ret->evaluator = evaluator;
 	ret->isFunction = isFunction;
+	ret->isVolatile = false;
 	
 	return ret;
 }
 
 void Builtin_free(Builtin* blt) {
-	free(blt->name);
-	free(blt);
+	ffree(blt->name);
+	ffree(blt);
 }
 
 Builtin* Builtin_copy(const Builtin* blt) {
-	return Builtin_new(blt->name, blt->evaluator, blt->isFunction);
+	Builtin* ret = Builtin_new(blt->name, blt->evaluator, blt->isFunction);
+	ret->isVolatile = blt->isVolatile;
+	return ret;
 }
 
-void Builtin_register(Builtin* blt, Context* ctx) {
-	Variable* var = VarBuiltin(strdup(blt->name), blt);
-	Context_addGlobal(ctx, var);
+const Variable* Builtin_find(const char* name) {
+	unsigned slot = Builtin_hash(name, BUILTIN_SEED) & (BUILTIN_SLOTS - 1);
+	unsigned index = builtin_slots[slot];
+	
+	/* Other names can land in a builtin's slot, so it still has to match */
+	if(index == 0 || strcmp(builtin_vars[index - 1].name, name) != 0) {
+		return NULL;
+	}
+	
+	return &builtin_vars[index - 1];
 }
 
 Value* Builtin_eval(const Builtin* blt, const Context* ctx, const ArgList* arglist, bool internal) {
+	STAT_INC(builtinCalls);
+	
 	/* Call the builtin's evaluator function */
+	ProfileFrame frame;
+	TRACE_BEGIN(TRACE_BUILTIN, blt->name, arglist ? arglist->count : 0);
+	PROFILE_ENTER(&frame, blt->name, true);
 	Value* ret = blt->evaluator(ctx, arglist, internal);
+	PROFILE_EXIT(&frame);
+	TRACE_END(TRACE_BUILTIN);
 	if(ret->type == VAL_ERR && ret->err->type == ERR_MATH) {
 		return ret;
 	}
 	else if(ret->type == VAL_REAL && isnan(ret->rval)) {
-		Value_free(ret);
-		return ValErr(mathError("Builtin function '%s' returned an invalid value.", blt->name));
+		/* Reuse the result, since a real owns nothing else */
+		ret->type = VAL_ERR;
+		ret->err = mathError("Builtin function '%s' returned an invalid value.", blt->name);
 	}
 	
 	return ret;
 }
 
-char* Builtin_repr(const Builtin* blt, bool pretty) {
-	if(pretty) {
-		return strdup(getPretty(blt->name));
-	}
-	
-	return strdup(blt->name);
+void Builtin_repr(const Builtin* blt, StrBuf* sb, bool pretty) {
+	StrBuf_append(sb, pretty ? getPretty(blt->name) : blt->name);
 }
 
-char* Builtin_verbose(const Builtin* blt, unsigned indent) {
-	char* ret;
-	asprintf(&ret, "<builtin %s>", blt->name);
-	return ret;
+void Builtin_verbose(const Builtin* blt, StrBuf* sb, unsigned indent) {
+	StrBuf_printf(sb, "<builtin %s>", blt->name);
 }
 
-char* Builtin_xml(const Builtin* blt, unsigned indent) {
+void Builtin_xml(const Builtin* blt, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x sqrt
 	 
@@ -82,8 +127,16 @@ char* Builtin_xml(const Builtin* blt, unsigned indent) {
 	   <builtin name="sqrt"/>
 	 </vardata>
 	*/
-	char* ret;
-	asprintf(&ret, "<builtin name=\"%s\"/>", blt->name);
-	return ret;
+	StrBuf_printf(sb, "<builtin name=\"%s\"/>", blt->name);
+}
+
+void Builtin_json(const Builtin* blt, StrBuf* sb) {
+	/*
+	 sc> ?jt sqrt
+	 {"tree":{"name":"sqrt","value":{"builtin":"sqrt"}}}
+	*/
+	StrBuf_append(sb, "{\"builtin\":");
+	StrBuf_jsonString(sb, blt->name);
+	StrBuf_putc(sb, '}');
 }
 
@@ -15,6 +15,7 @@ typedef struct Builtin Builtin;
 #include "context.h"
 #include "arglist.h"
 #include "value.h"
+#include "variable.h"
 
 typedef Value* (*builtin_eval_t)(const Context*, const ArgList*, bool);
 
@@ -22,6 +23,9 @@ struct Builtin {
 	char* name;
 	builtin_eval_t evaluator;
 	bool isFunction;
+	
+	/* Results can differ between calls, even with the same arguments */
+	bool isVolatile;
 };
 
 /* Constructor */
@@ -33,16 +37,21 @@ void Builtin_free(Builtin* blt);
 /* Copying */
 Builtin* Builtin_copy(const Builtin* blt);
 
-/* Registration */
-void Builtin_register(Builtin* blt, Context* ctx);
+/*
+ Lookup in the static table of builtins generated from builtins.def.
+ Returns NULL if `name` isn't a builtin. The variable is shared by every
+ context, so never free or modify it.
+*/
+const Variable* Builtin_find(const char* name);
 
 /* Evaluation */
 Value* Builtin_eval(const Builtin* blt, const Context* ctx, const ArgList* arglist, bool internal);
 
 /* Printing */
-char* Builtin_repr(const Builtin* blt, bool pretty);
-char* Builtin_verbose(const Builtin* blt, unsigned indent);
-char* Builtin_xml(const Builtin* blt, unsigned indent);
+void Builtin_repr(const Builtin* blt, StrBuf* sb, bool pretty);
+void Builtin_verbose(const Builtin* blt, StrBuf* sb, unsigned indent);
+void Builtin_xml(const Builtin* blt, StrBuf* sb, unsigned indent);
+void Builtin_json(const Builtin* blt, StrBuf* sb);
 
 
 #endif
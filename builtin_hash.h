@@ -0,0 +1,28 @@
+/*
+  builtin_hash.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_BUILTIN_HASH_H_
+#define _SC_BUILTIN_HASH_H_
+
+/*
+ Shared by gen_builtins, which searches for a seed that gives every builtin
+ its own slot, and by the lookups that use the generated table.
+*/
+static inline unsigned Builtin_hash(const char* name, unsigned seed) {
+	/* FNV-1a, with the seed mixed into the starting state */
+	unsigned hash = 2166136261u ^ (seed * 0x9E3779B9u);
+	
+	while(*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	
+	return hash ^ (hash >> 15);
+}
+
+#endif /* _SC_BUILTIN_HASH_H_ */
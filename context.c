@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_CONTEXT
+
 #include "context.h"
 #include <stdlib.h>
 #include <string.h>
@@ -13,11 +15,17 @@
 
 #include "generic.h"
 #include "variable.h"
+#include "image.h"
+#include "builtin.h"
+#include "reactive.h"
 
 
 struct VarNode {
 	Variable* var;
 	struct VarNode* next;
+	
+	/* See Context_version. Always 0 for locals */
+	unsigned long version;
 };
 
 struct ContextStack {
@@ -28,27 +36,53 @@ struct ContextStack {
 struct Context {
 	struct VarNode* globals;
 	struct ContextStack* locals;
+	
+	/* Globals that haven't been looked up yet live here. Names in `globals` hide these */
+	Image* image;
+	
+	/* Whether any global might be a reactive binding, so assignments can skip looking */
+	bool reactive;
+	
+	/* Version shared by every name the image defines */
+	unsigned long imageVersion;
 };
 
+/* Shared by every context, so a copy can never reuse a version for something else */
+static unsigned long last_version = 0;
+
 
+static unsigned long nextVersion(void);
 static void freeVars(struct VarNode* vars);
 static void freeStack(struct ContextStack* stack);
 static struct VarNode* copyVars(const struct VarNode* src);
 static struct ContextStack* copyStack(const struct ContextStack* stack);
-static void addVar(struct VarNode** vars, Variable* var);
+static struct VarNode* addVar(struct VarNode** vars, Variable* var);
 static struct VarNode* findPrev(struct VarNode* cur, const char* name);
 static bool isFirst(struct VarNode* cur, const char* name);
 static struct VarNode* findNode(struct VarNode* cur, const char* name);
 static Variable* findVar(struct VarNode* cur, const char* name);
+static const Variable* findGlobal(const Context* ctx, const char* name);
+static void invalidate(const Context* ctx, const char* name);
+static void forgetAll(const Context* ctx);
+static void unbindImage(Context* ctx);
+static int compareVars(const void* a, const void* b);
 
 
+static unsigned long nextVersion(void) {
+	return __atomic_add_fetch(&last_version, 1, __ATOMIC_RELAXED);
+}
+
 Context* Context_new(void) {
 	Context* ret = fmalloc(sizeof(*ret));
 	
 	ret->globals = fmalloc(sizeof(*ret->globals));
-	ret->globals->var = VarValue(strdup("ans"), ValInt(0));
+	ret->globals->var = VarValue(fstrdup("ans"), ValInt(0));
 	ret->globals->next = NULL;
+	ret->globals->version = nextVersion();
 	ret->locals = NULL;
+	ret->image = NULL;
+	ret->reactive = false;
+	ret->imageVersion = 0;
 	
 	return ret;
 }
@@ -61,7 +95,7 @@ static void freeVars(struct VarNode* cur) {
 	while(cur) {
 		/* Free current element */
 		Variable_free(cur->var);
-		free(cur);
+		ffree(cur);
 		
 		/* Go to next element in the linked list */
 		cur = next;
@@ -82,7 +116,12 @@ static void freeStack(struct ContextStack* stack) {
 void Context_free(Context* ctx) {
 	freeVars(ctx->globals);
 	freeStack(ctx->locals);
-	free(ctx);
+	
+	if(ctx->image) {
+		Image_release(ctx->image);
+	}
+	
+	ffree(ctx);
 }
 
 static struct VarNode* copyVars(const struct VarNode* src) {
@@ -95,6 +134,7 @@ static struct VarNode* copyVars(const struct VarNode* src) {
 		cur = fmalloc(sizeof(*cur));
 		cur->var = Variable_copy(src->var);
 		cur->next = NULL;
+		cur->version = src->version;
 		
 		
 		if(prev) {
@@ -144,27 +184,40 @@ static struct ContextStack* copyStack(const struct ContextStack* stack) {
 Context* Context_copy(const Context* ctx) {
 	if(!ctx) return NULL;
 	
-	Context* ret = Context_new();
+	/* Not Context_new, since its globals would just be thrown away */
+	Context* ret = fmalloc(sizeof(*ret));
 	
 	ret->globals = copyVars(ctx->globals);
 	ret->locals = copyStack(ctx->locals);
 	
+	/* Images are never modified, so copies can share them */
+	ret->image = ctx->image ? Image_retain(ctx->image) : NULL;
+	ret->reactive = ctx->reactive;
+	ret->imageVersion = ctx->imageVersion;
+	
 	return ret;
 }
 
-static void addVar(struct VarNode** vars, Variable* var) {
+static struct VarNode* addVar(struct VarNode** vars, Variable* var) {
 	struct VarNode* elem = fmalloc(sizeof(*elem));
 	
 	elem->var = var;
+	elem->version = 0;
 	
 	/* Put the new element in the front of the linked list and move the rest back */
 	elem->next = *vars;
 	*vars = elem;
+	
+	return elem;
 }
 
-void Context_addGlobal(const Context* ctx, Variable* var) {
+void Context_addGlobal(Context* ctx, Variable* var) {
+	if(var->type == VAR_REACTIVE) {
+		ctx->reactive = true;
+	}
+	
 	/* Always keep "ans" first */
-	addVar(&ctx->globals->next, var);
+	addVar(&ctx->globals->next, var)->version = nextVersion();
 }
 
 void Context_addLocal(const Context* ctx, Variable* var) {
@@ -175,37 +228,49 @@ void Context_addLocal(const Context* ctx, Variable* var) {
 	addVar(&ctx->locals->vars, var);
 }
 
-void Context_setGlobal(const Context* ctx, const char* name, Variable* var) {
+void Context_setGlobal(Context* ctx, const char* name, Variable* var) {
 	if(var->type == VAR_FUNC && strcmp(name, "ans") == 0) {
 		RAISE(nameError("Cannot redefine special varaible 'ans' as a function."), false);
 		return;
 	}
 	
-	Variable* dst = findVar(ctx->globals, name);
+	if(Builtin_find(name) != NULL) {
+		RAISE(typeError("Unable to modify builtin variable '%s'.", name), false);
+		Variable_free(var);
+		return;
+	}
+	
+	struct VarNode* dst = findNode(ctx->globals, name);
 	if(dst == NULL) {
 		/* Variable doesn't yet exist, so create it. */
 		/* Make sure we are assigning the correct variable */
 		if(var->name != NULL) {
-			free(var->name);
+			ffree(var->name);
 		}
 		
-		var->name = strdup(name);
+		var->name = fstrdup(name);
 		Context_addGlobal(ctx, var);
 	}
 	else {
-		if(dst->type == VAR_BUILTIN) {
-			RAISE(typeError("Unable to modify builtin variable '%s'.", dst->name), false);
-			return;
+		/* Variable already exists, so update it */
+		if(var->type == VAR_REACTIVE) {
+			ctx->reactive = true;
 		}
 		
-		/* Variable already exists, so update it */
-		Variable_update(dst, var);
+		Variable_update(dst->var, var);
+		dst->version = nextVersion();
 	}
+	
+	invalidate(ctx, name);
 }
 
 Context* Context_pushFrame(const Context* ctx) {
-	Context* ret = Context_new();
+	/* Shares the globals instead of starting with its own */
+	Context* ret = fmalloc(sizeof(*ret));
 	ret->globals = ctx->globals;
+	ret->image = ctx->image;
+	ret->reactive = ctx->reactive;
+	ret->imageVersion = ctx->imageVersion;
 	
 	struct ContextStack* frame = fcalloc(1, sizeof(*frame));
 	
@@ -217,8 +282,8 @@ Context* Context_pushFrame(const Context* ctx) {
 
 void Context_popFrame(Context* ctx) {
 	freeVars(ctx->locals->vars);
-	free(ctx->locals);
-	free(ctx);
+	ffree(ctx->locals);
+	ffree(ctx);
 }
 
 static struct VarNode* findPrev(struct VarNode* cur, const char* name) {
@@ -239,7 +304,7 @@ static bool isFirst(struct VarNode* cur, const char* name) {
 	return cur && strcmp(cur->var->name, name) == 0;
 }
 
-void Context_del(const Context* ctx, const char* name) {
+void Context_del(Context* ctx, const char* name) {
 	struct VarNode* cur;
 	struct VarNode* prev = NULL;
 	
@@ -248,6 +313,16 @@ void Context_del(const Context* ctx, const char* name) {
 		return;
 	}
 	
+	if(Builtin_find(name) != NULL) {
+		RAISE(typeError("Cannot delete builtin variable '%s'.", name), false);
+		return;
+	}
+	
+	/* Images can't hide single names, so bring everything into globals first */
+	if(ctx->image && Image_find(ctx->image, name) >= 0) {
+		unbindImage(ctx);
+	}
+	
 	/* First node in locals linked list */
 	if(ctx->locals != NULL) {
 		if(isFirst(ctx->locals->vars, name)) {
@@ -257,7 +332,7 @@ void Context_del(const Context* ctx, const char* name) {
 			
 			/* Free node */
 			Variable_free(cur->var);
-			free(cur);
+			ffree(cur);
 			
 			return;
 		}
@@ -277,33 +352,27 @@ void Context_del(const Context* ctx, const char* name) {
 	
 	cur = prev->next;
 	
-	if(cur->var->type == VAR_BUILTIN) {
-		RAISE(typeError("Cannot delete builtin variable '%s'.", name), false);
-		return;
-	}
-	
 	/* Link previous node to next one */
 	prev->next = cur->next;
 	
 	/* Free current node */
 	Variable_free(cur->var);
-	free(cur);
+	ffree(cur);
+	
+	invalidate(ctx, name);
 }
 
 void Context_clear(Context* ctx) {
-	/* Delete all global variables that aren't builtins */
-	struct VarNode* prev = ctx->globals;
-	struct VarNode* cur = prev->next;
-	while(cur != NULL) {
-		if(cur->var->type != VAR_BUILTIN) {
-			prev->next = cur->next;
-			Variable_free(cur->var);
-			free(cur);
-		}
-		
-		prev = prev->next;
-		cur = prev->next;
+	if(ctx->image) {
+		Image_release(ctx->image);
+		ctx->image = NULL;
 	}
+	
+	/* Builtins aren't stored in contexts, so everything but "ans" goes */
+	freeVars(ctx->globals->next);
+	ctx->globals->next = NULL;
+	ctx->reactive = false;
+	ctx->imageVersion = 0;
 }
 
 static struct VarNode* findNode(struct VarNode* cur, const char* name) {
@@ -324,8 +393,22 @@ static Variable* findVar(struct VarNode* cur, const char* name) {
 	return node ? node->var : NULL;
 }
 
-Variable* Context_get(const Context* ctx, const char* name) {
-	Variable* ret = NULL;
+static const Variable* findGlobal(const Context* ctx, const char* name) {
+	/* Builtins can't be redefined, so they're checked first */
+	const Variable* ret = Builtin_find(name) ?: findVar(ctx->globals, name);
+	
+	if(ret == NULL && ctx->image != NULL) {
+		int index = Image_find(ctx->image, name);
+		if(index >= 0) {
+			ret = Image_get(ctx->image, (unsigned)index);
+		}
+	}
+	
+	return ret;
+}
+
+const Variable* Context_get(const Context* ctx, const char* name) {
+	const Variable* ret = NULL;
 	
 	if(ctx->locals != NULL) {
 		/* Search the top locals stack frame for the variable */
@@ -333,16 +416,155 @@ Variable* Context_get(const Context* ctx, const char* name) {
 	}
 	
 	/* Search globals as a last resort only if it wasn't found in locals */
-	return ret ?: findVar(ctx->globals, name);
+	return ret ?: findGlobal(ctx, name);
 }
 
-Variable* Context_getAbove(const Context* ctx, const char* name) {
-	Variable* ret = NULL;
+const Variable* Context_getAbove(const Context* ctx, const char* name) {
+	const Variable* ret = NULL;
 	
 	if(ctx->locals != NULL && ctx->locals->next != NULL) {
 		ret = findVar(ctx->locals->next->vars, name);
 	}
 	
-	return ret ?: findVar(ctx->globals, name);
+	return ret ?: findGlobal(ctx, name);
+}
+
+unsigned long Context_version(const Context* ctx, const char* name) {
+	struct VarNode* node = findNode(ctx->globals, name);
+	if(node != NULL) {
+		return node->version;
+	}
+	
+	if(ctx->image != NULL && Image_find(ctx->image, name) >= 0) {
+		return ctx->imageVersion;
+	}
+	
+	/* Builtins never change, and missing names have nothing to change */
+	return 0;
+}
+
+static void invalidate(const Context* ctx, const char* name) {
+	if(!ctx->reactive) {
+		return;
+	}
+	
+	/* A binding whose result was already dropped had its readers dropped along with it */
+	struct VarNode* cur;
+	for(cur = ctx->globals->next; cur != NULL; cur = cur->next) {
+		Variable* var = cur->var;
+		if(var->type == VAR_REACTIVE && Reactive_invalidate(var->rx, name)) {
+			invalidate(ctx, var->name);
+		}
+	}
+}
+
+static void forgetAll(const Context* ctx) {
+	if(!ctx->reactive) {
+		return;
+	}
+	
+	struct VarNode* cur;
+	for(cur = ctx->globals->next; cur != NULL; cur = cur->next) {
+		if(cur->var->type == VAR_REACTIVE) {
+			Reactive_forget(cur->var->rx);
+		}
+	}
+}
+
+/* Moves every entry of the image that isn't hidden into globals, then drops the image */
+static void unbindImage(Context* ctx) {
+	Image* img = ctx->image;
+	ctx->image = NULL;
+	
+	unsigned i;
+	for(i = 0; i < Image_count(img); i++) {
+		if(findVar(ctx->globals, Image_name(img, i)) == NULL) {
+			Context_addGlobal(ctx, Variable_copy(Image_get(img, i)));
+		}
+	}
+	
+	Image_release(img);
+}
+
+void Context_attachImage(Context* ctx, Image* img) {
+	if(ctx->image) {
+		unbindImage(ctx);
+	}
+	
+	/* Definitions from the image replace existing ones, so remove anything it would be hidden by */
+	struct VarNode* prev = ctx->globals;
+	struct VarNode* cur = prev->next;
+	while(cur != NULL) {
+		if(Image_find(img, cur->var->name) >= 0) {
+			prev->next = cur->next;
+			Variable_free(cur->var);
+			ffree(cur);
+		}
+		else {
+			prev = cur;
+		}
+		
+		cur = prev->next;
+	}
+	
+	ctx->image = img;
+	ctx->imageVersion = nextVersion();
+	
+	/* Anything could read the names that were replaced */
+	forgetAll(ctx);
+	
+	/* Images are shared and never modified, so reactive bindings need copies they can keep results in */
+	unsigned i;
+	for(i = 0; i < Image_count(img); i++) {
+		if(Image_isReactive(img, i)) {
+			Context_addGlobal(ctx, Variable_copy(Image_get(img, i)));
+		}
+	}
+}
+
+static int compareVars(const void* a, const void* b) {
+	const Variable* x = *(const Variable* const*)a;
+	const Variable* y = *(const Variable* const*)b;
+	return strcmp(x->name, y->name);
+}
+
+const Variable** Context_userGlobals(const Context* ctx, unsigned* count) {
+	unsigned cap = 16;
+	const Variable** ret = fmalloc(cap * sizeof(*ret));
+	*count = 0;
+	
+	/* Skip "ans", which is always first */
+	struct VarNode* cur;
+	for(cur = ctx->globals->next; cur != NULL; cur = cur->next) {
+		if(cur->var->type != VAR_VALUE && cur->var->type != VAR_FUNC && cur->var->type != VAR_REACTIVE) {
+			continue;
+		}
+		
+		if(*count == cap) {
+			cap *= 2;
+			ret = frealloc(ret, cap * sizeof(*ret));
+		}
+		
+		ret[(*count)++] = cur->var;
+	}
+	
+	if(ctx->image) {
+		unsigned i;
+		for(i = 0; i < Image_count(ctx->image); i++) {
+			if(findVar(ctx->globals, Image_name(ctx->image, i)) != NULL) {
+				continue;
+			}
+			
+			if(*count == cap) {
+				cap *= 2;
+				ret = frealloc(ret, cap * sizeof(*ret));
+			}
+			
+			ret[(*count)++] = Image_get(ctx->image, i);
+		}
+	}
+	
+	qsort(ret, *count, sizeof(*ret), &compareVars);
+	return ret;
 }
 
@@ -12,6 +12,7 @@
 
 typedef struct Context Context;
 #include "variable.h"
+#include "image.h"
 
 
 /* Constructor */
@@ -25,23 +26,48 @@ Context* Context_copy(const Context* ctx);
 
 /* Variable accessing */
 /* These methods consume the `var` argument. */
-void Context_addGlobal(const Context* ctx, Variable* var);
+void Context_addGlobal(Context* ctx, Variable* var);
 void Context_addLocal(const Context* ctx, Variable* var);
-void Context_setGlobal(const Context* ctx, const char* name, Variable* var);
+
+/*
+ Replacing or deleting a global also drops the results of reactive bindings
+ that read it, and of every binding that reads those.
+*/
+void Context_setGlobal(Context* ctx, const char* name, Variable* var);
 
 /* Stack frames */
 Context* Context_pushFrame(const Context* ctx);
 void Context_popFrame(Context* ctx);
 
 /* Variable deletion */
-void Context_del(const Context* ctx, const char* name);
+void Context_del(Context* ctx, const char* name);
 void Context_clear(Context* ctx);
 
+/*
+ Makes the image's definitions visible as globals, replacing any existing ones
+ with the same names. Consumes `img`.
+*/
+void Context_attachImage(Context* ctx, Image* img);
+
+/*
+ Every global defined by the user rather than by a module, sorted by name.
+ Free the returned array but not the variables in it.
+*/
+const Variable** Context_userGlobals(const Context* ctx, unsigned* count);
+
+/*
+ Changes whenever the global called `name` is defined, replaced or deleted, so
+ a result computed from it can be reused while the version stays the same. A
+ version is never reused, even by a different context. Missing names and
+ builtins are 0.
+*/
+unsigned long Context_version(const Context* ctx, const char* name);
+
 /*
  Context_get and Context_getAbove return a pointer from within the
  context, so do not free the returned variable.
 */
-Variable* Context_get(const Context* ctx, const char* name);
-Variable* Context_getAbove(const Context* ctx, const char* name);
+const Variable* Context_get(const Context* ctx, const char* name);
+const Variable* Context_getAbove(const Context* ctx, const char* name);
 
 #endif
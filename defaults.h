@@ -9,16 +9,20 @@
 #ifndef _SC_DEFAULTS_H_
 #define _SC_DEFAULTS_H_
 
+#include <stdbool.h>
+
 #include "context.h"
+#include "arglist.h"
+#include "value.h"
 
 
 #define EVAL_CONST(name, val) \
-static Value* eval_##name(const Context* ctx, const ArgList* arglist, bool internal) { \
+Value* eval_##name(const Context* ctx, const ArgList* arglist, bool internal) { \
 	return ValReal((val)); \
 }
 
 #define EVAL_FUNC(name, func, nargs) \
-static Value* eval_##name(const Context* ctx, const ArgList* arglist, bool internal) { \
+Value* eval_##name(const Context* ctx, const ArgList* arglist, bool internal) { \
 	if(arglist->count != (nargs)) { \
 		return ValErr(builtinArgs(#name, (nargs), arglist->count)); \
 	} \
@@ -37,8 +41,11 @@ static Value* eval_##name(const Context* ctx, const ArgList* arglist, bool inter
 }
 
 
-void register_math(Context* ctx);
-void register_vector(Context* ctx);
+/* Evaluators for everything listed in builtins.def */
+#define BUILTIN(name, isFunction) \
+Value* eval_##name(const Context* ctx, const ArgList* arglist, bool internal);
+#include "builtins.def"
+#undef BUILTIN
 
 
 #endif
@@ -6,9 +6,12 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "defaults.h"
 #include <math.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "generic.h"
 #include "error.h"
@@ -18,6 +21,7 @@
 #include "value.h"
 #include "binop.h"
 #include "vector.h"
+#include "matrix.h"
 #include "fraction.h"
 #include "funccall.h"
 #include "template.h"
@@ -29,7 +33,7 @@ EVAL_CONST(e, M_E);
 EVAL_CONST(phi, PHI);
 
 
-static Value* eval_sqrt(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_sqrt(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 1) {
 		return ValErr(builtinArgs("sqrt", 1, arglist->count));
 	}
@@ -38,7 +42,7 @@ static Value* eval_sqrt(const Context* ctx, const ArgList* arglist, bool interna
 	return TP_EVAL(tp, ctx, "@@^(1/2)", Value_copy(arglist->args[0]));
 }
 
-static Value* eval_abs(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_abs(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 1) {
 		return ValErr(builtinArgs("abs", 1, arglist->count));
 	}
@@ -61,11 +65,16 @@ static Value* eval_abs(const Context* ctx, const ArgList* arglist, bool internal
 		case VAL_FRAC:
 			ret = ValFrac(Fraction_new(ABS(val->frac->n), val->frac->d));
 			break;
-			
+		
 		case VAL_VEC:
 			ret = Vector_magnitude(val->vec, ctx);
 			break;
 		
+		case VAL_MAT:
+			/* |M| is the determinant */
+			ret = Matrix_det(val->mat, ctx);
+			break;
+		
 		default:
 			badValType(val->type);
 	}
@@ -74,7 +83,7 @@ static Value* eval_abs(const Context* ctx, const ArgList* arglist, bool internal
 	return ret;
 }
 
-static Value* eval_exp(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_exp(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 1) {
 		return ValErr(builtinArgs("exp", 1, arglist->count));
 	}
@@ -124,58 +133,79 @@ EVAL_FUNC(log2, log2(a[0]), 1);
 EVAL_FUNC(ln, log(a[0]), 1);
 EVAL_FUNC(logbase, log(a[0]) / log(a[1]), 2);
 
+/* Diagnostics */
+Value* eval_memstats(const Context* ctx, const ArgList* arglist, bool internal) {
+	if(arglist->count != 0) {
+		return ValErr(builtinArgs("memstats", 0, arglist->count));
+	}
+	
+	if(!mem_tracking) {
+		return ValErr(typeError("Builtin 'memstats' needs memory tracking, which 'sc --memstats' turns on."));
+	}
+	
+	MemCounts counts;
+	Mem_counts(MEM_TAG_COUNT, &counts);
+	
+	/* Live bytes, peak bytes and allocations so far */
+	ArgList* stats = ArgList_create(3, ValInt(counts.live), ValInt(counts.peak), ValInt(counts.allocs));
+	return ValVec(Vector_new(stats));
+}
 
-static const char* _math_const_names[] = {
-	"pi", "e", "phi"
-};
-
-static builtin_eval_t _math_consts[] = {
-	&eval_pi, &eval_e, &eval_phi
-};
-
-static const char* _math_names[] = {
-	"sqrt", "abs", "exp",
-	"sin", "cos", "tan",
-	"sec", "csc", "cot",
-	"asin", "acos", "atan",
-	"asec", "acsc", "acot",
-	"sinh", "cosh", "tanh",
-	"sech", "csch", "coth",
-	"asinh", "acosh", "atanh",
-	"asech", "acsch", "acoth",
-	"log", "log2", "ln",
-	"logbase", "atan2"
-};
-
-static builtin_eval_t _math_funcs[] = {
-	&eval_sqrt, &eval_abs, &eval_exp,
-	&eval_sin, &eval_cos, &eval_tan,
-	&eval_sec, &eval_csc, &eval_cot,
-	&eval_asin, &eval_acos, &eval_atan,
-	&eval_asec, &eval_acsc, &eval_acot,
-	&eval_sinh, &eval_cosh, &eval_tanh,
-	&eval_sech, &eval_csch, &eval_coth,
-	&eval_asinh, &eval_acosh, &eval_atanh,
-	&eval_asech, &eval_acsch, &eval_acoth,
-	&eval_log, &eval_log2, &eval_ln,
-	&eval_logbase, &eval_atan2
-};
-
-
-void register_math(Context* ctx) {
-	unsigned i;
-	unsigned constCount = ARRSIZE(_math_const_names);
+/*
+ time(expr, n) evaluates `expr` n times after n/10 + 1 untimed warmup runs,
+ and returns <mean, min, stddev> of the runs in nanoseconds. Arguments arrive
+ unevaluated, so every run does all of the work again.
+*/
+Value* eval_time(const Context* ctx, const ArgList* arglist, bool internal) {
+	if(arglist->count != 2) {
+		return ValErr(builtinArgs("time", 2, arglist->count));
+	}
+	
+	Value* count = Value_coerce(arglist->args[1], ctx);
+	if(count->type == VAL_ERR) {
+		return count;
+	}
 	
-	for(i = 0; i < constCount; i++) {
-		Builtin* blt = Builtin_new(_math_const_names[i], _math_consts[i], false);
-		Builtin_register(blt, ctx);
+	if(count->type != VAL_INT || count->ival < 1) {
+		Value_free(count);
+		return ValErr(typeError("Builtin 'time' expects a positive integer count."));
 	}
 	
-	unsigned funcCount = ARRSIZE(_math_names);
+	long long n = count->ival;
+	Value_free(count);
 	
-	for(i = 0; i < funcCount; i++) {
-		Builtin* blt = Builtin_new(_math_names[i], _math_funcs[i], true);
-		Builtin_register(blt, ctx);
+	/* Warms up caches, and stops early if the expression fails */
+	const Value* expr = arglist->args[0];
+	long long i;
+	for(i = 0; i < n / 10 + 1; i++) {
+		Value* ret = Value_eval(expr, ctx);
+		if(ret->type == VAL_ERR) {
+			return ret;
+		}
+		Value_free(ret);
 	}
+	
+	/* Running mean and variance, by Welford's method */
+	double mean = 0;
+	double m2 = 0;
+	double fastest = INFINITY;
+	
+	for(i = 0; i < n; i++) {
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Value* ret = Value_eval(expr, ctx);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		Value_free(ret);
+		
+		double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+		fastest = MIN(fastest, ns);
+		
+		double delta = ns - mean;
+		mean += delta / (i + 1);
+		m2 += delta * (ns - mean);
+	}
+	
+	double stddev = n > 1 ? sqrt(m2 / (n - 1)) : 0;
+	ArgList* stats = ArgList_create(3, ValReal(mean), ValReal(fastest), ValReal(stddev));
+	return ValVec(Vector_new(stats));
 }
-
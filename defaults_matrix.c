@@ -0,0 +1,145 @@
+/*
+  defaults_matrix.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_VECTORS
+
+#include "matrix.h"
+#include <stdbool.h>
+
+#include "defaults.h"
+#include "error.h"
+#include "value.h"
+#include "vector.h"
+#include "context.h"
+#include "arglist.h"
+
+
+static Value* asMatrix(const char* name, Value* val);
+static Value* matrixArg(const char* name, const Context* ctx, const ArgList* arglist);
+
+
+/* Consumes `val`, which must be a matrix or a vector of row vectors */
+static Value* asMatrix(const char* name, Value* val) {
+	if(val->type == VAL_ERR || val->type == VAL_MAT) {
+		return val;
+	}
+	
+	Value* ret;
+	if(val->type == VAL_VEC && val->vec->vals->args[0]->type == VAL_VEC) {
+		ret = Matrix_fromVector(val->vec);
+	}
+	else {
+		ret = ValErr(typeError("Builtin '%s' expects a matrix.", name));
+	}
+	
+	Value_free(val);
+	return ret;
+}
+
+/* Evaluates the only argument as a matrix */
+static Value* matrixArg(const char* name, const Context* ctx, const ArgList* arglist) {
+	if(arglist->count != 1) {
+		return ValErr(builtinArgs(name, 1, arglist->count));
+	}
+	
+	return asMatrix(name, Value_coerce(arglist->args[0], ctx));
+}
+
+Value* eval_mat(const Context* ctx, const ArgList* arglist, bool internal) {
+	if(arglist->count != 1) {
+		return ValErr(builtinArgs("mat", 1, arglist->count));
+	}
+	
+	Value* val = Value_coerce(arglist->args[0], ctx);
+	if(val->type == VAL_ERR || val->type == VAL_MAT) {
+		return val;
+	}
+	
+	Value* ret;
+	if(val->type == VAL_VEC) {
+		/* Either a vector of rows or a single row */
+		ret = Matrix_fromVector(val->vec);
+	}
+	else {
+		ret = ValErr(typeError("Builtin 'mat' expects a vector of vectors."));
+	}
+	
+	Value_free(val);
+	return ret;
+}
+
+Value* eval_transpose(const Context* ctx, const ArgList* arglist, bool internal) {
+	Value* mat = matrixArg("transpose", ctx, arglist);
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	Value* ret = Matrix_transpose(mat->mat);
+	Value_free(mat);
+	return ret;
+}
+
+Value* eval_det(const Context* ctx, const ArgList* arglist, bool internal) {
+	Value* mat = matrixArg("det", ctx, arglist);
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	Value* ret = Matrix_det(mat->mat, ctx);
+	Value_free(mat);
+	return ret;
+}
+
+Value* eval_inv(const Context* ctx, const ArgList* arglist, bool internal) {
+	Value* mat = matrixArg("inv", ctx, arglist);
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	Value* ret = Matrix_inv(mat->mat, ctx);
+	Value_free(mat);
+	return ret;
+}
+
+Value* eval_rank(const Context* ctx, const ArgList* arglist, bool internal) {
+	Value* mat = matrixArg("rank", ctx, arglist);
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	Value* ret = Matrix_rank(mat->mat, ctx);
+	Value_free(mat);
+	return ret;
+}
+
+Value* eval_solve(const Context* ctx, const ArgList* arglist, bool internal) {
+	if(arglist->count != 2) {
+		return ValErr(builtinArgs("solve", 2, arglist->count));
+	}
+	
+	Value* mat = asMatrix("solve", Value_coerce(arglist->args[0], ctx));
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	/* Several right-hand sides can be given as the columns of a matrix */
+	Value* rhs = Value_coerce(arglist->args[1], ctx);
+	if(rhs->type == VAL_VEC && rhs->vec->vals->args[0]->type == VAL_VEC) {
+		rhs = asMatrix("solve", rhs);
+	}
+	
+	if(rhs->type == VAL_ERR) {
+		Value_free(mat);
+		return rhs;
+	}
+	
+	Value* ret = Matrix_solve(mat->mat, rhs, ctx);
+	Value_free(mat);
+	Value_free(rhs);
+	return ret;
+}
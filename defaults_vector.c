@@ -6,9 +6,13 @@
   Copyright (c) 2014 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VECTORS
+
 #include "vector.h"
 #include <stdbool.h>
 
+#include "matrix.h"
+
 #include "error.h"
 #include "value.h"
 #include "context.h"
@@ -17,7 +21,7 @@
 #include "builtin.h"
 #include "template.h"
 
-static Value* eval_dot(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_dot(const Context* ctx, const ArgList* arglist, bool internal) {
 	Value* ret;
 	
 	if(arglist->count != 2) {
@@ -49,7 +53,7 @@ static Value* eval_dot(const Context* ctx, const ArgList* arglist, bool internal
 	return ret;
 }
 
-static Value* eval_cross(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_cross(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 2) {
 		/* Two vectors are required for a cross product */
 		return ValErr(builtinArgs("cross", 2, arglist->count));
@@ -87,7 +91,7 @@ static Value* eval_cross(const Context* ctx, const ArgList* arglist, bool intern
 	return ret;
 }
 
-static Value* eval_map(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_map(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 2) {
 		return ValErr(builtinArgs("map", 2, arglist->count));
 	}
@@ -136,7 +140,7 @@ static Value* eval_map(const Context* ctx, const ArgList* arglist, bool internal
 	return ValVec(Vector_new(mapping));
 }
 
-static Value* eval_elem(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_elem(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 2) {
 		return ValErr(builtinArgs("elem", 2, arglist->count));
 	}
@@ -145,13 +149,18 @@ static Value* eval_elem(const Context* ctx, const ArgList* arglist, bool interna
 	Value* vec = Value_coerce(arglist->args[0], ctx);
 	Value* index = Value_coerce(arglist->args[1], ctx);
 	
-	/* Check vector type */
-	if(vec->type != VAL_VEC) {
-		return ValErr(typeError("Only vectors are subscriptable."));
-	}
-	
 	/* Get actual value */
-	Value* ret = Vector_elem(vec->vec, index, ctx);
+	Value* ret;
+	if(vec->type == VAL_MAT) {
+		/* Picks a row */
+		ret = Matrix_elem(vec->mat, index, ctx);
+	}
+	else if(vec->type == VAL_VEC) {
+		ret = Vector_elem(vec->vec, index, ctx);
+	}
+	else {
+		ret = ValErr(typeError("Only vectors and matrices are subscriptable."));
+	}
 	
 	/* Free allocated memory */
 	Value_free(vec);
@@ -159,7 +168,7 @@ static Value* eval_elem(const Context* ctx, const ArgList* arglist, bool interna
 	return ret;
 }
 
-static Value* eval_mag(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_mag(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 1) {
 		return ValErr(builtinArgs("mag", 1, arglist->count));
 	}
@@ -173,7 +182,7 @@ static Value* eval_mag(const Context* ctx, const ArgList* arglist, bool internal
 	return Vector_magnitude(vec->vec, ctx);
 }
 
-static Value* eval_norm(const Context* ctx, const ArgList* arglist, bool internal) {
+Value* eval_norm(const Context* ctx, const ArgList* arglist, bool internal) {
 	if(arglist->count != 1) {
 		return ValErr(builtinArgs("norm", 1, arglist->count));
 	}
@@ -187,23 +196,3 @@ static Value* eval_norm(const Context* ctx, const ArgList* arglist, bool interna
 	TP(tp);
 	return TP_EVAL(tp, ctx, "@1v/mag(@1v)", Vector_copy(val->vec));
 }
-
-static const char* _vector_names[] = {
-	"dot", "cross", "map",
-	"elem", "mag", "norm"
-};
-static builtin_eval_t _vector_funcs[] = {
-	&eval_dot, &eval_cross, &eval_map,
-	&eval_elem, &eval_mag, &eval_norm
-};
-
-/* This is just a copy of register_math remade for vectors */
-void register_vector(Context* ctx) {
-	unsigned count = ARRSIZE(_vector_names);
-	unsigned i;
-	for(i = 0; i < count; i++) {
-		Builtin* blt = Builtin_new(_vector_names[i], _vector_funcs[i], true);
-		Builtin_register(blt, ctx);
-	}
-}
-
@@ -0,0 +1,426 @@
+/*
+  dtoa.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Shortest round trip formatting of doubles with Grisu3, from Florian Loitsch's
+ "Printing Floating-Point Numbers Quickly and Accurately with Integers". Grisu3
+ knows when it can't prove its digits are the shortest, which happens for about
+ one double in 200. Those are formatted by the C library instead.
+*/
+
+#define MEM_TAG MEM_PRINTING
+
+#include "dtoa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "generic.h"
+
+/* Most digits a shortest representation can need, with room to spare */
+#define DIGITS_MAX 20
+
+/* Scaled values are kept with their binary exponents in this range */
+#define MIN_TARGET_EXP (-60)
+
+/* log10(2) */
+#define D_1_LOG2_10 0.30102999566398114
+
+typedef struct DiyFp {
+	uint64_t f;
+	int e;
+} DiyFp;
+
+typedef struct CachedPower {
+	uint64_t f;
+	short e;
+	short k;
+} CachedPower;
+
+/* 10^k rounded to 64 bits for every eighth k from -348 to 340 */
+static const CachedPower cached_powers[] = {
+	{0xfa8fd5a0081c0288, -1220, -348},
+	{0xbaaee17fa23ebf76, -1193, -340},
+	{0x8b16fb203055ac76, -1166, -332},
+	{0xcf42894a5dce35ea, -1140, -324},
+	{0x9a6bb0aa55653b2d, -1113, -316},
+	{0xe61acf033d1a45df, -1087, -308},
+	{0xab70fe17c79ac6ca, -1060, -300},
+	{0xff77b1fcbebcdc4f, -1034, -292},
+	{0xbe5691ef416bd60c, -1007, -284},
+	{0x8dd01fad907ffc3c,  -980, -276},
+	{0xd3515c2831559a83,  -954, -268},
+	{0x9d71ac8fada6c9b5,  -927, -260},
+	{0xea9c227723ee8bcb,  -901, -252},
+	{0xaecc49914078536d,  -874, -244},
+	{0x823c12795db6ce57,  -847, -236},
+	{0xc21094364dfb5637,  -821, -228},
+	{0x9096ea6f3848984f,  -794, -220},
+	{0xd77485cb25823ac7,  -768, -212},
+	{0xa086cfcd97bf97f4,  -741, -204},
+	{0xef340a98172aace5,  -715, -196},
+	{0xb23867fb2a35b28e,  -688, -188},
+	{0x84c8d4dfd2c63f3b,  -661, -180},
+	{0xc5dd44271ad3cdba,  -635, -172},
+	{0x936b9fcebb25c996,  -608, -164},
+	{0xdbac6c247d62a584,  -582, -156},
+	{0xa3ab66580d5fdaf6,  -555, -148},
+	{0xf3e2f893dec3f126,  -529, -140},
+	{0xb5b5ada8aaff80b8,  -502, -132},
+	{0x87625f056c7c4a8b,  -475, -124},
+	{0xc9bcff6034c13053,  -449, -116},
+	{0x964e858c91ba2655,  -422, -108},
+	{0xdff9772470297ebd,  -396, -100},
+	{0xa6dfbd9fb8e5b88f,  -369,  -92},
+	{0xf8a95fcf88747d94,  -343,  -84},
+	{0xb94470938fa89bcf,  -316,  -76},
+	{0x8a08f0f8bf0f156b,  -289,  -68},
+	{0xcdb02555653131b6,  -263,  -60},
+	{0x993fe2c6d07b7fac,  -236,  -52},
+	{0xe45c10c42a2b3b06,  -210,  -44},
+	{0xaa242499697392d3,  -183,  -36},
+	{0xfd87b5f28300ca0e,  -157,  -28},
+	{0xbce5086492111aeb,  -130,  -20},
+	{0x8cbccc096f5088cc,  -103,  -12},
+	{0xd1b71758e219652c,   -77,   -4},
+	{0x9c40000000000000,   -50,    4},
+	{0xe8d4a51000000000,   -24,   12},
+	{0xad78ebc5ac620000,     3,   20},
+	{0x813f3978f8940984,    30,   28},
+	{0xc097ce7bc90715b3,    56,   36},
+	{0x8f7e32ce7bea5c70,    83,   44},
+	{0xd5d238a4abe98068,   109,   52},
+	{0x9f4f2726179a2245,   136,   60},
+	{0xed63a231d4c4fb27,   162,   68},
+	{0xb0de65388cc8ada8,   189,   76},
+	{0x83c7088e1aab65db,   216,   84},
+	{0xc45d1df942711d9a,   242,   92},
+	{0x924d692ca61be758,   269,  100},
+	{0xda01ee641a708dea,   295,  108},
+	{0xa26da3999aef774a,   322,  116},
+	{0xf209787bb47d6b85,   348,  124},
+	{0xb454e4a179dd1877,   375,  132},
+	{0x865b86925b9bc5c2,   402,  140},
+	{0xc83553c5c8965d3d,   428,  148},
+	{0x952ab45cfa97a0b3,   455,  156},
+	{0xde469fbd99a05fe3,   481,  164},
+	{0xa59bc234db398c25,   508,  172},
+	{0xf6c69a72a3989f5c,   534,  180},
+	{0xb7dcbf5354e9bece,   561,  188},
+	{0x88fcf317f22241e2,   588,  196},
+	{0xcc20ce9bd35c78a5,   614,  204},
+	{0x98165af37b2153df,   641,  212},
+	{0xe2a0b5dc971f303a,   667,  220},
+	{0xa8d9d1535ce3b396,   694,  228},
+	{0xfb9b7cd9a4a7443c,   720,  236},
+	{0xbb764c4ca7a44410,   747,  244},
+	{0x8bab8eefb6409c1a,   774,  252},
+	{0xd01fef10a657842c,   800,  260},
+	{0x9b10a4e5e9913129,   827,  268},
+	{0xe7109bfba19c0c9d,   853,  276},
+	{0xac2820d9623bf429,   880,  284},
+	{0x80444b5e7aa7cf85,   907,  292},
+	{0xbf21e44003acdd2d,   933,  300},
+	{0x8e679c2f5e44ff8f,   960,  308},
+	{0xd433179d9c8cb841,   986,  316},
+	{0x9e19db92b4e31ba9,  1013,  324},
+	{0xeb96bf6ebadf77d9,  1039,  332},
+	{0xaf87023b9bf0ee6b,  1066,  340}
+};
+
+#define CACHED_POWERS_OFFSET 348
+#define CACHED_POWERS_STEP   8
+
+
+static DiyFp multiply(DiyFp x, DiyFp y);
+static DiyFp normalize(DiyFp x);
+static CachedPower cachedPower(int minExp);
+static bool roundWeed(char* digits, int len, uint64_t distTooHighW, uint64_t unsafe, uint64_t rest, uint64_t tenKappa, uint64_t unit);
+static bool digitGen(DiyFp low, DiyFp w, DiyFp high, char* digits, int* len, int* kappa);
+static bool grisu3(double val, char* digits, int* len, int* exp10);
+static int libcDigits(double val, char* digits, int* exp10);
+static int formatDigits(char* buf, bool neg, const char* digits, int len, int exp10);
+
+
+/* The upper 64 bits of the 128-bit product, rounded */
+static DiyFp multiply(DiyFp x, DiyFp y) {
+	uint64_t a = x.f >> 32;
+	uint64_t b = x.f & 0xffffffff;
+	uint64_t c = y.f >> 32;
+	uint64_t d = y.f & 0xffffffff;
+	
+	uint64_t ac = a * c;
+	uint64_t bc = b * c;
+	uint64_t ad = a * d;
+	uint64_t bd = b * d;
+	
+	uint64_t mid = (bd >> 32) + (ad & 0xffffffff) + (bc & 0xffffffff) + (1ULL << 31);
+	DiyFp ret = {ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64};
+	return ret;
+}
+
+static DiyFp normalize(DiyFp x) {
+	while(!(x.f & (1ULL << 63))) {
+		x.f <<= 1;
+		x.e--;
+	}
+	
+	return x;
+}
+
+/* The smallest cached power that scales a number with exponent minExp into range */
+static CachedPower cachedPower(int minExp) {
+	int k = (int)ceil((minExp + 63) * D_1_LOG2_10);
+	int index = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+	return cached_powers[index];
+}
+
+/*
+ Moves the last digit closer to w while it stays inside the unsafe interval,
+ then checks that the result is provably the closest shortest representation.
+ All distances are in units of the scaled values.
+*/
+static bool roundWeed(char* digits, int len, uint64_t distTooHighW, uint64_t unsafe, uint64_t rest, uint64_t tenKappa, uint64_t unit) {
+	uint64_t smallDist = distTooHighW - unit;
+	uint64_t bigDist = distTooHighW + unit;
+	
+	while(rest < smallDist && unsafe - rest >= tenKappa
+	      && (rest + tenKappa < smallDist || smallDist - rest >= rest + tenKappa - smallDist)) {
+		digits[len - 1]--;
+		rest += tenKappa;
+	}
+	
+	if(rest < bigDist && unsafe - rest >= tenKappa
+	   && (rest + tenKappa < bigDist || bigDist - rest > rest + tenKappa - bigDist)) {
+		return false;
+	}
+	
+	return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+/*
+ Generates the fewest digits that land strictly between low and high, which
+ are w's boundaries widened by the error of scaling them. Sets kappa to the
+ power of ten of the first digit that wasn't generated.
+*/
+static bool digitGen(DiyFp low, DiyFp w, DiyFp high, char* digits, int* len, int* kappa) {
+	uint64_t unit = 1;
+	DiyFp tooLow = {low.f - unit, low.e};
+	DiyFp tooHigh = {high.f + unit, high.e};
+	uint64_t unsafe = tooHigh.f - tooLow.f;
+	
+	int shift = -w.e;
+	uint64_t one = 1ULL << shift;
+	uint32_t integrals = (uint32_t)(tooHigh.f >> shift);
+	uint64_t fractionals = tooHigh.f & (one - 1);
+	
+	/* Largest power of ten no bigger than the integral part */
+	uint32_t divisor = 1;
+	*kappa = 1;
+	while(divisor <= integrals / 10) {
+		divisor *= 10;
+		++*kappa;
+	}
+	
+	*len = 0;
+	while(*kappa > 0) {
+		digits[(*len)++] = '0' + integrals / divisor;
+		integrals %= divisor;
+		--*kappa;
+		
+		uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+		if(rest < unsafe) {
+			return roundWeed(digits, *len, tooHigh.f - w.f, unsafe, rest, (uint64_t)divisor << shift, unit);
+		}
+		
+		divisor /= 10;
+	}
+	
+	for(;;) {
+		fractionals *= 10;
+		unit *= 10;
+		unsafe *= 10;
+		
+		digits[(*len)++] = '0' + (int)(fractionals >> shift);
+		fractionals &= one - 1;
+		--*kappa;
+		
+		if(fractionals < unsafe) {
+			return roundWeed(digits, *len, (tooHigh.f - w.f) * unit, unsafe, fractionals, one, unit);
+		}
+	}
+}
+
+/* val must be positive and finite. The digits times 10^exp10 are val */
+static bool grisu3(double val, char* digits, int* len, int* exp10) {
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	
+	int biased = (int)(bits >> 52) & 0x7ff;
+	uint64_t mantissa = bits & ((1ULL << 52) - 1);
+	
+	DiyFp v;
+	if(biased == 0) {
+		/* Subnormal */
+		v.f = mantissa;
+		v.e = -1074;
+	}
+	else {
+		v.f = mantissa | (1ULL << 52);
+		v.e = biased - 1075;
+	}
+	
+	/* Halfway to the neighboring doubles, which is closer below a power of two */
+	DiyFp plus = {(v.f << 1) + 1, v.e - 1};
+	plus = normalize(plus);
+	
+	DiyFp minus;
+	if(mantissa == 0 && biased > 1) {
+		minus.f = (v.f << 2) - 1;
+		minus.e = v.e - 2;
+	}
+	else {
+		minus.f = (v.f << 1) - 1;
+		minus.e = v.e - 1;
+	}
+	
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+	
+	DiyFp w = normalize(v);
+	
+	CachedPower cached = cachedPower(MIN_TARGET_EXP - (w.e + 64));
+	DiyFp c = {cached.f, cached.e};
+	
+	int kappa;
+	bool ret = digitGen(multiply(minus, c), multiply(w, c), multiply(plus, c), digits, len, &kappa);
+	*exp10 = kappa - cached.k;
+	return ret;
+}
+
+/*
+ The C library's digits are exact, but finding the shortest takes a few tries.
+ Rounding to DBL_DIG digits finds any shorter representation there is.
+ Only the digits are taken from the output, so the locale doesn't matter.
+*/
+static int libcDigits(double val, char* digits, int* exp10) {
+	char tmp[DIGITS_MAX + 16];
+	int prec;
+	for(prec = DBL_DIG; ; prec++) {
+		snprintf(tmp, sizeof(tmp), "%.*e", prec - 1, val);
+		
+		/* DBL_DECIMAL_DIG digits always read back */
+		if(prec == DBL_DECIMAL_DIG || strtod(tmp, NULL) == val) {
+			break;
+		}
+	}
+	
+	int len = 0;
+	const char* p;
+	for(p = tmp; *p != 'e'; p++) {
+		if(*p >= '0' && *p <= '9') {
+			digits[len++] = *p;
+		}
+	}
+	
+	while(len > 1 && digits[len - 1] == '0') {
+		len--;
+	}
+	
+	*exp10 = atoi(p + 1) - (len - 1);
+	return len;
+}
+
+/* Lays out the digits like %g would, switching to an exponent at DBL_DIG digits */
+static int formatDigits(char* buf, bool neg, const char* digits, int len, int exp10) {
+	char* p = buf;
+	if(neg) {
+		*p++ = '-';
+	}
+	
+	/* Power of ten of the first digit */
+	int lead = len + exp10 - 1;
+	
+	if(lead < -4 || lead >= DBL_DIG) {
+		*p++ = digits[0];
+		if(len > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, len - 1);
+			p += len - 1;
+		}
+		
+		*p++ = 'e';
+		*p++ = lead < 0 ? '-' : '+';
+		
+		unsigned mag = ABS(lead);
+		if(mag >= 100) {
+			*p++ = '0' + mag / 100;
+		}
+		*p++ = '0' + mag / 10 % 10;
+		*p++ = '0' + mag % 10;
+	}
+	else if(lead < 0) {
+		/* 0.000ddd */
+		*p++ = '0';
+		*p++ = '.';
+		memset(p, '0', -lead - 1);
+		p += -lead - 1;
+		memcpy(p, digits, len);
+		p += len;
+	}
+	else if(lead >= len - 1) {
+		/* ddd000 */
+		memcpy(p, digits, len);
+		p += len;
+		memset(p, '0', lead - (len - 1));
+		p += lead - (len - 1);
+	}
+	else {
+		/* dd.ddd */
+		memcpy(p, digits, lead + 1);
+		p += lead + 1;
+		*p++ = '.';
+		memcpy(p, digits + lead + 1, len - lead - 1);
+		p += len - lead - 1;
+	}
+	
+	*p = '\0';
+	return (int)(p - buf);
+}
+
+
+int formatShortest(char* buf, double val) {
+	if(isnan(val)) {
+		strcpy(buf, "nan");
+		return 3;
+	}
+	
+	bool neg = signbit(val);
+	if(isinf(val)) {
+		strcpy(buf, neg ? "-inf" : "inf");
+		return neg ? 4 : 3;
+	}
+	
+	if(val == 0) {
+		strcpy(buf, neg ? "-0" : "0");
+		return neg ? 2 : 1;
+	}
+	
+	char digits[DIGITS_MAX];
+	int len;
+	int exp10;
+	if(!grisu3(fabs(val), digits, &len, &exp10)) {
+		len = libcDigits(fabs(val), digits, &exp10);
+	}
+	
+	return formatDigits(buf, neg, digits, len, exp10);
+}
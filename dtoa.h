@@ -0,0 +1,23 @@
+/*
+  dtoa.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_DTOA_H_
+#define _SC_DTOA_H_
+
+/* Enough for any double printed by formatShortest, with its terminator */
+#define SHORTEST_MAX 32
+
+/*
+ Writes the shortest decimal that reads back as val and returns its length.
+ The layout follows %g, using an exponent once there would be more than DBL_DIG
+ digits before the point or more than four zeros after it. Never allocates, and
+ always uses '.' whatever the locale.
+*/
+int formatShortest(char* buf, double val);
+
+#endif /* _SC_DTOA_H_ */
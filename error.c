@@ -11,41 +11,251 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include "support.h"
 #include "generic.h"
 
 
-const char* kNullErrStr             = "NULL pointer value.";
-const char* kDivByZeroStr           = "Division by zero.";
-const char* kModByZeroStr           = "Modulus by zero.";
-const char* kVarNotFoundStr         = "No variable named '%s' found.";
-const char* kBadOpTypeStr           = "Bad %s operand type: %d.";
-const char* kBadCharStr             = "Unexpected character: '%c'.";
-const char* kBuiltinArgsStr         = "Builtin '%s' expects %u argument%s, not %u.";
-const char* kBuiltinNotFuncStr      = "Builtin '%s' is not a function.";
-const char* kBadConversionStr       = "One or more arguments to builtin '%s' couldn't be converted to numbers.";
-const char* kEarlyEndStr            = "Premature end of input.";
-const char* kMissingPlaceholderStr  = "Missing placeholder number %z.";
+const char* const kNullErrStr             = "NULL pointer value.";
+const char* const kDivByZeroStr           = "Division by zero.";
+const char* const kModByZeroStr           = "Modulus by zero.";
+const char* const kVarNotFoundStr         = "No variable named '%s' found.";
+const char* const kBadOpTypeStr           = "Bad %s operand type: %d.";
+const char* const kBadCharStr             = "Unexpected character: '%c'.";
+const char* const kBuiltinArgsStr         = "Builtin '%s' expects %u argument%s, not %u.";
+const char* const kBuiltinNotFuncStr      = "Builtin '%s' is not a function.";
+const char* const kBadConversionStr       = "One or more arguments to builtin '%s' couldn't be converted to numbers.";
+const char* const kEarlyEndStr            = "Premature end of input.";
+const char* const kMissingPlaceholderStr  = "Missing placeholder number %u.";
 
-const char* kAllocErrStr            = "Unable to allocate memory.";
-const char* kBadValStr              = "Unexpected value type: %d.";
-const char* kBadVarStr              = "Unexpected variable type: %d.";
+const char* const kAllocErrStr            = "Unable to allocate memory.";
+const char* const kBadValStr              = "Unexpected value type: %d.";
+const char* const kBadVarStr              = "Unexpected variable type: %d.";
 
 
-static const char* error_messages[] = {
+/* Freed errors are kept for reuse, up to this many per thread */
+#define POOL_MAX 32
+
+/* Longest conversion specification kept, such as "%-08.3lld" */
+#define SPEC_MAX 16
+
+typedef enum {
+	ARG_NONE = 0,
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_DOUBLE,
+	ARG_STR,
+	ARG_PTR
+} ARGKIND;
+
+
+/* NULL means stderr, which isn't a constant expression */
+static THREAD_LOCAL FILE* err_stream = NULL;
+static THREAD_LOCAL const char* err_line = NULL;
+static THREAD_LOCAL Error** err_capture = NULL;
+static THREAD_LOCAL bool err_json = false;
+
+static THREAD_LOCAL Error* err_pool = NULL;
+static THREAD_LOCAL unsigned err_pool_size = 0;
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static Error ignore_error = {ERR_IGN, ""};
+
+
+static const char* const status_names[] = {
+	"ok", "math", "syntax", "name", "type", "internal", "unknown"
+};
+
+static const char* const error_prefixes[] = {
 	"",
-	"Math Error: %s\n",
-	"Syntax Error: %s\n",
-	"Fatal Error: %s\n",
-	"Name Error: %s\n",
-	"Type Error: %s\n",
-	"Internal Error: %s\n",
-	"Unknown Error: %s\n"
+	"Math Error: ",
+	"Syntax Error: ",
+	"Fatal Error: ",
+	"Name Error: ",
+	"Type Error: ",
+	"Internal Error: ",
+	"Unknown Error: "
 };
 
 
+static ARGKIND parseSpec(const char** fmt, char* spec);
+static void setString(Error* err, unsigned i, const char* str);
+static void collectArgs(Error* err, const char* fmt, va_list args);
+static Error* takeError(void);
+static void freePool(void* pool);
+static void makePoolKey(void);
+static char* formatMessage(const Error* err, char* buf, size_t size);
+
+
+/*
+ Reads the conversion specification starting at the '%' in *fmt, copying it to
+ spec and advancing past it. Returns ARG_NONE without consuming anything for
+ conversions that aren't supported.
+*/
+static ARGKIND parseSpec(const char** fmt, char* spec) {
+	const char* p = *fmt + 1;
+	p += strspn(p, "-+ #0");
+	p += strspn(p, "0123456789");
+	if(*p == '.') {
+		p++;
+		p += strspn(p, "0123456789");
+	}
+	
+	ARGKIND intKind = ARG_INT;
+	if(p[0] == 'l' && p[1] == 'l') {
+		intKind = ARG_LLONG;
+		p += 2;
+	}
+	else if(*p == 'l') {
+		intKind = ARG_LONG;
+		p++;
+	}
+	else if(*p == 'z') {
+		intKind = ARG_SIZE;
+		p++;
+	}
+	else {
+		/* Shorter types are promoted to int anyway */
+		while(*p == 'h') {
+			p++;
+		}
+	}
+	
+	ARGKIND kind;
+	switch(*p) {
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+			kind = intKind;
+			break;
+		
+		case 'c':
+			kind = ARG_INT;
+			break;
+		
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			kind = ARG_DOUBLE;
+			break;
+		
+		case 's': kind = ARG_STR; break;
+		case 'p': kind = ARG_PTR; break;
+		default:  kind = ARG_NONE; break;
+	}
+	
+	size_t len = p + 1 - *fmt;
+	if(kind == ARG_NONE || len >= SPEC_MAX) {
+		return ARG_NONE;
+	}
+	
+	memcpy(spec, *fmt, len);
+	spec[len] = '\0';
+	*fmt = p + 1;
+	return kind;
+}
+
+/* Copies a string argument into the error, so the caller can free theirs */
+static void setString(Error* err, unsigned i, const char* str) {
+	if(str == NULL) {
+		err->args[i].s = NULL;
+		return;
+	}
+	
+	/* Strings are packed after the ones for earlier arguments */
+	size_t used = 0;
+	unsigned j;
+	for(j = 0; j < i; j++) {
+		const char* prev = err->args[j].s;
+		if(err->kinds[j] == ARG_STR && prev >= err->strs && prev < err->strs + sizeof(err->strs)) {
+			used = prev + strlen(prev) + 1 - err->strs;
+		}
+	}
+	
+	size_t len = strlen(str) + 1;
+	if(len <= sizeof(err->strs) - used) {
+		err->args[i].s = memcpy(err->strs + used, str, len);
+	}
+	else {
+		err->args[i].s = fstrdup(str);
+		err->owned |= 1 << i;
+	}
+}
+
+/* Only collects the arguments, formatting waits until someone looks */
+static void collectArgs(Error* err, const char* fmt, va_list args) {
+	err->fmt = fmt;
+	err->argc = 0;
+	err->owned = 0;
+	
+	char spec[SPEC_MAX];
+	const char* p = fmt;
+	while(err->argc < ERROR_MAX_ARGS && (p = strchr(p, '%')) != NULL) {
+		if(p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		
+		ARGKIND kind = parseSpec(&p, spec);
+		if(kind == ARG_NONE) {
+			break;
+		}
+		
+		unsigned i = err->argc++;
+		err->kinds[i] = kind;
+		switch(kind) {
+			case ARG_INT:    err->args[i].i = va_arg(args, int); break;
+			case ARG_LONG:   err->args[i].l = va_arg(args, long); break;
+			case ARG_LLONG:  err->args[i].ll = va_arg(args, long long); break;
+			case ARG_SIZE:   err->args[i].z = va_arg(args, size_t); break;
+			case ARG_DOUBLE: err->args[i].d = va_arg(args, double); break;
+			case ARG_STR:    setString(err, i, va_arg(args, const char*)); break;
+			case ARG_PTR:    err->args[i].p = va_arg(args, const void*); break;
+			default:         break;
+		}
+	}
+}
+
+static Error* takeError(void) {
+	Error* ret = err_pool;
+	if(ret != NULL) {
+		err_pool = ret->next;
+		err_pool_size--;
+		return ret;
+	}
+	
+	return fmalloc(sizeof(*ret));
+}
+
+/* Runs when a thread that used the pool exits */
+static void freePool(void* pool) {
+	Error** head = pool;
+	while(*head != NULL) {
+		Error* next = (*head)->next;
+		ffree(*head);
+		*head = next;
+	}
+}
+
+static void makePoolKey(void) {
+	pthread_key_create(&pool_key, &freePool);
+}
+
+/* Formats into buf if the message fits, or else into a heap buffer */
+static char* formatMessage(const Error* err, char* buf, size_t size) {
+	size_t len = Error_format(err, buf, size);
+	if(len < size) {
+		return buf;
+	}
+	
+	char* ret = fmalloc(len + 1);
+	Error_format(err, ret, len + 1);
+	return ret;
+}
+
+
 Error* Error_new(ERRTYPE type, const char* fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
@@ -58,43 +268,254 @@ Error* Error_new(ERRTYPE type, const char* fmt, ...) {
 }
 
 Error* Error_vnew(ERRTYPE type, const char* fmt, va_list args) {
-	Error* ret = fmalloc(sizeof(*ret));
+	Error* ret = takeError();
 	ret->type = type;
-	
-	char* tmp;
-	vasprintf(&tmp, fmt, args);
-	
-	asprintf(&ret->msg, error_messages[type], tmp);
-	
-	free(tmp);
-	
+	collectArgs(ret, fmt, args);
 	return ret;
 }
 
+Error* Error_ignore(void) {
+	return &ignore_error;
+}
+
+void Error_freePool(void) {
+	freePool(&err_pool);
+	err_pool_size = 0;
+}
+
 void Error_free(Error* err) {
-	free(err->msg);
-	free(err);
+	if(err == NULL || err == &ignore_error) {
+		return;
+	}
+	
+	unsigned i;
+	for(i = 0; i < err->argc; i++) {
+		if(err->owned & (1 << i)) {
+			ffree((char*)err->args[i].s);
+		}
+	}
+	
+	if(err_pool_size >= POOL_MAX) {
+		ffree(err);
+		return;
+	}
+	
+	/* The first error kept by a thread registers its pool to be freed at exit */
+	if(err_pool_size == 0) {
+		pthread_once(&pool_once, &makePoolKey);
+		if(pthread_getspecific(pool_key) == NULL) {
+			pthread_setspecific(pool_key, &err_pool);
+		}
+	}
+	
+	err->next = err_pool;
+	err_pool = err;
+	err_pool_size++;
 }
 
 Error* Error_copy(const Error* err) {
-	Error* ret = fmalloc(sizeof(*ret));
+	if(err == &ignore_error) {
+		return &ignore_error;
+	}
+	
+	Error* ret = takeError();
+	memcpy(ret, err, offsetof(Error, next));
 	
-	ret->type = err->type;
-	ret->msg = strdup(err->msg);
+	/* Strings have to point into the copy, or to heap copies of its own */
+	unsigned i;
+	for(i = 0; i < ret->argc; i++) {
+		const char* str = err->args[i].s;
+		if(ret->kinds[i] != ARG_STR || str == NULL) {
+			continue;
+		}
+		
+		if(err->owned & (1 << i)) {
+			ret->args[i].s = fstrdup(str);
+		}
+		else {
+			ret->args[i].s = ret->strs + (str - err->strs);
+		}
+	}
 	
 	return ret;
 }
 
+size_t Error_format(const Error* err, char* buf, size_t size) {
+	size_t len = 0;
+	unsigned argi = 0;
+	char spec[SPEC_MAX];
+	const char* p = err->fmt;
+	
+	while(*p != '\0') {
+		/* Copy literal text up to the next conversion, and "%%" as one '%' */
+		size_t run = strcspn(p, "%");
+		if(run == 0 && p[1] == '%') {
+			run = 1;
+			p++;
+		}
+		
+		if(run > 0) {
+			if(len < size) {
+				memcpy(buf + len, p, MIN(run, size - len));
+			}
+			
+			len += run;
+			p += run;
+			continue;
+		}
+		
+		ARGKIND kind = argi < err->argc ? parseSpec(&p, spec) : ARG_NONE;
+		if(kind == ARG_NONE) {
+			/* Anything that wasn't collected is copied as it is */
+			if(len < size) {
+				buf[len] = '%';
+			}
+			
+			len++;
+			p++;
+			continue;
+		}
+		
+		const ErrorArg* arg = &err->args[argi++];
+		char* out = len < size ? buf + len : NULL;
+		size_t room = len < size ? size - len : 0;
+		int n;
+		switch(kind) {
+			case ARG_INT:    n = snprintf(out, room, spec, arg->i); break;
+			case ARG_LONG:   n = snprintf(out, room, spec, arg->l); break;
+			case ARG_LLONG:  n = snprintf(out, room, spec, arg->ll); break;
+			case ARG_SIZE:   n = snprintf(out, room, spec, arg->z); break;
+			case ARG_DOUBLE: n = snprintf(out, room, spec, arg->d); break;
+			case ARG_STR:    n = snprintf(out, room, spec, arg->s); break;
+			case ARG_PTR:    n = snprintf(out, room, spec, arg->p); break;
+			default:         n = 0; break;
+		}
+		
+		len += MAX(n, 0);
+	}
+	
+	if(size > 0) {
+		buf[MIN(len, size - 1)] = '\0';
+	}
+	
+	return len;
+}
+
+FILE* Error_setStream(FILE* fp) {
+	FILE* prev = err_stream ?: stderr;
+	err_stream = fp;
+	return prev;
+}
+
+FILE* Error_stream(void) {
+	return err_stream ?: stderr;
+}
+
+const char* Error_setLine(const char* line) {
+	const char* prev = err_line;
+	err_line = line;
+	return prev;
+}
+
+Error** Error_capture(Error** slot) {
+	Error** prev = err_capture;
+	err_capture = slot;
+	return prev;
+}
+
+bool Error_setJson(bool json) {
+	bool prev = err_json;
+	err_json = json;
+	return prev;
+}
+
+bool Error_jsonMode(void) {
+	return err_json;
+}
+
 void Error_raise(const Error* err, bool forceDeath) {
-	fprintf(stderr, "%s", err->msg);
+	bool fatal = forceDeath || !Error_canRecover(err);
+	
+	if(!fatal && err_capture != NULL) {
+		if(*err_capture == NULL && err->type != ERR_IGN) {
+			*err_capture = Error_copy(err);
+		}
+		return;
+	}
+	
+	if(!fatal && err_json) {
+		if(err->type != ERR_IGN) {
+			StrBuf sb;
+			StrBuf_initFile(&sb, err_stream ?: stderr);
+			StrBuf_append(&sb, "{\"error\":");
+			Error_json(err, &sb);
+			StrBuf_append(&sb, "}\n");
+		}
+		return;
+	}
+	
+	/* Most messages fit on the stack */
+	char stackbuf[256];
+	char* msg = formatMessage(err, stackbuf, sizeof(stackbuf));
+	
+	/* A redirected stream may be a buffer that never gets flushed if we die */
+	if(err->type != ERR_IGN) {
+		fprintf(fatal ? stderr : err_stream ?: stderr, "%s%s\n", error_prefixes[err->type], msg);
+	}
 	
-	if(forceDeath || !Error_canRecover(err)) {
+	if(msg != stackbuf) {
+		ffree(msg);
+	}
+	
+	if(fatal) {
 		/* Useful to set a breakpoint on the next line for debugging */
-		fprintf(stderr, "Crashing line:\n%s", line);
+		fprintf(stderr, "Crashing line:\n%s", err_line ?: "");
 		exit(EXIT_FAILURE);
 	}
 }
 
+SC_STATUS Error_status(const Error* err) {
+	switch(err->type) {
+		case ERR_MATH:     return SC_ERR_MATH;
+		case ERR_SYNTAX:   return SC_ERR_SYNTAX;
+		case ERR_NAME:     return SC_ERR_NAME;
+		case ERR_TYPE:     return SC_ERR_TYPE;
+		case ERR_FATAL:
+		case ERR_INTERNAL: return SC_ERR_INTERNAL;
+		default:           return SC_ERR_UNKNOWN;
+	}
+}
+
+void Error_export(const Error* err, SCError* out) {
+	if(out == NULL) {
+		return;
+	}
+	
+	out->code = Error_status(err);
+	Error_format(err, out->msg, sizeof(out->msg));
+}
+
+void Error_json(const Error* err, StrBuf* sb) {
+	char stackbuf[256];
+	char* msg = formatMessage(err, stackbuf, sizeof(stackbuf));
+	
+	StrBuf_printf(sb, "{\"type\":\"%s\",\"message\":", Error_statusName(Error_status(err)));
+	StrBuf_jsonString(sb, msg);
+	StrBuf_putc(sb, '}');
+	
+	if(msg != stackbuf) {
+		ffree(msg);
+	}
+}
+
+const char* Error_statusName(SC_STATUS status) {
+	if((unsigned)status >= ARRSIZE(status_names)) {
+		return status_names[SC_ERR_UNKNOWN];
+	}
+	
+	return status_names[status];
+}
+
 bool Error_canRecover(const Error* err) {
 	switch(err->type) {
 		case ERR_MATH:
@@ -116,12 +537,15 @@ void die(const char* file, const char* function, int line, const char* fmt, ...)
 	va_list args;
 	va_start(args, fmt);
 	
-	Error* err = Error_vnew(ERR_FATAL, fmt, args);
+	/* Nothing is allocated, since this is how running out of memory is reported */
+	Error err;
+	err.type = ERR_FATAL;
+	collectArgs(&err, fmt, args);
 	
 	va_end(args);
 	
 	fprintf(stderr, "\n\nFile %s in %s on line %d:\n", file, function, line);
-	Error_raise(err, true);
+	Error_raise(&err, true);
 	/* Error_raise will cause the program to die */
 	
 	UNREACHABLE();
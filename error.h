@@ -9,10 +9,13 @@
 #ifndef _SC_ERROR_H_
 #define _SC_ERROR_H_
 
+#include <stdio.h>
 #include <stdbool.h>
 #include <stdarg.h>
 
 #include "support.h"
+#include "libsupercalc.h"
+#include "strbuf.h"
 
 typedef struct Error Error;
 
@@ -27,9 +30,38 @@ typedef enum {
 	ERR_UNK
 } ERRTYPE;
 
+/* Most messages take one or two arguments */
+#define ERROR_MAX_ARGS 4
+
+/* String arguments are copied here, or to the heap if they don't fit */
+#define ERROR_STR_SPACE 96
+
+typedef union {
+	int i;
+	long l;
+	long long ll;
+	size_t z;
+	double d;
+	const char* s;
+	const void* p;
+} ErrorArg;
+
+/*
+ The message isn't formatted until the error is printed or exported. Until
+ then, an error is just its format string and the arguments collected for it.
+ Format strings must outlive the error, so they should be literals or one of
+ the constants below. Conversions may use flags, a width, a precision and the
+ length modifiers h, hh, l, ll and z, but not '*'.
+*/
 struct Error {
 	ERRTYPE type;
-	char* msg;
+	const char* fmt;
+	unsigned char argc;
+	unsigned char kinds[ERROR_MAX_ARGS];
+	unsigned char owned;
+	ErrorArg args[ERROR_MAX_ARGS];
+	char strs[ERROR_STR_SPACE];
+	Error* next;
 };
 
 
@@ -45,7 +77,7 @@ struct Error {
 } while(0)
 
 /* Convenience constructors */
-#define ignoreError()               Error_new(ERR_IGN, "")
+#define ignoreError()               Error_ignore()
 #define mathError(...)              Error_new(ERR_MATH, __VA_ARGS__)
 #define syntaxError(...)            Error_new(ERR_SYNTAX, __VA_ARGS__)
 #define fatalError(...)             Error_new(ERR_FATAL, __VA_ARGS__)
@@ -54,21 +86,21 @@ struct Error {
 #define internalError(...)          Error_new(ERR_INTERNAL, __VA_ARGS__)
 #define unknownError(...)           Error_new(ERR_UNK, __VA_ARGS__)
 
-extern const char* kNullErrStr;
-extern const char* kDivByZeroStr;
-extern const char* kModByZeroStr;
-extern const char* kVarNotFoundStr;
-extern const char* kBadOpTypeStr;
-extern const char* kBadCharStr;
-extern const char* kBuiltinArgsStr;
-extern const char* kBuiltinNotFuncStr;
-extern const char* kBadConversionStr;
-extern const char* kEarlyEndStr;
-extern const char* kMissingPlaceholderStr;
-
-extern const char* kAllocErrStr;
-extern const char* kBadValStr;
-extern const char* kBadVarStr;
+extern const char* const kNullErrStr;
+extern const char* const kDivByZeroStr;
+extern const char* const kModByZeroStr;
+extern const char* const kVarNotFoundStr;
+extern const char* const kBadOpTypeStr;
+extern const char* const kBadCharStr;
+extern const char* const kBuiltinArgsStr;
+extern const char* const kBuiltinNotFuncStr;
+extern const char* const kBadConversionStr;
+extern const char* const kEarlyEndStr;
+extern const char* const kMissingPlaceholderStr;
+
+extern const char* const kAllocErrStr;
+extern const char* const kBadValStr;
+extern const char* const kBadVarStr;
 
 #define nullError()                 unknownError(kNullErrStr)
 #define zeroDivError()              mathError(kDivByZeroStr)
@@ -92,15 +124,61 @@ extern const char* kBadVarStr;
 Error* Error_new(ERRTYPE type, const char* fmt, ...);
 Error* Error_vnew(ERRTYPE type, const char* fmt, va_list args);
 
+/* Shared error meaning the problem was already reported. Never allocates */
+Error* Error_ignore(void);
+
 /* Destructor */
 void Error_free(Error* err);
 
+/* Frees the errors this thread keeps for reuse. Other threads do this when they exit */
+void Error_freePool(void);
+
 /* Copying */
 Error* Error_copy(const Error* err);
 
 /* Printing and maybe a side of suicide */
 void Error_raise(const Error* err, bool forceDeath);
 
+/*
+ Errors are printed to a per-thread stream, which defaults to stderr.
+ Returns the previous stream so callers can restore it.
+*/
+FILE* Error_setStream(FILE* fp);
+FILE* Error_stream(void);
+
+/* Per-thread source line shown when a fatal error crashes. Returns the previous one */
+const char* Error_setLine(const char* line);
+
+/*
+ While a capture slot is set, recoverable errors raised on this thread are
+ stored in it instead of being printed. Only the first one is kept, so the
+ slot should start out NULL. Returns the previous slot.
+*/
+Error** Error_capture(Error** slot);
+
+/*
+ While set, recoverable errors raised on this thread are printed as a line of
+ {"error":{"type":...,"message":...}} instead of text. Returns the previous setting.
+*/
+bool Error_setJson(bool json);
+bool Error_jsonMode(void);
+
+/*
+ Formats the message without its "Math Error: " prefix, like snprintf. Returns
+ the length of the whole message even when it was truncated.
+*/
+size_t Error_format(const Error* err, char* buf, size_t size);
+
+/* Conversion to the library's structured errors */
+SC_STATUS Error_status(const Error* err);
+void Error_export(const Error* err, SCError* out);
+
+/* Writes {"type":"math","message":"..."} */
+void Error_json(const Error* err, StrBuf* sb);
+
+/* Lowercase name of a status, like "math" */
+const char* Error_statusName(SC_STATUS status);
+
 /* Fatal or not? */
 bool Error_canRecover(const Error* err);
 
@@ -1,17 +1,18 @@
 /*
  fraction.c
  SuperCalc
- 
+
  Created by C0deH4cker on 10/21/13.
  Copyright (c) 2013 C0deH4cker. All rights reserved.
  */
 
+#define MEM_TAG MEM_FRACTIONS
+
 #include "fraction.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <float.h>
 
 #include "support.h"
 #include "error.h"
@@ -46,7 +47,7 @@ Fraction* Fraction_new(long long numerator, long long denominator) {
 }
 
 void Fraction_free(Fraction* frac) {
-	free(frac);
+	ffree(frac);
 }
 
 Fraction* Fraction_copy(const Fraction* frac) {
@@ -89,18 +90,18 @@ Value* Fraction_add(const Fraction* a, const Value* b) {
 		case VAL_FRAC:
 			ret = fracAdd(a, b->frac);
 			break;
-			
+		
 		case VAL_INT:
 			n = a->n + b->ival * a->d;
 			d = a->d;
 			
 			ret = ValFrac(Fraction_new(n, d));
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(Fraction_asReal(a) + b->rval);
 			break;
-			
+		
 		default:
 			badValType(b->type);
 	}
@@ -123,18 +124,18 @@ Value* Fraction_sub(const Fraction* a, const Value* b) {
 		case VAL_FRAC:
 			ret = fracSub(a, b->frac);
 			break;
-			
+		
 		case VAL_INT:
 			n = a->n - b->ival * a->d;
 			d = a->d;
 			
 			ret = ValFrac(Fraction_new(n, d));
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(Fraction_asReal(a) - b->rval);
 			break;
-			
+		
 		default:
 			badValType(b->type);
 			break;
@@ -158,18 +159,18 @@ Value* Fraction_mul(const Fraction* a, const Value* b) {
 		case VAL_FRAC:
 			ret = fracMul(a, b->frac);
 			break;
-			
+		
 		case VAL_INT:
 			n = a->n * b->ival;
 			d = a->d;
 			
 			ret = ValFrac(Fraction_new(n, d));
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(Fraction_asReal(a) * b->rval);
 			break;
-			
+		
 		default:
 			badValType(b->type);
 			break;
@@ -193,18 +194,18 @@ Value* Fraction_div(const Fraction* a, const Value* b) {
 		case VAL_FRAC:
 			ret = fracDiv(a, b->frac);
 			break;
-			
+		
 		case VAL_INT:
 			n = a->n;
 			d = a->d * b->ival;
 			
 			ret = ValFrac(Fraction_new(n, d));
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(Fraction_asReal(a) / b->rval);
 			break;
-			
+		
 		default:
 			badValType(b->type);
 			break;
@@ -255,17 +256,17 @@ Value* Fraction_mod(const Fraction* a, const Value* b) {
 			case VAL_FRAC:
 				ret = fracMod(a, b->frac);
 				break;
-				
+			
 			case VAL_INT:
 				f = Fraction_new(b->ival, 1);
 				ret = fracMod(a, f);
 				Fraction_free(f);
 				break;
-				
+			
 			case VAL_REAL:
 				ret = ValReal(fmod(Fraction_asReal(a), b->rval));
 				break;
-				
+			
 			default:
 				badValType(b->type);
 				break;
@@ -436,12 +437,13 @@ static Value* fracPow(const Fraction* base, const Fraction* exp) {
 										));
 			}
 #else
+			Value_free(coef);
 			ret = ValReal(pow(Fraction_asReal(base), Fraction_asReal(exp)));
 #endif
 		}
 		
-		free(n_primes);
-		free(d_primes);
+		ffree(n_primes);
+		ffree(d_primes);
 	}
 	
 	return ret;
@@ -455,7 +457,7 @@ Value* Fraction_pow(const Fraction* base, const Value* exp) {
 		case VAL_FRAC:
 			ret = fracPow(base, exp->frac);
 			break;
-			
+		
 		case VAL_INT:
 			/* (a/b)^-c is same as (b/a)^c */
 			if(exp->ival < 0) {
@@ -469,11 +471,11 @@ Value* Fraction_pow(const Fraction* base, const Value* exp) {
 			
 			ret = ValFrac(Fraction_new(n, d));
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(pow(Fraction_asReal(base), exp->rval));
 			break;
-			
+		
 		default:
 			badValType(exp->type);
 			break;
@@ -491,18 +493,18 @@ Value* Fraction_rpow(const Fraction* exp, const Value* base) {
 			/* Shouldn't happen, but easy to add */
 			ret = fracPow(base->frac, exp);
 			break;
-			
+		
 		case VAL_INT:
 			/* a^(b/c) */
 			fbase = Fraction_new(base->ival, 1);
 			ret = fracPow(fbase, exp);
 			Fraction_free(fbase);
 			break;
-			
+		
 		case VAL_REAL:
 			ret = ValReal(pow(base->rval, Fraction_asReal(exp)));
 			break;
-			
+		
 		default:
 			badValType(base->type);
 			break;
@@ -548,35 +550,41 @@ double Fraction_asReal(const Fraction* frac) {
 	return (double)frac->n / (double)frac->d;
 }
 
-char* Fraction_repr(const Fraction* f, bool approx) {
-	char* ret;
-	
+void Fraction_repr(const Fraction* f, StrBuf* sb, bool approx) {
 	if(approx) {
-		asprintf(&ret, "%lld/%lld (%.*g)", f->n, f->d, DBL_DIG, Fraction_asReal(f));
+		StrBuf_printf(sb, "%lld/%lld (", f->n, f->d);
+		StrBuf_real(sb, Fraction_asReal(f));
+		StrBuf_putc(sb, ')');
 	}
 	else {
-		asprintf(&ret, "%lld/%lld", f->n, f->d);
+		StrBuf_printf(sb, "%lld/%lld", f->n, f->d);
 	}
-	
-	return ret;
 }
 
-char* Fraction_xml(const Fraction* f) {
+void Fraction_xml(const Fraction* f, StrBuf* sb) {
 	/*
 	 sc> a = -42/1337
 	 -6/191
 	 sc> ?x a
-	 
+	
 	 <vardata name="a">
 	   <frac numerator="-6" denominator="191"/>
 	 </vardata>
-	 
+	
 	 -6/191
 	*/
-	char* ret;
-	asprintf(&ret,
-			 "<frac numerator=\"%lld\" denominator=\"%lld\"/>",
-			 f->n, f->d);
-	return ret;
+	StrBuf_printf(sb,
+				  "<frac numerator=\"%lld\" denominator=\"%lld\"/>",
+				  f->n, f->d);
+}
+
+void Fraction_json(const Fraction* f, StrBuf* sb) {
+	/*
+	 sc> ?j 4/49
+	 {"result":{"num":4,"den":49,"approx":0.08163265306122448}}
+	*/
+	StrBuf_printf(sb, "{\"num\":%lld,\"den\":%lld,\"approx\":", f->n, f->d);
+	StrBuf_jsonReal(sb, Fraction_asReal(f));
+	StrBuf_putc(sb, '}');
 }
 
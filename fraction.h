@@ -46,7 +46,8 @@ Value* Fraction_cmp(const Fraction* a, const Value* b);
 double Fraction_asReal(const Fraction* frac);
 
 /* Printing */
-char* Fraction_repr(const Fraction* frac, bool approx);
-char* Fraction_xml(const Fraction* frac);
+void Fraction_repr(const Fraction* frac, StrBuf* sb, bool approx);
+void Fraction_xml(const Fraction* frac, StrBuf* sb);
+void Fraction_json(const Fraction* frac, StrBuf* sb);
 
 #endif
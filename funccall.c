@@ -1,11 +1,13 @@
 /*
  funccall.c
  SuperCalc
- 
+
  Created by C0deH4cker on 11/7/13.
  Copyright (c) 2013 C0deH4cker. All rights reserved.
  */
 
+#define MEM_TAG MEM_VALUES
+
 #include "funccall.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -22,13 +24,15 @@
 #include "function.h"
 #include "builtin.h"
 #include "binop.h"
+#include "trace.h"
+#include "profile.h"
 
 
 static Value* callVar(const Context* ctx, const char* name, const ArgList* args);
-static char* reprFunc(const char* name, const ArgList* arglist, bool pretty);
-static char* specialRepr(const char* name, const ArgList* arglist, bool pretty);
-static char* verboseFunc(const char* name, const ArgList* arglist, unsigned indent);
-static char* specialVerbose(const char* name, const ArgList* arglist, unsigned indent);
+static void reprArgs(const ArgList* arglist, StrBuf* sb, bool pretty);
+static void specialRepr(const char* name, const ArgList* arglist, StrBuf* sb, bool pretty);
+static void verboseArgs(const ArgList* arglist, StrBuf* sb, unsigned indent);
+static void specialVerbose(const char* name, const ArgList* arglist, StrBuf* sb, unsigned indent);
 
 
 FuncCall* FuncCall_new(Value* func, ArgList* arglist) {
@@ -48,7 +52,7 @@ FuncCall* FuncCall_create(const char* name, ArgList* arglist) {
 void FuncCall_free(FuncCall* call) {
 	Value_free(call->func);
 	ArgList_free(call->arglist);
-	free(call);
+	ffree(call);
 }
 
 FuncCall* FuncCall_copy(const FuncCall* call) {
@@ -64,7 +68,7 @@ static Value* callVar(const Context* ctx, const char* name, const ArgList* args)
 		name++;
 	}
 	
-	Variable* var = Variable_get(ctx, name);
+	const Variable* var = Variable_get(ctx, name);
 	if(var == NULL) {
 		return ValErr(varNotFound(name));
 	}
@@ -86,9 +90,16 @@ static Value* callVar(const Context* ctx, const char* name, const ArgList* args)
 			
 			break;
 		
-		case VAR_FUNC:
+		case VAR_FUNC: {
+			/* Functions don't know their own names, so they're traced and profiled here */
+			ProfileFrame frame;
+			TRACE_BEGIN(TRACE_FUNCTION, name, args->count);
+			PROFILE_ENTER(&frame, name, false);
 			ret = Function_eval(var->func, ctx, args);
+			PROFILE_EXIT(&frame);
+			TRACE_END(TRACE_FUNCTION);
 			break;
+		}
 		
 		case VAR_ERR:
 			/* Shouldn't be reached... */
@@ -128,13 +139,18 @@ Value* FuncCall_eval(const FuncCall* call, const Context* ctx) {
 		case VAL_INT:
 		case VAL_REAL:
 		case VAL_FRAC:
-		case VAL_VEC: {
-			char* repr = Value_repr(call->func, false, false);
+		case VAL_VEC:
+		case VAL_MAT: {
+			StrBuf sb;
+			StrBuf_init(&sb);
+			Value_repr(call->func, &sb, false, false);
+			
+			char* repr = StrBuf_finish(&sb);
 			ret = ValErr(typeError("Value %s is not a callable.", repr));
-			free(repr);
+			ffree(repr);
 			break;
 		}
-			
+		
 		default:
 			badValType(func->type);
 	}
@@ -143,20 +159,14 @@ Value* FuncCall_eval(const FuncCall* call, const Context* ctx) {
 	return ret;
 }
 
-static char* reprFunc(const char* name, const ArgList* arglist, bool pretty) {
-	char* ret;
-	char* argstr = ArgList_repr(arglist, pretty);
-	const char* disp = pretty ? getPretty(name) : name;
-	
-	asprintf(&ret, "%s(%s)", disp, argstr);
-	
-	free(argstr);
-	return ret;
+/* Prints the parenthesized arguments after the callee */
+static void reprArgs(const ArgList* arglist, StrBuf* sb, bool pretty) {
+	StrBuf_putc(sb, '(');
+	ArgList_repr(arglist, sb, pretty);
+	StrBuf_putc(sb, ')');
 }
 
-static char* specialRepr(const char* name, const ArgList* arglist, bool pretty) {
-	char* ret;
-	
+static void specialRepr(const char* name, const ArgList* arglist, StrBuf* sb, bool pretty) {
 	/* TODO: Consider removing special printing for abs in repr */
 	if(strcmp(name, "abs") == 0) {
 		if(arglist->count != 1) {
@@ -164,9 +174,9 @@ static char* specialRepr(const char* name, const ArgList* arglist, bool pretty)
 			RAISE(internalError("More than one argument passed to internal call of abs"), true);
 		}
 		
-		char* args = ArgList_repr(arglist, pretty);
-		asprintf(&ret, "|%s|", args);
-		free(args);
+		StrBuf_putc(sb, '|');
+		ArgList_repr(arglist, sb, pretty);
+		StrBuf_putc(sb, '|');
 	}
 	else if(strcmp(name, "elem") == 0) {
 		if(arglist->count != 2) {
@@ -174,75 +184,55 @@ static char* specialRepr(const char* name, const ArgList* arglist, bool pretty)
 			RAISE(internalError("Invalid argument count passed to internal call of elem"), true);
 		}
 		
-		char* vec = Value_repr(arglist->args[0], pretty, false);
-		char* index = Value_repr(arglist->args[1], pretty, false);
-		
-		asprintf(&ret, "%s[%s]", vec, index);
-		
-		free(index);
-		free(vec);
+		Value_repr(arglist->args[0], sb, pretty, false);
+		StrBuf_putc(sb, '[');
+		Value_repr(arglist->args[1], sb, pretty, false);
+		StrBuf_putc(sb, ']');
 	}
 	else {
 		/* Just default to printing the function */
-		ret = reprFunc(name, arglist, pretty);
+		StrBuf_append(sb, pretty ? getPretty(name) : name);
+		reprArgs(arglist, sb, pretty);
 	}
-	
-	return ret;
 }
 
-char* FuncCall_repr(const FuncCall* call, bool pretty) {
+void FuncCall_repr(const FuncCall* call, StrBuf* sb, bool pretty) {
 	if(call->func->type == VAL_VAR && call->func->name[0] == '@') {
 		/* Internal call */
-		return specialRepr(call->func->name + 1, call->arglist, pretty);
+		specialRepr(call->func->name + 1, call->arglist, sb, pretty);
+		return;
 	}
 	
-	char* callable = Value_repr(call->func, pretty, false);
-	char* ret = reprFunc(callable, call->arglist, pretty);
-	
-	free(callable);
-	return ret;
+	Value_repr(call->func, sb, pretty, false);
+	reprArgs(call->arglist, sb, pretty);
 }
 
-char* FuncCall_wrap(const FuncCall* call) {
-	char* ret;
-	char* callable = Value_wrap(call->func, false);
-	char* argstr = ArgList_wrap(call->arglist);
-	
-	asprintf(&ret, "%s(%s)", callable, argstr);
-	
-	free(argstr);
-	free(callable);
-	return ret;
+void FuncCall_wrap(const FuncCall* call, StrBuf* sb) {
+	Value_wrap(call->func, sb, false);
+	StrBuf_putc(sb, '(');
+	ArgList_wrap(call->arglist, sb);
+	StrBuf_putc(sb, ')');
 }
 
-static char* verboseFunc(const char* name, const ArgList* arglist, unsigned indent) {
-	char* ret;
-	char* args = ArgList_verbose(arglist, indent + 1);
-	
-	asprintf(&ret,
-			 "%3$s(\n"        /* name */
-				 "%2$s%4$s\n" /* args */
-			 "%1$s)",
-			 indentation(indent), indentation(indent + 1),
-			 name,
-			 args);
-	
-	free(args);
-	return ret;
+/* Prints the arguments on their own lines after the callee */
+static void verboseArgs(const ArgList* arglist, StrBuf* sb, unsigned indent) {
+	StrBuf_putc(sb, '(');
+	StrBuf_newline(sb, indent + 1);
+	ArgList_verbose(arglist, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_putc(sb, ')');
 }
 
-static char* specialVerbose(const char* name, const ArgList* arglist, unsigned indent) {
-	char* ret;
-	
+static void specialVerbose(const char* name, const ArgList* arglist, StrBuf* sb, unsigned indent) {
 	if(strcmp(name, "abs") == 0) {
 		if(arglist->count != 1) {
 			/* Shouldn't ever happen */
 			RAISE(internalError("More than one argument passed to internal call of abs"), true);
 		}
 		
-		char* args = ArgList_verbose(arglist, indent + 1);
-		asprintf(&ret, "|%s|", args);
-		free(args);
+		StrBuf_putc(sb, '|');
+		ArgList_verbose(arglist, sb, indent + 1);
+		StrBuf_putc(sb, '|');
 	}
 	else if(strcmp(name, "elem") == 0) {
 		if(arglist->count != 2) {
@@ -250,44 +240,35 @@ static char* specialVerbose(const char* name, const ArgList* arglist, unsigned i
 			RAISE(internalError("Invalid argument count passed to internal call of elem"), true);
 		}
 		
-		char* vec = Value_verbose(arglist->args[0], indent);
-		char* index = Value_verbose(arglist->args[1], indent + 1);
-		
-		asprintf(&ret,
-				 "%3$s[\n"
-					 "%2$s%4$s\n"
-				 "%1$s]",
-				 indentation(indent), indentation(indent + 1),
-				 vec, index);
-		
-		free(index);
-		free(vec);
+		Value_verbose(arglist->args[0], sb, indent);
+		StrBuf_putc(sb, '[');
+		StrBuf_newline(sb, indent + 1);
+		Value_verbose(arglist->args[1], sb, indent + 1);
+		StrBuf_newline(sb, indent);
+		StrBuf_putc(sb, ']');
 	}
 	else {
 		/* Just default to printing the function */
-		ret = verboseFunc(name, arglist, indent);
+		StrBuf_append(sb, name);
+		verboseArgs(arglist, sb, indent);
 	}
-	
-	return ret;
 }
 
-char* FuncCall_verbose(const FuncCall* call, unsigned indent) {
+void FuncCall_verbose(const FuncCall* call, StrBuf* sb, unsigned indent) {
 	if(call->func->type == VAL_VAR && call->func->name[0] == '@') {
 		/* Internal call */
-		return specialVerbose(&call->func->name[1], call->arglist, indent);
+		specialVerbose(&call->func->name[1], call->arglist, sb, indent);
+		return;
 	}
 	
-	char* callable = Value_verbose(call->func, indent);
-	char* ret = verboseFunc(callable, call->arglist, indent);
-	
-	free(callable);
-	return ret;
+	Value_verbose(call->func, sb, indent);
+	verboseArgs(call->arglist, sb, indent);
 }
 
-char* FuncCall_xml(const FuncCall* call, unsigned indent) {
+void FuncCall_xml(const FuncCall* call, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x atan2(4, 1 + 2)
-	 
+	
 	 <call>
 	   <callee>
 	     <var name="atan2"/>
@@ -300,41 +281,42 @@ char* FuncCall_xml(const FuncCall* call, unsigned indent) {
 	     </add>
 	   </args>
 	 </call>
-	 
+	
 	 0.927295218001612
 	*/
-	char* ret;
-	char* callee = Value_xml(call->func, indent + 2);
+	StrBuf_append(sb, "<call>");
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "<callee>");
+	StrBuf_newline(sb, indent + 2);
+	Value_xml(call->func, sb, indent + 2);
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "</callee>");
+	StrBuf_newline(sb, indent + 1);
 	
 	if(call->arglist->count > 0) {
-		char* args = ArgList_xml(call->arglist, indent + 2);
-		asprintf(&ret,
-				 "<call>\n"
-					 "%2$s<callee>\n"
-						 "%3$s%4$s\n" /* func */
-					 "%2$s</callee>\n"
-					 "%2$s<args>\n"
-						 "%5$s\n" /* args */
-					 "%2$s</args>\n"
-				 "%1$s</call>",
-				 indentation(indent), indentation(indent + 1), indentation(indent + 2),
-				 callee,
-				 args);
-		free(args);
+		StrBuf_append(sb, "<args>\n");
+		ArgList_xml(call->arglist, sb, indent + 2);
+		StrBuf_newline(sb, indent + 1);
+		StrBuf_append(sb, "</args>");
 	}
 	else {
-		asprintf(&ret,
-				 "<call>\n"
-					 "%2$s<callee>\n"
-						 "%3$s%4$s\n" /* func */
-					 "%2$s</callee>\n"
-					 "%2$s<args/>\n"
-				 "%1$s</call>",
-				 indentation(indent), indentation(indent + 1), indentation(indent + 2),
-				 callee);
+		StrBuf_append(sb, "<args/>");
 	}
 	
-	free(callee);
-	return ret;
+	StrBuf_newline(sb, indent);
+	StrBuf_append(sb, "</call>");
+}
+
+void FuncCall_json(const FuncCall* call, StrBuf* sb) {
+	/*
+	 sc> ?jt atan2(4, 1 + 2)
+	 {"tree":{"call":{"var":"atan2"},"args":[4,{"op":"add","a":1,"b":2}]}}
+	 {"result":0.9272952180016122}
+	*/
+	StrBuf_append(sb, "{\"call\":");
+	Value_json(call->func, sb);
+	StrBuf_append(sb, ",\"args\":");
+	ArgList_json(call->arglist, sb);
+	StrBuf_putc(sb, '}');
 }
 
@@ -40,9 +40,10 @@ FuncCall* FuncCall_copy(const FuncCall* call);
 Value* FuncCall_eval(const FuncCall* call, const Context* ctx);
 
 /* Printing */
-char* FuncCall_repr(const FuncCall* call, bool pretty);
-char* FuncCall_wrap(const FuncCall* call);
-char* FuncCall_verbose(const FuncCall* call, unsigned indent);
-char* FuncCall_xml(const FuncCall* call, unsigned indent);
+void FuncCall_repr(const FuncCall* call, StrBuf* sb, bool pretty);
+void FuncCall_wrap(const FuncCall* call, StrBuf* sb);
+void FuncCall_verbose(const FuncCall* call, StrBuf* sb, unsigned indent);
+void FuncCall_xml(const FuncCall* call, StrBuf* sb, unsigned indent);
+void FuncCall_json(const FuncCall* call, StrBuf* sb);
 
 #endif
@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "function.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -19,9 +21,11 @@
 #include "value.h"
 #include "arglist.h"
 #include "variable.h"
+#include "stats.h"
 
 
-static char* argsToString(const Function* func);
+static void argsRepr(const Function* func, StrBuf* sb);
+static void argsXml(const Function* func, StrBuf* sb, unsigned indent);
 
 
 Function* Function_new(unsigned argcount, char** argnames, Value* body) {
@@ -37,26 +41,28 @@ Function* Function_new(unsigned argcount, char** argnames, Value* body) {
 void Function_free(Function* func) {
 	unsigned i;
 	for(i = 0; i < func->argcount; i++) {
-		free(func->argnames[i]);
+		ffree(func->argnames[i]);
 	}
-	free(func->argnames);
+	ffree(func->argnames);
 	
 	Value_free(func->body);
 	
-	free(func);
+	ffree(func);
 }
 
 Function* Function_copy(const Function* func) {
 	char** argsCopy = fmalloc(func->argcount * sizeof(*argsCopy));
 	unsigned i;
 	for(i = 0; i < func->argcount; i++) {
-		argsCopy[i] = strdup(func->argnames[i]);
+		argsCopy[i] = fstrdup(func->argnames[i]);
 	}
 	
 	return Function_new(func->argcount, argsCopy, Value_copy(func->body));
 }
 
 Value* Function_eval(const Function* func, const Context* ctx, const ArgList* arglist) {
+	STAT_INC(funcCalls);
+	
 	if(func->argcount != arglist->count) {
 		return ValErr(typeError("Function expects %u argument%s, not %u.", func->argcount, func->argcount == 1 ? "" : "s", arglist->count));
 	}
@@ -72,10 +78,10 @@ Value* Function_eval(const Function* func, const Context* ctx, const ArgList* ar
 	for(i = 0; i < evaluated->count; i++) {
 		Value* val = Value_copy(evaluated->args[i]);
 		Variable* arg;
-		char* argname = strdup(func->argnames[i]);
+		char* argname = fstrdup(func->argnames[i]);
 		
 		if(val->type == VAL_VAR) {
-			Variable* var = Variable_getAbove(frame, val->name);
+			const Variable* var = Variable_getAbove(frame, val->name);
 			
 			switch(var->type) {
 				case VAR_VALUE:
@@ -93,9 +99,11 @@ Value* Function_eval(const Function* func, const Context* ctx, const ArgList* ar
 				default:
 					badVarType(var->type);
 			}
+			
+			Value_free(val);
 		}
 		else {
-			arg = VarValue(argname, Value_copy(val));
+			arg = VarValue(argname, val);
 		}
 		
 		Context_addLocal(frame, arg);
@@ -110,93 +118,55 @@ Value* Function_eval(const Function* func, const Context* ctx, const ArgList* ar
 	return ret;
 }
 
-static char* argsToString(const Function* func) {
-	char* ret = NULL;
+static void argsRepr(const Function* func, StrBuf* sb) {
 	unsigned i;
 	for(i = 0; i < func->argcount; i++) {
-		if(i == 0) {
-			asprintf(&ret, "%s", func->argnames[i]);
-		}
-		else {
-			char* tmp;
-			asprintf(&tmp, "%s, %s", ret, func->argnames[i]);
-			free(ret);
-			ret = tmp;
+		if(i > 0) {
+			StrBuf_append(sb, ", ");
 		}
+		
+		StrBuf_append(sb, func->argnames[i]);
 	}
-	
-	return ret;
 }
 
-char* Function_repr(const Function* func, bool pretty) {
-	char* ret;
-	char* args = argsToString(func);
-	char* body = Value_repr(func->body, pretty, false);
-	
-	asprintf(&ret, "(%s) = %s", args ?: "", body);
-	
-	free(body);
-	free(args);
-	return ret;
+void Function_repr(const Function* func, StrBuf* sb, bool pretty) {
+	StrBuf_putc(sb, '(');
+	argsRepr(func, sb);
+	StrBuf_append(sb, ") = ");
+	Value_repr(func->body, sb, pretty, false);
 }
 
-char* Function_wrap(const Function* func) {
-	char* ret;
-	char* args = argsToString(func);
-	char* body = Value_wrap(func->body, false);
-	
-	asprintf(&ret, "(%s) = %s", args ?: "", body);
-	
-	free(body);
-	free(args);
-	return ret;
+void Function_wrap(const Function* func, StrBuf* sb) {
+	StrBuf_putc(sb, '(');
+	argsRepr(func, sb);
+	StrBuf_append(sb, ") = ");
+	Value_wrap(func->body, sb, false);
 }
 
-char* Function_verbose(const Function* func) {
-	char* ret;
-	char* args = argsToString(func);
-	char* body = Value_verbose(func->body, 1);
-	
-	asprintf(&ret,
-			 "(%s) {\n"
-				 "%s%s\n"
-			 "}",
-			 args ?: "",
-			 indentation(1), body);
-	
-	free(body);
-	free(args);
-	return ret;
+void Function_verbose(const Function* func, StrBuf* sb) {
+	StrBuf_putc(sb, '(');
+	argsRepr(func, sb);
+	StrBuf_append(sb, ") {");
+	StrBuf_newline(sb, 1);
+	Value_verbose(func->body, sb, 1);
+	StrBuf_append(sb, "\n}");
 }
 
-static char* argsXml(const Function* func, unsigned indent) {
-	char* ret = NULL;
-	
+static void argsXml(const Function* func, StrBuf* sb, unsigned indent) {
 	unsigned i;
 	for(i = 0; i < func->argcount; i++) {
-		if(i == 0) {
-			asprintf(&ret, "%s<arg name=\"%s\"/>",
-					 indentation(indent), func->argnames[i]);
-		}
-		else {
-			char* tmp;
-			asprintf(&tmp,
-					 "%s\n"
-					 "%s<arg name=\"%s\"/>",
-					 ret,
-					 indentation(indent), func->argnames[i]);
-			free(ret);
-			ret = tmp;
+		if(i > 0) {
+			StrBuf_putc(sb, '\n');
 		}
+		
+		StrBuf_printf(sb, "%s<arg name=\"%s\"/>", indentation(indent), func->argnames[i]);
 	}
-	
-	return ret;
 }
 
-char* Function_xml(const Function* func, unsigned indent) {
+void Function_xml(const Function* func, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x f(x) = 3x + 4
-	 
+	
 	 <vardata name="f">
 	   <func>
 	     <argnames>
@@ -214,40 +184,47 @@ char* Function_xml(const Function* func, unsigned indent) {
 	   </func>
 	 </vardata>
 	*/
-	char* ret;
-	char* body = Value_xml(func->body, indent + 2);
+	StrBuf_append(sb, "<func>");
+	StrBuf_newline(sb, indent + 1);
 	
 	if(func->argcount > 0) {
-		char* args = argsXml(func, indent + 2);
-		
-		asprintf(&ret,
-				 "<func>\n"
-					 "%2$s<argnames>\n"
-						 "%4$s\n" /* args */
-					 "%2$s</argnames>\n"
-					 "%2$s<expr>\n"
-						 "%3$s%5$s\n" /* body */
-					 "%2$s</expr>\n"
-				 "%1$s</func>",
-				 indentation(indent), indentation(indent + 1), indentation(indent + 2),
-				 args,
-				 body);
-		
-		free(args);
+		StrBuf_append(sb, "<argnames>\n");
+		argsXml(func, sb, indent + 2);
+		StrBuf_newline(sb, indent + 1);
+		StrBuf_append(sb, "</argnames>");
 	}
 	else {
-		asprintf(&ret,
-				 "<func>\n"
-					 "%2$s<argnames/>\n"
-					 "%2$s<expr>\n"
-						 "%3$s%4$s\n" /* body */
-					 "%2$s</expr>\n"
-				 "%1$s</func>",
-				 indentation(indent), indentation(indent + 1), indentation(indent + 2),
-				 body);
+		StrBuf_append(sb, "<argnames/>");
 	}
 	
-	free(body);
-	return ret;
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "<expr>");
+	StrBuf_newline(sb, indent + 2);
+	Value_xml(func->body, sb, indent + 2);
+	StrBuf_newline(sb, indent + 1);
+	StrBuf_append(sb, "</expr>");
+	StrBuf_newline(sb, indent);
+	StrBuf_append(sb, "</func>");
+}
+
+void Function_json(const Function* func, StrBuf* sb) {
+	/*
+	 sc> ?jt f(x) = 3x + 4
+	 {"tree":{"name":"f","value":{"args":["x"],"body":{"op":"add","a":{"op":"mul","a":3,"b":{"var":"x"}},"b":4}}}}
+	*/
+	StrBuf_append(sb, "{\"args\":[");
+	
+	unsigned i;
+	for(i = 0; i < func->argcount; i++) {
+		if(i > 0) {
+			StrBuf_putc(sb, ',');
+		}
+		
+		StrBuf_jsonString(sb, func->argnames[i]);
+	}
+	
+	StrBuf_append(sb, "],\"body\":");
+	Value_json(func->body, sb);
+	StrBuf_putc(sb, '}');
 }
 
@@ -39,9 +39,10 @@ Function* Function_copy(const Function* func);
 Value* Function_eval(const Function* func, const Context* ctx, const ArgList* arglist);
 
 /* Printing */
-char* Function_repr(const Function* func, bool pretty);
-char* Function_wrap(const Function* func);
-char* Function_verbose(const Function* func);
-char* Function_xml(const Function* func, unsigned indent);
+void Function_repr(const Function* func, StrBuf* sb, bool pretty);
+void Function_wrap(const Function* func, StrBuf* sb);
+void Function_verbose(const Function* func, StrBuf* sb);
+void Function_xml(const Function* func, StrBuf* sb, unsigned indent);
+void Function_json(const Function* func, StrBuf* sb);
 
 #endif
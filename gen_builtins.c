@@ -0,0 +1,100 @@
+/*
+  gen_builtins.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Build tool that writes builtins_table.h: a collision-free hash table of the
+ names in builtins.def, so looking up a builtin costs one hash and one strcmp.
+ Runs on the build machine, so it only uses the hash function and the list.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "builtin_hash.h"
+
+/* Seeds to try at each table size before doubling it */
+#define MAX_SEEDS 100000
+
+static const char* const names[] = {
+#define BUILTIN(name, isFunction) #name,
+#include "builtins.def"
+#undef BUILTIN
+};
+
+#define COUNT (sizeof(names) / sizeof(names[0]))
+
+
+static bool tryTable(unsigned char* slots, unsigned size, unsigned seed);
+
+
+/* Slots hold an index into names plus one, so zero means empty */
+static bool tryTable(unsigned char* slots, unsigned size, unsigned seed) {
+	memset(slots, 0, size);
+	
+	unsigned i;
+	for(i = 0; i < COUNT; i++) {
+		unsigned slot = Builtin_hash(names[i], seed) & (size - 1);
+		if(slots[slot] != 0) {
+			return false;
+		}
+		
+		slots[slot] = (unsigned char)(i + 1);
+	}
+	
+	return true;
+}
+
+int main(void) {
+	if(COUNT >= 255) {
+		fprintf(stderr, "Too many builtins for one byte per slot\n");
+		return EXIT_FAILURE;
+	}
+	
+	/* Start at the smallest power of two with some room to spare */
+	unsigned size = 1;
+	while(size < COUNT * 2) {
+		size *= 2;
+	}
+	
+	unsigned char slots[4096];
+	unsigned seed = 0;
+	bool found = false;
+	
+	while(!found && size <= sizeof(slots)) {
+		for(seed = 0; seed < MAX_SEEDS; seed++) {
+			if(tryTable(slots, size, seed)) {
+				found = true;
+				break;
+			}
+		}
+		
+		if(!found) {
+			size *= 2;
+		}
+	}
+	
+	if(!found) {
+		fprintf(stderr, "Unable to find a perfect hash for the builtins\n");
+		return EXIT_FAILURE;
+	}
+	
+	printf("/* Generated by gen_builtins from builtins.def. Do not edit. */\n\n");
+	printf("#define BUILTIN_SEED  %uu\n", seed);
+	printf("#define BUILTIN_SLOTS %u\n\n", size);
+	printf("static const unsigned char builtin_slots[BUILTIN_SLOTS] = {");
+	
+	unsigned i;
+	for(i = 0; i < size; i++) {
+		printf("%s%u%s", i % 16 == 0 ? "\n\t" : " ", slots[i], i + 1 < size ? "," : "");
+	}
+	
+	printf("\n};\n");
+	return 0;
+}
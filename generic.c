@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_PARSER
+
 #include "generic.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +15,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <stddef.h>
+#include <limits.h>
+#include <pthread.h>
 
 #ifdef _MSC_VER
 # include <io.h>
@@ -26,21 +30,22 @@
 
 #define ICHAR   ' '
 #define IWIDTH  2
-#define EPSILON 1e-12
 
 typedef enum {
 	VC_PRETTY = 'p',
 	VC_REPR   = 'r',
 	VC_WRAP   = 'w',
 	VC_TREE   = 't',
-	VC_XML    = 'x'
+	VC_XML    = 'x',
+	VC_JSON   = 'j',
+	VC_UPDATES = 'u',
+	VC_STATS  = 's',
+	VC_PERF   = 'h'
 } VERBOSITY_CHAR;
 
-char line[4096];
-
-char* readLine(FILE* fout, const char* prompt, FILE* fin) {
+char* readLine(char* buf, size_t size, FILE* fout, const char* prompt, FILE* fin) {
 	fprintf(fout, "%s", prompt);
-	return fgets(line, sizeof(line), fin);
+	return fgets(buf, (int)size, fin);
 }
 
 bool isInteractive(FILE* fp) {
@@ -90,6 +95,22 @@ VERBOSITY getVerbosity(const char** str) {
 				ADD_V(XML);
 				break;
 			
+			case VC_JSON:
+				ADD_V(JSON);
+				break;
+			
+			case VC_UPDATES:
+				ADD_V(UPDATES);
+				break;
+			
+			case VC_STATS:
+				ADD_V(STATS);
+				break;
+			
+			case VC_PERF:
+				ADD_V(PERF);
+				break;
+			
 			case ' ':
 			case '\t':
 				/* Verbosity command ended by whitespace only */
@@ -100,7 +121,7 @@ VERBOSITY getVerbosity(const char** str) {
 				RAISE(badChar(**str), false);
 				return V_ERR;
 		}
-		
+
 #undef ADD_V
 		
 		(*str)++;
@@ -114,7 +135,7 @@ VERBOSITY getVerbosity(const char** str) {
 	return ret;
 }
 
-static const char* _repr_tok[] = {
+static const char* const _repr_tok[] = {
 	"sqrt",
 	"alpha", "beta", "gamma", "delta",
 	"epsilon", "zeta", "eta", "theta",
@@ -123,7 +144,7 @@ static const char* _repr_tok[] = {
 	"rho", "sigma", "tau", "upsilon",
 	"phi", "chi", "psi", "omega"
 };
-static const char* _pretty_tok[] = {
+static const char* const _pretty_tok[] = {
 	"√",
 	"α", "β", "γ", "δ",
 	"ε", "ζ", "η", "θ",
@@ -152,13 +173,17 @@ void trimSpaces(const char** str) {
 	*str = p;
 }
 
+static char blanks[40 * IWIDTH + 1];
+static pthread_once_t blanks_once = PTHREAD_ONCE_INIT;
+
+static void initBlanks(void) {
+	memset(blanks, ICHAR, ARRSIZE(blanks) - 1);
+	blanks[ARRSIZE(blanks) - 1] = '\0';
+}
+
 const char* indentation(unsigned level) {
 	/* Try just using a static array full of spaces */
-	static char blanks[40 * IWIDTH + 1] = "";
-	if(blanks[0] == '\0') {
-		memset(blanks, ICHAR, ARRSIZE(blanks) - 1);
-		blanks[ARRSIZE(blanks) - 1] = '\0';
-	}
+	pthread_once(&blanks_once, &initBlanks);
 	
 	if(level <= (ARRSIZE(blanks) - 1) / IWIDTH) {
 		return &blanks[ARRSIZE(blanks) - 1 - level * IWIDTH];
@@ -174,24 +199,31 @@ const char* indentation(unsigned level) {
 		count *= 2;
 	}
 	
-	/* Expand array if necessary */
-	static size_t large_count = 0;
-	static char** larger = NULL;
-	if(index + 1 > large_count) {
-		size_t new_count = index + 1;
-		larger = frealloc(larger, new_count * sizeof(*larger));
-		memset(larger + large_count, 0, (new_count - large_count) * sizeof(*larger));
-		large_count = new_count;
-	}
+	/*
+	 Each slot doubles the size of the last one, so these are enough for any
+	 unsigned level. Slots are filled lazily and never freed or replaced once
+	 published, so other threads can keep using them without a lock.
+	*/
+	static char* larger[CHAR_BIT * sizeof(unsigned)];
+	char* spaces = __atomic_load_n(&larger[index], __ATOMIC_ACQUIRE);
 	
 	/* Need to create array of spaces */
-	if(larger[index] == NULL) {
-		larger[index] = fmalloc(count * IWIDTH + 1);
-		memset(larger[index], IWIDTH, count * IWIDTH);
-		larger[index][count * IWIDTH] = '\0';
+	if(spaces == NULL) {
+		char* created = fmalloc(count * IWIDTH + 1);
+		memset(created, ICHAR, count * IWIDTH);
+		created[count * IWIDTH] = '\0';
+		
+		if(__atomic_compare_exchange_n(&larger[index], &spaces, created, false,
+		                               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			spaces = created;
+		}
+		else {
+			/* Another thread beat us to it */
+			ffree(created);
+		}
 	}
 	
-	return &larger[index][(count - level) * IWIDTH];
+	return &spaces[(count - level) * IWIDTH];
 }
 
 long long ipow(long long base, long long exp) {
@@ -218,7 +250,7 @@ char* nextSpecial(const char** expr) {
 		
 		if(strncmp(_pretty_tok[i], *expr, len) == 0) {
 			*expr += len;
-			return strdup(_repr_tok[i]);
+			return fstrdup(_repr_tok[i]);
 		}
 	}
 	
@@ -266,12 +298,3 @@ int getSign(const char** expr) {
 	return sign;
 }
 
-double approx(double real) {
-	/* "Close enough" to zero. This makes %g look better. */
-	if(ABS(real) < EPSILON) {
-		return 0.0;
-	}
-	
-	return real;
-}
-
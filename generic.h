@@ -12,8 +12,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "error.h"
+#include "mem.h"
+
+/* Files define this before any includes to count their allocations as something else */
+#ifndef MEM_TAG
+# define MEM_TAG MEM_OTHER
+#endif
 
 
 #ifdef _MSC_VER
@@ -48,41 +56,76 @@
 #define HAS_ANY(flags, flag) (((flags) & (flag)) != 0)
 #define ARRSIZE(arr) (sizeof(arr) / sizeof(arr[0]))
 
-static inline void* fmalloc(size_t size) {
-	void* ret = malloc(size);
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+/* Allocations remember their file and line, but only while memory is tracked */
+#define MEM_SITE __FILE__ ":" STRINGIFY(__LINE__)
+#define fmalloc(size) fmalloc_at((size), MEM_TAG, MEM_SITE)
+#define fcalloc(count, size) fcalloc_at((count), (size), MEM_TAG, MEM_SITE)
+#define frealloc(mem, size) frealloc_at((mem), (size), MEM_TAG, MEM_SITE)
+#define fstrdup(str) fstrdup_at((str), MEM_TAG, MEM_SITE)
+
+static inline void* fmalloc_at(size_t size, MEMTAG tag, const char* site) {
+	void* ret = mem_tracking ? Mem_alloc(size, false, tag, site) : malloc(size);
 	if(ret == NULL) {
 		allocError();
 	}
 	return ret;
 }
 
-static inline void* fcalloc(size_t count, size_t size) {
-	void* ret = calloc(count, size);
+static inline void* fcalloc_at(size_t count, size_t size, MEMTAG tag, const char* site) {
+	if(size != 0 && count > SIZE_MAX / size) {
+		allocError();
+	}
+	
+	void* ret = mem_tracking ? Mem_alloc(count * size, true, tag, site) : calloc(count, size);
 	if(ret == NULL) {
 		allocError();
 	}
 	return ret;
 }
 
-static inline void* frealloc(void* mem, size_t size) {
-	void* ret = realloc(mem, size);
+static inline void* frealloc_at(void* mem, size_t size, MEMTAG tag, const char* site) {
+	void* ret = mem_tracking ? Mem_realloc(mem, size, tag, site) : realloc(mem, size);
 	if(ret == NULL) {
 		allocError();
 	}
 	return ret;
 }
 
+static inline char* fstrdup_at(const char* str, MEMTAG tag, const char* site) {
+	size_t size = strlen(str) + 1;
+	char* ret = fmalloc_at(size, tag, site);
+	memcpy(ret, str, size);
+	return ret;
+}
+
+/* Frees anything, including memory from before tracking started or from the C library */
+static inline void ffree(void* mem) {
+	if(mem_tracking) {
+		Mem_free(mem);
+	}
+	else {
+		free(mem);
+	}
+}
+
 typedef enum {
 	V_ERR    = 1<<0,
 	V_PRETTY = 1<<1,
 	V_REPR   = 1<<2,
 	V_WRAP   = 1<<3,
 	V_TREE   = 1<<4,
-	V_XML    = 1<<5
+	V_XML    = 1<<5,
+	V_JSON   = 1<<6,
+	V_UPDATES = 1<<7,
+	V_STATS  = 1<<8,
+	V_PERF   = 1<<9
 } VERBOSITY;
 
-/* Hacky, I know */
-extern char line[4096];
+/* Size of the line buffer each SuperCalc instance reads into */
+#define LINE_MAX_LEN 4096
 
 /* Tokenization */
 void trimSpaces(const char** str);
@@ -91,7 +134,7 @@ char* nextToken(const char** expr);
 int getSign(const char** expr);
 
 /* Input */
-char* readLine(FILE* fout, const char* prompt, FILE* fin);
+char* readLine(char* buf, size_t size, FILE* fout, const char* prompt, FILE* fin);
 bool isInteractive(FILE* fp);
 VERBOSITY getVerbosity(const char** str);
 
@@ -102,6 +145,5 @@ const char* indentation(unsigned level);
 /* Math */
 long long ipow(long long base, long long exp);
 long long gcd(long long a, long long b);
-double approx(double real);
 
 #endif /* _SC_GENERIC_H_ */
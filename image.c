@@ -0,0 +1,751 @@
+/*
+  image.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_CONTEXT
+
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "generic.h"
+#include "error.h"
+#include "context.h"
+#include "variable.h"
+#include "value.h"
+#include "function.h"
+#include "reactive.h"
+#include "fraction.h"
+#include "binop.h"
+#include "unop.h"
+#include "funccall.h"
+#include "arglist.h"
+#include "vector.h"
+#include "matrix.h"
+
+
+#define IMAGE_MAGIC       "SCIMAGE"
+#define IMAGE_VERSION     1
+#define IMAGE_BYTE_ORDER  0x01020304
+
+/* Deeper trees than this are treated as corrupt rather than risking the stack */
+#define IMAGE_MAX_DEPTH   4096
+
+typedef enum {
+	IMG_VALUE = 0,
+	IMG_FUNC,
+	IMG_REACTIVE
+} IMGKIND;
+
+typedef struct ImageHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t count;
+	uint32_t size;
+} ImageHeader;
+
+/* Offsets are from the start of the file */
+typedef struct ImageEntry {
+	uint32_t name;
+	uint32_t kind;
+	uint32_t data;
+	uint32_t length;
+} ImageEntry;
+
+struct Image {
+	unsigned refs;
+	
+	/* The whole file, mapped read-only */
+	const char* map;
+	size_t size;
+	
+	const ImageEntry* entries;
+	unsigned count;
+	
+	/* Decoded entries, filled in on first use */
+	Variable** bound;
+};
+
+/* Growable output buffer for saving */
+typedef struct ImageBuf {
+	char* data;
+	size_t len;
+	size_t cap;
+} ImageBuf;
+
+/* Cursor over encoded data. Reading past `end` sets `bad` instead */
+typedef struct ImageReader {
+	const char* p;
+	const char* end;
+	bool bad;
+} ImageReader;
+
+
+static size_t putBytes(ImageBuf* buf, const void* data, size_t len);
+static void putU8(ImageBuf* buf, uint8_t n);
+static void putU32(ImageBuf* buf, uint32_t n);
+static void putName(ImageBuf* buf, const char* name);
+static bool putValue(ImageBuf* buf, const Value* val);
+static bool putFunction(ImageBuf* buf, const Function* func);
+static bool writeFile(const char* path, const ImageBuf* buf);
+static bool readBytes(ImageReader* r, void* out, size_t len);
+static uint8_t readU8(ImageReader* r);
+static uint32_t readU32(ImageReader* r);
+static const char* readName(ImageReader* r, uint32_t* len);
+static bool checkValue(ImageReader* r, unsigned depth);
+static bool checkEntry(const Image* img, const ImageEntry* entry);
+static Value* readValue(ImageReader* r);
+static Variable* readEntry(const Image* img, unsigned index);
+
+
+static size_t putBytes(ImageBuf* buf, const void* data, size_t len) {
+	if(buf->len + len > buf->cap) {
+		buf->cap = MAX(buf->cap * 2, buf->len + len);
+		buf->data = frealloc(buf->data, buf->cap);
+	}
+	
+	size_t offset = buf->len;
+	if(data != NULL) {
+		memcpy(buf->data + offset, data, len);
+	}
+	else {
+		memset(buf->data + offset, 0, len);
+	}
+	
+	buf->len += len;
+	return offset;
+}
+
+static void putU8(ImageBuf* buf, uint8_t n) {
+	putBytes(buf, &n, sizeof(n));
+}
+
+static void putU32(ImageBuf* buf, uint32_t n) {
+	putBytes(buf, &n, sizeof(n));
+}
+
+static void putName(ImageBuf* buf, const char* name) {
+	uint32_t len = (uint32_t)strlen(name);
+	putU32(buf, len);
+	putBytes(buf, name, len);
+}
+
+/* Returns false for values that have no encoding */
+static bool putValue(ImageBuf* buf, const Value* val) {
+	unsigned i;
+	
+	putU8(buf, (uint8_t)val->type);
+	
+	switch(val->type) {
+		case VAL_INT:
+			putBytes(buf, &val->ival, sizeof(val->ival));
+			return true;
+		
+		case VAL_REAL:
+			putBytes(buf, &val->rval, sizeof(val->rval));
+			return true;
+		
+		case VAL_FRAC:
+			putBytes(buf, &val->frac->n, sizeof(val->frac->n));
+			putBytes(buf, &val->frac->d, sizeof(val->frac->d));
+			return true;
+		
+		case VAL_EXPR:
+			putU8(buf, (uint8_t)val->expr->type);
+			return putValue(buf, val->expr->a) && putValue(buf, val->expr->b);
+		
+		case VAL_UNARY:
+			putU8(buf, (uint8_t)val->term->type);
+			return putValue(buf, val->term->a);
+		
+		case VAL_CALL:
+			if(!putValue(buf, val->call->func)) {
+				return false;
+			}
+			
+			putU32(buf, val->call->arglist->count);
+			for(i = 0; i < val->call->arglist->count; i++) {
+				if(!putValue(buf, val->call->arglist->args[i])) {
+					return false;
+				}
+			}
+			return true;
+		
+		case VAL_VAR:
+			putName(buf, val->name);
+			return true;
+		
+		case VAL_VEC:
+			putU32(buf, val->vec->vals->count);
+			for(i = 0; i < val->vec->vals->count; i++) {
+				if(!putValue(buf, val->vec->vals->args[i])) {
+					return false;
+				}
+			}
+			return true;
+		
+		case VAL_MAT: {
+			const Matrix* mat = val->mat;
+			size_t count = (size_t)mat->rows * mat->cols;
+			
+			putU32(buf, mat->rows);
+			putU32(buf, mat->cols);
+			putU8(buf, (uint8_t)mat->kind);
+			
+			/* Whole numbers and reals are written as they're stored */
+			if(mat->kind != MAT_BOXED) {
+				putBytes(buf, mat->data, count * sizeof(int64_t));
+				return true;
+			}
+			
+			size_t j;
+			for(j = 0; j < count; j++) {
+				if(!putValue(buf, mat->vals[j])) {
+					return false;
+				}
+			}
+			return true;
+		}
+		
+		default:
+			return false;
+	}
+}
+
+static bool putFunction(ImageBuf* buf, const Function* func) {
+	putU32(buf, func->argcount);
+	
+	unsigned i;
+	for(i = 0; i < func->argcount; i++) {
+		putName(buf, func->argnames[i]);
+	}
+	
+	return putValue(buf, func->body);
+}
+
+/* Written next to the destination and renamed over it, so a failed save leaves the old image alone */
+static bool writeFile(const char* path, const ImageBuf* buf) {
+	size_t size = strlen(path) + sizeof(".tmp");
+	char* tmp = fmalloc(size);
+	if(snprintf(tmp, size, "%s.tmp", path) != (int)size - 1) {
+		RAISE(nameError("Unable to write '%s'.", path), false);
+		ffree(tmp);
+		return false;
+	}
+	
+	FILE* fp = fopen(tmp, "wb");
+	if(fp == NULL) {
+		RAISE(nameError("Unable to write '%s': %s.", path, strerror(errno)), false);
+		ffree(tmp);
+		return false;
+	}
+	
+	bool ok = fwrite(buf->data, 1, buf->len, fp) == buf->len;
+	ok = fclose(fp) == 0 && ok;
+	ok = ok && rename(tmp, path) == 0;
+	
+	if(!ok) {
+		RAISE(nameError("Unable to write '%s': %s.", path, strerror(errno)), false);
+		unlink(tmp);
+	}
+	
+	ffree(tmp);
+	return ok;
+}
+
+bool Image_save(const Context* ctx, const char* path) {
+	unsigned count;
+	const Variable** vars = Context_userGlobals(ctx, &count);
+	
+	ImageBuf buf = {NULL, 0, 0};
+	
+	ImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	header.version = IMAGE_VERSION;
+	header.byteOrder = IMAGE_BYTE_ORDER;
+	header.count = count;
+	putBytes(&buf, &header, sizeof(header));
+	
+	/* Filled in once the offsets are known */
+	size_t table = putBytes(&buf, NULL, count * sizeof(ImageEntry));
+	
+	/* Names are kept together so lookups touch as few pages as possible */
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		ImageEntry entry;
+		entry.name = (uint32_t)putBytes(&buf, vars[i]->name, strlen(vars[i]->name) + 1);
+		memcpy(buf.data + table + i * sizeof(entry), &entry, sizeof(entry));
+	}
+	
+	for(i = 0; i < count; i++) {
+		ImageEntry* entry = (ImageEntry*)(buf.data + table + i * sizeof(*entry));
+		size_t start = buf.len;
+		bool ok;
+		uint32_t kind;
+		
+		if(vars[i]->type == VAR_FUNC) {
+			kind = IMG_FUNC;
+			ok = putFunction(&buf, vars[i]->func);
+		}
+		else if(vars[i]->type == VAR_REACTIVE) {
+			/* Only the formula, since results depend on what the image gets loaded into */
+			kind = IMG_REACTIVE;
+			ok = putValue(&buf, vars[i]->rx->formula);
+		}
+		else {
+			kind = IMG_VALUE;
+			ok = putValue(&buf, vars[i]->val);
+		}
+		
+		if(!ok) {
+			RAISE(typeError("Unable to save '%s' in an image.", vars[i]->name), false);
+			ffree(buf.data);
+			ffree(vars);
+			return false;
+		}
+		
+		/* The buffer may have moved */
+		entry = (ImageEntry*)(buf.data + table + i * sizeof(*entry));
+		entry->kind = kind;
+		entry->data = (uint32_t)start;
+		entry->length = (uint32_t)(buf.len - start);
+	}
+	
+	if(buf.len > UINT32_MAX) {
+		RAISE(typeError("Too much to save in one image."), false);
+		ffree(buf.data);
+		ffree(vars);
+		return false;
+	}
+	
+	((ImageHeader*)buf.data)->size = (uint32_t)buf.len;
+	
+	bool ok = writeFile(path, &buf);
+	ffree(buf.data);
+	ffree(vars);
+	return ok;
+}
+
+static bool readBytes(ImageReader* r, void* out, size_t len) {
+	if(r->bad || (size_t)(r->end - r->p) < len) {
+		r->bad = true;
+		memset(out, 0, len);
+		return false;
+	}
+	
+	memcpy(out, r->p, len);
+	r->p += len;
+	return true;
+}
+
+static uint8_t readU8(ImageReader* r) {
+	uint8_t ret;
+	readBytes(r, &ret, sizeof(ret));
+	return ret;
+}
+
+static uint32_t readU32(ImageReader* r) {
+	uint32_t ret;
+	readBytes(r, &ret, sizeof(ret));
+	return ret;
+}
+
+/* Returns a pointer into the image, which isn't NUL-terminated */
+static const char* readName(ImageReader* r, uint32_t* len) {
+	*len = readU32(r);
+	if(r->bad || *len == 0 || (size_t)(r->end - r->p) < *len) {
+		r->bad = true;
+		return NULL;
+	}
+	
+	const char* ret = r->p;
+	r->p += *len;
+	return ret;
+}
+
+/* Walks one encoded value without building anything */
+static bool checkValue(ImageReader* r, unsigned depth) {
+	if(depth > IMAGE_MAX_DEPTH) {
+		return false;
+	}
+	
+	uint32_t i, count, len;
+	int64_t n, d;
+	
+	VALTYPE type = (VALTYPE)readU8(r);
+	switch(type) {
+		case VAL_INT:
+		case VAL_REAL:
+			readBytes(r, &n, sizeof(n));
+			return !r->bad;
+		
+		case VAL_FRAC:
+			readBytes(r, &n, sizeof(n));
+			readBytes(r, &d, sizeof(d));
+			return !r->bad && d != 0;
+		
+		case VAL_EXPR:
+			if(readU8(r) > BIN_POW) {
+				return false;
+			}
+			return checkValue(r, depth + 1) && checkValue(r, depth + 1);
+		
+		case VAL_UNARY:
+			if(readU8(r) != UN_FACT) {
+				return false;
+			}
+			return checkValue(r, depth + 1);
+		
+		case VAL_CALL:
+		case VAL_VEC:
+			if(type == VAL_CALL && !checkValue(r, depth + 1)) {
+				return false;
+			}
+			
+			/* Functions can be called with no arguments, but vectors can't be empty */
+			count = readU32(r);
+			if(type == VAL_VEC && count == 0) {
+				return false;
+			}
+			
+			for(i = 0; i < count && !r->bad; i++) {
+				if(!checkValue(r, depth + 1)) {
+					return false;
+				}
+			}
+			return !r->bad;
+		
+		case VAL_VAR:
+			readName(r, &len);
+			return !r->bad;
+		
+		case VAL_MAT: {
+			uint32_t rows = readU32(r);
+			uint32_t cols = readU32(r);
+			uint8_t kind = readU8(r);
+			if(r->bad || rows == 0 || cols == 0 || kind > MAT_BOXED) {
+				return false;
+			}
+			
+			uint64_t elems = (uint64_t)rows * cols;
+			if(kind != MAT_BOXED) {
+				if(elems > (size_t)(r->end - r->p) / sizeof(int64_t)) {
+					return false;
+				}
+				
+				r->p += elems * sizeof(int64_t);
+				return true;
+			}
+			
+			uint64_t j;
+			for(j = 0; j < elems && !r->bad; j++) {
+				if(!checkValue(r, depth + 1)) {
+					return false;
+				}
+			}
+			return !r->bad;
+		}
+		
+		default:
+			return false;
+	}
+}
+
+static bool checkEntry(const Image* img, const ImageEntry* entry) {
+	if(entry->name >= img->size || memchr(img->map + entry->name, '\0', img->size - entry->name) == NULL) {
+		return false;
+	}
+	
+	if(entry->data > img->size || entry->length > img->size - entry->data) {
+		return false;
+	}
+	
+	ImageReader r = {img->map + entry->data, img->map + entry->data + entry->length, false};
+	
+	if(entry->kind == IMG_FUNC) {
+		uint32_t argcount = readU32(&r);
+		uint32_t i, len;
+		for(i = 0; i < argcount && !r.bad; i++) {
+			readName(&r, &len);
+		}
+	}
+	else if(entry->kind != IMG_VALUE && entry->kind != IMG_REACTIVE) {
+		return false;
+	}
+	
+	/* The value has to fill the entry exactly */
+	return checkValue(&r, 0) && r.p == r.end;
+}
+
+Image* Image_open(const char* path) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		RAISE(nameError("Unable to open '%s': %s.", path, strerror(errno)), false);
+		return NULL;
+	}
+	
+	struct stat st;
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ImageHeader)) {
+		close(fd);
+		RAISE(typeError("'%s' is not a SuperCalc image.", path), false);
+		return NULL;
+	}
+	
+	size_t size = (size_t)st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	
+	if(map == MAP_FAILED) {
+		RAISE(nameError("Unable to map '%s': %s.", path, strerror(errno)), false);
+		return NULL;
+	}
+	
+	const ImageHeader* header = map;
+	if(memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0) {
+		munmap(map, size);
+		RAISE(typeError("'%s' is not a SuperCalc image.", path), false);
+		return NULL;
+	}
+	
+	if(header->version != IMAGE_VERSION || header->byteOrder != IMAGE_BYTE_ORDER) {
+		munmap(map, size);
+		RAISE(typeError("'%s' was saved by an incompatible version of SuperCalc.", path), false);
+		return NULL;
+	}
+	
+	Image* ret = fcalloc(1, sizeof(*ret));
+	ret->refs = 1;
+	ret->map = map;
+	ret->size = size;
+	ret->entries = (const ImageEntry*)(ret->map + sizeof(*header));
+	ret->count = header->count;
+	
+	bool ok = header->size == size
+	       && header->count <= (size - sizeof(*header)) / sizeof(ImageEntry);
+	
+	/* Everything is checked up front so decoding later never has to fail */
+	unsigned i;
+	for(i = 0; ok && i < ret->count; i++) {
+		ok = checkEntry(ret, &ret->entries[i]);
+		
+		/* Lookups rely on the names being sorted and distinct */
+		if(ok && i > 0) {
+			ok = strcmp(Image_name(ret, i - 1), Image_name(ret, i)) < 0;
+		}
+	}
+	
+	if(!ok) {
+		munmap(map, size);
+		ffree(ret);
+		RAISE(typeError("'%s' is corrupt.", path), false);
+		return NULL;
+	}
+	
+	ret->bound = fcalloc(MAX(ret->count, 1), sizeof(*ret->bound));
+	return ret;
+}
+
+Image* Image_retain(Image* img) {
+	__atomic_add_fetch(&img->refs, 1, __ATOMIC_RELAXED);
+	return img;
+}
+
+void Image_release(Image* img) {
+	if(__atomic_sub_fetch(&img->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+		return;
+	}
+	
+	unsigned i;
+	for(i = 0; i < img->count; i++) {
+		if(img->bound[i] != NULL) {
+			Variable_free(img->bound[i]);
+		}
+	}
+	
+	ffree(img->bound);
+	munmap((void*)img->map, img->size);
+	ffree(img);
+}
+
+unsigned Image_count(const Image* img) {
+	return img->count;
+}
+
+const char* Image_name(const Image* img, unsigned index) {
+	return img->map + img->entries[index].name;
+}
+
+bool Image_isReactive(const Image* img, unsigned index) {
+	return img->entries[index].kind == IMG_REACTIVE;
+}
+
+int Image_find(const Image* img, const char* name) {
+	unsigned lo = 0;
+	unsigned hi = img->count;
+	
+	while(lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(name, Image_name(img, mid));
+		
+		if(cmp == 0) {
+			return (int)mid;
+		}
+		
+		if(cmp < 0) {
+			hi = mid;
+		}
+		else {
+			lo = mid + 1;
+		}
+	}
+	
+	return -1;
+}
+
+/* Only called on data that checkValue accepted */
+static Value* readValue(ImageReader* r) {
+	VALTYPE type = (VALTYPE)readU8(r);
+	long long ival;
+	double rval;
+	long long n, d;
+	uint32_t i, count, len;
+	const char* name;
+	char* copy;
+	Value* ret;
+	
+	switch(type) {
+		case VAL_INT:
+			readBytes(r, &ival, sizeof(ival));
+			return ValInt(ival);
+		
+		case VAL_REAL:
+			readBytes(r, &rval, sizeof(rval));
+			return ValReal(rval);
+		
+		case VAL_FRAC:
+			readBytes(r, &n, sizeof(n));
+			readBytes(r, &d, sizeof(d));
+			return ValFrac(Fraction_new(n, d));
+		
+		case VAL_EXPR: {
+			BINTYPE op = (BINTYPE)readU8(r);
+			Value* a = readValue(r);
+			Value* b = readValue(r);
+			return ValExpr(BinOp_new(op, a, b));
+		}
+		
+		case VAL_UNARY: {
+			UNTYPE op = (UNTYPE)readU8(r);
+			return ValUnary(UnOp_new(op, readValue(r)));
+		}
+		
+		case VAL_CALL: {
+			Value* func = readValue(r);
+			count = readU32(r);
+			
+			ArgList* args = ArgList_new(count);
+			for(i = 0; i < count; i++) {
+				args->args[i] = readValue(r);
+			}
+			return ValCall(FuncCall_new(func, args));
+		}
+		
+		case VAL_VAR:
+			name = readName(r, &len);
+			copy = strndup(name, len);
+			ret = ValVar(copy);
+			ffree(copy);
+			return ret;
+		
+		case VAL_VEC: {
+			count = readU32(r);
+			
+			ArgList* vals = ArgList_new(count);
+			for(i = 0; i < count; i++) {
+				vals->args[i] = readValue(r);
+			}
+			return ValVec(Vector_new(vals));
+		}
+		
+		case VAL_MAT: {
+			uint32_t rows = readU32(r);
+			uint32_t cols = readU32(r);
+			MATKIND kind = (MATKIND)readU8(r);
+			size_t elems = (size_t)rows * cols;
+			
+			if(kind != MAT_BOXED) {
+				Matrix* mat = Matrix_new(rows, cols, kind);
+				readBytes(r, mat->data, elems * sizeof(int64_t));
+				return ValMat(mat);
+			}
+			
+			Value** vals = fmalloc(elems * sizeof(*vals));
+			size_t j;
+			for(j = 0; j < elems; j++) {
+				vals[j] = readValue(r);
+			}
+			return ValMat(Matrix_fromValues(rows, cols, vals));
+		}
+		
+		default:
+			badValType(type);
+	}
+}
+
+static Variable* readEntry(const Image* img, unsigned index) {
+	const ImageEntry* entry = &img->entries[index];
+	ImageReader r = {img->map + entry->data, img->map + entry->data + entry->length, false};
+	char* name = fstrdup(Image_name(img, index));
+	
+	if(entry->kind == IMG_VALUE) {
+		return VarValue(name, readValue(&r));
+	}
+	
+	if(entry->kind == IMG_REACTIVE) {
+		return VarReactive(name, Reactive_new(readValue(&r)));
+	}
+	
+	uint32_t argcount = readU32(&r);
+	char** argnames = argcount ? fmalloc(argcount * sizeof(*argnames)) : NULL;
+	
+	uint32_t i, len;
+	for(i = 0; i < argcount; i++) {
+		const char* arg = readName(&r, &len);
+		argnames[i] = strndup(arg, len);
+	}
+	
+	return VarFunc(name, Function_new(argcount, argnames, readValue(&r)));
+}
+
+Variable* Image_get(Image* img, unsigned index) {
+	Variable** slot = &img->bound[index];
+	Variable* ret = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+	
+	if(ret == NULL) {
+		/* Threads that race to decode the same entry keep whichever copy lands first */
+		Variable* created = readEntry(img, index);
+		if(__atomic_compare_exchange_n(slot, &ret, created, false,
+		                               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			ret = created;
+		}
+		else {
+			Variable_free(created);
+		}
+	}
+	
+	return ret;
+}
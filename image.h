@@ -0,0 +1,56 @@
+/*
+  image.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_IMAGE_H_
+#define _SC_IMAGE_H_
+
+#include <stdbool.h>
+
+typedef struct Image Image;
+#include "context.h"
+#include "variable.h"
+
+/*
+ An image is a binary snapshot of a context's user-defined globals. Opening
+ one maps the file and checks it over, but nothing is decoded until a name is
+ first looked up, so startup cost doesn't grow with what a session never uses.
+
+ Layout, in native byte order (the header records which):
+
+     header   magic, version, byte order mark, entry count, file size
+     entries  {name offset, kind, data offset, data length}, sorted by name
+     data     names, then each entry's value or function, encoded in prefix order
+*/
+
+/* Writes every global that isn't a builtin. Raises an error and returns false on failure */
+bool Image_save(const Context* ctx, const char* path);
+
+/* Returns NULL after raising an error if the file can't be used */
+Image* Image_open(const char* path);
+
+/* Reference counting, since copies of a context share its image */
+Image* Image_retain(Image* img);
+void Image_release(Image* img);
+
+/* Number of entries, which are numbered in name order */
+unsigned Image_count(const Image* img);
+const char* Image_name(const Image* img, unsigned index);
+
+/* Reactive bindings keep results, so contexts copy them out when attaching the image */
+bool Image_isReactive(const Image* img, unsigned index);
+
+/* Returns the index of `name`, or -1 if the image doesn't have it */
+int Image_find(const Image* img, const char* name);
+
+/*
+ Decodes an entry the first time it's asked for. The variable belongs to the
+ image, so do not free it. Safe to call from several threads at once.
+*/
+Variable* Image_get(Image* img, unsigned index);
+
+#endif /* _SC_IMAGE_H_ */
@@ -0,0 +1,101 @@
+/*
+  libsupercalc.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Public interface of libsupercalc. This is the only header that embedders
+ need, and it doesn't pull in any of the interpreter's internals.
+
+     SuperCalc* sc = SC_new(NULL);
+     SC_exec(sc, "f(x, y) = 3x^2 + y", NULL, NULL);
+
+     const char* params[] = {"x", "y"};
+     Prepared* prep = SC_prepare(sc, "f(x, y) / 2", params, 2, &err);
+
+     double args[] = {4, 1}, result;
+     if(Prepared_eval(prep, args, &result, &err) == SC_OK) ...
+
+     Prepared_free(prep);
+     SC_free(sc);
+*/
+
+#ifndef _LIBSUPERCALC_H_
+#define _LIBSUPERCALC_H_
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SuperCalc SuperCalc;
+typedef struct Prepared Prepared;
+
+typedef enum {
+	SC_OK = 0,
+	SC_ERR_MATH,
+	SC_ERR_SYNTAX,
+	SC_ERR_NAME,
+	SC_ERR_TYPE,
+	SC_ERR_INTERNAL,
+	SC_ERR_UNKNOWN
+} SC_STATUS;
+
+/* Message doesn't include the "Math Error: " style prefix or a newline */
+#define SC_ERRMSG_MAX 256
+
+typedef struct SCError {
+	SC_STATUS code;
+	char msg[SC_ERRMSG_MAX];
+} SCError;
+
+
+/* Constructor. Pass NULL for `fout` when only using the functions in this header */
+SuperCalc* SC_new(FILE* fout);
+
+/* Destructor */
+void SC_free(SuperCalc* sc);
+
+/*
+ Runs one line of input without printing anything, such as a variable or
+ function definition. If the line evaluates to a number and `result` isn't
+ NULL, the number is stored there. `err` may be NULL.
+*/
+SC_STATUS SC_exec(SuperCalc* sc, const char* code, double* result, SCError* err);
+
+/*
+ Compiles `expr` once so it can be evaluated many times. Each name in `params`
+ becomes a slot that is bound to a number when evaluating. Every other name is
+ resolved now: variables, including := bindings, are captured with their
+ current values, and calls to builtins and user functions are bound directly,
+ so evaluating does no parsing and no name lookups. Later changes to `sc`
+ don't affect the handle, and `sc` may be freed before it. Returns NULL and
+ fills in `err` on failure.
+*/
+Prepared* SC_prepare(const SuperCalc* sc, const char* expr,
+                     const char* const* params, unsigned count, SCError* err);
+
+/* Same as SC_prepare, using the body and parameters of user function `name` */
+Prepared* SC_prepareFunc(const SuperCalc* sc, const char* name, SCError* err);
+
+/* Destructor */
+void Prepared_free(Prepared* prep);
+
+/* Number of numbers Prepared_eval expects in `args` */
+unsigned Prepared_paramCount(const Prepared* prep);
+
+/*
+ Evaluates with args[i] bound to the i-th parameter. Doesn't modify `prep`,
+ so one handle may be evaluated from several threads at once.
+*/
+SC_STATUS Prepared_eval(const Prepared* prep, const double* args, double* result, SCError* err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LIBSUPERCALC_H_ */
@@ -0,0 +1,145 @@
+/*
+  lru.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "lru.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "generic.h"
+
+/* Small caches still get enough buckets to keep chains short */
+#define MIN_BUCKETS 16
+
+
+static LruNode** findLink(const Lru* lru, const LruNode* node);
+static void detach(Lru* lru, LruNode* node);
+static void pushFront(Lru* lru, LruNode* node);
+
+
+/* Returns the link that points to `node` in its bucket */
+static LruNode** findLink(const Lru* lru, const LruNode* node) {
+	LruNode** link = &lru->buckets[node->hash & (lru->nbuckets - 1)];
+	
+	while(*link != node) {
+		link = &(*link)->chain;
+	}
+	
+	return link;
+}
+
+static void detach(Lru* lru, LruNode* node) {
+	if(node->prev != NULL) {
+		node->prev->next = node->next;
+	}
+	else {
+		lru->head = node->next;
+	}
+	
+	if(node->next != NULL) {
+		node->next->prev = node->prev;
+	}
+	else {
+		lru->tail = node->prev;
+	}
+}
+
+static void pushFront(Lru* lru, LruNode* node) {
+	node->prev = NULL;
+	node->next = lru->head;
+	
+	if(lru->head != NULL) {
+		lru->head->prev = node;
+	}
+	else {
+		lru->tail = node;
+	}
+	
+	lru->head = node;
+}
+
+
+void Lru_init(Lru* lru, MEMTAG tag) {
+	memset(lru, 0, sizeof(*lru));
+	lru->tag = tag;
+	Lru_resize(lru, 0);
+}
+
+void Lru_destroy(Lru* lru) {
+	ffree(lru->buckets);
+	lru->buckets = NULL;
+	lru->nbuckets = 0;
+}
+
+LruNode* Lru_find(const Lru* lru, unsigned hash, const void* key, lru_match_t match) {
+	LruNode* node = lru->buckets[hash & (lru->nbuckets - 1)];
+	
+	while(node != NULL && (node->hash != hash || !match(node, key))) {
+		node = node->chain;
+	}
+	
+	return node;
+}
+
+void Lru_touch(Lru* lru, LruNode* node) {
+	detach(lru, node);
+	pushFront(lru, node);
+}
+
+void Lru_insert(Lru* lru, LruNode* node, unsigned hash) {
+	LruNode** bucket = &lru->buckets[hash & (lru->nbuckets - 1)];
+	
+	node->hash = hash;
+	node->chain = *bucket;
+	*bucket = node;
+	pushFront(lru, node);
+	lru->count++;
+}
+
+void Lru_remove(Lru* lru, LruNode* node) {
+	*findLink(lru, node) = node->chain;
+	detach(lru, node);
+	lru->count--;
+}
+
+LruNode* Lru_oldest(const Lru* lru) {
+	return lru->tail;
+}
+
+LruNode* Lru_takeAll(Lru* lru) {
+	LruNode* ret = lru->head;
+	
+	lru->head = NULL;
+	lru->tail = NULL;
+	lru->count = 0;
+	memset(lru->buckets, 0, lru->nbuckets * sizeof(*lru->buckets));
+	
+	return ret;
+}
+
+void Lru_resize(Lru* lru, unsigned capacity) {
+	unsigned nbuckets = MIN_BUCKETS;
+	while(nbuckets < capacity) {
+		nbuckets *= 2;
+	}
+	
+	if(nbuckets == lru->nbuckets) {
+		return;
+	}
+	
+	ffree(lru->buckets);
+	lru->buckets = fcalloc_at(nbuckets, sizeof(*lru->buckets), lru->tag, MEM_SITE);
+	lru->nbuckets = nbuckets;
+	
+	/* Every entry is on the recency list, so rebuild the chains from it */
+	LruNode* node;
+	for(node = lru->head; node != NULL; node = node->next) {
+		LruNode** bucket = &lru->buckets[node->hash & (nbuckets - 1)];
+		node->chain = *bucket;
+		*bucket = node;
+	}
+}
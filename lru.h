@@ -0,0 +1,81 @@
+/*
+  lru.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_LRU_H_
+#define _SC_LRU_H_
+
+#include <stdbool.h>
+
+#include "mem.h"
+
+/*
+ Links for one entry of an Lru. Caches put this first in their own entry
+ structs, so a node can be cast back to the entry holding it.
+*/
+typedef struct LruNode LruNode;
+struct LruNode {
+	/* Next entry in the same bucket */
+	LruNode* chain;
+	
+	/* Recency list, most recently used first */
+	LruNode* prev;
+	LruNode* next;
+	
+	unsigned hash;
+};
+
+/* Whether the entry holding `node` is the one for `key` */
+typedef bool (*lru_match_t)(const LruNode* node, const void* key);
+
+/*
+ A hash table with chaining that also keeps its entries in order of use, for
+ caches that evict the least recently used entry. It only links entries, so
+ each cache allocates and frees its own.
+*/
+typedef struct Lru {
+	LruNode** buckets;
+	unsigned nbuckets;
+	LruNode* head;
+	LruNode* tail;
+	unsigned count;
+	
+	/* What the buckets are counted as */
+	MEMTAG tag;
+} Lru;
+
+
+void Lru_init(Lru* lru, MEMTAG tag);
+
+/* Frees the buckets, but not the entries, which should be removed first */
+void Lru_destroy(Lru* lru);
+
+/* Returns the entry for `key`, or NULL. Doesn't count as a use */
+LruNode* Lru_find(const Lru* lru, unsigned hash, const void* key, lru_match_t match);
+
+/* Marks `node` as the most recently used */
+void Lru_touch(Lru* lru, LruNode* node);
+
+/* Adds `node` as the most recently used entry */
+void Lru_insert(Lru* lru, LruNode* node, unsigned hash);
+
+/* Unlinks `node`, which the caller then frees */
+void Lru_remove(Lru* lru, LruNode* node);
+
+/* Least recently used entry, or NULL when empty */
+LruNode* Lru_oldest(const Lru* lru);
+
+/*
+ Unlinks every entry and returns the most recently used one. The rest follow
+ through `next`, so the caller can walk them to free them.
+*/
+LruNode* Lru_takeAll(Lru* lru);
+
+/* Sizes the table to one bucket per entry for `capacity` entries */
+void Lru_resize(Lru* lru, unsigned capacity);
+
+#endif /* _SC_LRU_H_ */
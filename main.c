@@ -8,11 +8,195 @@
 
 #include "supercalc.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "watch.h"
+#include "trace.h"
+
+static void usage(const char* prog) {
+	fprintf(stderr,
+	        "Usage: %s [--image FILE] [--jobs N] [--json] [--parse-cache N] [--result-cache N] [--memstats] [--perf-counters] [--trace FILE] [--watch FILE]\n"
+	        "       %s --compile FILE -o IMAGE [--image FILE]\n"
+	        "       %s --serve ADDRESS [--image FILE] [--jobs N] [--max-sessions N] [--idle-timeout SECS]\n"
+	        "ADDRESS is unix:/path/to/socket, port, or host:port\n",
+	        prog, prog, prog);
+	exit(EXIT_FAILURE);
+}
+
+static unsigned parseCount(const char* prog, const char* str, unsigned min) {
+	char* end;
+	unsigned long num = strtoul(str, &end, 10);
+	if(*str == '\0' || *end != '\0' || num < min || num > 1000000) {
+		usage(prog);
+	}
+	
+	return (unsigned)num;
+}
+
+/*
+ Finishes writing the trace for --trace. With --memstats, reports memory use
+ and anything still allocated once everything is freed.
+*/
+static int finish(SuperCalc* sc, int status) {
+	if(trace_enabled) {
+		Trace_stop();
+	}
+	
+	if(sc != NULL) {
+		SC_free(sc);
+	}
+	
+	if(mem_tracking) {
+		SC_cleanup();
+		Mem_report(stderr);
+	}
+	
+	return status;
+}
 
 int main(int argc, char* argv[]) {
+	unsigned jobs = 0;
+	bool json = false;
+	bool perf = false;
+	int cacheSize = -1;
+	int resultsSize = -1;
+	const char* image = NULL;
+	const char* watch = NULL;
+	const char* trace = NULL;
+	const char* compile = NULL;
+	const char* output = NULL;
+	ServerOptions serve = {
+		.address = NULL,
+		.image = NULL,
+		.maxSessions = 64,
+		.idleTimeout = 300
+	};
+	
+	int i;
+	for(i = 1; i < argc; i++) {
+		const char* opt = argv[i];
+		if(strcmp(opt, "--json") == 0) {
+			json = true;
+			continue;
+		}
+		
+		if(strcmp(opt, "--memstats") == 0) {
+			/* Nothing has been allocated yet */
+			Mem_startTracking();
+			continue;
+		}
+		
+		if(strcmp(opt, "--perf-counters") == 0) {
+			perf = true;
+			continue;
+		}
+		
+		/* Every other option takes an argument */
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+		}
+		
+		const char* arg = argv[++i];
+		if(strcmp(opt, "--jobs") == 0 || strcmp(opt, "-j") == 0) {
+			jobs = parseCount(argv[0], arg, 1);
+		}
+		else if(strcmp(opt, "--image") == 0) {
+			image = arg;
+		}
+		else if(strcmp(opt, "--parse-cache") == 0) {
+			cacheSize = parseCount(argv[0], arg, 0);
+		}
+		else if(strcmp(opt, "--result-cache") == 0) {
+			resultsSize = parseCount(argv[0], arg, 0);
+		}
+		else if(strcmp(opt, "--watch") == 0) {
+			watch = arg;
+		}
+		else if(strcmp(opt, "--trace") == 0) {
+			trace = arg;
+		}
+		else if(strcmp(opt, "--compile") == 0) {
+			compile = arg;
+		}
+		else if(strcmp(opt, "-o") == 0) {
+			output = arg;
+		}
+		else if(strcmp(opt, "--serve") == 0) {
+			serve.address = arg;
+		}
+		else if(strcmp(opt, "--max-sessions") == 0) {
+			serve.maxSessions = parseCount(argv[0], arg, 1);
+		}
+		else if(strcmp(opt, "--idle-timeout") == 0) {
+			serve.idleTimeout = parseCount(argv[0], arg, 0);
+		}
+		else {
+			usage(argv[0]);
+		}
+	}
+	
+	if((compile == NULL) != (output == NULL)) {
+		usage(argv[0]);
+	}
+	
+	if(trace != NULL && !Trace_start(trace)) {
+		return finish(NULL, EXIT_FAILURE);
+	}
+	
+	if(serve.address != NULL) {
+		/* Use every core unless told otherwise */
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		serve.workers = jobs ?: (cores > 0 ? (unsigned)cores : 1);
+		serve.image = image;
+		return finish(NULL, Server_run(&serve));
+	}
+	
+	jobs = jobs ?: 1;
+	
 	SuperCalc* sc = SC_new(stdout);
-	SC_run(sc, stdin);
-	SC_free(sc);
+	SC_setJobs(sc, jobs);
+	
+	if(cacheSize >= 0) {
+		/* 0 turns the cache off */
+		ParseCache_setCapacity(sc->cache, cacheSize);
+	}
+	
+	if(resultsSize >= 0) {
+		ResultCache_setCapacity(sc->results, resultsSize);
+	}
+	
+	if(json) {
+		/* Results and errors are both JSON lines on stdout */
+		sc->json = true;
+		sc->ferr = sc->fout;
+	}
+	
+	/* Every line reports its hardware counters, as if it began with ?h */
+	sc->perf = perf;
+	
+	if(image != NULL && !SC_loadImage(sc, image)) {
+		return finish(sc, EXIT_FAILURE);
+	}
+	
+	if(compile != NULL) {
+		/* An image given with --image ends up in the output too */
+		bool ok = SC_compile(sc, compile, output);
+		return finish(sc, ok ? 0 : EXIT_FAILURE);
+	}
+	
+	if(watch != NULL) {
+		/* Runs until interrupted */
+		bool ok = Watch_file(sc, watch);
+		return finish(sc, ok ? 0 : EXIT_FAILURE);
+	}
+	
+	Value* last = SC_run(sc, stdin);
+	if(last != NULL) {
+		Value_free(last);
+	}
 	
-	return 0;
-}
\ No newline at end of file
+	return finish(sc, 0);
+}
@@ -0,0 +1,2013 @@
+/*
+  matrix.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_VECTORS
+
+#include "matrix.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+
+#include "support.h"
+#include "generic.h"
+#include "error.h"
+#include "arglist.h"
+#include "value.h"
+#include "vector.h"
+#include "context.h"
+#include "binop.h"
+
+/* Block of the product that the real kernel keeps in registers */
+#define MAT_MR 4
+#define MAT_NR 4
+
+/* Rows and columns of B packed at a time, so the panel stays in L2 */
+#define MAT_KC 256
+#define MAT_NC 256
+
+/* Transposing works on square tiles of this many elements a side */
+#define MAT_TILE 32
+
+#ifdef __GNUC__
+/* One row of the kernel's block, split into whatever vector registers the target has */
+typedef double v4d __attribute__((vector_size(MAT_NR * sizeof(double))));
+#endif
+
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+/* Wide enough that a product of two elements never overflows */
+typedef __int128 wide;
+#else
+typedef long long wide;
+#endif
+
+/* Residues this many primes under 2^31 combine into a modulus that still fits in a wide */
+#define MOD_PRIMES (sizeof(wide) / 4)
+
+/* Primes just under 2^31, so a product of two residues fits in 64 bits */
+static const unsigned long long primes[] = {
+	2147483647, 2147483629, 2147483587, 2147483579,
+	2147483563, 2147483549, 2147483543, 2147483497
+};
+
+
+static size_t elemCount(const Matrix* mat);
+static bool isNumber(const Value* val);
+static Value* elemAt(const Matrix* mat, size_t i);
+static const Value* borrowAt(const Matrix* mat, size_t i, Value* tmp);
+static const double* asReals(const Matrix* mat, double** owned);
+static Value** toValues(const Matrix* mat);
+static void freeValues(Value** vals, size_t count);
+static Matrix* identity(unsigned n);
+static long long intOp(BINTYPE bin, long long a, long long b);
+static double realOp(BINTYPE bin, double a, double b);
+static Value* elementwise(const Matrix* mat, const Value* other, BINTYPE bin, bool rev, const Context* ctx);
+static void packPanel(const double* b, size_t ldb, unsigned kc, unsigned nc, double* panel);
+static void kernel(unsigned kc, const double* a, size_t lda, const double* panel, double* c, size_t ldc, unsigned mr, unsigned nr);
+static void gemm(unsigned m, unsigned n, unsigned k, const double* a, const double* b, double* c);
+static Matrix* realProduct(const Matrix* a, const Matrix* b);
+static Matrix* intProduct(const Matrix* a, const Matrix* b);
+static Value* boxedProduct(const Matrix* a, const Matrix* b, const Context* ctx);
+static Value* vectorProduct(const Matrix* mat, const Vector* vec, bool left, const Context* ctx);
+static Value* flatten(Value* mat);
+static double luFactor(double* a, unsigned n, unsigned* perm);
+static void luSolve(const double* lu, unsigned n, const unsigned* perm, const double* b, double* x);
+static Value* realSolve(const Matrix* a, const Matrix* b);
+static unsigned realRank(const Matrix* mat);
+static bool mulOverflows(wide a, wide b, wide* out);
+static bool subOverflows(wide a, wide b, wide* out);
+static bool fits(wide x, long long* out);
+static bool cross(long long a, long long d, long long b, long long c, long long prev, long long* out);
+static void ratioAt(const Matrix* mat, size_t i, long long* n, long long* d);
+static bool loadRows(const Matrix* a, const Matrix* b, long long* out, long long* scales);
+static bool bareiss(long long* a, unsigned rows, unsigned cols, unsigned limit, unsigned* rank, bool* negate);
+static Value* ratio(long long n, long long d);
+static Value* exactDet(const Matrix* mat);
+static bool backSubstitute(const long long* m, unsigned n, unsigned width, unsigned t, long long det, long long* y);
+static Value* bareissSolve(long long* m, unsigned n, unsigned width);
+static unsigned long long modPow(unsigned long long base, unsigned long long exp, unsigned long long p);
+static bool modSolve(const long long* m, unsigned n, unsigned width, unsigned long long p, unsigned long long* x);
+static wide crt(const unsigned long long* r, const unsigned long long* p, unsigned count);
+static wide isqrt(wide x);
+static bool reconstruct(wide u, wide mod, wide bound, long long* num, long long* den);
+static bool checkColumn(const long long* m, unsigned n, unsigned width, unsigned t, const long long* nums, const long long* dens);
+static Value* modularSolve(const long long* m, unsigned n, unsigned width);
+static Value* exactSolve(const Matrix* a, const Matrix* b);
+
+
+static size_t elemCount(const Matrix* mat) {
+	return (size_t)mat->rows * mat->cols;
+}
+
+static bool isNumber(const Value* val) {
+	return val->type == VAL_INT || val->type == VAL_REAL || val->type == VAL_FRAC;
+}
+
+static Value* elemAt(const Matrix* mat, size_t i) {
+	switch(mat->kind) {
+		case MAT_INT:
+			return ValInt(mat->ints[i]);
+		
+		case MAT_REAL:
+			return ValReal(mat->reals[i]);
+		
+		default:
+			return Value_copy(mat->vals[i]);
+	}
+}
+
+/* Unboxed elements are put in `tmp`, so nothing is allocated just to read them */
+static const Value* borrowAt(const Matrix* mat, size_t i, Value* tmp) {
+	switch(mat->kind) {
+		case MAT_INT:
+			tmp->type = VAL_INT;
+			tmp->ival = mat->ints[i];
+			return tmp;
+		
+		case MAT_REAL:
+			tmp->type = VAL_REAL;
+			tmp->rval = mat->reals[i];
+			return tmp;
+		
+		default:
+			return mat->vals[i];
+	}
+}
+
+/* Real matrices are used as they are, and anything else is converted into `owned` */
+static const double* asReals(const Matrix* mat, double** owned) {
+	if(mat->kind == MAT_REAL) {
+		*owned = NULL;
+		return mat->reals;
+	}
+	
+	size_t count = elemCount(mat);
+	double* ret = fmalloc(count * sizeof(*ret));
+	
+	size_t i;
+	for(i = 0; i < count; i++) {
+		ret[i] = mat->kind == MAT_INT ? mat->ints[i] : Value_asReal(mat->vals[i]);
+	}
+	
+	*owned = ret;
+	return ret;
+}
+
+static Value** toValues(const Matrix* mat) {
+	size_t count = elemCount(mat);
+	Value** ret = fmalloc(count * sizeof(*ret));
+	
+	size_t i;
+	for(i = 0; i < count; i++) {
+		ret[i] = elemAt(mat, i);
+	}
+	
+	return ret;
+}
+
+static void freeValues(Value** vals, size_t count) {
+	size_t i;
+	for(i = 0; i < count; i++) {
+		Value_free(vals[i]);
+	}
+	
+	ffree(vals);
+}
+
+static Matrix* identity(unsigned n) {
+	Matrix* ret = Matrix_new(n, n, MAT_INT);
+	
+	unsigned i;
+	for(i = 0; i < n; i++) {
+		ret->ints[(size_t)i * n + i] = 1;
+	}
+	
+	return ret;
+}
+
+/* Same as binop.c does for two integers */
+static long long intOp(BINTYPE bin, long long a, long long b) {
+	switch(bin) {
+		case BIN_ADD:
+			return a + b;
+		
+		case BIN_SUB:
+			return a - b;
+		
+		default:
+			return a * b;
+	}
+}
+
+static double realOp(BINTYPE bin, double a, double b) {
+	switch(bin) {
+		case BIN_ADD:
+			return a + b;
+		
+		case BIN_SUB:
+			return a - b;
+		
+		case BIN_MUL:
+			return a * b;
+		
+		case BIN_DIV:
+			return a / b;
+		
+		default:
+			return fmod(a, b);
+	}
+}
+
+/*
+ Applies `bin` between each element and either a number or the matching
+ element of another matrix. `rev` puts the other operand on the left. Whole
+ numbers and reals are handled here when the result can't be a fraction, and
+ everything else goes through BinOp_apply one element at a time.
+*/
+static Value* elementwise(const Matrix* mat, const Value* other, BINTYPE bin, bool rev, const Context* ctx) {
+	const Matrix* om = NULL;
+	MATKIND kind;
+	
+	switch(other->type) {
+		case VAL_MAT:
+			om = other->mat;
+			if(om->rows != mat->rows || om->cols != mat->cols) {
+				return ValErr(mathError("Cannot %s matrices of different sizes.", binop_verb[bin]));
+			}
+			kind = om->kind;
+			break;
+		
+		case VAL_INT:
+			kind = MAT_INT;
+			break;
+		
+		case VAL_REAL:
+			kind = MAT_REAL;
+			break;
+		
+		case VAL_FRAC:
+			kind = MAT_BOXED;
+			break;
+		
+		case VAL_VEC:
+			return ValErr(typeError("Cannot %s a matrix and a vector.", binop_verb[bin]));
+		
+		default:
+			return ValErr(badOpType(rev ? "left" : "right", other->type));
+	}
+	
+	size_t count = elemCount(mat);
+	size_t step = om ? 1 : 0;
+	size_t i;
+	
+	if(mat->kind == MAT_INT && kind == MAT_INT && (bin == BIN_ADD || bin == BIN_SUB || bin == BIN_MUL)) {
+		const long long* x = mat->ints;
+		const long long* y = om ? om->ints : &other->ival;
+		Matrix* ret = Matrix_new(mat->rows, mat->cols, MAT_INT);
+		
+		for(i = 0; i < count; i++) {
+			ret->ints[i] = rev ? intOp(bin, y[i * step], x[i]) : intOp(bin, x[i], y[i * step]);
+		}
+		
+		return ValMat(ret);
+	}
+	
+	if((mat->kind == MAT_REAL || kind == MAT_REAL) && bin != BIN_POW) {
+		/* Anything combined with a real is real */
+		double *ownX, *ownY = NULL;
+		double scalar = Value_asReal(other);
+		const double* x = asReals(mat, &ownX);
+		const double* y = om ? asReals(om, &ownY) : &scalar;
+		Matrix* ret = Matrix_new(mat->rows, mat->cols, MAT_REAL);
+		bool zero = false;
+		
+		for(i = 0; i < count; i++) {
+			double l = rev ? y[i * step] : x[i];
+			double r = rev ? x[i] : y[i * step];
+			
+			if(r == 0 && (bin == BIN_DIV || bin == BIN_MOD)) {
+				zero = true;
+				break;
+			}
+			
+			ret->reals[i] = realOp(bin, l, r);
+		}
+		
+		ffree(ownX);
+		ffree(ownY);
+		
+		if(zero) {
+			Matrix_free(ret);
+			return ValErr(zeroDivError());
+		}
+		
+		return ValMat(ret);
+	}
+	
+	Value** vals = fmalloc(count * sizeof(*vals));
+	for(i = 0; i < count; i++) {
+		Value tmpX, tmpY;
+		const Value* x = borrowAt(mat, i, &tmpX);
+		const Value* y = om ? borrowAt(om, i, &tmpY) : other;
+		
+		Value* val = rev ? BinOp_apply(bin, ctx, y, x) : BinOp_apply(bin, ctx, x, y);
+		if(val->type == VAL_ERR) {
+			freeValues(vals, i);
+			return val;
+		}
+		
+		vals[i] = val;
+	}
+	
+	return ValMat(Matrix_fromValues(mat->rows, mat->cols, vals));
+}
+
+/*
+ Copies `kc` rows of `nc` columns of B into strips MAT_NR columns wide, each
+ stored row after row. Columns past the edge are zero, so the kernel never
+ needs to check for them.
+*/
+static void packPanel(const double* b, size_t ldb, unsigned kc, unsigned nc, double* panel) {
+	unsigned jr, k, j;
+	for(jr = 0; jr < nc; jr += MAT_NR) {
+		double* strip = panel + (size_t)jr * kc;
+		unsigned width = MIN(MAT_NR, nc - jr);
+		
+		for(k = 0; k < kc; k++) {
+			const double* row = b + k * ldb + jr;
+			for(j = 0; j < MAT_NR; j++) {
+				strip[k * MAT_NR + j] = j < width ? row[j] : 0;
+			}
+		}
+	}
+}
+
+/*
+ Adds the product of `mr` rows of A and one packed strip of B into C. Rows
+ past the edge reuse the first row of A, and their sums are thrown away.
+*/
+static void kernel(unsigned kc, const double* a, size_t lda, const double* panel, double* c, size_t ldc, unsigned mr, unsigned nr) {
+	const double* rows[MAT_MR];
+	double sums[MAT_MR][MAT_NR];
+	unsigned r, j, k;
+	
+	for(r = 0; r < MAT_MR; r++) {
+		rows[r] = a + (r < mr ? r : 0) * lda;
+	}
+
+#ifdef __GNUC__
+	v4d acc0 = {0}, acc1 = {0}, acc2 = {0}, acc3 = {0};
+	
+	for(k = 0; k < kc; k++) {
+		v4d b;
+		memcpy(&b, panel + k * MAT_NR, sizeof(b));
+		
+		acc0 += rows[0][k] * b;
+		acc1 += rows[1][k] * b;
+		acc2 += rows[2][k] * b;
+		acc3 += rows[3][k] * b;
+	}
+	
+	memcpy(sums[0], &acc0, sizeof(acc0));
+	memcpy(sums[1], &acc1, sizeof(acc1));
+	memcpy(sums[2], &acc2, sizeof(acc2));
+	memcpy(sums[3], &acc3, sizeof(acc3));
+#else
+	memset(sums, 0, sizeof(sums));
+	
+	for(k = 0; k < kc; k++) {
+		for(r = 0; r < MAT_MR; r++) {
+			for(j = 0; j < MAT_NR; j++) {
+				sums[r][j] += rows[r][k] * panel[k * MAT_NR + j];
+			}
+		}
+	}
+#endif
+	
+	for(r = 0; r < mr; r++) {
+		for(j = 0; j < nr; j++) {
+			c[r * ldc + j] += sums[r][j];
+		}
+	}
+}
+
+/*
+ C += A * B, where A is m x k, B is k x n and all three are row-major. B is
+ packed one panel at a time, and each group of MAT_MR rows of A is run
+ against every strip of the panel while those rows are still in L1.
+*/
+static void gemm(unsigned m, unsigned n, unsigned k, const double* a, const double* b, double* c) {
+	double* panel = fmalloc((size_t)MAT_KC * MAT_NC * sizeof(*panel));
+	
+	unsigned jc, pc, i, jr;
+	for(jc = 0; jc < n; jc += MAT_NC) {
+		unsigned nc = MIN(MAT_NC, n - jc);
+		
+		for(pc = 0; pc < k; pc += MAT_KC) {
+			unsigned kc = MIN(MAT_KC, k - pc);
+			packPanel(b + (size_t)pc * n + jc, n, kc, nc, panel);
+			
+			for(i = 0; i < m; i += MAT_MR) {
+				unsigned mr = MIN(MAT_MR, m - i);
+				
+				for(jr = 0; jr < nc; jr += MAT_NR) {
+					kernel(kc, a + (size_t)i * k + pc, k, panel + (size_t)jr * kc,
+					       c + (size_t)i * n + jc + jr, n, mr, MIN(MAT_NR, nc - jr));
+				}
+			}
+		}
+	}
+	
+	ffree(panel);
+}
+
+static Matrix* realProduct(const Matrix* a, const Matrix* b) {
+	double *ownA, *ownB;
+	const double* x = asReals(a, &ownA);
+	const double* y = asReals(b, &ownB);
+	
+	Matrix* ret = Matrix_new(a->rows, b->cols, MAT_REAL);
+	gemm(a->rows, b->cols, a->cols, x, y, ret->reals);
+	
+	ffree(ownA);
+	ffree(ownB);
+	return ret;
+}
+
+/* Blocked the same way as gemm, but a row at a time so the compiler can vectorize it */
+static Matrix* intProduct(const Matrix* a, const Matrix* b) {
+	unsigned m = a->rows, k = a->cols, n = b->cols;
+	Matrix* ret = Matrix_new(m, n, MAT_INT);
+	
+	unsigned jc, pc, i, p, j;
+	for(jc = 0; jc < n; jc += MAT_NC) {
+		unsigned nc = MIN(MAT_NC, n - jc);
+		
+		for(pc = 0; pc < k; pc += MAT_KC) {
+			unsigned kc = MIN(MAT_KC, k - pc);
+			
+			for(i = 0; i < m; i++) {
+				long long* out = ret->ints + (size_t)i * n + jc;
+				
+				for(p = pc; p < pc + kc; p++) {
+					long long x = a->ints[(size_t)i * k + p];
+					const long long* row = b->ints + (size_t)p * n + jc;
+					
+					for(j = 0; j < nc; j++) {
+						out[j] += x * row[j];
+					}
+				}
+			}
+		}
+	}
+	
+	return ret;
+}
+
+static Value* boxedProduct(const Matrix* a, const Matrix* b, const Context* ctx) {
+	unsigned m = a->rows, k = a->cols, n = b->cols;
+	Value** vals = fmalloc((size_t)m * n * sizeof(*vals));
+	
+	size_t filled = 0;
+	unsigned i, j, p;
+	for(i = 0; i < m; i++) {
+		for(j = 0; j < n; j++) {
+			Value* sum = ValInt(0);
+			
+			for(p = 0; p < k; p++) {
+				Value tmpX, tmpY;
+				const Value* x = borrowAt(a, (size_t)i * k + p, &tmpX);
+				const Value* y = borrowAt(b, (size_t)p * n + j, &tmpY);
+				
+				Value* prod = BinOp_apply(BIN_MUL, ctx, x, y);
+				if(prod->type != VAL_ERR) {
+					Value* tmp = BinOp_apply(BIN_ADD, ctx, sum, prod);
+					Value_free(prod);
+					prod = tmp;
+				}
+				
+				Value_free(sum);
+				sum = prod;
+				
+				if(sum->type == VAL_ERR) {
+					freeValues(vals, filled);
+					return sum;
+				}
+			}
+			
+			vals[filled++] = sum;
+		}
+	}
+	
+	return ValMat(Matrix_fromValues(m, n, vals));
+}
+
+/* The vector is a column, or a row when it's on the left */
+static Value* vectorProduct(const Matrix* mat, const Vector* vec, bool left, const Context* ctx) {
+	unsigned count = vec->vals->count;
+	Value** vals = fmalloc(count * sizeof(*vals));
+	
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		if(!isNumber(vec->vals->args[i])) {
+			freeValues(vals, i);
+			return ValErr(typeError("Only vectors of numbers can be multiplied by a matrix."));
+		}
+		
+		vals[i] = Value_copy(vec->vals->args[i]);
+	}
+	
+	Matrix* other = left ? Matrix_fromValues(1, count, vals) : Matrix_fromValues(count, 1, vals);
+	Value* prod = left ? Matrix_product(other, mat, ctx) : Matrix_product(mat, other, ctx);
+	Matrix_free(other);
+	
+	/* The product is a single row or column either way */
+	return flatten(prod);
+}
+
+/* Consumes a matrix with a single row or column, returning it as a vector */
+static Value* flatten(Value* mat) {
+	if(mat->type == VAL_ERR) {
+		return mat;
+	}
+	
+	ArgList* args = ArgList_new((unsigned)elemCount(mat->mat));
+	
+	unsigned i;
+	for(i = 0; i < args->count; i++) {
+		args->args[i] = elemAt(mat->mat, i);
+	}
+	
+	Value_free(mat);
+	return ValVec(Vector_new(args));
+}
+
+/*
+ Factors `a` in place into L below the diagonal and U on and above it, using
+ partial pivoting. `perm` gets which original row ended up in each row.
+ Returns the determinant, which is zero when the matrix is singular.
+*/
+static double luFactor(double* a, unsigned n, unsigned* perm) {
+	double det = 1;
+	unsigned p, i, j;
+	
+	for(i = 0; i < n; i++) {
+		perm[i] = i;
+	}
+	
+	for(p = 0; p < n; p++) {
+		unsigned best = p;
+		for(i = p + 1; i < n; i++) {
+			if(fabs(a[(size_t)i * n + p]) > fabs(a[(size_t)best * n + p])) {
+				best = i;
+			}
+		}
+		
+		if(a[(size_t)best * n + p] == 0) {
+			return 0;
+		}
+		
+		if(best != p) {
+			double* x = a + (size_t)p * n;
+			double* y = a + (size_t)best * n;
+			for(j = 0; j < n; j++) {
+				double tmp = x[j];
+				x[j] = y[j];
+				y[j] = tmp;
+			}
+			
+			unsigned tmp = perm[p];
+			perm[p] = perm[best];
+			perm[best] = tmp;
+			det = -det;
+		}
+		
+		const double* pivotRow = a + (size_t)p * n;
+		double pivot = pivotRow[p];
+		det *= pivot;
+		
+		for(i = p + 1; i < n; i++) {
+			double* row = a + (size_t)i * n;
+			double factor = row[p] /= pivot;
+			
+			for(j = p + 1; j < n; j++) {
+				row[j] -= factor * pivotRow[j];
+			}
+		}
+	}
+	
+	return det;
+}
+
+/* Solves LUx = Pb, where `lu` and `perm` come from luFactor */
+static void luSolve(const double* lu, unsigned n, const unsigned* perm, const double* b, double* x) {
+	unsigned i, k;
+	
+	for(i = 0; i < n; i++) {
+		double sum = b[perm[i]];
+		for(k = 0; k < i; k++) {
+			sum -= lu[(size_t)i * n + k] * x[k];
+		}
+		x[i] = sum;
+	}
+	
+	for(i = n; i-- > 0;) {
+		double sum = x[i];
+		for(k = i + 1; k < n; k++) {
+			sum -= lu[(size_t)i * n + k] * x[k];
+		}
+		x[i] = sum / lu[(size_t)i * n + i];
+	}
+}
+
+/* Solves AX = B in reals, with A square and B having as many rows */
+static Value* realSolve(const Matrix* a, const Matrix* b) {
+	unsigned n = a->rows;
+	unsigned i, j;
+	double* owned;
+	const double* reals = asReals(a, &owned);
+	
+	double* lu = fmalloc((size_t)n * n * sizeof(*lu));
+	unsigned* perm = fmalloc(n * sizeof(*perm));
+	memcpy(lu, reals, (size_t)n * n * sizeof(*lu));
+	ffree(owned);
+	
+	if(luFactor(lu, n, perm) == 0) {
+		ffree(lu);
+		ffree(perm);
+		return ValErr(mathError("Matrix is singular."));
+	}
+	
+	const double* rhs = asReals(b, &owned);
+	Matrix* ret = Matrix_new(n, b->cols, MAT_REAL);
+	double* col = fmalloc(n * sizeof(*col));
+	double* x = fmalloc(n * sizeof(*x));
+	
+	for(j = 0; j < b->cols; j++) {
+		for(i = 0; i < n; i++) {
+			col[i] = rhs[(size_t)i * b->cols + j];
+		}
+		
+		luSolve(lu, n, perm, col, x);
+		
+		for(i = 0; i < n; i++) {
+			ret->reals[(size_t)i * b->cols + j] = x[i];
+		}
+	}
+	
+	ffree(x);
+	ffree(col);
+	ffree(owned);
+	ffree(lu);
+	ffree(perm);
+	return ValMat(ret);
+}
+
+/*
+ Row reduces a copy with partial pivoting, counting the pivots that aren't
+ lost in rounding error compared to the largest element.
+*/
+static unsigned realRank(const Matrix* mat) {
+	unsigned rows = mat->rows;
+	unsigned cols = mat->cols;
+	size_t count = elemCount(mat);
+	double* owned;
+	const double* reals = asReals(mat, &owned);
+	
+	double* a = fmalloc(count * sizeof(*a));
+	memcpy(a, reals, count * sizeof(*a));
+	ffree(owned);
+	
+	double largest = 0;
+	size_t k;
+	for(k = 0; k < count; k++) {
+		largest = fmax(largest, fabs(a[k]));
+	}
+	
+	double tolerance = MAX(rows, cols) * DBL_EPSILON * largest;
+	unsigned rank = 0;
+	unsigned c, i, j;
+	
+	for(c = 0; c < cols && rank < rows; c++) {
+		unsigned best = rank;
+		for(i = rank + 1; i < rows; i++) {
+			if(fabs(a[(size_t)i * cols + c]) > fabs(a[(size_t)best * cols + c])) {
+				best = i;
+			}
+		}
+		
+		if(fabs(a[(size_t)best * cols + c]) <= tolerance) {
+			continue;
+		}
+		
+		double* pivotRow = a + (size_t)rank * cols;
+		if(best != rank) {
+			double* row = a + (size_t)best * cols;
+			for(j = c; j < cols; j++) {
+				double tmp = row[j];
+				row[j] = pivotRow[j];
+				pivotRow[j] = tmp;
+			}
+		}
+		
+		for(i = rank + 1; i < rows; i++) {
+			double* row = a + (size_t)i * cols;
+			double factor = row[c] / pivotRow[c];
+			for(j = c; j < cols; j++) {
+				row[j] -= factor * pivotRow[j];
+			}
+		}
+		
+		rank++;
+	}
+	
+	ffree(a);
+	return rank;
+}
+
+/* Both return true when the result doesn't fit */
+static bool mulOverflows(wide a, wide b, wide* out) {
+#ifdef __GNUC__
+	return __builtin_mul_overflow(a, b, out);
+#else
+	if(a == 0 || b == 0) {
+		*out = 0;
+		return false;
+	}
+	
+	if(b == -1) {
+		*out = -a;
+		return a == LLONG_MIN;
+	}
+	
+	*out = (wide)((unsigned long long)a * (unsigned long long)b);
+	return *out / b != a;
+#endif
+}
+
+static bool subOverflows(wide a, wide b, wide* out) {
+#ifdef __GNUC__
+	return __builtin_sub_overflow(a, b, out);
+#else
+	if((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b)) {
+		return true;
+	}
+	
+	*out = a - b;
+	return false;
+#endif
+}
+
+/* LLONG_MIN is left out too, so negating or dividing by -1 is always safe */
+static bool fits(wide x, long long* out) {
+	if(x < -LLONG_MAX || x > LLONG_MAX) {
+		return false;
+	}
+	
+	*out = (long long)x;
+	return true;
+}
+
+/* Sets `out` to (a*d - b*c) / prev, which Bareiss guarantees is exact */
+static bool cross(long long a, long long d, long long b, long long c, long long prev, long long* out) {
+	wide ad, bc, num;
+	if(mulOverflows(a, d, &ad) || mulOverflows(b, c, &bc) || subOverflows(ad, bc, &num)) {
+		return false;
+	}
+	
+	return fits(prev == 1 ? num : num / prev, out);
+}
+
+/* Element `i` of an exact matrix as n/d */
+static void ratioAt(const Matrix* mat, size_t i, long long* n, long long* d) {
+	if(mat->kind == MAT_INT) {
+		*n = mat->ints[i];
+		*d = 1;
+	}
+	else if(mat->vals[i]->type == VAL_FRAC) {
+		*n = mat->vals[i]->frac->n;
+		*d = mat->vals[i]->frac->d;
+	}
+	else {
+		*n = mat->vals[i]->ival;
+		*d = 1;
+	}
+}
+
+/*
+ Copies each row of `a`, followed by the same row of `b` when there is one,
+ into `out` as whole numbers. The rows are multiplied by the lcm of their
+ denominators, which go in `scales`. Returns false if anything overflows.
+*/
+static bool loadRows(const Matrix* a, const Matrix* b, long long* out, long long* scales) {
+	unsigned bcols = b ? b->cols : 0;
+	unsigned width = a->cols + bcols;
+	unsigned r, c;
+	long long n, d;
+	
+	for(r = 0; r < a->rows; r++) {
+		long long scale = 1;
+		
+		for(c = 0; c < width; c++) {
+			if(c < a->cols) {
+				ratioAt(a, (size_t)r * a->cols + c, &n, &d);
+			}
+			else {
+				ratioAt(b, (size_t)r * bcols + c - a->cols, &n, &d);
+			}
+			
+			wide lcm;
+			if(mulOverflows(scale / gcd(scale, d), d, &lcm) || !fits(lcm, &scale)) {
+				return false;
+			}
+		}
+		
+		for(c = 0; c < width; c++) {
+			if(c < a->cols) {
+				ratioAt(a, (size_t)r * a->cols + c, &n, &d);
+			}
+			else {
+				ratioAt(b, (size_t)r * bcols + c - a->cols, &n, &d);
+			}
+			
+			wide scaled;
+			if(mulOverflows(n, scale / d, &scaled) || !fits(scaled, &out[(size_t)r * width + c])) {
+				return false;
+			}
+		}
+		
+		scales[r] = scale;
+	}
+	
+	return true;
+}
+
+/*
+ Fraction-free Gaussian elimination. Each step replaces the rows below the
+ pivot with the cross products against the pivot row, divided exactly by
+ the previous pivot. Every entry is then a minor of the original matrix, so
+ nothing grows beyond the determinant and no gcds are needed.
+
+ Only the first `limit` columns are used for pivots, so the columns after
+ them are carried along as right-hand sides. Leaves `a` in echelon form,
+ with the last pivot being the determinant of the rows and columns used.
+ Returns false if an entry overflows.
+*/
+static bool bareiss(long long* a, unsigned rows, unsigned cols, unsigned limit, unsigned* rank, bool* negate) {
+	long long prev = 1;
+	unsigned r = 0;
+	unsigned c, i, j;
+	
+	*negate = false;
+	
+	for(c = 0; c < limit && r < rows; c++) {
+		/* Any nonzero pivot will do, since nothing is rounded */
+		for(i = r; i < rows && a[(size_t)i * cols + c] == 0; i++);
+		
+		if(i == rows) {
+			continue;
+		}
+		
+		long long* pivotRow = a + (size_t)r * cols;
+		
+		if(i != r) {
+			long long* row = a + (size_t)i * cols;
+			for(j = c; j < cols; j++) {
+				long long tmp = row[j];
+				row[j] = pivotRow[j];
+				pivotRow[j] = tmp;
+			}
+			
+			*negate = !*negate;
+		}
+		
+		long long pivot = pivotRow[c];
+		
+		for(i = r + 1; i < rows; i++) {
+			long long* row = a + (size_t)i * cols;
+			for(j = c + 1; j < cols; j++) {
+				if(!cross(pivot, row[j], row[c], pivotRow[j], prev, &row[j])) {
+					return false;
+				}
+			}
+			
+			row[c] = 0;
+		}
+		
+		prev = pivot;
+		r++;
+	}
+	
+	*rank = r;
+	return true;
+}
+
+static Value* ratio(long long n, long long d) {
+	if(n % d == 0) {
+		return ValInt(n / d);
+	}
+	
+	return ValFrac(Fraction_new(n, d));
+}
+
+/* Returns NULL when the matrix is too big to stay exact */
+static Value* exactDet(const Matrix* mat) {
+	unsigned n = mat->rows;
+	long long* a = fmalloc((size_t)n * n * sizeof(*a));
+	long long* scales = fmalloc(n * sizeof(*scales));
+	unsigned rank;
+	bool negate;
+	
+	if(!loadRows(mat, NULL, a, scales) || !bareiss(a, n, n, n, &rank, &negate)) {
+		ffree(a);
+		ffree(scales);
+		return NULL;
+	}
+	
+	if(rank < n) {
+		ffree(a);
+		ffree(scales);
+		return ValInt(0);
+	}
+	
+	/* Undo the row scaling, reducing as it goes so the denominator stays small */
+	long long num = a[(size_t)n * n - 1];
+	long long den = 1;
+	
+	unsigned i;
+	for(i = 0; i < n; i++) {
+		long long scale = scales[i];
+		long long factor = gcd(ABS(num), scale);
+		num /= factor;
+		scale /= factor;
+		
+		wide prod;
+		if(mulOverflows(den, scale, &prod) || !fits(prod, &den)) {
+			ffree(a);
+			ffree(scales);
+			return NULL;
+		}
+	}
+	
+	ffree(a);
+	ffree(scales);
+	return ratio(negate ? -num : num, den);
+}
+
+/*
+ Finds det * x for column `t` of the right-hand sides, where `m` is the
+ echelon form from bareiss. Cramer's rule says those are whole numbers, so
+ every division is exact.
+*/
+static bool backSubstitute(const long long* m, unsigned n, unsigned width, unsigned t, long long det, long long* y) {
+	unsigned i, j;
+	for(i = n; i-- > 0;) {
+		const long long* row = m + (size_t)i * width;
+		wide sum;
+		if(mulOverflows(det, row[n + t], &sum)) {
+			return false;
+		}
+		
+		for(j = i + 1; j < n; j++) {
+			wide prod;
+			if(mulOverflows(row[j], y[j], &prod) || subOverflows(sum, prod, &sum)) {
+				return false;
+			}
+		}
+		
+		if(!fits(sum / row[i], &y[i])) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+/*
+ Solves the whole number system in `m`, with the right-hand sides after the
+ first `n` columns, by Bareiss elimination in place. Returns NULL when an
+ entry overflows.
+*/
+static Value* bareissSolve(long long* m, unsigned n, unsigned width) {
+	unsigned cols = width - n;
+	unsigned rank;
+	bool negate;
+	
+	if(!bareiss(m, n, width, n, &rank, &negate)) {
+		return NULL;
+	}
+	
+	if(rank < n) {
+		return ValErr(mathError("Matrix is singular."));
+	}
+	
+	/* The last pivot is the determinant of the scaled and swapped rows */
+	long long det = m[(size_t)(n - 1) * width + n - 1];
+	long long* y = fmalloc(n * sizeof(*y));
+	Value** vals = fcalloc((size_t)n * cols, sizeof(*vals));
+	
+	unsigned i, t;
+	for(t = 0; t < cols; t++) {
+		if(!backSubstitute(m, n, width, t, det, y)) {
+			break;
+		}
+		
+		for(i = 0; i < n; i++) {
+			vals[(size_t)i * cols + t] = ratio(y[i], det);
+		}
+	}
+	
+	ffree(y);
+	
+	if(t < cols) {
+		/* Any columns not reached are still NULL */
+		freeValues(vals, (size_t)n * cols);
+		return NULL;
+	}
+	
+	return ValMat(Matrix_fromValues(n, cols, vals));
+}
+
+static unsigned long long modPow(unsigned long long base, unsigned long long exp, unsigned long long p) {
+	unsigned long long ret = 1;
+	base %= p;
+	
+	while(exp > 0) {
+		if(exp & 1) {
+			ret = ret * base % p;
+		}
+		
+		base = base * base % p;
+		exp >>= 1;
+	}
+	
+	return ret;
+}
+
+/*
+ Gauss-Jordan elimination of `m` modulo the prime `p`, leaving the solution
+ for each right-hand side in `x`. Returns false if A is singular modulo `p`,
+ which happens when p divides the determinant.
+*/
+static bool modSolve(const long long* m, unsigned n, unsigned width, unsigned long long p, unsigned long long* x) {
+	unsigned cols = width - n;
+	unsigned long long* a = fmalloc((size_t)n * width * sizeof(*a));
+	unsigned c, i, j;
+	
+	size_t k;
+	for(k = 0; k < (size_t)n * width; k++) {
+		long long r = m[k] % (long long)p;
+		a[k] = r < 0 ? (unsigned long long)(r + (long long)p) : (unsigned long long)r;
+	}
+	
+	for(c = 0; c < n; c++) {
+		for(i = c; i < n && a[(size_t)i * width + c] == 0; i++);
+		
+		if(i == n) {
+			ffree(a);
+			return false;
+		}
+		
+		unsigned long long* pivotRow = a + (size_t)c * width;
+		
+		if(i != c) {
+			unsigned long long* row = a + (size_t)i * width;
+			for(j = c; j < width; j++) {
+				unsigned long long tmp = row[j];
+				row[j] = pivotRow[j];
+				pivotRow[j] = tmp;
+			}
+		}
+		
+		/* Fermat's little theorem gives the inverse */
+		unsigned long long inv = modPow(pivotRow[c], p - 2, p);
+		for(j = c; j < width; j++) {
+			pivotRow[j] = pivotRow[j] * inv % p;
+		}
+		
+		for(i = 0; i < n; i++) {
+			unsigned long long* row = a + (size_t)i * width;
+			unsigned long long factor = row[c];
+			if(i == c || factor == 0) {
+				continue;
+			}
+			
+			for(j = c; j < width; j++) {
+				row[j] = (row[j] + (p - factor) * pivotRow[j]) % p;
+			}
+		}
+	}
+	
+	for(i = 0; i < n; i++) {
+		memcpy(x + (size_t)i * cols, a + (size_t)i * width + n, cols * sizeof(*x));
+	}
+	
+	ffree(a);
+	return true;
+}
+
+/* Garner's algorithm, giving the number below the product of `p` with each residue in `r` */
+static wide crt(const unsigned long long* r, const unsigned long long* p, unsigned count) {
+	unsigned long long digits[MOD_PRIMES];
+	unsigned i, j;
+	
+	for(i = 0; i < count; i++) {
+		unsigned long long v = r[i];
+		for(j = 0; j < i; j++) {
+			v = (v + p[i] - digits[j] % p[i]) % p[i] * modPow(p[j], p[i] - 2, p[i]) % p[i];
+		}
+		digits[i] = v;
+	}
+	
+	wide ret = digits[count - 1];
+	for(i = count - 1; i-- > 0;) {
+		ret = ret * (wide)p[i] + digits[i];
+	}
+	
+	return ret;
+}
+
+static wide isqrt(wide x) {
+	wide ret = (wide)sqrt((double)x);
+	
+	/* The double can be off by a little either way */
+	while(ret > 0 && ret * ret > x) {
+		ret--;
+	}
+	
+	while((ret + 1) * (ret + 1) <= x) {
+		ret++;
+	}
+	
+	return ret;
+}
+
+/*
+ Finds the fraction num/den congruent to `u` modulo `mod` with both no
+ larger than `bound`, by running the extended Euclidean algorithm until the
+ remainder is small enough. When 2 * bound^2 < mod there's at most one.
+*/
+static bool reconstruct(wide u, wide mod, wide bound, long long* num, long long* den) {
+	wide r0 = mod, r1 = u;
+	wide t0 = 0, t1 = 1;
+	
+	while(r1 > bound) {
+		wide q = r0 / r1;
+		wide r = r0 - q * r1;
+		wide t = t0 - q * t1;
+		r0 = r1;
+		r1 = r;
+		t0 = t1;
+		t1 = t;
+	}
+	
+	if(t1 < 0) {
+		t1 = -t1;
+		r1 = -r1;
+	}
+	
+	if(t1 == 0 || t1 > bound) {
+		return false;
+	}
+	
+	*num = (long long)r1;
+	*den = (long long)t1;
+	return gcd(ABS(*num), *den) == 1;
+}
+
+/* Whether the fractions nums/dens satisfy every equation for right-hand side `t` exactly */
+static bool checkColumn(const long long* m, unsigned n, unsigned width, unsigned t, const long long* nums, const long long* dens) {
+	unsigned cols = width - n;
+	unsigned i, j;
+	
+	/* Everything is multiplied by the common denominator to stay whole */
+	long long lcm = 1;
+	for(i = 0; i < n; i++) {
+		wide next;
+		long long den = dens[(size_t)i * cols + t];
+		if(mulOverflows(lcm / gcd(lcm, den), den, &next) || !fits(next, &lcm)) {
+			return false;
+		}
+	}
+	
+	for(i = 0; i < n; i++) {
+		const long long* row = m + (size_t)i * width;
+		wide sum;
+		if(mulOverflows(row[n + t], lcm, &sum)) {
+			return false;
+		}
+		
+		for(j = 0; j < n; j++) {
+			size_t k = (size_t)j * cols + t;
+			wide scaled, prod;
+			if(mulOverflows(nums[k], lcm / dens[k], &scaled)
+			   || mulOverflows(row[j], scaled, &prod)
+			   || subOverflows(sum, prod, &sum)) {
+				return false;
+			}
+		}
+		
+		if(sum != 0) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+/*
+ Solves the whole number system in `m` modulo several primes and recovers
+ each unknown as a fraction from its residues. Bareiss needs the whole
+ determinant to fit, which random 50x50 systems overflow many times over,
+ while this only needs the answer to fit. An answer is only kept once it
+ satisfies every equation exactly, so this can fail but is never wrong.
+*/
+static Value* modularSolve(const long long* m, unsigned n, unsigned width) {
+	unsigned cols = width - n;
+	size_t count = (size_t)n * cols;
+	unsigned long long* residues = fmalloc(MOD_PRIMES * count * sizeof(*residues));
+	unsigned long long used[MOD_PRIMES];
+	unsigned found = 0;
+	
+	/* Skip any primes that divide the determinant */
+	unsigned i;
+	for(i = 0; i < ARRSIZE(primes) && found < MOD_PRIMES; i++) {
+		if(modSolve(m, n, width, primes[i], residues + found * count)) {
+			used[found++] = primes[i];
+		}
+	}
+	
+	if(found < MOD_PRIMES) {
+		ffree(residues);
+		return NULL;
+	}
+	
+	wide mod = 1;
+	for(i = 0; i < MOD_PRIMES; i++) {
+		mod *= used[i];
+	}
+	wide bound = isqrt(mod / 2);
+	
+	long long* nums = fmalloc(count * sizeof(*nums));
+	long long* dens = fmalloc(count * sizeof(*dens));
+	bool ok = true;
+	
+	size_t k;
+	for(k = 0; k < count && ok; k++) {
+		unsigned long long r[MOD_PRIMES];
+		for(i = 0; i < MOD_PRIMES; i++) {
+			r[i] = residues[i * count + k];
+		}
+		
+		ok = reconstruct(crt(r, used, MOD_PRIMES), mod, bound, &nums[k], &dens[k]);
+	}
+	
+	unsigned t;
+	for(t = 0; t < cols && ok; t++) {
+		ok = checkColumn(m, n, width, t, nums, dens);
+	}
+	
+	Value* ret = NULL;
+	if(ok) {
+		Value** vals = fmalloc(count * sizeof(*vals));
+		for(k = 0; k < count; k++) {
+			vals[k] = ratio(nums[k], dens[k]);
+		}
+		
+		ret = ValMat(Matrix_fromValues(n, cols, vals));
+	}
+	
+	ffree(residues);
+	ffree(nums);
+	ffree(dens);
+	return ret;
+}
+
+/* Solves AX = B exactly with A square. Returns NULL when the answer is too big to stay exact */
+static Value* exactSolve(const Matrix* a, const Matrix* b) {
+	unsigned n = a->rows;
+	unsigned width = n + b->cols;
+	size_t size = (size_t)n * width * sizeof(long long);
+	long long* m = fmalloc(size);
+	long long* scales = fmalloc(n * sizeof(*scales));
+	
+	bool loaded = loadRows(a, b, m, scales);
+	ffree(scales);
+	
+	if(!loaded) {
+		ffree(m);
+		return NULL;
+	}
+	
+	/* Bareiss works in place, so keep the rows in case it overflows */
+	long long* rows = fmalloc(size);
+	memcpy(rows, m, size);
+	
+	Value* ret = bareissSolve(m, n, width);
+	if(ret == NULL) {
+		ret = modularSolve(rows, n, width);
+	}
+	
+	ffree(m);
+	ffree(rows);
+	return ret;
+}
+
+
+Matrix* Matrix_new(unsigned rows, unsigned cols, MATKIND kind) {
+	Matrix* ret = fmalloc(sizeof(*ret));
+	size_t count = (size_t)rows * cols;
+	
+	ret->rows = rows;
+	ret->cols = cols;
+	ret->kind = kind;
+	
+	switch(kind) {
+		case MAT_INT:
+			ret->ints = fcalloc(count, sizeof(*ret->ints));
+			break;
+		
+		case MAT_REAL:
+			ret->reals = fcalloc(count, sizeof(*ret->reals));
+			break;
+		
+		default:
+			ret->vals = fcalloc(count, sizeof(*ret->vals));
+			break;
+	}
+	
+	return ret;
+}
+
+Matrix* Matrix_fromValues(unsigned rows, unsigned cols, Value** vals) {
+	size_t count = (size_t)rows * cols;
+	bool numbers = true;
+	bool real = false;
+	bool frac = false;
+	
+	size_t i;
+	for(i = 0; i < count; i++) {
+		switch(vals[i]->type) {
+			case VAL_INT:
+				break;
+			
+			case VAL_REAL:
+				real = true;
+				break;
+			
+			case VAL_FRAC:
+				frac = true;
+				break;
+			
+			default:
+				numbers = false;
+				break;
+		}
+	}
+	
+	Matrix* ret;
+	
+	/* Fractions are only kept when they can't be turned into reals anyway */
+	if(!numbers || (frac && !real)) {
+		ret = fmalloc(sizeof(*ret));
+		ret->rows = rows;
+		ret->cols = cols;
+		ret->kind = MAT_BOXED;
+		ret->vals = vals;
+		return ret;
+	}
+	
+	ret = Matrix_new(rows, cols, real ? MAT_REAL : MAT_INT);
+	for(i = 0; i < count; i++) {
+		if(real) {
+			ret->reals[i] = Value_asReal(vals[i]);
+		}
+		else {
+			ret->ints[i] = vals[i]->ival;
+		}
+	}
+	
+	freeValues(vals, count);
+	return ret;
+}
+
+void Matrix_free(Matrix* mat) {
+	if(mat->kind == MAT_BOXED) {
+		size_t count = elemCount(mat);
+		
+		size_t i;
+		for(i = 0; i < count; i++) {
+			Value_free(mat->vals[i]);
+		}
+	}
+	
+	ffree(mat->data);
+	ffree(mat);
+}
+
+Matrix* Matrix_copy(const Matrix* mat) {
+	size_t count = elemCount(mat);
+	Matrix* ret;
+	
+	if(mat->kind == MAT_BOXED) {
+		ret = fmalloc(sizeof(*ret));
+		ret->rows = mat->rows;
+		ret->cols = mat->cols;
+		ret->kind = MAT_BOXED;
+		ret->vals = toValues(mat);
+		return ret;
+	}
+	
+	ret = Matrix_new(mat->rows, mat->cols, mat->kind);
+	memcpy(ret->data, mat->data, count * (mat->kind == MAT_INT ? sizeof(*mat->ints) : sizeof(*mat->reals)));
+	return ret;
+}
+
+Value* Matrix_fromVector(const Vector* vec) {
+	const ArgList* outer = vec->vals;
+	
+	/* A vector of numbers is a single row */
+	bool nested = outer->args[0]->type == VAL_VEC;
+	unsigned rows = nested ? outer->count : 1;
+	unsigned cols = nested ? outer->args[0]->vec->vals->count : outer->count;
+	
+	Value** vals = fmalloc((size_t)rows * cols * sizeof(*vals));
+	size_t filled = 0;
+	
+	unsigned r, c;
+	for(r = 0; r < rows; r++) {
+		const ArgList* row = outer;
+		if(nested) {
+			const Value* val = outer->args[r];
+			if(val->type != VAL_VEC || val->vec->vals->count != cols) {
+				freeValues(vals, filled);
+				return ValErr(mathError("Matrix rows must all be vectors of the same length."));
+			}
+			
+			row = val->vec->vals;
+		}
+		
+		for(c = 0; c < cols; c++) {
+			if(!isNumber(row->args[c])) {
+				freeValues(vals, filled);
+				return ValErr(typeError("Matrix elements must be numbers."));
+			}
+			
+			vals[filled++] = Value_copy(row->args[c]);
+		}
+	}
+	
+	return ValMat(Matrix_fromValues(rows, cols, vals));
+}
+
+Value* Matrix_get(const Matrix* mat, unsigned row, unsigned col) {
+	return elemAt(mat, (size_t)row * mat->cols + col);
+}
+
+Value* Matrix_parse(const char** expr, const parser_cb* cb) {
+	unsigned size = 2;
+	unsigned count = 0;
+	ArgList** rows = fmalloc(size * sizeof(*rows));
+	Value* err = NULL;
+	unsigned i;
+	
+	trimSpaces(expr);
+	if(**expr != '[') {
+		/* A single row can leave out its own brackets, like [1, 2, 3] */
+		if((rows[0] = ArgList_parse(expr, ',', ']', cb)) == NULL) {
+			/* Error occurred and has already been raised */
+			err = ValErr(ignoreError());
+		}
+		else {
+			count = 1;
+		}
+	}
+	else {
+		while(1) {
+			/* Move past the '[' character */
+			(*expr)++;
+			
+			ArgList* row = ArgList_parse(expr, ',', ']', cb);
+			if(row == NULL) {
+				err = ValErr(ignoreError());
+				break;
+			}
+			
+			if(count >= size) {
+				size *= 2;
+				rows = frealloc(rows, size * sizeof(*rows));
+			}
+			rows[count++] = row;
+			
+			trimSpaces(expr);
+			if(**expr == ']') {
+				(*expr)++;
+				break;
+			}
+			
+			if(**expr == ',') {
+				(*expr)++;
+				trimSpaces(expr);
+				if(**expr == '[') {
+					continue;
+				}
+			}
+			
+			err = ValErr(badChar(**expr));
+			break;
+		}
+	}
+	
+	unsigned cols = count > 0 ? rows[0]->count : 0;
+	if(err == NULL && cols == 0) {
+		err = ValErr(syntaxError("Matrix must have at least 1 element."));
+	}
+	
+	for(i = 1; i < count && err == NULL; i++) {
+		if(rows[i]->count != cols) {
+			err = ValErr(syntaxError("Matrix rows must all have the same length."));
+		}
+	}
+	
+	Value** vals = NULL;
+	if(err == NULL) {
+		vals = fmalloc((size_t)count * cols * sizeof(*vals));
+		for(i = 0; i < count; i++) {
+			/* Moved out of the row, so freeing it leaves them alone */
+			memcpy(vals + (size_t)i * cols, rows[i]->args, cols * sizeof(*vals));
+			rows[i]->count = 0;
+		}
+	}
+	
+	for(i = 0; i < count; i++) {
+		ArgList_free(rows[i]);
+	}
+	ffree(rows);
+	
+	if(err != NULL) {
+		return err;
+	}
+	
+	return ValMat(Matrix_fromValues(count, cols, vals));
+}
+
+Value* Matrix_eval(const Matrix* mat, const Context* ctx) {
+	if(mat->kind != MAT_BOXED) {
+		return ValMat(Matrix_copy(mat));
+	}
+	
+	size_t count = elemCount(mat);
+	Value** vals = fmalloc(count * sizeof(*vals));
+	
+	size_t i;
+	for(i = 0; i < count; i++) {
+		Value* val = Value_coerce(mat->vals[i], ctx);
+		
+		if(val->type != VAL_ERR && !isNumber(val)) {
+			Value_free(val);
+			val = ValErr(typeError("Matrix elements must be numbers."));
+		}
+		
+		if(val->type == VAL_ERR) {
+			freeValues(vals, i);
+			return val;
+		}
+		
+		vals[i] = val;
+	}
+	
+	return ValMat(Matrix_fromValues(mat->rows, mat->cols, vals));
+}
+
+Value* Matrix_add(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_ADD, false, ctx);
+}
+
+Value* Matrix_sub(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_SUB, false, ctx);
+}
+
+Value* Matrix_rsub(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_SUB, true, ctx);
+}
+
+Value* Matrix_mul(const Matrix* mat, const Value* other, const Context* ctx) {
+	if(other->type == VAL_MAT) {
+		return Matrix_product(mat, other->mat, ctx);
+	}
+	
+	if(other->type == VAL_VEC) {
+		return vectorProduct(mat, other->vec, false, ctx);
+	}
+	
+	return elementwise(mat, other, BIN_MUL, false, ctx);
+}
+
+Value* Matrix_rmul(const Matrix* mat, const Value* other, const Context* ctx) {
+	if(other->type == VAL_VEC) {
+		return vectorProduct(mat, other->vec, true, ctx);
+	}
+	
+	return elementwise(mat, other, BIN_MUL, true, ctx);
+}
+
+Value* Matrix_div(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_DIV, false, ctx);
+}
+
+Value* Matrix_rdiv(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_DIV, true, ctx);
+}
+
+Value* Matrix_mod(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_MOD, false, ctx);
+}
+
+Value* Matrix_rmod(const Matrix* mat, const Value* other, const Context* ctx) {
+	return elementwise(mat, other, BIN_MOD, true, ctx);
+}
+
+Value* Matrix_pow(const Matrix* mat, const Value* other, const Context* ctx) {
+	if(other->type != VAL_INT) {
+		return ValErr(typeError("Matrices can only be raised to integer powers."));
+	}
+	
+	if(mat->rows != mat->cols) {
+		return ValErr(mathError("Only square matrices can be raised to a power."));
+	}
+	
+	/* M^-n is inv(M)^n */
+	Value* base = other->ival < 0 ? Matrix_inv(mat, ctx) : ValMat(Matrix_copy(mat));
+	if(base->type == VAL_ERR) {
+		return base;
+	}
+	
+	unsigned long long exp = other->ival < 0 ? -(unsigned long long)other->ival : (unsigned long long)other->ival;
+	Value* ret = ValMat(identity(mat->rows));
+	
+	/* Square and multiply */
+	while(exp > 0 && ret->type != VAL_ERR) {
+		Value* tmp;
+		
+		if(exp & 1) {
+			tmp = Matrix_product(ret->mat, base->mat, ctx);
+			Value_free(ret);
+			ret = tmp;
+		}
+		
+		exp >>= 1;
+		if(exp > 0 && ret->type != VAL_ERR) {
+			tmp = Matrix_product(base->mat, base->mat, ctx);
+			Value_free(base);
+			base = tmp;
+			
+			if(base->type == VAL_ERR) {
+				Value_free(ret);
+				return base;
+			}
+		}
+	}
+	
+	Value_free(base);
+	return ret;
+}
+
+Value* Matrix_product(const Matrix* a, const Matrix* b, const Context* ctx) {
+	if(a->cols != b->rows) {
+		return ValErr(mathError("Cannot multiply a %ux%u matrix by a %ux%u matrix.",
+		                        a->rows, a->cols, b->rows, b->cols));
+	}
+	
+	if(a->kind == MAT_REAL || b->kind == MAT_REAL) {
+		return ValMat(realProduct(a, b));
+	}
+	
+	if(a->kind == MAT_INT && b->kind == MAT_INT) {
+		return ValMat(intProduct(a, b));
+	}
+	
+	return boxedProduct(a, b, ctx);
+}
+
+Value* Matrix_transpose(const Matrix* mat) {
+	unsigned rows = mat->rows, cols = mat->cols;
+	Matrix* ret = Matrix_new(cols, rows, mat->kind);
+	
+	/* Tiles keep both the rows being read and the columns being written in cache */
+	unsigned ii, jj, i, j;
+	for(ii = 0; ii < rows; ii += MAT_TILE) {
+		unsigned iend = MIN(ii + MAT_TILE, rows);
+		
+		for(jj = 0; jj < cols; jj += MAT_TILE) {
+			unsigned jend = MIN(jj + MAT_TILE, cols);
+			
+			for(i = ii; i < iend; i++) {
+				for(j = jj; j < jend; j++) {
+					size_t from = (size_t)i * cols + j;
+					size_t to = (size_t)j * rows + i;
+					
+					switch(mat->kind) {
+						case MAT_INT:
+							ret->ints[to] = mat->ints[from];
+							break;
+						
+						case MAT_REAL:
+							ret->reals[to] = mat->reals[from];
+							break;
+						
+						default:
+							ret->vals[to] = Value_copy(mat->vals[from]);
+							break;
+					}
+				}
+			}
+		}
+	}
+	
+	return ValMat(ret);
+}
+
+Value* Matrix_det(const Matrix* mat, const Context* ctx) {
+	if(mat->rows != mat->cols) {
+		return ValErr(mathError("Only square matrices have a determinant."));
+	}
+	
+	if(mat->kind != MAT_REAL) {
+		Value* ret = exactDet(mat);
+		if(ret != NULL) {
+			return ret;
+		}
+		
+		/* Too big to stay exact, so approximate it instead */
+	}
+	
+	unsigned n = mat->rows;
+	double* owned;
+	const double* reals = asReals(mat, &owned);
+	double* lu = fmalloc((size_t)n * n * sizeof(*lu));
+	unsigned* perm = fmalloc(n * sizeof(*perm));
+	memcpy(lu, reals, (size_t)n * n * sizeof(*lu));
+	
+	double det = luFactor(lu, n, perm);
+	
+	ffree(owned);
+	ffree(lu);
+	ffree(perm);
+	return ValReal(det);
+}
+
+Value* Matrix_inv(const Matrix* mat, const Context* ctx) {
+	if(mat->rows != mat->cols) {
+		return ValErr(mathError("Only square matrices can be inverted."));
+	}
+	
+	Matrix* id = identity(mat->rows);
+	Value* ret = NULL;
+	
+	if(mat->kind != MAT_REAL) {
+		ret = exactSolve(mat, id);
+	}
+	
+	if(ret == NULL) {
+		ret = realSolve(mat, id);
+	}
+	
+	Matrix_free(id);
+	return ret;
+}
+
+Value* Matrix_solve(const Matrix* mat, const Value* rhs, const Context* ctx) {
+	if(mat->rows != mat->cols) {
+		return ValErr(mathError("Only square systems can be solved."));
+	}
+	
+	/* A vector is a column, and the solution is given back as one */
+	Matrix* b;
+	if(rhs->type == VAL_VEC) {
+		const ArgList* args = rhs->vec->vals;
+		Value** vals = fmalloc(args->count * sizeof(*vals));
+		
+		unsigned i;
+		for(i = 0; i < args->count; i++) {
+			if(!isNumber(args->args[i])) {
+				freeValues(vals, i);
+				return ValErr(typeError("Matrix elements must be numbers."));
+			}
+			
+			vals[i] = Value_copy(args->args[i]);
+		}
+		
+		b = Matrix_fromValues(args->count, 1, vals);
+	}
+	else if(rhs->type == VAL_MAT) {
+		b = Matrix_copy(rhs->mat);
+	}
+	else {
+		return ValErr(typeError("Can only solve for a vector or matrix."));
+	}
+	
+	if(b->rows != mat->rows) {
+		Value* err = ValErr(mathError("Cannot solve a %ux%u system for %u rows.", mat->rows, mat->cols, b->rows));
+		Matrix_free(b);
+		return err;
+	}
+	
+	Value* ret = NULL;
+	if(mat->kind != MAT_REAL && b->kind != MAT_REAL) {
+		ret = exactSolve(mat, b);
+	}
+	
+	if(ret == NULL) {
+		ret = realSolve(mat, b);
+	}
+	
+	Matrix_free(b);
+	return rhs->type == VAL_VEC ? flatten(ret) : ret;
+}
+
+Value* Matrix_rank(const Matrix* mat, const Context* ctx) {
+	if(mat->kind != MAT_REAL) {
+		size_t count = elemCount(mat);
+		long long* a = fmalloc(count * sizeof(*a));
+		long long* scales = fmalloc(mat->rows * sizeof(*scales));
+		unsigned rank;
+		bool negate;
+		
+		bool exact = loadRows(mat, NULL, a, scales) && bareiss(a, mat->rows, mat->cols, mat->cols, &rank, &negate);
+		
+		ffree(a);
+		ffree(scales);
+		
+		if(exact) {
+			return ValInt(rank);
+		}
+	}
+	
+	return ValInt(realRank(mat));
+}
+
+Value* Matrix_elem(const Matrix* mat, const Value* index, const Context* ctx) {
+	if(index->type != VAL_INT) {
+		return ValErr(typeError("Subscript index must be an integer."));
+	}
+	
+	if(index->ival < 0) {
+		return ValErr(mathError("Subscript index cannot be negative."));
+	}
+	
+	if(index->ival >= mat->rows) {
+		return ValErr(mathError("Index %lld is out of range: [0-%u]", index->ival, mat->rows - 1));
+	}
+	
+	/* Each row is a vector, so M[i][j] is an element */
+	unsigned row = (unsigned)index->ival;
+	ArgList* args = ArgList_new(mat->cols);
+	
+	unsigned i;
+	for(i = 0; i < mat->cols; i++) {
+		args->args[i] = Matrix_get(mat, row, i);
+	}
+	
+	return ValVec(Vector_new(args));
+}
+
+void Matrix_repr(const Matrix* mat, StrBuf* sb, bool pretty) {
+	StrBuf_putc(sb, '[');
+	
+	unsigned r, c;
+	for(r = 0; r < mat->rows; r++) {
+		StrBuf_append(sb, r > 0 ? ", [" : "[");
+		
+		for(c = 0; c < mat->cols; c++) {
+			if(c > 0) {
+				StrBuf_append(sb, ", ");
+			}
+			
+			Value tmp;
+			Value_repr(borrowAt(mat, (size_t)r * mat->cols + c, &tmp), sb, pretty, false);
+		}
+		
+		StrBuf_putc(sb, ']');
+	}
+	
+	StrBuf_putc(sb, ']');
+}
+
+void Matrix_wrap(const Matrix* mat, StrBuf* sb) {
+	StrBuf_putc(sb, '[');
+	
+	unsigned r, c;
+	for(r = 0; r < mat->rows; r++) {
+		StrBuf_append(sb, r > 0 ? ", [" : "[");
+		
+		for(c = 0; c < mat->cols; c++) {
+			if(c > 0) {
+				StrBuf_append(sb, ", ");
+			}
+			
+			Value tmp;
+			Value_wrap(borrowAt(mat, (size_t)r * mat->cols + c, &tmp), sb, false);
+		}
+		
+		StrBuf_putc(sb, ']');
+	}
+	
+	StrBuf_putc(sb, ']');
+}
+
+void Matrix_verbose(const Matrix* mat, StrBuf* sb, unsigned indent) {
+	StrBuf_printf(sb, "Matrix %ux%u [", mat->rows, mat->cols);
+	
+	unsigned r, c;
+	for(r = 0; r < mat->rows; r++) {
+		StrBuf_newline(sb, indent + 1);
+		StrBuf_printf(sb, "[%u] ", r);
+		
+		for(c = 0; c < mat->cols; c++) {
+			if(c > 0) {
+				StrBuf_append(sb, ", ");
+			}
+			
+			Value tmp;
+			Value_verbose(borrowAt(mat, (size_t)r * mat->cols + c, &tmp), sb, indent + 1);
+		}
+	}
+	
+	StrBuf_newline(sb, indent);
+	StrBuf_putc(sb, ']');
+}
+
+void Matrix_xml(const Matrix* mat, StrBuf* sb, unsigned indent) {
+	/*
+	 sc> ?x [[1, 1/2], [pi, 0]]
+	
+	 <mat rows="2" cols="2">
+	   <row>
+	     <int>1</int>
+	     <div>
+	       <int>1</int>
+	       <int>2</int>
+	     </div>
+	   </row>
+	   <row>
+	     <var name="pi"/>
+	     <int>0</int>
+	   </row>
+	 </mat>
+	
+	 [[1, 0.5], [3.14159265358979, 0]]
+	*/
+	StrBuf_printf(sb, "<mat rows=\"%u\" cols=\"%u\">", mat->rows, mat->cols);
+	
+	unsigned r, c;
+	for(r = 0; r < mat->rows; r++) {
+		StrBuf_newline(sb, indent + 1);
+		StrBuf_append(sb, "<row>");
+		
+		for(c = 0; c < mat->cols; c++) {
+			Value tmp;
+			StrBuf_newline(sb, indent + 2);
+			Value_xml(borrowAt(mat, (size_t)r * mat->cols + c, &tmp), sb, indent + 2);
+		}
+		
+		StrBuf_newline(sb, indent + 1);
+		StrBuf_append(sb, "</row>");
+	}
+	
+	StrBuf_newline(sb, indent);
+	StrBuf_append(sb, "</mat>");
+}
+
+void Matrix_json(const Matrix* mat, StrBuf* sb) {
+	/*
+	 sc> ?j [[1, 2], [1/3, 4]]
+	 {"result":[[1,2],[{"num":1,"den":3,"approx":0.3333333333333333},4]]}
+	*/
+	StrBuf_putc(sb, '[');
+	
+	unsigned r, c;
+	for(r = 0; r < mat->rows; r++) {
+		StrBuf_append(sb, r > 0 ? ",[" : "[");
+		
+		for(c = 0; c < mat->cols; c++) {
+			if(c > 0) {
+				StrBuf_putc(sb, ',');
+			}
+			
+			Value tmp;
+			Value_json(borrowAt(mat, (size_t)r * mat->cols + c, &tmp), sb);
+		}
+		
+		StrBuf_putc(sb, ']');
+	}
+	
+	StrBuf_putc(sb, ']');
+}
@@ -0,0 +1,108 @@
+/*
+  matrix.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_MATRIX_H_
+#define _SC_MATRIX_H_
+
+#include <stdbool.h>
+
+typedef struct Matrix Matrix;
+#include "value.h"
+#include "vector.h"
+#include "context.h"
+#include "strbuf.h"
+
+
+typedef enum {
+	MAT_INT,
+	MAT_REAL,
+	MAT_BOXED
+} MATKIND;
+
+/*
+ Elements are stored row-major in one block. Matrices of whole numbers or
+ reals keep them unboxed, so the kernels can work on them directly. Any other
+ matrix holds Values, which once evaluated means at least one is a fraction.
+*/
+struct Matrix {
+	unsigned rows;
+	unsigned cols;
+	MATKIND kind;
+	union {
+		void*      data;
+		long long* ints;
+		double*    reals;
+		Value**    vals;
+	};
+};
+
+
+/* Constructor */
+/* Elements start as zero, or NULL when boxed */
+Matrix* Matrix_new(unsigned rows, unsigned cols, MATKIND kind);
+
+/*
+ Consumes `vals` and every Value in it. When they're all numbers, they're
+ packed into the narrowest storage that holds them exactly.
+*/
+Matrix* Matrix_fromValues(unsigned rows, unsigned cols, Value** vals);
+
+/* Destructor */
+void Matrix_free(Matrix* mat);
+
+/* Copying */
+Matrix* Matrix_copy(const Matrix* mat);
+
+/* Conversion */
+Value* Matrix_fromVector(const Vector* vec);
+Value* Matrix_get(const Matrix* mat, unsigned row, unsigned col);
+
+/* Parsing */
+Value* Matrix_parse(const char** expr, const parser_cb* cb);
+
+/* Evaluation */
+Value* Matrix_eval(const Matrix* mat, const Context* ctx);
+
+/* Arithmetic */
+/* Only products of two matrices and integer powers aren't done elementwise */
+Value* Matrix_add(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_sub(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_rsub(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_mul(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_rmul(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_div(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_rdiv(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_mod(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_rmod(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_pow(const Matrix* mat, const Value* other, const Context* ctx);
+Value* Matrix_product(const Matrix* a, const Matrix* b, const Context* ctx);
+Value* Matrix_transpose(const Matrix* mat);
+
+/*
+ Exact matrices use fraction-free Bareiss elimination, so the results stay
+ exact. Real matrices, and exact ones whose minors don't fit in a long long,
+ are factored with partial pivoting instead.
+*/
+Value* Matrix_det(const Matrix* mat, const Context* ctx);
+Value* Matrix_inv(const Matrix* mat, const Context* ctx);
+Value* Matrix_rank(const Matrix* mat, const Context* ctx);
+
+/* Solves M * x = rhs, where rhs is a vector or a matrix of right-hand sides */
+Value* Matrix_solve(const Matrix* mat, const Value* rhs, const Context* ctx);
+
+/* Access Values */
+Value* Matrix_elem(const Matrix* mat, const Value* index, const Context* ctx);
+
+/* Printing */
+void Matrix_repr(const Matrix* mat, StrBuf* sb, bool pretty);
+void Matrix_wrap(const Matrix* mat, StrBuf* sb);
+void Matrix_verbose(const Matrix* mat, StrBuf* sb, unsigned indent);
+void Matrix_xml(const Matrix* mat, StrBuf* sb, unsigned indent);
+void Matrix_json(const Matrix* mat, StrBuf* sb);
+
+#endif
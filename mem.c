@@ -0,0 +1,320 @@
+/*
+  mem.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "mem.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Starting size of the block table, which doubles once it's half full */
+#define MIN_SLOTS 1024
+
+/* A tracked allocation. Slots with no memory are empty */
+typedef struct Block {
+	void* mem;
+	size_t size;
+	const char* site;
+	MEMTAG tag;
+} Block;
+
+/* Blocks still allocated when reporting, combined by where they came from */
+typedef struct Leak {
+	const char* site;
+	MEMTAG tag;
+	size_t bytes;
+	unsigned long blocks;
+} Leak;
+
+bool mem_tracking = false;
+
+/* The table is raw memory, so it never shows up in itself */
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static Block* blocks = NULL;
+static size_t nslots = 0;
+static size_t nblocks = 0;
+
+static MemCounts tag_counts[MEM_TAG_COUNT];
+static MemCounts total_counts;
+
+static const char* const tag_names[MEM_TAG_COUNT] = {
+	"other",
+	"parser",
+	"values",
+	"vectors",
+	"fractions",
+	"context",
+	"printing"
+};
+
+
+static size_t hashPtr(const void* mem);
+static void addCounts(MemCounts* counts, size_t size, bool isNew);
+static void subCounts(MemCounts* counts, size_t size);
+static void grow(void);
+static void insertBlock(void* mem, size_t size, MEMTAG tag, const char* site);
+static bool removeBlock(const void* mem, Block* removed);
+static int compareLeaks(const void* a, const void* b);
+
+
+static size_t hashPtr(const void* mem) {
+	uint64_t bits = (uintptr_t)mem >> 4;
+	return (size_t)((bits * 0x9e3779b97f4a7c15ULL) >> 32) & (nslots - 1);
+}
+
+static void addCounts(MemCounts* counts, size_t size, bool isNew) {
+	counts->live += size;
+	if(counts->live > counts->peak) {
+		counts->peak = counts->live;
+	}
+	
+	if(isNew) {
+		counts->blocks++;
+		counts->allocs++;
+	}
+}
+
+static void subCounts(MemCounts* counts, size_t size) {
+	counts->live -= size;
+}
+
+static void grow(void) {
+	Block* old = blocks;
+	size_t oldSlots = nslots;
+	
+	nslots = nslots ? nslots * 2 : MIN_SLOTS;
+	blocks = calloc(nslots, sizeof(*blocks));
+	if(blocks == NULL) {
+		abort();
+	}
+	
+	size_t i;
+	for(i = 0; i < oldSlots; i++) {
+		if(old[i].mem != NULL) {
+			size_t slot = hashPtr(old[i].mem);
+			while(blocks[slot].mem != NULL) {
+				slot = (slot + 1) & (nslots - 1);
+			}
+			blocks[slot] = old[i];
+		}
+	}
+	
+	free(old);
+}
+
+static void insertBlock(void* mem, size_t size, MEMTAG tag, const char* site) {
+	if(2 * (nblocks + 1) > nslots) {
+		grow();
+	}
+	
+	size_t slot = hashPtr(mem);
+	while(blocks[slot].mem != NULL) {
+		slot = (slot + 1) & (nslots - 1);
+	}
+	
+	blocks[slot] = (Block){mem, size, site, tag};
+	nblocks++;
+}
+
+/* Linear probing, so later blocks in the run are shifted back to fill the hole */
+static bool removeBlock(const void* mem, Block* removed) {
+	if(nslots == 0) {
+		return false;
+	}
+	
+	size_t mask = nslots - 1;
+	size_t i = hashPtr(mem);
+	while(blocks[i].mem != mem) {
+		if(blocks[i].mem == NULL) {
+			return false;
+		}
+		i = (i + 1) & mask;
+	}
+	
+	*removed = blocks[i];
+	nblocks--;
+	
+	size_t j = i;
+	while(true) {
+		j = (j + 1) & mask;
+		if(blocks[j].mem == NULL) {
+			break;
+		}
+		
+		/* Blocks whose home slot is cyclically within (i, j] have to stay put */
+		size_t home = hashPtr(blocks[j].mem);
+		bool stays = (i < j) ? (home > i && home <= j) : (home > i || home <= j);
+		if(!stays) {
+			blocks[i] = blocks[j];
+			i = j;
+		}
+	}
+	
+	blocks[i].mem = NULL;
+	return true;
+}
+
+/* Biggest first */
+static int compareLeaks(const void* a, const void* b) {
+	const Leak* la = a;
+	const Leak* lb = b;
+	
+	if(la->bytes != lb->bytes) {
+		return la->bytes < lb->bytes ? 1 : -1;
+	}
+	
+	return strcmp(la->site, lb->site);
+}
+
+
+void Mem_startTracking(void) {
+	mem_tracking = true;
+}
+
+void* Mem_alloc(size_t size, bool zero, MEMTAG tag, const char* site) {
+	void* ret = zero ? calloc(1, size) : malloc(size);
+	if(ret == NULL) {
+		return NULL;
+	}
+	
+	pthread_mutex_lock(&mem_lock);
+	insertBlock(ret, size, tag, site);
+	addCounts(&tag_counts[tag], size, true);
+	addCounts(&total_counts, size, true);
+	pthread_mutex_unlock(&mem_lock);
+	
+	return ret;
+}
+
+void* Mem_realloc(void* mem, size_t size, MEMTAG tag, const char* site) {
+	if(mem == NULL) {
+		return Mem_alloc(size, false, tag, site);
+	}
+	
+	/* Held throughout, since the old address can be handed out again as soon as it moves */
+	pthread_mutex_lock(&mem_lock);
+	
+	Block old;
+	bool isNew = !removeBlock(mem, &old);
+	
+	void* ret = realloc(mem, size);
+	if(ret == NULL) {
+		/* The old block is still there */
+		if(!isNew) {
+			insertBlock(mem, old.size, old.tag, old.site);
+		}
+		
+		pthread_mutex_unlock(&mem_lock);
+		return NULL;
+	}
+	
+	/* A block keeps the subsystem that first allocated it */
+	if(!isNew) {
+		tag = old.tag;
+		subCounts(&tag_counts[tag], old.size);
+		subCounts(&total_counts, old.size);
+	}
+	
+	insertBlock(ret, size, tag, site);
+	addCounts(&tag_counts[tag], size, isNew);
+	addCounts(&total_counts, size, isNew);
+	
+	pthread_mutex_unlock(&mem_lock);
+	return ret;
+}
+
+void Mem_free(void* mem) {
+	if(mem == NULL) {
+		return;
+	}
+	
+	pthread_mutex_lock(&mem_lock);
+	
+	/* Memory from the C library was never recorded */
+	Block old;
+	if(removeBlock(mem, &old)) {
+		subCounts(&tag_counts[old.tag], old.size);
+		tag_counts[old.tag].blocks--;
+		subCounts(&total_counts, old.size);
+		total_counts.blocks--;
+	}
+	
+	pthread_mutex_unlock(&mem_lock);
+	
+	free(mem);
+}
+
+void Mem_counts(MEMTAG tag, MemCounts* counts) {
+	pthread_mutex_lock(&mem_lock);
+	*counts = (tag == MEM_TAG_COUNT) ? total_counts : tag_counts[tag];
+	pthread_mutex_unlock(&mem_lock);
+}
+
+const char* Mem_tagName(MEMTAG tag) {
+	return tag_names[tag];
+}
+
+size_t Mem_report(FILE* fp) {
+	pthread_mutex_lock(&mem_lock);
+	
+	fprintf(fp, "%-10s %12s %12s %12s\n", "Subsystem", "Live", "Peak", "Allocations");
+	
+	unsigned t;
+	for(t = 0; t < MEM_TAG_COUNT; t++) {
+		const MemCounts* c = &tag_counts[t];
+		fprintf(fp, "%-10s %12zu %12zu %12lu\n", tag_names[t], c->live, c->peak, c->allocs);
+	}
+	fprintf(fp, "%-10s %12zu %12zu %12lu\n", "total", total_counts.live, total_counts.peak, total_counts.allocs);
+	
+	size_t ret = total_counts.live;
+	if(nblocks == 0) {
+		pthread_mutex_unlock(&mem_lock);
+		return ret;
+	}
+	
+	/* Sites are string literals, so the same site always has the same address */
+	Leak* leaks = calloc(nblocks, sizeof(*leaks));
+	size_t nleaks = 0;
+	
+	size_t i;
+	for(i = 0; leaks != NULL && i < nslots; i++) {
+		const Block* b = &blocks[i];
+		if(b->mem == NULL) {
+			continue;
+		}
+		
+		size_t j = 0;
+		while(j < nleaks && leaks[j].site != b->site) {
+			j++;
+		}
+		
+		if(j == nleaks) {
+			leaks[nleaks++] = (Leak){b->site, b->tag, 0, 0};
+		}
+		
+		leaks[j].bytes += b->size;
+		leaks[j].blocks++;
+	}
+	
+	fprintf(fp, "\nStill allocated: %zu bytes in %zu block%s\n", ret, nblocks, nblocks == 1 ? "" : "s");
+	pthread_mutex_unlock(&mem_lock);
+	
+	if(leaks == NULL) {
+		return ret;
+	}
+	
+	qsort(leaks, nleaks, sizeof(*leaks), &compareLeaks);
+	for(i = 0; i < nleaks; i++) {
+		fprintf(fp, "%12zu bytes in %lu block%s from %s (%s)\n",
+		        leaks[i].bytes, leaks[i].blocks, leaks[i].blocks == 1 ? "" : "s",
+		        leaks[i].site, tag_names[leaks[i].tag]);
+	}
+	
+	free(leaks);
+	return ret;
+}
@@ -0,0 +1,68 @@
+/*
+  mem.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_MEM_H_
+#define _SC_MEM_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ Subsystems that allocations are counted under. A file picks its own by
+ defining MEM_TAG before including anything, and is MEM_OTHER otherwise.
+*/
+typedef enum {
+	MEM_OTHER,
+	MEM_PARSER,
+	MEM_VALUES,
+	MEM_VECTORS,
+	MEM_FRACTIONS,
+	MEM_CONTEXT,
+	MEM_PRINTING,
+	MEM_TAG_COUNT
+} MEMTAG;
+
+typedef struct MemCounts {
+	/* Bytes allocated and not freed yet, and the most there ever were */
+	size_t live;
+	size_t peak;
+	
+	unsigned long blocks;
+	unsigned long allocs;
+} MemCounts;
+
+/* Set once tracking starts, and never cleared */
+extern bool mem_tracking;
+
+
+/*
+ From here on, fmalloc, fcalloc, frealloc and fstrdup record where each block
+ came from and ffree forgets it again. Call this before anything is allocated,
+ since blocks from before aren't counted. Memory from the C library, such as
+ from asprintf or open_memstream, isn't counted either.
+*/
+void Mem_startTracking(void);
+
+/* Used by the allocation wrappers in generic.h while tracking */
+void* Mem_alloc(size_t size, bool zero, MEMTAG tag, const char* site);
+void* Mem_realloc(void* mem, size_t size, MEMTAG tag, const char* site);
+void Mem_free(void* mem);
+
+/* Counts for one subsystem, or for all of them with MEM_TAG_COUNT */
+void Mem_counts(MEMTAG tag, MemCounts* counts);
+
+const char* Mem_tagName(MEMTAG tag);
+
+/*
+ Prints the counts for each subsystem, then every block still allocated,
+ grouped by where it was allocated. Returns the number of bytes still live.
+*/
+size_t Mem_report(FILE* fp);
+
+#endif /* _SC_MEM_H_ */
@@ -0,0 +1,235 @@
+/*
+  memcheck.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Runs a script touching every subsystem with memory tracking on, both alone
+ and with parallel jobs, then frees everything. Nothing may still be
+ allocated afterwards, so leaks like a pushed frame dropping a globals list of
+ its own show up here. Each subsystem must have counted something too.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "supercalc.h"
+#include "generic.h"
+#include "mem.h"
+#include "watch.h"
+
+static const char* script =
+	"f(x) = 3x + 4\n"
+	"g(x, y) = f(x) * y + sqrt(x)\n"
+	"g(9, 2) + f(f(f(1)))\n"
+	"map(f, <1, 2, 3, 4>)\n"
+	"cross(<1, 0, 0>, <0, 1, 0>) + <1/3, 2/5, 7>\n"
+	"(2 / 7) ^ 2 + 5/6\n"
+	"rate = 1/20\n"
+	"total := 1200 * (1 + rate)^3\n"
+	"?u total\n"
+	"rate = 0.06\n"
+	"?sj total + g(1, 2)\n"
+	"?t f(2) + <1, f(3)>[0]\n"
+	"?x sqrt(f(4))\n"
+	"?p g(4, 1/3)\n"
+	"g(4, 1/3)\n"
+	"g(4, 1/3)\n"
+	"missing + 1\n"
+	"1 / 0\n"
+	"sqrt(1, 2)\n"
+	"3 +* 4\n"
+	"f(1, 2)\n"
+	"loop := loop + 1\n"
+	"loop\n"
+	"~f\n"
+	"f(2)\n"
+	"m = [[1, 2], [3, 4]]\n"
+	"inv(m) * m + transpose(m)^2\n"
+	"det([[1/2, 1], [1, 3.5]]) + |m * <1, 2>|\n"
+	"[[1, 2], [3]]\n"
+	"solve(<<1/2, 1>, <1, 3>>, <1, 2>) + solve(m, <1.5, 2>)\n"
+	"rank(m) + det([[2^62, 3], [5, 2^62]])\n"
+	"solve([[1, 2], [2, 4]], m)\n"
+	"~~~\n"
+	"rate\n";
+
+static unsigned failures = 0;
+
+
+static void runScript(unsigned jobs);
+static void runWatch(void);
+static void writeFile(const char* path, const char* text);
+static void runPoll(void);
+static void expectCounted(MEMTAG tag);
+
+
+static void runScript(unsigned jobs) {
+	char* out = NULL;
+	size_t outlen = 0;
+	char* err = NULL;
+	size_t errlen = 0;
+	
+	FILE* fin = fmemopen((char*)script, strlen(script), "r");
+	FILE* fout = open_memstream(&out, &outlen);
+	FILE* ferr = open_memstream(&err, &errlen);
+	
+	SuperCalc* sc = SC_new(fout);
+	sc->ferr = ferr;
+	SC_setJobs(sc, jobs);
+	
+	Value* last = SC_runFile(sc, fin, "");
+	if(last) {
+		Value_free(last);
+	}
+	
+	/* Bindings are captured with their current value when preparing */
+	const char* params[] = {"x"};
+	double result = 0;
+	SC_exec(sc, "a = 3", NULL, NULL);
+	SC_exec(sc, "b := 2a + 4", NULL, NULL);
+	Prepared* prep = SC_prepare(sc, "b + x", params, 1, NULL);
+	if(prep == NULL || Prepared_eval(prep, (double[]){1}, &result, NULL) != SC_OK || result != 11) {
+		fprintf(stderr, "Preparing an expression that reads a binding failed\n");
+		failures++;
+	}
+	
+	if(prep != NULL) {
+		Prepared_free(prep);
+	}
+	
+	/* Live bytes, peak bytes and allocations */
+	double live;
+	if(SC_exec(sc, "memstats()[0]", &live, NULL) != SC_OK || live <= 0) {
+		fprintf(stderr, "memstats() didn't report any live memory\n");
+		failures++;
+	}
+	
+	SC_free(sc);
+	fclose(fin);
+	fclose(fout);
+	fclose(ferr);
+	free(out);
+	free(err);
+}
+
+/* Editing one line and appending another only evaluates those two */
+static void runWatch(void) {
+	char* out = NULL;
+	size_t outlen = 0;
+	FILE* fout = open_memstream(&out, &outlen);
+	
+	SuperCalc* sc = SC_new(fout);
+	Watch* w = Watch_new(sc);
+	
+	Watch_update(w, "a = 1\nb = 2\nx = a + b\nc = 10\nc + 1\nb * 2\n");
+	unsigned evaluated = Watch_update(w, "a = 1\nb = 2\nx = a - b\nc = 10\nc + 1\nb * 2\nx * 3\n");
+	if(evaluated != 2) {
+		fprintf(stderr, "Watch evaluated %u lines after two edits\n", evaluated);
+		failures++;
+	}
+	
+	Watch_free(w);
+	SC_free(sc);
+	fclose(fout);
+	free(out);
+}
+
+static void writeFile(const char* path, const char* text) {
+	FILE* fp = fopen(path, "w");
+	fputs(text, fp);
+	fclose(fp);
+}
+
+/* A file that's truncated and then rewritten is only read once it settles */
+static void runPoll(void) {
+	char path[] = "/tmp/memcheck-XXXXXX";
+	int fd = mkstemp(path);
+	if(fd < 0) {
+		fprintf(stderr, "Unable to create a file to watch\n");
+		failures++;
+		return;
+	}
+	close(fd);
+	
+	char* out = NULL;
+	size_t outlen = 0;
+	FILE* fout = open_memstream(&out, &outlen);
+	
+	SuperCalc* sc = SC_new(fout);
+	Watch* w = Watch_new(sc);
+	unsigned evaluated = 0;
+	
+	writeFile(path, "a = 1\nb = 2\n");
+	if(Watch_poll(w, path, &evaluated) || !Watch_poll(w, path, &evaluated) || evaluated != 2) {
+		fprintf(stderr, "Watch didn't read the file once it settled\n");
+		failures++;
+	}
+	
+	writeFile(path, "");
+	if(Watch_poll(w, path, &evaluated)) {
+		fprintf(stderr, "Watch read a file that was just truncated\n");
+		failures++;
+	}
+	
+	writeFile(path, "a = 1\nb = 30\n");
+	bool early = Watch_poll(w, path, &evaluated);
+	if(early || !Watch_poll(w, path, &evaluated) || evaluated != 1 || Watch_lines(w) != 2) {
+		fprintf(stderr, "Watch didn't read the rewritten file as one edit\n");
+		failures++;
+	}
+	
+	Watch_free(w);
+	SC_free(sc);
+	fclose(fout);
+	free(out);
+	unlink(path);
+}
+
+static void expectCounted(MEMTAG tag) {
+	MemCounts counts;
+	Mem_counts(tag, &counts);
+	
+	if(counts.allocs == 0) {
+		fprintf(stderr, "Nothing was allocated by %s\n", Mem_tagName(tag));
+		failures++;
+	}
+}
+
+int main(void) {
+	Mem_startTracking();
+	
+	runScript(1);
+	runScript(4);
+	runWatch();
+	runPoll();
+	
+	MEMTAG tag;
+	for(tag = MEM_PARSER; tag < MEM_TAG_COUNT; tag++) {
+		expectCounted(tag);
+	}
+	
+	/* Shared caches belong to no instance */
+	SC_cleanup();
+	
+	MemCounts total;
+	Mem_counts(MEM_TAG_COUNT, &total);
+	if(total.live != 0 || total.blocks != 0) {
+		Mem_report(stderr);
+		failures++;
+	}
+	
+	if(failures > 0) {
+		fprintf(stderr, "%u failures\n", failures);
+		return EXIT_FAILURE;
+	}
+	
+	printf("No leaks after %lu allocations, peak %zu bytes\n", total.allocs, total.peak);
+	return 0;
+}
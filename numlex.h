@@ -0,0 +1,31 @@
+/*
+  numlex.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_NUMLEX_H_
+#define _SC_NUMLEX_H_
+
+typedef enum {
+	NUM_NONE = 0,
+	NUM_INT,
+	NUM_REAL,
+	NUM_RANGE,
+	NUM_REAL_RANGE
+} NUMKIND;
+
+/*
+ Scans the numeric literal at *expr and moves past it. Decimal literals may
+ have a fraction and an exponent, and hex (0x1f) and binary (0b101) literals
+ are always integers. Underscores may separate digits, as in 1_000_000.
+ Decimal integers too large for a long long become reals. Returns NUM_RANGE
+ for a hex or binary literal that's too large, NUM_REAL_RANGE for a real that
+ would overflow to infinity or underflow to zero, or NUM_NONE without moving
+ if there's no literal. Doesn't depend on the locale.
+*/
+NUMKIND lexNumber(const char** expr, long long* ival, double* rval);
+
+#endif /* _SC_NUMLEX_H_ */
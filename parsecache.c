@@ -0,0 +1,160 @@
+/*
+  parsecache.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_PARSER
+
+#include "parsecache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "generic.h"
+#include "statement.h"
+#include "lru.h"
+
+typedef struct Entry {
+	LruNode node;
+	Statement* stmt;
+	size_t len;
+	char key[];
+} Entry;
+
+/* A line without its trailing whitespace */
+typedef struct Key {
+	const char* text;
+	size_t len;
+} Key;
+
+struct ParseCache {
+	Lru lru;
+	ParseCacheStats stats;
+};
+
+
+static unsigned hashKey(const char* key, size_t len);
+static size_t keyLength(const char* code);
+static bool matchKey(const LruNode* node, const void* key);
+static void freeEntry(Entry* entry);
+static void evict(ParseCache* cache);
+
+
+/* FNV-1a */
+static unsigned hashKey(const char* key, size_t len) {
+	unsigned hash = 2166136261u;
+	
+	size_t i;
+	for(i = 0; i < len; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 16777619u;
+	}
+	
+	return hash;
+}
+
+/* Length of the line without trailing whitespace */
+static size_t keyLength(const char* code) {
+	size_t len = strlen(code);
+	while(len > 0 && isspace((unsigned char)code[len - 1])) {
+		len--;
+	}
+	
+	return len;
+}
+
+static bool matchKey(const LruNode* node, const void* key) {
+	const Entry* entry = (const Entry*)node;
+	const Key* k = key;
+	return entry->len == k->len && memcmp(entry->key, k->text, k->len) == 0;
+}
+
+static void freeEntry(Entry* entry) {
+	/* Statements still being evaluated hold their own references */
+	Statement_free(entry->stmt);
+	ffree(entry);
+}
+
+/* Drops the least recently used entry */
+static void evict(ParseCache* cache) {
+	Entry* entry = (Entry*)Lru_oldest(&cache->lru);
+	Lru_remove(&cache->lru, &entry->node);
+	freeEntry(entry);
+	
+	cache->stats.evictions++;
+}
+
+
+ParseCache* ParseCache_new(unsigned capacity) {
+	ParseCache* ret = fcalloc(1, sizeof(*ret));
+	
+	Lru_init(&ret->lru, MEM_TAG);
+	ParseCache_setCapacity(ret, capacity);
+	
+	return ret;
+}
+
+void ParseCache_free(ParseCache* cache) {
+	ParseCache_clear(cache);
+	Lru_destroy(&cache->lru);
+	ffree(cache);
+}
+
+Statement* ParseCache_parse(ParseCache* cache, const char* code) {
+	if(cache->stats.capacity == 0) {
+		cache->stats.misses++;
+		return Statement_parse(&code);
+	}
+	
+	Key key = {code, keyLength(code)};
+	unsigned hash = hashKey(key.text, key.len);
+	
+	Entry* entry = (Entry*)Lru_find(&cache->lru, hash, &key, &matchKey);
+	if(entry != NULL) {
+		cache->stats.hits++;
+		Lru_touch(&cache->lru, &entry->node);
+		return Statement_retain(entry->stmt);
+	}
+	
+	cache->stats.misses++;
+	
+	if(cache->lru.count >= cache->stats.capacity) {
+		evict(cache);
+	}
+	
+	entry = fmalloc(sizeof(*entry) + key.len + 1);
+	memcpy(entry->key, code, key.len);
+	entry->key[key.len] = '\0';
+	entry->len = key.len;
+	entry->stmt = Statement_parse(&code);
+	Lru_insert(&cache->lru, &entry->node, hash);
+	
+	return Statement_retain(entry->stmt);
+}
+
+void ParseCache_clear(ParseCache* cache) {
+	LruNode* node = Lru_takeAll(&cache->lru);
+	while(node != NULL) {
+		LruNode* next = node->next;
+		freeEntry((Entry*)node);
+		node = next;
+	}
+}
+
+void ParseCache_setCapacity(ParseCache* cache, unsigned capacity) {
+	cache->stats.capacity = capacity;
+	
+	while(cache->lru.count > capacity) {
+		evict(cache);
+	}
+	
+	Lru_resize(&cache->lru, capacity);
+}
+
+void ParseCache_stats(const ParseCache* cache, ParseCacheStats* stats) {
+	*stats = cache->stats;
+	stats->count = cache->lru.count;
+}
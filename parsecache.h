@@ -0,0 +1,49 @@
+/*
+  parsecache.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_PARSECACHE_H_
+#define _SC_PARSECACHE_H_
+
+typedef struct ParseCache ParseCache;
+#include "statement.h"
+
+typedef struct ParseCacheStats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+	unsigned count;
+	unsigned capacity;
+} ParseCacheStats;
+
+
+/*
+ Remembers the statements parsed from recently seen lines, so a line that is
+ entered again skips the parser. Parsing doesn't depend on the context, so
+ entries stay valid when variables change and are only dropped to make room
+ for newer lines. A capacity of 0 disables caching.
+*/
+ParseCache* ParseCache_new(unsigned capacity);
+
+/* Destructor */
+void ParseCache_free(ParseCache* cache);
+
+/*
+ Returns a reference to the statement for `code`, which the caller releases
+ with Statement_free. Trailing whitespace doesn't make a line different.
+*/
+Statement* ParseCache_parse(ParseCache* cache, const char* code);
+
+/* Drops every entry, keeping the statistics */
+void ParseCache_clear(ParseCache* cache);
+
+/* Least recently used entries are evicted until at most `capacity` remain */
+void ParseCache_setCapacity(ParseCache* cache, unsigned capacity);
+
+void ParseCache_stats(const ParseCache* cache, ParseCacheStats* stats);
+
+#endif /* _SC_PARSECACHE_H_ */
@@ -0,0 +1,192 @@
+/*
+  perf.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "perf.h"
+#include <string.h>
+#include <inttypes.h>
+
+#ifdef __linux__
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/perf_event.h>
+#endif
+
+#include "support.h"
+
+static const char* const perf_names[PERF_COUNT] = {
+	"cycles",
+	"instructions",
+	"cache misses",
+	"branch misses"
+};
+
+static const char* const perf_keys[PERF_COUNT] = {
+	"cycles",
+	"instructions",
+	"cache_misses",
+	"branch_misses"
+};
+
+#ifdef __linux__
+
+static const uint64_t perf_configs[PERF_COUNT] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/* The first counter that opened leads the group, so they're all read at once */
+static THREAD_LOCAL bool perf_tried = false;
+static THREAD_LOCAL int perf_fds[PERF_COUNT];
+static THREAD_LOCAL int perf_leader = -1;
+
+/* Which counter each value read from the group belongs to, in the order they joined */
+static THREAD_LOCAL PERFCOUNTER perf_order[PERF_COUNT];
+static THREAD_LOCAL unsigned perf_members = 0;
+
+
+static int openCounter(PERFCOUNTER counter, int group);
+static void openGroup(void);
+
+
+static int openCounter(PERFCOUNTER counter, int group) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = perf_configs[counter];
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	
+	/* This thread, on any CPU */
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void openGroup(void) {
+	perf_tried = true;
+	
+	unsigned i;
+	for(i = 0; i < PERF_COUNT; i++) {
+		perf_fds[i] = openCounter(i, perf_leader);
+		if(perf_fds[i] < 0) {
+			continue;
+		}
+		
+		if(perf_leader < 0) {
+			perf_leader = perf_fds[i];
+		}
+		
+		perf_order[perf_members++] = i;
+	}
+}
+
+void Perf_read(PerfCounts* counts) {
+	memset(counts, 0, sizeof(*counts));
+	
+	if(!perf_tried) {
+		openGroup();
+	}
+	
+	if(perf_leader < 0) {
+		return;
+	}
+	
+	struct {
+		uint64_t nr;
+		uint64_t timeRunning;
+		uint64_t values[PERF_COUNT];
+	} group;
+	
+	ssize_t len = read(perf_leader, &group, sizeof(group));
+	
+	/* Counters that were never scheduled onto the PMU have nothing to say */
+	if(len < (ssize_t)(2 * sizeof(uint64_t)) || group.timeRunning == 0) {
+		return;
+	}
+	
+	unsigned i;
+	for(i = 0; i < group.nr && i < perf_members; i++) {
+		counts->values[perf_order[i]] = group.values[i];
+		counts->valid |= 1u << perf_order[i];
+	}
+}
+
+void Perf_close(void) {
+	unsigned i;
+	for(i = 0; i < PERF_COUNT && perf_tried; i++) {
+		if(perf_fds[i] >= 0) {
+			close(perf_fds[i]);
+		}
+	}
+	
+	perf_tried = false;
+	perf_leader = -1;
+	perf_members = 0;
+}
+
+#else /* __linux__ */
+
+void Perf_read(PerfCounts* counts) {
+	memset(counts, 0, sizeof(*counts));
+}
+
+void Perf_close(void) {
+}
+
+#endif /* __linux__ */
+
+void Perf_diff(const PerfCounts* before, const PerfCounts* after, PerfCounts* diff) {
+	diff->valid = before->valid & after->valid;
+	
+	unsigned i;
+	for(i = 0; i < PERF_COUNT; i++) {
+		diff->values[i] = after->values[i] - before->values[i];
+	}
+}
+
+void Perf_add(PerfCounts* total, const PerfCounts* counts) {
+	total->valid |= counts->valid;
+	
+	unsigned i;
+	for(i = 0; i < PERF_COUNT; i++) {
+		total->values[i] += counts->values[i];
+	}
+}
+
+void Perf_print(const PerfCounts* counts, double scale, StrBuf* sb, bool json) {
+	bool first = true;
+	
+	unsigned i;
+	for(i = 0; i < PERF_COUNT; i++) {
+		if(!(counts->valid & (1u << i))) {
+			continue;
+		}
+		
+		if(!first) {
+			StrBuf_append(sb, json ? "," : ", ");
+		}
+		first = false;
+		
+		if(json) {
+			StrBuf_printf(sb, "\"%s\":", perf_keys[i]);
+		}
+		
+		if(scale == 1) {
+			StrBuf_printf(sb, "%" PRIu64, counts->values[i]);
+		}
+		else {
+			StrBuf_printf(sb, "%.1f", counts->values[i] / scale);
+		}
+		
+		if(!json) {
+			StrBuf_printf(sb, " %s", perf_names[i]);
+		}
+	}
+}
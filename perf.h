@@ -0,0 +1,56 @@
+/*
+  perf.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_PERF_H_
+#define _SC_PERF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "strbuf.h"
+
+typedef enum {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_COUNT
+} PERFCOUNTER;
+
+typedef struct PerfCounts {
+	uint64_t values[PERF_COUNT];
+	
+	/* Bit (1 << counter) for each counter that was actually counted */
+	unsigned valid;
+} PerfCounts;
+
+
+/*
+ Reads the hardware counters of the calling thread, which start counting the
+ first time it calls this. Only user space is counted. Counters the kernel or
+ the machine won't provide are left out of `valid`, which is 0 when none are
+ available, such as on other systems or with perf_event_paranoid set too high.
+*/
+void Perf_read(PerfCounts* counts);
+
+/* What was counted from `before` to `after` */
+void Perf_diff(const PerfCounts* before, const PerfCounts* after, PerfCounts* diff);
+
+/* Adds `counts` to `total` */
+void Perf_add(PerfCounts* total, const PerfCounts* counts);
+
+/*
+ Appends "1200 cycles, 800 instructions, ..." for the valid counters, each
+ divided by `scale`, or JSON members like "cycles":1200 when `json` is set
+*/
+void Perf_print(const PerfCounts* counts, double scale, StrBuf* sb, bool json);
+
+/* Stops counting on the calling thread */
+void Perf_close(void);
+
+#endif /* _SC_PERF_H_ */
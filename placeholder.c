@@ -6,6 +6,8 @@
 //  Copyright (c) 2015 C0deH4cker. All rights reserved.
 //
 
+#define MEM_TAG MEM_PARSER
+
 #include "placeholder.h"
 #include <string.h>
 #include <ctype.h>
@@ -29,7 +31,7 @@ static PLACETYPE getPlaceholderType(char type) {
 		case 'n': return PH_VAR;
 		case 'v': return PH_VEC;
 		case '@': return PH_VAL;
-			
+		
 		default:  return PH_ERR;
 	}
 }
@@ -54,7 +56,7 @@ Placeholder* Placeholder_fromString(const char* fmt) {
 
 /* Destructor */
 void Placeholder_free(Placeholder* ph) {
-	free(ph);
+	ffree(ph);
 }
 
 /* Copying */
@@ -110,26 +112,22 @@ static char getFormatChar(PLACETYPE type) {
 		case PH_VAR:    return 'n';
 		case PH_VEC:    return 'v';
 		case PH_VAL:    return '@';
-			
+		
 		default:         return '\0';
 	}
 }
 
 /* Printing */
-char* Placeholder_repr(const Placeholder* ph) {
-	char* ret;
-	
+void Placeholder_repr(const Placeholder* ph, StrBuf* sb) {
 	if(ph->index > 0) {
-		asprintf(&ret, "@%u%c", ph->index, getFormatChar(ph->type));
+		StrBuf_printf(sb, "@%u%c", ph->index, getFormatChar(ph->type));
 	}
 	else {
-		asprintf(&ret, "@%c", getFormatChar(ph->type));
+		StrBuf_printf(sb, "@%c", getFormatChar(ph->type));
 	}
-	
-	return ret;
 }
 
-char* Placeholder_xml(const Placeholder* ph, unsigned indent) {
+void Placeholder_xml(const Placeholder* ph, StrBuf* sb, unsigned indent) {
 	/*
 	 "@1i^(1/2)"
 	 <pow>
@@ -140,19 +138,28 @@ char* Placeholder_xml(const Placeholder* ph, unsigned indent) {
 	   </div>
 	 </pow>
 	*/
-	char* ret;
-	
 	if(ph->index > 0) {
-		asprintf(&ret,
-				 "<placeholder type=\"%c\" index=\"%u\"/>",
-				 ph->index, getFormatChar(ph->type));
+		StrBuf_printf(sb,
+					  "<placeholder type=\"%c\" index=\"%u\"/>",
+					  getFormatChar(ph->type), ph->index);
 	}
 	else {
-		asprintf(&ret,
-				 "<placeholder type=\"%c\"/>",
-				 getFormatChar(ph->type));
+		StrBuf_printf(sb,
+					  "<placeholder type=\"%c\"/>",
+					  getFormatChar(ph->type));
+	}
+}
+
+void Placeholder_json(const Placeholder* ph, StrBuf* sb) {
+	if(ph->index > 0) {
+		StrBuf_printf(sb,
+					  "{\"placeholder\":\"%c\",\"index\":%u}",
+					  getFormatChar(ph->type), ph->index);
+	}
+	else {
+		StrBuf_printf(sb,
+					  "{\"placeholder\":\"%c\"}",
+					  getFormatChar(ph->type));
 	}
-	
-	return ret;
 }
 
@@ -45,7 +45,8 @@ Placeholder* Placeholder_copy(const Placeholder* ph);
 Placeholder* Placeholder_parse(const char** expr);
 
 /* Printing */
-char* Placeholder_repr(const Placeholder* ph);
-char* Placeholder_xml(const Placeholder* ph, unsigned indent);
+void Placeholder_repr(const Placeholder* ph, StrBuf* sb);
+void Placeholder_xml(const Placeholder* ph, StrBuf* sb, unsigned indent);
+void Placeholder_json(const Placeholder* ph, StrBuf* sb);
 
 #endif /* _SC_PLACEHOLDER_H_ */
@@ -0,0 +1,751 @@
+/*
+  prepared.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "prepared.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "generic.h"
+#include "error.h"
+#include "value.h"
+#include "context.h"
+#include "variable.h"
+#include "arglist.h"
+#include "binop.h"
+#include "unop.h"
+#include "funccall.h"
+#include "function.h"
+#include "builtin.h"
+#include "vector.h"
+#include "matrix.h"
+
+/* Calls with at most this many arguments keep their parameter slots on the stack */
+#define STACK_SLOTS 8
+
+typedef enum {
+	PN_CONST,
+	PN_PARAM,
+	PN_BINOP,
+	PN_UNOP,
+	PN_BUILTIN,
+	PN_FUNC,
+	PN_VEC,
+	PN_MAT
+} PNTYPE;
+
+typedef struct PrepNode PrepNode;
+typedef struct PrepFunc PrepFunc;
+
+/*
+ The parsed tree is lowered into these nodes when preparing. Parameters become
+ slot indices, global variables become constants, and calls point straight at
+ the builtin or lowered user function they resolve to.
+*/
+struct PrepNode {
+	PNTYPE type;
+	int op;              /* BINTYPE or UNTYPE */
+	unsigned slot;       /* PN_PARAM */
+	Value* val;          /* PN_CONST */
+	const Builtin* blt;  /* PN_BUILTIN */
+	bool internal;
+	PrepFunc* func;      /* PN_FUNC */
+	unsigned cols;       /* PN_MAT */
+	unsigned count;
+	PrepNode** args;     /* Operands, call arguments, or vector or matrix elements */
+};
+
+/* Each user function is lowered once per handle, no matter how often it's called */
+struct PrepFunc {
+	const Function* src;
+	PrepNode* body;      /* NULL while the body is being lowered */
+	PrepFunc* next;
+};
+
+struct Prepared {
+	Context* ctx;
+	unsigned nparams;
+	PrepNode* root;
+	PrepFunc* funcs;
+};
+
+/* State while lowering one tree, either the expression or a function body */
+typedef struct Lowering {
+	Prepared* prep;
+	const char* const* names;
+	unsigned count;
+} Lowering;
+
+
+static PrepNode* allocNode(PNTYPE type, unsigned count);
+static PrepNode* constNode(Value* val);
+static void freeNode(PrepNode* node);
+static bool isFuncName(const PrepNode* node);
+static PrepNode* lowerValue(Lowering* lo, const Value* val, Error** err);
+static PrepNode* lowerOperand(Lowering* lo, const Value* val, Error** err);
+static PrepNode* lowerArgs(Lowering* lo, PrepNode* node, const ArgList* arglist, bool raw, Error** err);
+static PrepNode* lowerVar(Lowering* lo, const char* name, Error** err);
+static PrepNode* lowerCall(Lowering* lo, const FuncCall* call, Error** err);
+static PrepFunc* lowerFunc(Lowering* lo, const char* name, const Function* func, Error** err);
+static PrepNode* foldConstant(const Prepared* prep, PrepNode* node);
+static Prepared* prepare(const Context* ctx, const Value* tree,
+                         const char* const* params, unsigned count, Error** err);
+static Value* evalNode(const Prepared* prep, const PrepNode* node, Value* const* slots);
+static const Value* evalOperand(const Prepared* prep, const PrepNode* node, Value* const* slots, Value** owned);
+static ArgList* evalArgs(const Prepared* prep, const PrepNode* node, Value* const* slots, Value** err);
+
+
+static PrepNode* allocNode(PNTYPE type, unsigned count) {
+	PrepNode* ret = fcalloc(1, sizeof(*ret));
+	
+	ret->type = type;
+	ret->count = count;
+	if(count > 0) {
+		ret->args = fcalloc(count, sizeof(*ret->args));
+	}
+	
+	return ret;
+}
+
+static PrepNode* constNode(Value* val) {
+	PrepNode* ret = allocNode(PN_CONST, 0);
+	ret->val = val;
+	return ret;
+}
+
+static void freeNode(PrepNode* node) {
+	if(node == NULL) {
+		return;
+	}
+	
+	unsigned i;
+	for(i = 0; i < node->count; i++) {
+		freeNode(node->args[i]);
+	}
+	
+	if(node->val) {
+		Value_free(node->val);
+	}
+	
+	ffree(node->args);
+	ffree(node);
+}
+
+/* Function names may only be passed straight to builtins like map */
+static bool isFuncName(const PrepNode* node) {
+	return node->type == PN_CONST && node->val->type == VAL_VAR;
+}
+
+static PrepNode* lowerOperand(Lowering* lo, const Value* val, Error** err) {
+	PrepNode* ret = lowerValue(lo, val, err);
+	
+	if(ret != NULL && isFuncName(ret)) {
+		*err = typeError("Variable '%s' is a function.", ret->val->name);
+		freeNode(ret);
+		return NULL;
+	}
+	
+	return ret;
+}
+
+/* Fills in the node's arguments, freeing it on failure */
+static PrepNode* lowerArgs(Lowering* lo, PrepNode* node, const ArgList* arglist, bool raw, Error** err) {
+	unsigned i;
+	for(i = 0; i < arglist->count; i++) {
+		if(raw) {
+			node->args[i] = lowerValue(lo, arglist->args[i], err);
+		}
+		else {
+			node->args[i] = lowerOperand(lo, arglist->args[i], err);
+		}
+		
+		if(node->args[i] == NULL) {
+			freeNode(node);
+			return NULL;
+		}
+	}
+	
+	return node;
+}
+
+static PrepNode* lowerVar(Lowering* lo, const char* name, Error** err) {
+	/* Parameters shadow everything else */
+	unsigned i;
+	for(i = 0; i < lo->count; i++) {
+		if(strcmp(name, lo->names[i]) == 0) {
+			PrepNode* ret = allocNode(PN_PARAM, 0);
+			ret->slot = i;
+			return ret;
+		}
+	}
+	
+	const Context* ctx = lo->prep->ctx;
+	const Variable* var = Variable_get(ctx, name);
+	if(var == NULL) {
+		*err = varNotFound(name);
+		return NULL;
+	}
+	
+	Value* val;
+	switch(var->type) {
+		case VAR_VALUE:
+			/* Captured as it is right now */
+			val = Value_copy(var->val);
+			break;
+		
+		case VAR_CONSTANT:
+			val = Variable_eval(var, ctx);
+			break;
+		
+		case VAR_REACTIVE:
+			/* Captured like a value, so later changes to its inputs aren't seen */
+			val = Variable_eval(var, ctx);
+			break;
+		
+		case VAR_BUILTIN:
+			if(var->blt->isFunction) {
+				val = ValVar(name);
+			}
+			else {
+				val = Variable_coerce(var, ctx);
+			}
+			break;
+		
+		case VAR_FUNC:
+			val = ValVar(name);
+			break;
+		
+		case VAR_ERR:
+			*err = Error_copy(var->err);
+			return NULL;
+		
+		default:
+			badVarType(var->type);
+	}
+	
+	if(val->type == VAL_ERR) {
+		*err = Error_copy(val->err);
+		Value_free(val);
+		return NULL;
+	}
+	
+	return constNode(val);
+}
+
+static PrepFunc* lowerFunc(Lowering* lo, const char* name, const Function* func, Error** err) {
+	Prepared* prep = lo->prep;
+	
+	PrepFunc* cur;
+	for(cur = prep->funcs; cur != NULL; cur = cur->next) {
+		if(cur->src == func) {
+			if(cur->body == NULL) {
+				*err = typeError("Recursive function '%s' can't be prepared.", name);
+				return NULL;
+			}
+			
+			return cur;
+		}
+	}
+	
+	cur = fcalloc(1, sizeof(*cur));
+	cur->src = func;
+	cur->next = prep->funcs;
+	prep->funcs = cur;
+	
+	/* Function bodies only see their own arguments and globals */
+	Lowering inner = {prep, (const char* const*)func->argnames, func->argcount};
+	cur->body = lowerValue(&inner, func->body, err);
+	
+	/* Leave the failed entry in the list so Prepared_free cleans it up */
+	return cur->body ? cur : NULL;
+}
+
+static PrepNode* lowerCall(Lowering* lo, const FuncCall* call, Error** err) {
+	if(call->func->type != VAL_VAR) {
+		StrBuf sb;
+		StrBuf_init(&sb);
+		Value_repr(call->func, &sb, false, false);
+		
+		char* repr = StrBuf_finish(&sb);
+		*err = typeError("Value %s is not a callable.", repr);
+		ffree(repr);
+		return NULL;
+	}
+	
+	const char* name = call->func->name;
+	bool internal = false;
+	if(*name == '@') {
+		internal = true;
+		name++;
+	}
+	
+	unsigned i;
+	for(i = 0; i < lo->count; i++) {
+		if(strcmp(name, lo->names[i]) == 0) {
+			*err = typeError("Parameter '%s' can't be called in a prepared expression.", name);
+			return NULL;
+		}
+	}
+	
+	const Variable* var = Variable_get(lo->prep->ctx, name);
+	if(var == NULL) {
+		*err = varNotFound(name);
+		return NULL;
+	}
+	
+	const ArgList* arglist = call->arglist;
+	PrepNode* ret;
+	
+	switch(var->type) {
+		case VAR_BUILTIN:
+			if(var->blt->isFunction) {
+				/* Builtins get their arguments as they are, just like callVar does */
+				ret = allocNode(PN_BUILTIN, arglist->count);
+				ret->blt = var->blt;
+				ret->internal = internal;
+				return lowerArgs(lo, ret, arglist, true, err);
+			}
+			
+			if(arglist->count > 1) {
+				*err = builtinNotFunc(name);
+				return NULL;
+			}
+			
+			ret = lowerVar(lo, name, err);
+			if(ret == NULL || arglist->count == 0) {
+				return ret;
+			}
+			
+			/* i.e. pi(2) -> pi * 2 */
+			PrepNode* mul = allocNode(PN_BINOP, 2);
+			mul->op = BIN_MUL;
+			mul->args[0] = ret;
+			
+			if((mul->args[1] = lowerOperand(lo, arglist->args[0], err)) == NULL) {
+				freeNode(mul);
+				return NULL;
+			}
+			
+			return foldConstant(lo->prep, mul);
+		
+		case VAR_FUNC:
+			if(var->func->argcount != arglist->count) {
+				*err = typeError("Function expects %u argument%s, not %u.",
+				                 var->func->argcount,
+				                 var->func->argcount == 1 ? "" : "s",
+				                 arglist->count);
+				return NULL;
+			}
+			
+			ret = allocNode(PN_FUNC, arglist->count);
+			ret->func = lowerFunc(lo, var->name, var->func, err);
+			if(ret->func == NULL) {
+				freeNode(ret);
+				return NULL;
+			}
+			
+			return lowerArgs(lo, ret, arglist, false, err);
+		
+		case VAR_ERR:
+			*err = Error_copy(var->err);
+			return NULL;
+		
+		default:
+			*err = nameError("Variable '%s' is not a function.", var->name);
+			return NULL;
+	}
+}
+
+/* Operators on constants are evaluated right away */
+static PrepNode* foldConstant(const Prepared* prep, PrepNode* node) {
+	unsigned i;
+	for(i = 0; i < node->count; i++) {
+		if(node->args[i]->type != PN_CONST) {
+			return node;
+		}
+	}
+	
+	Value* val = evalNode(prep, node, NULL);
+	if(val->type == VAL_ERR) {
+		/* Report it when evaluating instead, like an unprepared expression would */
+		Value_free(val);
+		return node;
+	}
+	
+	freeNode(node);
+	return constNode(val);
+}
+
+static PrepNode* lowerValue(Lowering* lo, const Value* val, Error** err) {
+	PrepNode* ret;
+	
+	switch(val->type) {
+		case VAL_INT:
+		case VAL_REAL:
+		case VAL_FRAC:
+		case VAL_NEG:
+			/* Reduces fractions */
+			return constNode(Value_eval(val, lo->prep->ctx));
+		
+		case VAL_VAR:
+			return lowerVar(lo, val->name, err);
+		
+		case VAL_EXPR:
+			ret = allocNode(PN_BINOP, 2);
+			ret->op = val->expr->type;
+			
+			if((ret->args[0] = lowerOperand(lo, val->expr->a, err)) == NULL
+			   || (ret->args[1] = lowerOperand(lo, val->expr->b, err)) == NULL) {
+				freeNode(ret);
+				return NULL;
+			}
+			
+			return foldConstant(lo->prep, ret);
+		
+		case VAL_UNARY:
+			ret = allocNode(PN_UNOP, 1);
+			ret->op = val->term->type;
+			
+			if((ret->args[0] = lowerOperand(lo, val->term->a, err)) == NULL) {
+				freeNode(ret);
+				return NULL;
+			}
+			
+			return foldConstant(lo->prep, ret);
+		
+		case VAL_CALL:
+			return lowerCall(lo, val->call, err);
+		
+		case VAL_VEC:
+			ret = allocNode(PN_VEC, val->vec->vals->count);
+			return lowerArgs(lo, ret, val->vec->vals, false, err);
+		
+		case VAL_MAT: {
+			const Matrix* mat = val->mat;
+			if(mat->kind != MAT_BOXED) {
+				return constNode(Value_copy(val));
+			}
+			
+			ret = allocNode(PN_MAT, mat->rows * mat->cols);
+			ret->cols = mat->cols;
+			
+			unsigned i;
+			for(i = 0; i < ret->count; i++) {
+				if((ret->args[i] = lowerOperand(lo, mat->vals[i], err)) == NULL) {
+					freeNode(ret);
+					return NULL;
+				}
+			}
+			
+			return ret;
+		}
+		
+		case VAL_ERR:
+			*err = Error_copy(val->err);
+			return NULL;
+		
+		case VAL_END:
+			*err = earlyEnd();
+			return NULL;
+		
+		default:
+			badValType(val->type);
+	}
+}
+
+static Prepared* prepare(const Context* ctx, const Value* tree,
+                         const char* const* params, unsigned count, Error** err) {
+	Prepared* ret = fcalloc(1, sizeof(*ret));
+	
+	/* Private copy, so the handle doesn't care what happens to the original */
+	ret->ctx = Context_copy(ctx);
+	ret->nparams = count;
+	
+	/* Errors printed while lowering, such as by builtins, are captured instead */
+	Error* captured = NULL;
+	Error** prevCapture = Error_capture(&captured);
+	
+	Lowering lo = {ret, params, count};
+	ret->root = lowerOperand(&lo, tree, err);
+	
+	Error_capture(prevCapture);
+	
+	if(ret->root == NULL) {
+		Prepared_free(ret);
+		ret = NULL;
+	}
+	
+	if(captured) {
+		Error_free(captured);
+	}
+	
+	return ret;
+}
+
+Prepared* Prepared_new(const Context* ctx, const char* expr,
+                       const char* const* params, unsigned count, Error** err) {
+	*err = NULL;
+	
+	Error* captured = NULL;
+	Error** prevCapture = Error_capture(&captured);
+	
+	const char* p = expr;
+	Value* tree = Value_parse(&p, 0, 0, &default_cb);
+	
+	Error_capture(prevCapture);
+	
+	Prepared* ret = NULL;
+	if(captured) {
+		*err = captured;
+	}
+	else {
+		ret = prepare(ctx, tree, params, count, err);
+	}
+	
+	Value_free(tree);
+	return ret;
+}
+
+Prepared* Prepared_fromFunc(const Context* ctx, const char* name, Error** err) {
+	*err = NULL;
+	
+	const Variable* var = Variable_get(ctx, name);
+	if(var == NULL) {
+		*err = varNotFound(name);
+		return NULL;
+	}
+	
+	if(var->type != VAR_FUNC) {
+		*err = typeError("Variable '%s' is not a user function.", name);
+		return NULL;
+	}
+	
+	const Function* func = var->func;
+	return prepare(ctx, func->body, (const char* const*)func->argnames, func->argcount, err);
+}
+
+void Prepared_free(Prepared* prep) {
+	freeNode(prep->root);
+	
+	PrepFunc* cur = prep->funcs;
+	while(cur) {
+		PrepFunc* next = cur->next;
+		freeNode(cur->body);
+		ffree(cur);
+		cur = next;
+	}
+	
+	Context_free(prep->ctx);
+	ffree(prep);
+}
+
+unsigned Prepared_paramCount(const Prepared* prep) {
+	return prep->nparams;
+}
+
+/* Borrows constants and parameters instead of copying them */
+static const Value* evalOperand(const Prepared* prep, const PrepNode* node, Value* const* slots, Value** owned) {
+	*owned = NULL;
+	
+	switch(node->type) {
+		case PN_CONST: return node->val;
+		case PN_PARAM: return slots[node->slot];
+		default:       return *owned = evalNode(prep, node, slots);
+	}
+}
+
+/* On failure returns NULL and stores the error value in `err` */
+static ArgList* evalArgs(const Prepared* prep, const PrepNode* node, Value* const* slots, Value** err) {
+	ArgList* ret = ArgList_new(node->count);
+	
+	unsigned i;
+	for(i = 0; i < node->count; i++) {
+		Value* arg = evalNode(prep, node->args[i], slots);
+		if(arg->type == VAL_ERR) {
+			*err = arg;
+			ArgList_free(ret);
+			return NULL;
+		}
+		
+		ret->args[i] = arg;
+	}
+	
+	return ret;
+}
+
+static Value* evalNode(const Prepared* prep, const PrepNode* node, Value* const* slots) {
+	Value* ret = NULL;
+	Value* ownA;
+	Value* ownB;
+	const Value* a;
+	const Value* b;
+	ArgList* args;
+	
+	switch(node->type) {
+		case PN_CONST:
+			return Value_copy(node->val);
+		
+		case PN_PARAM:
+			return Value_copy(slots[node->slot]);
+		
+		case PN_BINOP:
+			a = evalOperand(prep, node->args[0], slots, &ownA);
+			if(a->type == VAL_ERR) {
+				return ownA;
+			}
+			
+			b = evalOperand(prep, node->args[1], slots, &ownB);
+			if(b->type == VAL_ERR) {
+				if(ownA) Value_free(ownA);
+				return ownB;
+			}
+			
+			ret = BinOp_apply(node->op, prep->ctx, a, b);
+			
+			if(ownA) Value_free(ownA);
+			if(ownB) Value_free(ownB);
+			return ret;
+		
+		case PN_UNOP:
+			a = evalOperand(prep, node->args[0], slots, &ownA);
+			if(a->type == VAL_ERR) {
+				return ownA;
+			}
+			
+			ret = UnOp_apply(node->op, prep->ctx, a);
+			
+			if(ownA) Value_free(ownA);
+			return ret;
+		
+		case PN_BUILTIN:
+			if((args = evalArgs(prep, node, slots, &ret)) == NULL) {
+				return ret;
+			}
+			
+			ret = Builtin_eval(node->blt, prep->ctx, args, node->internal);
+			ArgList_free(args);
+			return ret;
+		
+		case PN_FUNC: {
+			Value* stackSlots[STACK_SLOTS];
+			Value** locals = node->count <= STACK_SLOTS
+			               ? stackSlots
+			               : fmalloc(node->count * sizeof(*locals));
+			
+			unsigned i;
+			for(i = 0; i < node->count; i++) {
+				locals[i] = evalNode(prep, node->args[i], slots);
+				if(locals[i]->type == VAL_ERR) {
+					ret = locals[i];
+					break;
+				}
+			}
+			
+			if(ret == NULL) {
+				ret = evalNode(prep, node->func->body, locals);
+			}
+			
+			/* On error, locals[i] is the value being returned */
+			unsigned j;
+			for(j = 0; j < i; j++) {
+				Value_free(locals[j]);
+			}
+			
+			if(locals != stackSlots) {
+				ffree(locals);
+			}
+			
+			return ret;
+		}
+		
+		case PN_VEC:
+			if((args = evalArgs(prep, node, slots, &ret)) == NULL) {
+				return ret;
+			}
+			
+			return ValVec(Vector_new(args));
+		
+		case PN_MAT: {
+			Value** vals = fmalloc(node->count * sizeof(*vals));
+			
+			unsigned i;
+			for(i = 0; i < node->count; i++) {
+				vals[i] = evalNode(prep, node->args[i], slots);
+				if(vals[i]->type == VAL_ERR) {
+					ret = vals[i];
+					
+					unsigned j;
+					for(j = 0; j < i; j++) {
+						Value_free(vals[j]);
+					}
+					
+					ffree(vals);
+					return ret;
+				}
+			}
+			
+			/* Evaluating checks that every element is a number */
+			Matrix* mat = Matrix_fromValues(node->count / node->cols, node->cols, vals);
+			ret = Matrix_eval(mat, prep->ctx);
+			Matrix_free(mat);
+			return ret;
+		}
+		
+		default:
+			DIE("Unexpected prepared node type: %d.", node->type);
+	}
+}
+
+Value* Prepared_evalValues(const Prepared* prep, Value* const* args) {
+	return evalNode(prep, prep->root, args);
+}
+
+SC_STATUS Prepared_eval(const Prepared* prep, const double* args, double* result, SCError* err) {
+	Value* stackSlots[STACK_SLOTS];
+	Value** slots = prep->nparams <= STACK_SLOTS
+	              ? stackSlots
+	              : fmalloc(prep->nparams * sizeof(*slots));
+	
+	/* Whole numbers are bound as integers, just like if they had been typed in */
+	unsigned i;
+	for(i = 0; i < prep->nparams; i++) {
+		double arg = args[i];
+		if(arg == floor(arg) && fabs(arg) < 1e18) {
+			slots[i] = ValInt((long long)arg);
+		}
+		else {
+			slots[i] = ValReal(arg);
+		}
+	}
+	
+	Error* captured = NULL;
+	Error** prevCapture = Error_capture(&captured);
+	
+	Value* ret = evalNode(prep, prep->root, slots);
+	
+	Error_capture(prevCapture);
+	
+	SC_STATUS status = Value_export(ret, captured, result, err);
+	
+	if(captured) {
+		Error_free(captured);
+	}
+	
+	Value_free(ret);
+	
+	for(i = 0; i < prep->nparams; i++) {
+		Value_free(slots[i]);
+	}
+	
+	if(slots != stackSlots) {
+		ffree(slots);
+	}
+	
+	return status;
+}
@@ -0,0 +1,33 @@
+/*
+  prepared.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_PREPARED_H_
+#define _SC_PREPARED_H_
+
+#include "libsupercalc.h"
+#include "context.h"
+#include "value.h"
+#include "error.h"
+
+/*
+ Prepared_free, Prepared_paramCount and Prepared_eval are declared in
+ libsupercalc.h, since they are part of the public interface.
+*/
+
+/*
+ Constructors
+ On failure these return NULL and store the reason in `err`.
+*/
+Prepared* Prepared_new(const Context* ctx, const char* expr,
+                       const char* const* params, unsigned count, Error** err);
+Prepared* Prepared_fromFunc(const Context* ctx, const char* name, Error** err);
+
+/* Evaluation with already constructed arguments, one per parameter */
+Value* Prepared_evalValues(const Prepared* prep, Value* const* args);
+
+#endif /* _SC_PREPARED_H_ */
@@ -0,0 +1,272 @@
+/*
+  profile.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "generic.h"
+
+/* Totals for everything called by one name */
+typedef struct ProfileEntry {
+	char* name;
+	bool builtin;
+	unsigned long calls;
+	uint64_t inclusive;
+	uint64_t self;
+	struct ProfileEntry* next;
+} ProfileEntry;
+
+/*
+ One distinct call stack. Each call looks up its node once when it starts, so
+ the entry it counts towards doesn't need to be searched for again.
+*/
+struct ProfileNode {
+	ProfileEntry* entry;
+	uint64_t self;
+	ProfileNode* children;
+	ProfileNode* sibling;
+};
+
+struct Profile {
+	bool active;
+	
+	/* Calls on any thread using the profile update it under the lock */
+	pthread_mutex_t lock;
+	ProfileEntry* entries;
+	unsigned count;
+	
+	/* Calls made directly by statements are children of the root */
+	ProfileNode root;
+};
+
+THREAD_LOCAL Profile* prof_current = NULL;
+
+/* The innermost call in progress on this thread */
+static THREAD_LOCAL ProfileFrame* prof_top = NULL;
+
+
+static uint64_t nowNanos(void);
+static void freeNodes(ProfileNode* node);
+static void clear(Profile* prof);
+static ProfileEntry* findEntry(Profile* prof, const char* name, bool builtin);
+static ProfileNode* findChild(Profile* prof, ProfileNode* parent, const char* name, bool builtin);
+static int compareEntries(const void* a, const void* b);
+static void writeStacks(const ProfileNode* node, StrBuf* path, StrBuf* sb);
+
+
+static uint64_t nowNanos(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void freeNodes(ProfileNode* node) {
+	while(node != NULL) {
+		ProfileNode* next = node->sibling;
+		freeNodes(node->children);
+		ffree(node);
+		node = next;
+	}
+}
+
+static void clear(Profile* prof) {
+	freeNodes(prof->root.children);
+	prof->root.children = NULL;
+	prof->root.self = 0;
+	
+	ProfileEntry* entry = prof->entries;
+	while(entry != NULL) {
+		ProfileEntry* next = entry->next;
+		ffree(entry->name);
+		ffree(entry);
+		entry = next;
+	}
+	
+	prof->entries = NULL;
+	prof->count = 0;
+}
+
+/* Only searched when a new call stack shows up, so a list is plenty */
+static ProfileEntry* findEntry(Profile* prof, const char* name, bool builtin) {
+	ProfileEntry* entry;
+	for(entry = prof->entries; entry != NULL; entry = entry->next) {
+		if(entry->builtin == builtin && strcmp(entry->name, name) == 0) {
+			return entry;
+		}
+	}
+	
+	entry = fcalloc(1, sizeof(*entry));
+	entry->name = fstrdup(name);
+	entry->builtin = builtin;
+	entry->next = prof->entries;
+	prof->entries = entry;
+	prof->count++;
+	return entry;
+}
+
+static ProfileNode* findChild(Profile* prof, ProfileNode* parent, const char* name, bool builtin) {
+	ProfileNode* node;
+	for(node = parent->children; node != NULL; node = node->sibling) {
+		if(node->entry->builtin == builtin && strcmp(node->entry->name, name) == 0) {
+			return node;
+		}
+	}
+	
+	node = fcalloc(1, sizeof(*node));
+	node->entry = findEntry(prof, name, builtin);
+	node->sibling = parent->children;
+	parent->children = node;
+	return node;
+}
+
+/* Most self time first */
+static int compareEntries(const void* a, const void* b) {
+	const ProfileEntry* ea = *(const ProfileEntry* const*)a;
+	const ProfileEntry* eb = *(const ProfileEntry* const*)b;
+	
+	if(ea->self != eb->self) {
+		return ea->self < eb->self ? 1 : -1;
+	}
+	
+	return strcmp(ea->name, eb->name);
+}
+
+static void writeStacks(const ProfileNode* node, StrBuf* path, StrBuf* sb) {
+	for(; node != NULL; node = node->sibling) {
+		size_t len = path->len;
+		if(len > 0) {
+			StrBuf_putc(path, ';');
+		}
+		StrBuf_append(path, node->entry->name);
+		
+		if(node->self > 0) {
+			StrBuf_appendn(sb, path->str, path->len);
+			StrBuf_printf(sb, " %llu\n", (unsigned long long)node->self);
+		}
+		
+		writeStacks(node->children, path, sb);
+		path->len = len;
+	}
+}
+
+
+Profile* Profile_new(void) {
+	Profile* ret = fcalloc(1, sizeof(*ret));
+	pthread_mutex_init(&ret->lock, NULL);
+	return ret;
+}
+
+void Profile_free(Profile* prof) {
+	clear(prof);
+	pthread_mutex_destroy(&prof->lock);
+	ffree(prof);
+}
+
+void Profile_start(Profile* prof) {
+	clear(prof);
+	prof->active = true;
+}
+
+void Profile_stop(Profile* prof) {
+	prof->active = false;
+}
+
+Profile* Profile_use(Profile* prof) {
+	Profile* prev = prof_current;
+	prof_current = (prof != NULL && prof->active) ? prof : NULL;
+	return prev;
+}
+
+void Profile_enter(ProfileFrame* frame, const char* name, bool builtin) {
+	Profile* prof = prof_current;
+	ProfileNode* parent = prof_top ? prof_top->node : &prof->root;
+	
+	pthread_mutex_lock(&prof->lock);
+	frame->node = findChild(prof, parent, name, builtin);
+	pthread_mutex_unlock(&prof->lock);
+	
+	frame->children = 0;
+	frame->parent = prof_top;
+	prof_top = frame;
+	
+	/* Last, so the bookkeeping above isn't counted */
+	frame->start = nowNanos();
+}
+
+void Profile_exit(ProfileFrame* frame) {
+	uint64_t elapsed = nowNanos() - frame->start;
+	uint64_t self = elapsed - frame->children;
+	ProfileEntry* entry = frame->node->entry;
+	
+	/* A recursive call's time is already part of the outer call's */
+	bool outermost = true;
+	const ProfileFrame* cur;
+	for(cur = frame->parent; cur != NULL; cur = cur->parent) {
+		if(cur->node->entry == entry) {
+			outermost = false;
+			break;
+		}
+	}
+	
+	Profile* prof = prof_current;
+	pthread_mutex_lock(&prof->lock);
+	frame->node->self += self;
+	entry->calls++;
+	entry->self += self;
+	if(outermost) {
+		entry->inclusive += elapsed;
+	}
+	pthread_mutex_unlock(&prof->lock);
+	
+	prof_top = frame->parent;
+	if(prof_top != NULL) {
+		prof_top->children += elapsed;
+	}
+}
+
+void Profile_report(const Profile* prof, StrBuf* sb) {
+	if(prof->count == 0) {
+		StrBuf_append(sb, "Nothing was profiled\n");
+		return;
+	}
+	
+	ProfileEntry** sorted = fmalloc(prof->count * sizeof(*sorted));
+	int width = 4;
+	
+	unsigned i = 0;
+	ProfileEntry* entry;
+	for(entry = prof->entries; entry != NULL; entry = entry->next) {
+		sorted[i++] = entry;
+		
+		int len = (int)strlen(entry->name) + (entry->builtin ? 10 : 0);
+		width = MAX(width, len);
+	}
+	
+	qsort(sorted, prof->count, sizeof(*sorted), &compareEntries);
+	
+	StrBuf_printf(sb, "%-*s %10s %12s %12s\n", width, "Name", "Calls", "Total ms", "Self ms");
+	for(i = 0; i < prof->count; i++) {
+		entry = sorted[i];
+		int pad = width - (int)strlen(entry->name);
+		StrBuf_printf(sb, "%s%-*s %10lu %12.3f %12.3f\n",
+		              entry->name, pad, entry->builtin ? " (builtin)" : "",
+		              entry->calls, entry->inclusive / 1e6, entry->self / 1e6);
+	}
+	
+	ffree(sorted);
+}
+
+void Profile_stacks(const Profile* prof, StrBuf* sb) {
+	StrBuf path;
+	StrBuf_init(&path);
+	writeStacks(prof->root.children, &path, sb);
+	ffree(StrBuf_finish(&path));
+}
@@ -0,0 +1,87 @@
+/*
+  profile.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_PROFILE_H_
+#define _SC_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "support.h"
+#include "strbuf.h"
+
+typedef struct Profile Profile;
+typedef struct ProfileNode ProfileNode;
+
+/* A call in progress, which lives on the C stack of the thread making it */
+typedef struct ProfileFrame {
+	ProfileNode* node;
+	uint64_t start;
+	
+	/* Time spent in calls made from this one */
+	uint64_t children;
+	
+	struct ProfileFrame* parent;
+} ProfileFrame;
+
+/* Where calls on this thread are counted, or NULL when they aren't */
+extern THREAD_LOCAL Profile* prof_current;
+
+/* Brackets a call, costing only a check when not profiling */
+#define PROFILE_ENTER(frame, name, builtin) do { \
+	if(prof_current != NULL) { \
+		Profile_enter((frame), (name), (builtin)); \
+	} \
+} while(0)
+
+#define PROFILE_EXIT(frame) do { \
+	if(prof_current != NULL) { \
+		Profile_exit(frame); \
+	} \
+} while(0)
+
+
+/* Constructor */
+Profile* Profile_new(void);
+
+/* Destructor */
+void Profile_free(Profile* prof);
+
+/*
+ `profile on` throws away what was counted before and starts counting again.
+ `profile off` stops, keeping the counts for a report. Nothing may be
+ evaluating with the profile while these run.
+*/
+void Profile_start(Profile* prof);
+void Profile_stop(Profile* prof);
+
+/*
+ Counts calls on the calling thread in `prof` while it's on, and in nothing
+ otherwise. Returns the previous profile so it can be put back.
+*/
+Profile* Profile_use(Profile* prof);
+
+/* Used by PROFILE_ENTER and PROFILE_EXIT */
+void Profile_enter(ProfileFrame* frame, const char* name, bool builtin);
+void Profile_exit(ProfileFrame* frame);
+
+/*
+ Appends a table of every user function and builtin that was called, with its
+ number of calls, inclusive time and self time, hottest first. Time spent in
+ a recursive call only counts once towards its inclusive time.
+*/
+void Profile_report(const Profile* prof, StrBuf* sb);
+
+/*
+ Appends one line per distinct call stack, like "g;f;sqrt 1250", with the
+ self time in nanoseconds. This is the collapsed format that flamegraph.pl
+ and speedscope read.
+*/
+void Profile_stacks(const Profile* prof, StrBuf* sb);
+
+#endif /* _SC_PROFILE_H_ */
@@ -0,0 +1,336 @@
+/*
+  reactive.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_VALUES
+
+#include "reactive.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "support.h"
+#include "generic.h"
+#include "error.h"
+#include "value.h"
+#include "variable.h"
+#include "context.h"
+#include "function.h"
+
+
+/* Shared by the walks over a formula and the functions it calls */
+struct NameWalk {
+	const Context* ctx;
+	
+	/* Name that Reactive_reaches is looking for */
+	const char* target;
+	
+	/* Names collected for Reactive_eval */
+	char** names;
+	unsigned count;
+	unsigned cap;
+	
+	/* Function bodies and formulas already visited */
+	const void** seen;
+	unsigned nseen;
+	unsigned capseen;
+};
+
+static THREAD_LOCAL StrBuf* recompute_log = NULL;
+
+/* Counts cycles found on this thread, so results that ran into one aren't kept */
+static THREAD_LOCAL unsigned long cycles_found = 0;
+
+
+static bool firstVisit(struct NameWalk* walk, const void* node);
+static bool collectName(const char* name, void* data);
+static bool reachName(const char* name, void* data);
+static void collectDeps(Reactive* rx, const Context* ctx);
+static void freeDeps(Reactive* rx);
+
+
+Reactive* Reactive_new(Value* formula) {
+	Reactive* ret = fcalloc(1, sizeof(*ret));
+	
+	ret->formula = formula;
+	
+	return ret;
+}
+
+static void freeDeps(Reactive* rx) {
+	unsigned i;
+	for(i = 0; i < rx->ndeps; i++) {
+		ffree(rx->deps[i]);
+	}
+	
+	ffree(rx->deps);
+	rx->deps = NULL;
+	rx->ndeps = 0;
+}
+
+void Reactive_free(Reactive* rx) {
+	if(rx == NULL) {
+		return;
+	}
+	
+	Value_free(rx->formula);
+	if(rx->cached) {
+		Value_free(rx->cached);
+	}
+	
+	freeDeps(rx);
+	ffree(rx);
+}
+
+Reactive* Reactive_copy(const Reactive* rx) {
+	Reactive* ret = Reactive_new(Value_copy(rx->formula));
+	
+	if(rx->cached) {
+		ret->cached = Value_copy(rx->cached);
+	}
+	
+	if(rx->ndeps > 0) {
+		ret->deps = fmalloc(rx->ndeps * sizeof(*ret->deps));
+		
+		unsigned i;
+		for(i = 0; i < rx->ndeps; i++) {
+			ret->deps[i] = fstrdup(rx->deps[i]);
+		}
+		ret->ndeps = rx->ndeps;
+	}
+	
+	return ret;
+}
+
+static bool firstVisit(struct NameWalk* walk, const void* node) {
+	unsigned i;
+	for(i = 0; i < walk->nseen; i++) {
+		if(walk->seen[i] == node) {
+			return false;
+		}
+	}
+	
+	if(walk->nseen >= walk->capseen) {
+		walk->capseen = walk->capseen ? walk->capseen * 2 : 4;
+		walk->seen = frealloc(walk->seen, walk->capseen * sizeof(*walk->seen));
+	}
+	walk->seen[walk->nseen++] = node;
+	
+	return true;
+}
+
+/* Other reactive bindings aren't followed, since invalidating them reaches this one */
+static bool collectName(const char* name, void* data) {
+	struct NameWalk* walk = data;
+	
+	unsigned i;
+	for(i = 0; i < walk->count; i++) {
+		if(strcmp(walk->names[i], name) == 0) {
+			return true;
+		}
+	}
+	
+	if(walk->count >= walk->cap) {
+		walk->cap = walk->cap ? walk->cap * 2 : 4;
+		walk->names = frealloc(walk->names, walk->cap * sizeof(*walk->names));
+	}
+	walk->names[walk->count++] = fstrdup(name);
+	
+	/* Function bodies look their names up when they're called */
+	const Variable* var = Variable_get(walk->ctx, name);
+	if(var == NULL || var->type != VAR_FUNC || !firstVisit(walk, var->func)) {
+		return true;
+	}
+	
+	return Value_visitNames(var->func->body, &collectName, walk);
+}
+
+/* Stops the walk once the target turns up */
+static bool reachName(const char* name, void* data) {
+	struct NameWalk* walk = data;
+	
+	if(strcmp(name, walk->target) == 0) {
+		return false;
+	}
+	
+	const Variable* var = Variable_get(walk->ctx, name);
+	if(var == NULL) {
+		return true;
+	}
+	
+	if(var->type == VAR_FUNC && firstVisit(walk, var->func)) {
+		return Value_visitNames(var->func->body, &reachName, walk);
+	}
+	
+	if(var->type == VAR_REACTIVE && firstVisit(walk, var->rx)) {
+		return Value_visitNames(var->rx->formula, &reachName, walk);
+	}
+	
+	return true;
+}
+
+static void collectDeps(Reactive* rx, const Context* ctx) {
+	struct NameWalk walk = {ctx, NULL, NULL, 0, 0, NULL, 0, 0};
+	Value_visitNames(rx->formula, &collectName, &walk);
+	ffree(walk.seen);
+	
+	freeDeps(rx);
+	rx->deps = walk.names;
+	rx->ndeps = walk.count;
+}
+
+Value* Reactive_eval(Reactive* rx, const char* name, const Context* ctx) {
+	if(rx->cached != NULL) {
+		return Value_copy(rx->cached);
+	}
+	
+	if(rx->busy) {
+		cycles_found++;
+		return ValErr(typeError("Reactive binding '%s' depends on itself.", name));
+	}
+	
+	/* Read from inside a function, the formula still only sees globals */
+	Context* frame = Context_pushFrame(ctx);
+	
+	/* Errors raised along the way are kept in the result instead of printed */
+	Error* raised = NULL;
+	Error** prevCapture = Error_capture(&raised);
+	
+	unsigned long cycles = cycles_found;
+	
+	rx->busy = true;
+	Value* ret = Value_eval(rx->formula, frame);
+	rx->busy = false;
+	
+	Error_capture(prevCapture);
+	
+	if(raised != NULL) {
+		if(ret->type == VAL_ERR && ret->err->type == ERR_IGN) {
+			Value_free(ret);
+			ret = ValErr(raised);
+		}
+		else {
+			Error_free(raised);
+		}
+	}
+	
+	if(ret->type == VAL_VAR) {
+		/* Functions are looked up by name, so there would be nothing to keep */
+		Value_free(ret);
+		ret = ValErr(typeError("Reactive binding '%s' must be a value, not a function.", name));
+	}
+	
+	/* A cycle is reported from whichever binding was read first, so that can't be kept */
+	bool keep = cycles == cycles_found;
+	if(keep) {
+		collectDeps(rx, frame);
+	}
+	Context_popFrame(frame);
+	
+	
+	if(recompute_log != NULL) {
+		if(recompute_log->len > 0) {
+			StrBuf_append(recompute_log, ", ");
+		}
+		StrBuf_append(recompute_log, name);
+	}
+	
+	if(!keep) {
+		return ret;
+	}
+	
+	/* Errors are kept too, until something the formula read changes, and raised on every read */
+	rx->cached = ret;
+	return Value_copy(ret);
+}
+
+bool Reactive_invalidate(Reactive* rx, const char* name) {
+	if(rx->cached == NULL) {
+		return false;
+	}
+	
+	unsigned i;
+	for(i = 0; i < rx->ndeps; i++) {
+		if(strcmp(rx->deps[i], name) == 0) {
+			Reactive_forget(rx);
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void Reactive_forget(Reactive* rx) {
+	if(rx->cached) {
+		Value_free(rx->cached);
+		rx->cached = NULL;
+	}
+}
+
+bool Reactive_reaches(const Value* formula, const Context* ctx, const char* name) {
+	struct NameWalk walk = {ctx, name, NULL, 0, 0, NULL, 0, 0};
+	bool ret = !Value_visitNames(formula, &reachName, &walk);
+	
+	ffree(walk.seen);
+	return ret;
+}
+
+StrBuf* Reactive_setLog(StrBuf* log) {
+	StrBuf* prev = recompute_log;
+	recompute_log = log;
+	return prev;
+}
+
+void Reactive_repr(const Reactive* rx, StrBuf* sb, bool pretty) {
+	StrBuf_append(sb, " := ");
+	Value_repr(rx->formula, sb, pretty, false);
+}
+
+void Reactive_wrap(const Reactive* rx, StrBuf* sb) {
+	StrBuf_append(sb, " := ");
+	Value_wrap(rx->formula, sb, false);
+}
+
+void Reactive_verbose(const Reactive* rx, StrBuf* sb) {
+	StrBuf_append(sb, " := {");
+	StrBuf_newline(sb, 1);
+	Value_verbose(rx->formula, sb, 1);
+	StrBuf_append(sb, "\n}");
+}
+
+void Reactive_xml(const Reactive* rx, StrBuf* sb, unsigned indent) {
+	/*
+	 sc> ?x b := 2a + 4
+	
+	 <vardata name="b">
+	   <reactive>
+	     <add>
+	       <mul>
+	         <int>2</int>
+	         <var name="a"/>
+	       </mul>
+	       <int>4</int>
+	     </add>
+	   </reactive>
+	 </vardata>
+	*/
+	StrBuf_append(sb, "<reactive>");
+	StrBuf_newline(sb, indent + 1);
+	Value_xml(rx->formula, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_append(sb, "</reactive>");
+}
+
+void Reactive_json(const Reactive* rx, StrBuf* sb) {
+	/*
+	 sc> ?jt b := 2a + 4
+	 {"tree":{"name":"b","value":{"reactive":{"op":"add","a":{"op":"mul","a":2,"b":{"var":"a"}},"b":4}}}}
+	*/
+	StrBuf_append(sb, "{\"reactive\":");
+	Value_json(rx->formula, sb);
+	StrBuf_putc(sb, '}');
+}
@@ -0,0 +1,83 @@
+/*
+  reactive.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_REACTIVE_H_
+#define _SC_REACTIVE_H_
+
+#include <stdbool.h>
+
+typedef struct Reactive Reactive;
+#include "value.h"
+#include "context.h"
+#include "strbuf.h"
+
+
+/*
+ A binding made with `name := formula`. Its value is the formula's result, kept
+ until a global the formula reads changes. The context drops the result then,
+ along with the results of every binding that reads this one, and the formula
+ is only evaluated again the next time the binding is read.
+*/
+struct Reactive {
+	Value* formula;
+	
+	/* NULL when the formula has to be evaluated again */
+	Value* cached;
+	
+	/* Names the formula read last time, including inside functions it called */
+	char** deps;
+	unsigned ndeps;
+	
+	/* Set while evaluating, to catch bindings that end up reading themselves */
+	bool busy;
+};
+
+
+/* Constructor */
+/* Consumes `formula` */
+Reactive* Reactive_new(Value* formula);
+
+/* Destructor */
+void Reactive_free(Reactive* rx);
+
+/* Copying, including the cached result */
+Reactive* Reactive_copy(const Reactive* rx);
+
+/*
+ Returns the binding's value, evaluating the formula first if it needs to be.
+ Reading a binding from more than one thread at once is not safe.
+*/
+Value* Reactive_eval(Reactive* rx, const char* name, const Context* ctx);
+
+/* Drops the cached result if the formula read `name`. Returns whether it did */
+bool Reactive_invalidate(Reactive* rx, const char* name);
+
+/* Drops the cached result no matter what */
+void Reactive_forget(Reactive* rx);
+
+/*
+ Whether evaluating `formula` could end up reading `name`, directly or through
+ functions and other reactive bindings. Used to reject cycles when binding.
+*/
+bool Reactive_reaches(const Value* formula, const Context* ctx, const char* name);
+
+/*
+ While set, the name of every binding evaluated on this thread is appended to
+ `log`, separated by commas. Bindings finish after the ones they read, so the
+ names come out in dependency order. Returns the previous log.
+*/
+StrBuf* Reactive_setLog(StrBuf* log);
+
+/* Printing */
+void Reactive_repr(const Reactive* rx, StrBuf* sb, bool pretty);
+void Reactive_wrap(const Reactive* rx, StrBuf* sb);
+void Reactive_verbose(const Reactive* rx, StrBuf* sb);
+void Reactive_xml(const Reactive* rx, StrBuf* sb, unsigned indent);
+void Reactive_json(const Reactive* rx, StrBuf* sb);
+
+#endif /* _SC_REACTIVE_H_ */
@@ -0,0 +1,264 @@
+/*
+  resultcache.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_VALUES
+
+#include "resultcache.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "generic.h"
+#include "statement.h"
+#include "variable.h"
+#include "function.h"
+#include "reactive.h"
+#include "lru.h"
+
+/* A global the result was computed from, and its version back then */
+typedef struct ResultDep {
+	char* name;
+	unsigned long version;
+} ResultDep;
+
+typedef struct Entry {
+	LruNode node;
+	
+	/* Holds a reference, so no other statement can show up at the same address */
+	Statement* stmt;
+	Value* result;
+	
+	unsigned ndeps;
+	ResultDep deps[];
+} Entry;
+
+struct ResultCache {
+	Lru lru;
+	ResultCacheStats stats;
+};
+
+/* Collects the names an expression reads, following functions and reactive bindings */
+struct DepWalk {
+	const Context* ctx;
+	
+	char** names;
+	unsigned count;
+	unsigned cap;
+	
+	/* Function bodies and formulas already visited */
+	const Value** seen;
+	unsigned nseen;
+	unsigned capseen;
+	
+	/* Whether anything called can give a different result next time */
+	bool isVolatile;
+};
+
+
+static unsigned hashStmt(const Statement* stmt);
+static bool matchStmt(const LruNode* node, const void* key);
+static void freeEntry(Entry* entry);
+static void removeEntry(ResultCache* cache, Entry* entry);
+static void evict(ResultCache* cache);
+static bool collectName(const char* name, void* data);
+
+
+/* Statements are allocated, so the low bits say nothing */
+static unsigned hashStmt(const Statement* stmt) {
+	uintptr_t bits = (uintptr_t)stmt >> 4;
+	return (unsigned)(bits * 2654435761u);
+}
+
+static bool matchStmt(const LruNode* node, const void* key) {
+	return ((const Entry*)node)->stmt == key;
+}
+
+static void freeEntry(Entry* entry) {
+	unsigned i;
+	for(i = 0; i < entry->ndeps; i++) {
+		ffree(entry->deps[i].name);
+	}
+	
+	Statement_free(entry->stmt);
+	Value_free(entry->result);
+	ffree(entry);
+}
+
+static void removeEntry(ResultCache* cache, Entry* entry) {
+	Lru_remove(&cache->lru, &entry->node);
+	freeEntry(entry);
+}
+
+/* Drops the least recently used entry */
+static void evict(ResultCache* cache) {
+	removeEntry(cache, (Entry*)Lru_oldest(&cache->lru));
+	cache->stats.evictions++;
+}
+
+static bool collectName(const char* name, void* data) {
+	struct DepWalk* walk = data;
+	
+	unsigned i;
+	for(i = 0; i < walk->count; i++) {
+		if(strcmp(walk->names[i], name) == 0) {
+			return true;
+		}
+	}
+	
+	if(walk->count >= walk->cap) {
+		walk->cap = walk->cap ? walk->cap * 2 : 4;
+		walk->names = frealloc(walk->names, walk->cap * sizeof(*walk->names));
+	}
+	walk->names[walk->count++] = fstrdup(name);
+	
+	/* Function bodies look their names up when they're called, and reactive formulas when they're read */
+	const Variable* var = Context_get(walk->ctx, name);
+	const Value* body;
+	if(var != NULL && var->type == VAR_BUILTIN && var->blt->isVolatile) {
+		walk->isVolatile = true;
+		return false;
+	}
+	else if(var != NULL && var->type == VAR_FUNC) {
+		body = var->func->body;
+	}
+	else if(var != NULL && var->type == VAR_REACTIVE) {
+		body = var->rx->formula;
+	}
+	else {
+		return true;
+	}
+	
+	for(i = 0; i < walk->nseen; i++) {
+		if(walk->seen[i] == body) {
+			return true;
+		}
+	}
+	
+	if(walk->nseen >= walk->capseen) {
+		walk->capseen = walk->capseen ? walk->capseen * 2 : 4;
+		walk->seen = frealloc(walk->seen, walk->capseen * sizeof(*walk->seen));
+	}
+	walk->seen[walk->nseen++] = body;
+	
+	return Value_visitNames(body, &collectName, walk);
+}
+
+
+ResultCache* ResultCache_new(unsigned capacity) {
+	ResultCache* ret = fcalloc(1, sizeof(*ret));
+	
+	Lru_init(&ret->lru, MEM_TAG);
+	ResultCache_setCapacity(ret, capacity);
+	
+	return ret;
+}
+
+void ResultCache_free(ResultCache* cache) {
+	ResultCache_clear(cache);
+	Lru_destroy(&cache->lru);
+	ffree(cache);
+}
+
+bool ResultCache_accepts(const Statement* stmt) {
+	/* Only expressions, since assignments and definitions have to happen every time */
+	return stmt->var->type == VAR_VALUE && stmt->var->name == NULL;
+}
+
+Value* ResultCache_lookup(ResultCache* cache, const Statement* stmt, const Context* ctx) {
+	if(cache->lru.count == 0) {
+		cache->stats.misses++;
+		return NULL;
+	}
+	
+	Entry* entry = (Entry*)Lru_find(&cache->lru, hashStmt(stmt), stmt, &matchStmt);
+	if(entry == NULL) {
+		cache->stats.misses++;
+		return NULL;
+	}
+	
+	unsigned i;
+	for(i = 0; i < entry->ndeps; i++) {
+		if(Context_version(ctx, entry->deps[i].name) != entry->deps[i].version) {
+			/* It will be stored again once the statement is evaluated */
+			removeEntry(cache, entry);
+			cache->stats.stale++;
+			cache->stats.misses++;
+			return NULL;
+		}
+	}
+	
+	cache->stats.hits++;
+	Lru_touch(&cache->lru, &entry->node);
+	return Value_copy(entry->result);
+}
+
+void ResultCache_store(ResultCache* cache, Statement* stmt, const Context* ctx, const Value* result) {
+	if(cache->stats.capacity == 0 || result->type == VAL_ERR || result->type == VAL_VAR) {
+		return;
+	}
+	
+	struct DepWalk walk = {ctx, NULL, 0, 0, NULL, 0, 0, false};
+	Value_visitNames(stmt->var->val, &collectName, &walk);
+	ffree(walk.seen);
+	
+	unsigned i;
+	if(walk.isVolatile) {
+		for(i = 0; i < walk.count; i++) {
+			ffree(walk.names[i]);
+		}
+		
+		ffree(walk.names);
+		return;
+	}
+	
+	Entry* old = (Entry*)Lru_find(&cache->lru, hashStmt(stmt), stmt, &matchStmt);
+	if(old != NULL) {
+		removeEntry(cache, old);
+	}
+	
+	if(cache->lru.count >= cache->stats.capacity) {
+		evict(cache);
+	}
+	
+	Entry* entry = fmalloc(sizeof(*entry) + walk.count * sizeof(*entry->deps));
+	entry->stmt = Statement_retain(stmt);
+	entry->result = Value_copy(result);
+	entry->ndeps = walk.count;
+	
+	for(i = 0; i < walk.count; i++) {
+		entry->deps[i].name = walk.names[i];
+		entry->deps[i].version = Context_version(ctx, walk.names[i]);
+	}
+	ffree(walk.names);
+	
+	Lru_insert(&cache->lru, &entry->node, hashStmt(stmt));
+}
+
+void ResultCache_clear(ResultCache* cache) {
+	LruNode* node = Lru_takeAll(&cache->lru);
+	while(node != NULL) {
+		LruNode* next = node->next;
+		freeEntry((Entry*)node);
+		node = next;
+	}
+}
+
+void ResultCache_setCapacity(ResultCache* cache, unsigned capacity) {
+	cache->stats.capacity = capacity;
+	
+	while(cache->lru.count > capacity) {
+		evict(cache);
+	}
+	
+	Lru_resize(&cache->lru, capacity);
+}
+
+void ResultCache_stats(const ResultCache* cache, ResultCacheStats* stats) {
+	*stats = cache->stats;
+	stats->count = cache->lru.count;
+}
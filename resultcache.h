@@ -0,0 +1,65 @@
+/*
+  resultcache.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_RESULTCACHE_H_
+#define _SC_RESULTCACHE_H_
+
+#include <stdbool.h>
+
+typedef struct ResultCache ResultCache;
+#include "statement.h"
+#include "context.h"
+#include "value.h"
+
+typedef struct ResultCacheStats {
+	unsigned long hits;
+	unsigned long misses;
+	
+	/* Misses that found an entry, but something it read had changed since */
+	unsigned long stale;
+	
+	unsigned long evictions;
+	unsigned count;
+	unsigned capacity;
+} ResultCacheStats;
+
+
+/*
+ Remembers the results of expressions that don't assign anything, along with
+ the version of every global they read, including through the functions and
+ reactive bindings they used. Entries are keyed by statement, so they're found
+ when the parse cache hands back the same statement for a line. A result is
+ reused while none of those versions change. A capacity of 0 disables caching.
+*/
+ResultCache* ResultCache_new(unsigned capacity);
+
+/* Destructor */
+void ResultCache_free(ResultCache* cache);
+
+/* Whether the statement's results can be cached at all */
+bool ResultCache_accepts(const Statement* stmt);
+
+/* Returns a copy of the result of `stmt` if nothing it read has changed, or NULL */
+Value* ResultCache_lookup(ResultCache* cache, const Statement* stmt, const Context* ctx);
+
+/*
+ Keeps a copy of `result`, which must have just been computed from `ctx`, and a
+ reference to `stmt`. Only plain values are kept, and nothing that called a
+ volatile builtin.
+*/
+void ResultCache_store(ResultCache* cache, Statement* stmt, const Context* ctx, const Value* result);
+
+/* Drops every entry, keeping the statistics */
+void ResultCache_clear(ResultCache* cache);
+
+/* Least recently used entries are evicted until at most `capacity` remain */
+void ResultCache_setCapacity(ResultCache* cache, unsigned capacity);
+
+void ResultCache_stats(const ResultCache* cache, ResultCacheStats* stats);
+
+#endif /* _SC_RESULTCACHE_H_ */
@@ -0,0 +1,214 @@
+/*
+  roundtrip.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Checks formatShortest against the C library on random bit patterns, short
+ decimals and edge cases. Every result must read back as the same double, no
+ shorter decimal may read back too, and the digits must be the ones printf
+ rounds to at that length whenever those read back. The numeric literal lexer
+ must read every result back too, and must agree with strtod on long decimals.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+
+#include "dtoa.h"
+#include "numlex.h"
+
+#define RANDOM_BITS    200000
+#define RANDOM_DECIMAL 100000
+#define RANDOM_LONG    100000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+static unsigned failures = 0;
+
+
+static uint64_t nextRandom(void);
+static int countDigits(const char* str, char* digits);
+static void check(double val);
+static void checkLex(const char* str, double val);
+static void checkRange(const char* str);
+
+
+/* xorshift64* */
+static uint64_t nextRandom(void) {
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+/* Copies the significant digits of a formatted number, without trailing zeros */
+static int countDigits(const char* str, char* digits) {
+	int len = 0;
+	const char* p;
+	for(p = str; *p != '\0' && *p != 'e'; p++) {
+		if(*p >= '0' && *p <= '9' && (len > 0 || *p != '0')) {
+			digits[len++] = *p;
+		}
+	}
+	
+	while(len > 0 && digits[len - 1] == '0') {
+		len--;
+	}
+	
+	digits[len] = '\0';
+	return len;
+}
+
+static void check(double val) {
+	char buf[SHORTEST_MAX];
+	int len = formatShortest(buf, val);
+	
+	if(len != (int)strlen(buf) || len >= SHORTEST_MAX) {
+		printf("Bad length %d for %a: %s\n", len, val, buf);
+		failures++;
+		return;
+	}
+	
+	if(isnan(val) || isinf(val) || val == 0) {
+		return;
+	}
+	
+	if(strtod(buf, NULL) != val) {
+		printf("%a printed as %s, which reads back as %a\n", val, buf, strtod(buf, NULL));
+		failures++;
+		return;
+	}
+	
+	/* The sign isn't part of a literal */
+	checkLex(buf + (val < 0), fabs(val));
+	
+	char digits[SHORTEST_MAX];
+	int ndigits = countDigits(buf, digits);
+	
+	/*
+	 printf rounds correctly, so its digits at the same length must match. For
+	 powers of two they may not read back, since the interval below is narrower.
+	*/
+	char expect[64];
+	char expectDigits[64];
+	snprintf(expect, sizeof(expect), "%.*e", ndigits - 1, val);
+	countDigits(expect, expectDigits);
+	if(strtod(expect, NULL) == val && strcmp(digits, expectDigits) != 0) {
+		printf("%a printed as %s, but the closest %d digits are %s\n", val, buf, ndigits, expect);
+		failures++;
+		return;
+	}
+	
+	if(ndigits > 1) {
+		snprintf(expect, sizeof(expect), "%.*e", ndigits - 2, val);
+		if(strtod(expect, NULL) == val) {
+			printf("%a printed as %s, but %s is shorter\n", val, buf, expect);
+			failures++;
+		}
+	}
+}
+
+/* The whole string must lex as a number with exactly this value */
+static void checkLex(const char* str, double val) {
+	const char* p = str;
+	long long ival;
+	double rval;
+	
+	NUMKIND kind = lexNumber(&p, &ival, &rval);
+	if(kind == NUM_INT) {
+		rval = (double)ival;
+	}
+	
+	if(*p != '\0' || (kind != NUM_INT && kind != NUM_REAL) || memcmp(&rval, &val, sizeof(val)) != 0) {
+		printf("%s lexed as %a (kind %d) with '%s' left, not %a\n", str, rval, kind, p, val);
+		failures++;
+	}
+}
+
+/* Literals that strtod would give ERANGE for are rejected */
+static void checkRange(const char* str) {
+	const char* p = str;
+	long long ival;
+	double rval;
+	
+	NUMKIND kind = lexNumber(&p, &ival, &rval);
+	if(*p != '\0' || kind != NUM_REAL_RANGE) {
+		printf("%s lexed as kind %d with '%s' left, not out of range\n", str, kind, p);
+		failures++;
+	}
+}
+
+int main(void) {
+	static const double edges[] = {
+		DBL_MIN, DBL_MAX, DBL_EPSILON, DBL_TRUE_MIN,
+		0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3, 5e-324, 1e23, 9007199254740993.0,
+		123456789012345.0, 1234567890123456.0, 0.0001, 0.00001,
+		1e15, 1e16, 1e21, 1e22, 1.7976931348623157e308, 2.2250738585072009e-308,
+		0.0, -0.0, INFINITY, -INFINITY, NAN
+	};
+	
+	unsigned i;
+	for(i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		check(edges[i]);
+		check(-edges[i]);
+	}
+	
+	/* Every power of two, which has an asymmetric interval below it */
+	int exp;
+	for(exp = -1074; exp <= 1023; exp++) {
+		check(ldexp(1, exp));
+		check(nextafter(ldexp(1, exp), 0));
+	}
+	
+	for(i = 0; i < RANDOM_BITS; i++) {
+		uint64_t bits = nextRandom();
+		double val;
+		memcpy(&val, &bits, sizeof(val));
+		check(val);
+	}
+	
+	/* Short decimals are the common case in practice */
+	for(i = 0; i < RANDOM_DECIMAL; i++) {
+		char str[32];
+		snprintf(str, sizeof(str), "%llue%d",
+		         (unsigned long long)(nextRandom() % 1000000000), (int)(nextRandom() % 80) - 40);
+		check(strtod(str, NULL));
+	}
+	
+	checkRange("1e400");
+	checkRange("1e-400");
+	checkRange("123456789012345678901234567890e-360");
+	checkLex("0e-400", 0);
+	checkLex("4.9e-324", DBL_TRUE_MIN);
+	
+	/* Literals too long for 64 bits, where the lexer may need strtod */
+	for(i = 0; i < RANDOM_LONG; i++) {
+		char str[64];
+		int len = snprintf(str, sizeof(str), "%llu%llu",
+		                   (unsigned long long)nextRandom(), (unsigned long long)nextRandom());
+		snprintf(str + len, sizeof(str) - len, "e%d", (int)(nextRandom() % 660) - 360);
+		str[nextRandom() % 20 + 1] = '.';
+		
+		double val = strtod(str, NULL);
+		if(isinf(val) || val == 0) {
+			checkRange(str);
+		}
+		else {
+			checkLex(str, val);
+		}
+	}
+	
+	if(failures > 0) {
+		printf("%u failures\n", failures);
+		return EXIT_FAILURE;
+	}
+	
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,619 @@
+/*
+  server.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/* For accept4 */
+#define _GNU_SOURCE
+
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "supercalc.h"
+#include "generic.h"
+#include "error.h"
+#include "value.h"
+#include "threadpool.h"
+#include "image.h"
+#include "stats.h"
+
+/* Reading stops while a connection has this much unevaluated input */
+#define SERVE_INBUF_MAX  (1 << 20)
+
+/* Evaluation pauses while a connection has this much unsent output */
+#define SERVE_OUTBUF_MAX (1 << 20)
+
+#define SERVE_READ_CHUNK 16384
+#define SERVE_MAX_EVENTS 64
+
+typedef struct Server Server;
+typedef struct Session Session;
+
+struct Session {
+	int fd;
+	unsigned index;
+	Server* server;
+	SuperCalc* sc;
+	time_t lastActive;
+	
+	/* Bytes read from the socket that haven't been handed to a worker yet */
+	char* in;
+	size_t inlen;
+	size_t incap;
+	
+	/* Complete lines being evaluated. Only the worker touches these while busy */
+	char* work;
+	size_t worklen;
+	char* result;
+	size_t resultlen;
+	
+	/* Responses waiting to be written */
+	char* out;
+	size_t outlen;
+	size_t outcap;
+	size_t outpos;
+	
+	bool busy;
+	bool eof;
+	bool dead;
+	bool closed;
+	uint32_t events;
+	
+	/* Link in the server's list of finished jobs, or of closed sessions */
+	Session* nextDone;
+};
+
+struct Server {
+	const ServerOptions* opts;
+	int epfd;
+	int listenfd;
+	int donefd;
+	ThreadPool* pool;
+	
+	/* Shared by every session, which only decodes entries once between them */
+	Image* image;
+	
+	Session** sessions;
+	unsigned count;
+	
+	/* Workers push sessions here when they finish, then poke donefd */
+	pthread_mutex_t doneLock;
+	Session* done;
+	
+	/* Closed sessions are freed after each round of events, since later events may refer to them */
+	Session* graveyard;
+};
+
+
+static int openListener(const char* address);
+static void appendOut(Session* s, const char* data, size_t len);
+static void writeEscaped(FILE* fp, const char* str, size_t len);
+static void respond(SuperCalc* sc, const char* line, FILE* fout);
+static void serveJob(unsigned index, void* data);
+static void updateEvents(Session* s);
+static void acceptAll(Server* server);
+static void closeSession(Session* s);
+static void dispatch(Session* s);
+static void readSession(Session* s);
+static void flushSession(Session* s);
+static void finishSession(Session* s);
+static void finishJobs(Server* server);
+static void sweepIdle(Server* server);
+static void buryClosed(Server* server);
+
+
+static int openListener(const char* address) {
+	int fd;
+	
+	if(strncmp(address, "unix:", 5) == 0) {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		
+		const char* path = address + 5;
+		if(strlen(path) >= sizeof(addr.sun_path)) {
+			fprintf(stderr, "Socket path is too long: %s\n", path);
+			return -1;
+		}
+		strcpy(addr.sun_path, path);
+		
+		/* Left behind by an earlier server */
+		unlink(path);
+		
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if(fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			perror(address);
+			return -1;
+		}
+	}
+	else {
+		/* Only listen on localhost unless told otherwise */
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		
+		const char* port = address;
+		const char* colon = strrchr(address, ':');
+		if(colon != NULL) {
+			char host[64];
+			size_t len = colon - address;
+			if(len >= sizeof(host)) {
+				fprintf(stderr, "Bad address: %s\n", address);
+				return -1;
+			}
+			
+			memcpy(host, address, len);
+			host[len] = '\0';
+			port = colon + 1;
+			
+			if(strcmp(host, "localhost") != 0 && inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+				fprintf(stderr, "Bad address: %s\n", address);
+				return -1;
+			}
+		}
+		
+		char* end;
+		unsigned long num = strtoul(port, &end, 10);
+		if(*port == '\0' || *end != '\0' || num > 65535) {
+			fprintf(stderr, "Bad port: %s\n", port);
+			return -1;
+		}
+		addr.sin_port = htons((uint16_t)num);
+		
+		fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		int one = 1;
+		if(fd < 0
+		   || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0
+		   || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			perror(address);
+			return -1;
+		}
+	}
+	
+	if(listen(fd, SOMAXCONN) < 0) {
+		perror(address);
+		close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+static void appendOut(Session* s, const char* data, size_t len) {
+	if(s->outlen + len > s->outcap) {
+		s->outcap = MAX(s->outcap * 2, s->outlen + len);
+		s->out = frealloc(s->out, s->outcap);
+	}
+	
+	memcpy(s->out + s->outlen, data, len);
+	s->outlen += len;
+}
+
+static void writeEscaped(FILE* fp, const char* str, size_t len) {
+	size_t i;
+	for(i = 0; i < len; i++) {
+		switch(str[i]) {
+			case '\n': fputs("\\n", fp); break;
+			case '\\': fputs("\\\\", fp); break;
+			default:   fputc(str[i], fp); break;
+		}
+	}
+}
+
+/* Evaluates one request and writes its response line */
+static void respond(SuperCalc* sc, const char* line, FILE* fout) {
+	char* text = NULL;
+	size_t len = 0;
+	sc->fout = open_memstream(&text, &len);
+	
+	/* Errors become the response rather than being printed */
+	Error* raised = NULL;
+	Error** prevCapture = Error_capture(&raised);
+	
+	const char* p = line;
+	VERBOSITY v = getVerbosity(&p);
+	if(!(v & V_ERR)) {
+		Value* ret = SC_runString(sc, p, v);
+		if(ret) {
+			if(ret->type != VAL_VAR) {
+				Value_print(ret, sc, v);
+			}
+			
+			if(HAS_ANY(v, V_STATS | V_PERF)) {
+				Stats_print(sc, v);
+			}
+			
+			Value_free(ret);
+		}
+	}
+	
+	Error_capture(prevCapture);
+	fclose(sc->fout);
+	sc->fout = NULL;
+	
+	if(raised) {
+		SCError err;
+		Error_export(raised, &err);
+		Error_free(raised);
+		
+		fprintf(fout, "err %s ", Error_statusName(err.code));
+		writeEscaped(fout, err.msg, strlen(err.msg));
+	}
+	else {
+		/* Drop the newline after the last line of output */
+		if(len > 0 && text[len - 1] == '\n') {
+			len--;
+		}
+		
+		fputs("ok ", fout);
+		writeEscaped(fout, text, len);
+	}
+	
+	fputc('\n', fout);
+	ffree(text);
+}
+
+/* Runs on a worker thread */
+static void serveJob(unsigned index, void* data) {
+	Session* s = data;
+	FILE* fout = open_memstream(&s->result, &s->resultlen);
+	
+	char* line = s->work;
+	char* end = s->work + s->worklen;
+	while(line < end) {
+		char* nl = memchr(line, '\n', end - line);
+		*nl = '\0';
+		
+		respond(s->sc, line, fout);
+		line = nl + 1;
+	}
+	
+	fclose(fout);
+	
+	Server* server = s->server;
+	pthread_mutex_lock(&server->doneLock);
+	s->nextDone = server->done;
+	server->done = s;
+	pthread_mutex_unlock(&server->doneLock);
+	
+	uint64_t one = 1;
+	if(write(server->donefd, &one, sizeof(one)) < 0) {
+		/* The counter can't overflow in practice, and it's nonblocking */
+	}
+}
+
+static void updateEvents(Session* s) {
+	uint32_t want = 0;
+	if(!s->eof && !s->dead && s->inlen < SERVE_INBUF_MAX) {
+		want |= EPOLLIN;
+	}
+	if(s->outpos < s->outlen) {
+		want |= EPOLLOUT;
+	}
+	
+	if(want != s->events) {
+		struct epoll_event ev = {want, {.ptr = s}};
+		epoll_ctl(s->server->epfd, EPOLL_CTL_MOD, s->fd, &ev);
+		s->events = want;
+	}
+}
+
+static void acceptAll(Server* server) {
+	while(1) {
+		int fd = accept4(server->listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0) {
+			/* EAGAIN means there's nobody left to accept */
+			return;
+		}
+		
+		if(server->count >= server->opts->maxSessions) {
+			static const char busy[] = "err internal Too many sessions.\n";
+			if(send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL) < 0) {
+				/* They're getting turned away regardless */
+			}
+			close(fd);
+			continue;
+		}
+		
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		
+		Session* s = fcalloc(1, sizeof(*s));
+		s->fd = fd;
+		s->server = server;
+		s->sc = SC_new(NULL);
+		if(server->image) {
+			Context_attachImage(s->sc->ctx, Image_retain(server->image));
+		}
+		s->lastActive = time(NULL);
+		s->events = EPOLLIN;
+		
+		s->index = server->count++;
+		server->sessions = frealloc(server->sessions, server->count * sizeof(*server->sessions));
+		server->sessions[s->index] = s;
+		
+		struct epoll_event ev = {EPOLLIN, {.ptr = s}};
+		epoll_ctl(server->epfd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+static void closeSession(Session* s) {
+	/* The worker still owns it, so finishJobs will close it later */
+	if(s->busy) {
+		s->dead = true;
+		return;
+	}
+	
+	Server* server = s->server;
+	Session* last = server->sessions[--server->count];
+	server->sessions[s->index] = last;
+	last->index = s->index;
+	
+	epoll_ctl(server->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+	close(s->fd);
+	
+	s->closed = true;
+	s->nextDone = server->graveyard;
+	server->graveyard = s;
+}
+
+/* Hands every complete line to a worker, unless one is already busy with this session */
+static void dispatch(Session* s) {
+	if(s->busy || s->dead || s->outlen - s->outpos >= SERVE_OUTBUF_MAX) {
+		return;
+	}
+	
+	char* last = NULL;
+	size_t i;
+	for(i = s->inlen; i > 0; i--) {
+		if(s->in[i - 1] == '\n') {
+			last = &s->in[i - 1];
+			break;
+		}
+	}
+	
+	if(last == NULL) {
+		if(s->inlen >= LINE_MAX_LEN) {
+			/* Give up on the connection, since there's no telling where the next request starts */
+			static const char tooLong[] = "err syntax Line is too long.\n";
+			appendOut(s, tooLong, sizeof(tooLong) - 1);
+			s->inlen = 0;
+			s->eof = true;
+		}
+		
+		return;
+	}
+	
+	size_t len = last - s->in + 1;
+	ffree(s->work);
+	s->work = fmalloc(len);
+	memcpy(s->work, s->in, len);
+	s->worklen = len;
+	
+	memmove(s->in, s->in + len, s->inlen - len);
+	s->inlen -= len;
+	
+	s->busy = true;
+	ThreadPool_submit(s->server->pool, &serveJob, s);
+}
+
+static void readSession(Session* s) {
+	while(s->inlen < SERVE_INBUF_MAX) {
+		if(s->incap - s->inlen < SERVE_READ_CHUNK) {
+			s->incap = MAX(s->incap * 2, s->inlen + SERVE_READ_CHUNK);
+			s->in = frealloc(s->in, s->incap);
+		}
+		
+		ssize_t n = read(s->fd, s->in + s->inlen, s->incap - s->inlen);
+		if(n > 0) {
+			s->inlen += n;
+			s->lastActive = time(NULL);
+			continue;
+		}
+		
+		if(n == 0) {
+			s->eof = true;
+			
+			/* The last request doesn't need a newline */
+			if(s->inlen > 0 && s->in[s->inlen - 1] != '\n') {
+				s->in[s->inlen++] = '\n';
+			}
+		}
+		else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			s->dead = true;
+		}
+		break;
+	}
+}
+
+static void flushSession(Session* s) {
+	while(s->outpos < s->outlen) {
+		ssize_t n = send(s->fd, s->out + s->outpos, s->outlen - s->outpos, MSG_NOSIGNAL);
+		if(n < 0) {
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				s->dead = true;
+			}
+			break;
+		}
+		
+		s->outpos += n;
+	}
+	
+	if(s->outpos == s->outlen) {
+		s->outpos = s->outlen = 0;
+	}
+}
+
+/* Moves things along after any event on the session, and closes it when it's done */
+static void finishSession(Session* s) {
+	if(!s->dead) {
+		/* Flushing first lets dispatch resume if it was waiting on output */
+		flushSession(s);
+		dispatch(s);
+	}
+	
+	bool drained = !s->busy && s->outlen == 0 && s->inlen == 0;
+	if(s->dead || (s->eof && drained)) {
+		closeSession(s);
+		return;
+	}
+	
+	updateEvents(s);
+}
+
+static void finishJobs(Server* server) {
+	uint64_t count;
+	if(read(server->donefd, &count, sizeof(count)) < 0) {
+		/* Spurious wakeup, the list will just be empty */
+	}
+	
+	pthread_mutex_lock(&server->doneLock);
+	Session* s = server->done;
+	server->done = NULL;
+	pthread_mutex_unlock(&server->doneLock);
+	
+	while(s) {
+		Session* next = s->nextDone;
+		
+		s->busy = false;
+		s->lastActive = time(NULL);
+		appendOut(s, s->result, s->resultlen);
+		ffree(s->result);
+		s->result = NULL;
+		
+		finishSession(s);
+		s = next;
+	}
+}
+
+static void buryClosed(Server* server) {
+	while(server->graveyard) {
+		Session* s = server->graveyard;
+		server->graveyard = s->nextDone;
+		
+		SC_free(s->sc);
+		ffree(s->in);
+		ffree(s->work);
+		ffree(s->out);
+		ffree(s);
+	}
+}
+
+static void sweepIdle(Server* server) {
+	if(server->opts->idleTimeout == 0) {
+		return;
+	}
+	
+	time_t now = time(NULL);
+	
+	/* Walk backwards since closing moves the last session into the freed spot */
+	unsigned i = server->count;
+	while(i-- > 0) {
+		Session* s = server->sessions[i];
+		if(!s->busy && now - s->lastActive >= (time_t)server->opts->idleTimeout) {
+			closeSession(s);
+		}
+	}
+}
+
+int Server_run(const ServerOptions* opts) {
+	Server server;
+	memset(&server, 0, sizeof(server));
+	server.opts = opts;
+	pthread_mutex_init(&server.doneLock, NULL);
+	
+	if(opts->image) {
+		server.image = Image_open(opts->image);
+		if(server.image == NULL) {
+			return EXIT_FAILURE;
+		}
+	}
+	
+	server.listenfd = openListener(opts->address);
+	if(server.listenfd < 0) {
+		return EXIT_FAILURE;
+	}
+	
+	server.epfd = epoll_create1(EPOLL_CLOEXEC);
+	server.donefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(server.epfd < 0 || server.donefd < 0) {
+		perror("epoll");
+		return EXIT_FAILURE;
+	}
+	
+	/* The listener and donefd are told apart from sessions by their addresses */
+	struct epoll_event ev = {EPOLLIN, {.ptr = &server.listenfd}};
+	epoll_ctl(server.epfd, EPOLL_CTL_ADD, server.listenfd, &ev);
+	ev.data.ptr = &server.donefd;
+	epoll_ctl(server.epfd, EPOLL_CTL_ADD, server.donefd, &ev);
+	
+	/* This thread runs the event loop, so it doesn't count as a worker */
+	server.pool = ThreadPool_new(MAX(opts->workers, 1) + 1);
+	
+	fprintf(stderr, "Listening on %s\n", opts->address);
+	
+	struct epoll_event events[SERVE_MAX_EVENTS];
+	while(1) {
+		/* Wake up now and then to close idle sessions */
+		int n = epoll_wait(server.epfd, events, SERVE_MAX_EVENTS, 1000);
+		if(n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			break;
+		}
+		
+		int i;
+		for(i = 0; i < n; i++) {
+			void* ptr = events[i].data.ptr;
+			
+			if(ptr == &server.listenfd) {
+				acceptAll(&server);
+			}
+			else if(ptr == &server.donefd) {
+				finishJobs(&server);
+			}
+			else {
+				Session* s = ptr;
+				
+				/* Might have been closed by an earlier event in this batch */
+				if(s->closed) {
+					continue;
+				}
+				
+				if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+					readSession(s);
+				}
+				
+				finishSession(s);
+			}
+		}
+		
+		sweepIdle(&server);
+		buryClosed(&server);
+	}
+	
+	ThreadPool_free(server.pool);
+	close(server.donefd);
+	close(server.epfd);
+	close(server.listenfd);
+	return EXIT_FAILURE;
+}
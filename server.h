@@ -0,0 +1,42 @@
+/*
+  server.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_SERVER_H_
+#define _SC_SERVER_H_
+
+/*
+ Protocol: each line a client sends is one request, evaluated just like a line
+ typed into sc. Every request gets exactly one response line, in order:
+
+     ok <output>          Output has its newlines escaped as \n and \\
+     err <kind> <message> Kind is math, syntax, name, type, internal or unknown
+
+ Clients may send any number of requests without waiting for responses.
+*/
+
+typedef struct ServerOptions {
+	/* "unix:/path/to/socket", "port" or "host:port" */
+	const char* address;
+	
+	/* Image every session starts out with, or NULL */
+	const char* image;
+	
+	/* Threads evaluating requests */
+	unsigned workers;
+	
+	/* New connections beyond this many are turned away */
+	unsigned maxSessions;
+	
+	/* Seconds before an idle connection is closed, or 0 for never */
+	unsigned idleTimeout;
+} ServerOptions;
+
+/* Serves until killed. Only returns when unable to start */
+int Server_run(const ServerOptions* opts);
+
+#endif /* _SC_SERVER_H_ */
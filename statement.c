@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_PARSER
+
 #include "statement.h"
 #include <string.h>
 #include <stdio.h>
@@ -19,19 +21,31 @@
 #include "binop.h"
 #include "function.h"
 #include "binop.h"
+#include "reactive.h"
+#include "builtin.h"
 
 
 Statement* Statement_new(Variable* var) {
 	Statement* ret = fmalloc(sizeof(*ret));
 	
 	ret->var = var;
+	ret->refs = 1;
 	
 	return ret;
 }
 
 void Statement_free(Statement* stmt) {
+	if(__atomic_sub_fetch(&stmt->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+		return;
+	}
+	
 	Variable_free(stmt->var);
-	free(stmt);
+	ffree(stmt);
+}
+
+Statement* Statement_retain(Statement* stmt) {
+	__atomic_add_fetch(&stmt->refs, 1, __ATOMIC_RELAXED);
+	return stmt;
 }
 
 Statement* Statement_parse(const char** expr) {
@@ -50,7 +64,9 @@ Statement* Statement_parse(const char** expr) {
 			var = VarErr(earlyEnd());
 		}
 		else if(val->type == VAL_ERR) {
-			var = VarErr(Error_copy(val->err));
+			/* Take the error rather than copying it */
+			var = VarErr(val->err);
+			val->err = NULL;
 			Value_free(val);
 		}
 		else {
@@ -67,7 +83,8 @@ Statement* Statement_parse(const char** expr) {
 	
 	if(val->type == VAL_ERR) {
 		/* A parse error occurred */
-		var = VarErr(Error_copy(val->err));
+		var = VarErr(val->err);
+		val->err = NULL;
 		Value_free(val);
 		return Statement_new(var);
 	}
@@ -106,8 +123,8 @@ Statement* Statement_parse(const char** expr) {
 		if(arg == NULL && **expr != ')') {
 			/* Invalid character */
 			Value_free(val);
-			free(args);
-			free(name);
+			ffree(args);
+			ffree(name);
 			return Statement_new(VarErr(badChar(**expr)));
 		}
 		
@@ -115,7 +132,7 @@ Statement* Statement_parse(const char** expr) {
 		
 		if(arg == NULL) {
 			/* Empty parameter list means function with no args */
-			free(args);
+			ffree(args);
 			args = NULL;
 			len = 0;
 		}
@@ -141,14 +158,14 @@ Statement* Statement_parse(const char** expr) {
 				if(arg == NULL) {
 					/* Invalid character */
 					Value_free(val);
-					free(name);
+					ffree(name);
 					
 					/* Free argument names and return */
 					unsigned i;
 					for(i = 0; i < len; i++) {
-						free(args[i]);
+						ffree(args[i]);
 					}
-					free(args);
+					ffree(args);
 					return Statement_new(VarErr(badChar(**expr)));
 				}
 				
@@ -157,21 +174,21 @@ Statement* Statement_parse(const char** expr) {
 		}
 		
 		if(arg) {
-			free(arg);
+			ffree(arg);
 		}
 		
 		if(**expr != ')') {
 			/* Invalid character inside argument name list */
 			Value_free(val);
-			free(name);
+			ffree(name);
 			
 			if(args) {
 				/* Free argument names and return */
 				unsigned i;
 				for(i = 0; i < len; i++) {
-					free(args[i]);
+					ffree(args[i]);
 				}
-				free(args);
+				ffree(args);
 			}
 			
 			return Statement_new(VarErr(badChar(**expr)));
@@ -183,14 +200,14 @@ Statement* Statement_parse(const char** expr) {
 		
 		if(**expr != '=') {
 			Value_free(val);
-			free(name);
+			ffree(name);
 			
 			if(args) {
 				unsigned i;
 				for(i = 0; i < len; i++) {
-					free(args[i]);
+					ffree(args[i]);
 				}
-				free(args);
+				ffree(args);
 			}
 			
 			return Statement_new(VarErr(badChar(**expr)));
@@ -200,6 +217,18 @@ Statement* Statement_parse(const char** expr) {
 		Function* func = Function_new(len, args, val);
 		ret = Statement_new(VarFunc(name, func));
 	}
+	else if(**expr == ':') {
+		/* Reactive binding, like b := 2a + 4 */
+		(*expr)++;
+		
+		if(**expr != '=') {
+			Value_free(val);
+			ffree(name);
+			return Statement_new(VarErr(badChar(**expr)));
+		}
+		
+		ret = Statement_new(VarReactive(name, Reactive_new(val)));
+	}
 	else {
 		/* Defining a variable */
 		if(**expr != '=') {
@@ -209,7 +238,7 @@ Statement* Statement_parse(const char** expr) {
 			/* Still not an equals sign means invalid character */
 			if(**expr != '=') {
 				Value_free(val);
-				free(name);
+				ffree(name);
 				return Statement_new(VarErr(badChar(**expr)));
 			}
 			
@@ -222,11 +251,64 @@ Statement* Statement_parse(const char** expr) {
 	return ret;
 }
 
+static Value* coerceResult(Value* ret, const Context* ctx, VERBOSITY v) {
+	const Variable* func = Variable_get(ctx, ret->name);
+	if(func == NULL) {
+		Error* err = varNotFound(ret->name);
+		Value_free(ret);
+		return ValErr(err);
+	}
+	
+	if((v & (V_REPR|V_TREE|V_XML)) == 0
+	   || (func->type != VAR_FUNC && func->type != VAR_BUILTIN)) {
+		/* Coerce the variable to a Value */
+		Value* val = Variable_coerce(func, ctx);
+		Value_free(ret);
+		ret = val;
+	}
+	
+	return ret;
+}
+
+Value* Statement_evalPure(const Statement* stmt, const Context* ctx, VERBOSITY v, bool* ans) {
+	Variable* var = stmt->var;
+	*ans = false;
+	
+	if(var->type != VAR_VALUE || var->name != NULL) {
+		badVarType(var->type);
+	}
+	
+	/* Evaluate right side */
+	Value* ret = Value_eval(var->val, ctx);
+	
+	/* If an error occurred, bail */
+	if(ret->type == VAL_ERR) {
+		return ret;
+	}
+	
+	/* Statement result is a variable? */
+	if(ret->type == VAL_VAR) {
+		return coerceResult(ret, ctx, v);
+	}
+	
+	*ans = true;
+	return ret;
+}
+
 Value* Statement_eval(const Statement* stmt, Context* ctx, VERBOSITY v) {
 	Value* ret;
 	Variable* var = stmt->var;
 	
-	if(var->type == VAR_VALUE) {
+	if(var->type == VAR_VALUE && var->name == NULL) {
+		/* No assignment, so the only side effect is updating ans */
+		bool ans;
+		ret = Statement_evalPure(stmt, ctx, v, &ans);
+		
+		if(ans) {
+			Context_setGlobal(ctx, "ans", VarValue(NULL, Value_copy(ret)));
+		}
+	}
+	else if(var->type == VAR_VALUE) {
 		/* Evaluate right side */
 		ret = Value_eval(var->val, ctx);
 		
@@ -237,48 +319,57 @@ Value* Statement_eval(const Statement* stmt, Context* ctx, VERBOSITY v) {
 		
 		/* Statement result is a variable? */
 		if(ret->type == VAL_VAR) {
-			Variable* func = Variable_get(ctx, ret->name);
+			const Variable* func = Variable_get(ctx, ret->name);
 			if(func == NULL) {
 				Error* err = varNotFound(ret->name);
 				Value_free(ret);
 				return ValErr(err);
 			}
 			
-			if(var->name != NULL) {
-				/* Assign the variable */
-				if(func->type == VAR_BUILTIN) {
-					Value_free(ret);
-					return ValErr(typeError("Cannot assign a variable to a builtin."));
-				}
-				
-				Context_setGlobal(ctx, var->name, Variable_copy(func));
-			}
-			else if((v & (V_REPR|V_TREE|V_XML)) == 0
-					|| (func->type != VAR_FUNC && func->type != VAR_BUILTIN)) {
-				/* Coerce the variable to a Value */
-				Value* val = Variable_coerce(func, ctx);
+			/* Assign the variable */
+			if(func->type == VAR_BUILTIN) {
 				Value_free(ret);
-				ret = val;
+				return ValErr(typeError("Cannot assign a variable to a builtin."));
 			}
+			
+			Context_setGlobal(ctx, var->name, Variable_copy(func));
 		}
 		else {
-			/* This means ret must be a Value */
-			Value_free(var->val);
-			var->val = Value_copy(ret);
+			/* This means ret must be a Value, stored apart from the tree */
+			Variable* assigned = VarValue(fstrdup(var->name), Value_copy(ret));
 			
 			/* Update ans */
-			Context_setGlobal(ctx, "ans", Variable_copy(var));
+			Context_setGlobal(ctx, "ans", Variable_copy(assigned));
 			
 			/* Save the newly evaluated variable */
-			if(var->name != NULL) {
-				Context_setGlobal(ctx, var->name, Variable_copy(var));
-			}
+			Context_setGlobal(ctx, var->name, assigned);
 		}
 	}
 	else if(var->type == VAR_FUNC) {
 		ret = ValVar(var->name);
 		Context_setGlobal(ctx, var->name, Variable_copy(var));
 	}
+	else if(var->type == VAR_REACTIVE) {
+		if(strcmp(var->name, "ans") == 0) {
+			return ValErr(nameError("Cannot make special variable 'ans' reactive."));
+		}
+		
+		if(Builtin_find(var->name) != NULL) {
+			return ValErr(typeError("Unable to modify builtin variable '%s'.", var->name));
+		}
+		
+		if(Reactive_reaches(var->rx->formula, ctx, var->name)) {
+			return ValErr(typeError("Reactive binding '%s' would depend on itself.", var->name));
+		}
+		
+		/* Bound even if the formula fails for now, since what it reads may be defined later */
+		Context_setGlobal(ctx, var->name, Variable_copy(var));
+		ret = Variable_eval(Context_get(ctx, var->name), ctx);
+		
+		if(ret->type != VAL_ERR) {
+			Context_setGlobal(ctx, "ans", VarValue(NULL, Value_copy(ret)));
+		}
+	}
 	else {
 		badVarType(var->type);
 	}
@@ -286,80 +377,180 @@ Value* Statement_eval(const Statement* stmt, Context* ctx, VERBOSITY v) {
 	return ret;
 }
 
+struct PurityCheck {
+	const Context* ctx;
+	const Function** seen;
+	unsigned count;
+	unsigned capacity;
+};
+
+static bool checkPureName(const char* name, void* data) {
+	struct PurityCheck* check = data;
+	
+	/* The value of ans changes after every statement */
+	if(strcmp(name, "ans") == 0) {
+		return false;
+	}
+	
+	const Variable* var = Variable_get(check->ctx, name);
+	
+	/* Reading a reactive binding may evaluate it, which writes to the context */
+	if(var != NULL && var->type == VAR_REACTIVE) {
+		return false;
+	}
+	
+	if(var == NULL || var->type != VAR_FUNC) {
+		return true;
+	}
+	
+	/* Functions can read ans too, so look inside of them (only once each) */
+	unsigned i;
+	for(i = 0; i < check->count; i++) {
+		if(check->seen[i] == var->func) {
+			return true;
+		}
+	}
+	
+	if(check->count >= check->capacity) {
+		check->capacity = check->capacity ? check->capacity * 2 : 4;
+		check->seen = frealloc(check->seen, check->capacity * sizeof(*check->seen));
+	}
+	check->seen[check->count++] = var->func;
+	
+	return Value_visitNames(var->func->body, &checkPureName, check);
+}
+
+bool Statement_isPure(const Statement* stmt, const Context* ctx) {
+	Variable* var = stmt->var;
+	
+	/* Parse errors just print a message */
+	if(var->type == VAR_ERR) {
+		return true;
+	}
+	
+	/* Assignments and function definitions modify the context */
+	if(var->type != VAR_VALUE || var->name != NULL) {
+		return false;
+	}
+	
+	struct PurityCheck check = {ctx, NULL, 0, 0};
+	bool ret = Value_visitNames(var->val, &checkPureName, &check);
+	
+	ffree(check.seen);
+	return ret;
+}
+
 bool Statement_didError(const Statement* stmt) {
 	return (stmt->var->type == VAR_ERR);
 }
 
-char* Statement_repr(const Statement* stmt, const Context* ctx, bool pretty) {
+void Statement_repr(const Statement* stmt, const Context* ctx, StrBuf* sb, bool pretty) {
 	/* I think I toungued my twist trying to read this aloud */
 	if(stmt->var->type == VAR_VALUE && stmt->var->val->type == VAL_VAR) {
-		/* Return the reprint of the variable in ctx */
-		Variable* var = Variable_get(ctx, stmt->var->val->name);
+		/* Print the reprint of the variable in ctx */
+		const Variable* var = Variable_get(ctx, stmt->var->val->name);
 		if(var == NULL) {
-			/* If the variable doesn't exist, just return its name */
-			if(pretty) {
-				return strdup(getPretty(stmt->var->val->name));
-			}
-			
-			return strdup(stmt->var->val->name);
+			/* If the variable doesn't exist, just print its name */
+			const char* name = stmt->var->val->name;
+			StrBuf_append(sb, pretty ? getPretty(name) : name);
+			return;
 		}
 		
-		return Variable_repr(var, pretty);
+		Variable_repr(var, sb, pretty);
+		return;
 	}
 	
-	return Variable_repr(stmt->var, pretty);
+	Variable_repr(stmt->var, sb, pretty);
 }
 
-char* Statement_wrap(const Statement* stmt, const Context* ctx) {
+void Statement_wrap(const Statement* stmt, const Context* ctx, StrBuf* sb) {
 	/* I think I toungued my twist trying to read this aloud */
 	if(stmt->var->type == VAR_VALUE && stmt->var->val->type == VAL_VAR) {
-		/* Return the reprint of the variable in ctx */
-		Variable* var = Variable_get(ctx, stmt->var->val->name);
+		/* Print the reprint of the variable in ctx */
+		const Variable* var = Variable_get(ctx, stmt->var->val->name);
 		if(var == NULL) {
-			/* If the variable doesn't exist, just return its name */
-			return strdup(stmt->var->val->name);
+			/* If the variable doesn't exist, just print its name */
+			StrBuf_append(sb, stmt->var->val->name);
+			return;
 		}
 		
-		return Variable_wrap(var);
+		Variable_wrap(var, sb);
+		return;
 	}
 	
-	return Variable_wrap(stmt->var);
+	Variable_wrap(stmt->var, sb);
 }
 
-char* Statement_verbose(const Statement* stmt, const Context* ctx) {
+void Statement_verbose(const Statement* stmt, const Context* ctx, StrBuf* sb) {
 	if(stmt->var->type == VAR_VALUE && stmt->var->val->type == VAL_VAR) {
-		/* Return the verbose representation of the variable in ctx */
-		Variable* var = Variable_get(ctx, stmt->var->val->name);
+		/* Print the verbose representation of the variable in ctx */
+		const Variable* var = Variable_get(ctx, stmt->var->val->name);
 		if(var == NULL) {
-			/* If the variable doesn't exist, just return its name */
-			return Value_verbose(stmt->var->val, 0);
+			/* If the variable doesn't exist, just print its name */
+			Value_verbose(stmt->var->val, sb, 0);
+			return;
 		}
 		
-		return Variable_verbose(var);
+		Variable_verbose(var, sb);
+		return;
 	}
 	
-	return Variable_verbose(stmt->var);
+	Variable_verbose(stmt->var, sb);
 }
 
-char* Statement_xml(const Statement* stmt, const Context* ctx) {
+void Statement_xml(const Statement* stmt, const Context* ctx, StrBuf* sb) {
 	if(stmt->var->type == VAR_VALUE && stmt->var->val->type == VAL_VAR) {
-		/* Return the xml representation of the variable in ctx */
-		Variable* var = Variable_get(ctx, stmt->var->val->name);
+		/* Print the xml representation of the variable in ctx */
+		const Variable* var = Variable_get(ctx, stmt->var->val->name);
 		if(var == NULL) {
-			/* If the variable doesn't exist, just return its name */
-			return Value_xml(stmt->var->val, 0);
+			/* If the variable doesn't exist, just print its name */
+			Value_xml(stmt->var->val, sb, 0);
+			return;
 		}
 		
-		return Variable_xml(var);
+		Variable_xml(var, sb);
+		return;
 	}
 	
-	return Variable_xml(stmt->var);
+	Variable_xml(stmt->var, sb);
+}
+
+void Statement_json(const Statement* stmt, const Context* ctx, StrBuf* sb) {
+	if(stmt->var->type == VAR_VALUE && stmt->var->val->type == VAL_VAR) {
+		/* Show what the variable holds, like Statement_xml */
+		const Variable* var = Variable_get(ctx, stmt->var->val->name);
+		if(var == NULL) {
+			Value_json(stmt->var->val, sb);
+			return;
+		}
+		
+		Variable_json(var, sb);
+		return;
+	}
+	
+	Variable_json(stmt->var, sb);
 }
 
 void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 	/* Error parsing? */
 	if(Statement_didError(stmt)) {
+		bool json = Error_setJson(Error_jsonMode() || HAS_ANY(v, V_JSON));
 		Error_raise(stmt->var->err, false);
+		Error_setJson(json);
+		return;
+	}
+	
+	/* Trees can be huge, so they're streamed to the output rather than built up */
+	StrBuf sb;
+	StrBuf_initFile(&sb, sc->fout);
+	
+	if(v & V_JSON) {
+		/* Only the tree has a JSON form, and the result follows on its own line */
+		if(v & V_TREE) {
+			StrBuf_append(&sb, "{\"tree\":");
+			Statement_json(stmt, sc->ctx, &sb);
+			StrBuf_append(&sb, "}\n");
+		}
 		return;
 	}
 	
@@ -369,9 +560,8 @@ void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 		needNewline++;
 		
 		/* Dump XML output because why not? */
-		char* xml = Statement_xml(stmt, sc->ctx);
-		fprintf(sc->fout, "%s\n", xml);
-		free(xml);
+		Statement_xml(stmt, sc->ctx, &sb);
+		StrBuf_putc(&sb, '\n');
 	}
 	
 	if(v & V_TREE) {
@@ -380,9 +570,8 @@ void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 		}
 		
 		/* Dump parse tree */
-		char* tree = Statement_verbose(stmt, sc->ctx);
-		fprintf(sc->fout, "%s\n", tree);
-		free(tree);
+		Statement_verbose(stmt, sc->ctx, &sb);
+		StrBuf_putc(&sb, '\n');
 	}
 	
 	if(v & V_WRAP) {
@@ -391,9 +580,8 @@ void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 		}
 		
 		/* Wrap lots of stuff in parentheses for clarity */
-		char* wrapped = Statement_wrap(stmt, sc->ctx);
-		fprintf(sc->fout, "%s\n", wrapped);
-		free(wrapped);
+		Statement_wrap(stmt, sc->ctx, &sb);
+		StrBuf_putc(&sb, '\n');
 	}
 	
 	if(v & V_REPR) {
@@ -402,9 +590,8 @@ void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 		}
 		
 		/* Print parenthesized statement */
-		char* reprinted = Statement_repr(stmt, sc->ctx, v & V_PRETTY);
-		fprintf(sc->fout, "%s\n", reprinted);
-		free(reprinted);
+		Statement_repr(stmt, sc->ctx, &sb, v & V_PRETTY);
+		StrBuf_putc(&sb, '\n');
 	}
 	
 	if(needNewline++ && sc->interactive) {
@@ -412,3 +599,41 @@ void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v) {
 	}
 }
 
+
+void Statement_printUpdates(const char* names, const SuperCalc* sc, VERBOSITY v) {
+	StrBuf sb;
+	StrBuf_initFile(&sb, sc->fout);
+	
+	if(v & V_JSON) {
+		/* Names are logged as "a, b, c" */
+		StrBuf_append(&sb, "{\"recomputed\":[");
+		
+		const char* p = names;
+		while(*p != '\0') {
+			size_t len = strcspn(p, ",");
+			StrBuf_putc(&sb, '"');
+			StrBuf_appendn(&sb, p, len);
+			StrBuf_putc(&sb, '"');
+			
+			p += len;
+			if(*p == ',') {
+				StrBuf_putc(&sb, ',');
+				p += 2;
+			}
+		}
+		
+		StrBuf_append(&sb, "]}\n");
+		return;
+	}
+	
+	if(*names == '\0') {
+		StrBuf_append(&sb, "Nothing recomputed\n");
+	}
+	else {
+		StrBuf_printf(&sb, "Recomputed %s\n", names);
+	}
+	
+	if(sc->interactive) {
+		fputc('\n', sc->fout);
+	}
+}
@@ -20,6 +20,7 @@ typedef struct Statement Statement;
 
 struct Statement {
 	Variable* var;
+	unsigned refs;
 };
 
 
@@ -34,6 +35,12 @@ Statement* Statement_new(Variable* var);
 /* Destructor */
 void Statement_free(Statement* stmt);
 
+/*
+ Parsed statements are shared by the parse cache, so they're reference counted
+ and never modified by evaluation. Statement_free drops one reference.
+*/
+Statement* Statement_retain(Statement* stmt);
+
 /* Parsing */
 Statement* Statement_parse(const char** expr);
 
@@ -43,11 +50,24 @@ bool Statement_didError(const Statement* stmt);
 /* Evaluation */
 Value* Statement_eval(const Statement* stmt, Context* ctx, VERBOSITY v);
 
+/*
+ Pure statements only read from the context, so independent ones can be
+ evaluated concurrently. Statement_evalPure is like Statement_eval but never
+ modifies `ctx`. Instead, `ans` is set to whether the result should be stored
+ as the new value of "ans".
+*/
+bool Statement_isPure(const Statement* stmt, const Context* ctx);
+Value* Statement_evalPure(const Statement* stmt, const Context* ctx, VERBOSITY v, bool* ans);
+
 /* Printing */
-char* Statement_repr(const Statement* stmt, const Context* ctx, bool pretty);
-char* Statement_wrap(const Statement* stmt, const Context* ctx);
-char* Statement_verbose(const Statement* stmt, const Context* ctx);
-char* Statement_xml(const Statement* stmt, const Context* ctx);
+void Statement_repr(const Statement* stmt, const Context* ctx, StrBuf* sb, bool pretty);
+void Statement_wrap(const Statement* stmt, const Context* ctx, StrBuf* sb);
+void Statement_verbose(const Statement* stmt, const Context* ctx, StrBuf* sb);
+void Statement_xml(const Statement* stmt, const Context* ctx, StrBuf* sb);
+void Statement_json(const Statement* stmt, const Context* ctx, StrBuf* sb);
 void Statement_print(const Statement* stmt, const SuperCalc* sc, VERBOSITY v);
 
+/* For `?u`, prints the reactive bindings recomputed while evaluating, as logged by Reactive_setLog */
+void Statement_printUpdates(const char* names, const SuperCalc* sc, VERBOSITY v);
+
 #endif
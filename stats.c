@@ -0,0 +1,205 @@
+/*
+  stats.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "supercalc.h"
+#include "strbuf.h"
+#include "perf.h"
+
+/* Time spent in one phase, in seconds, and the hardware counts for `?h` */
+typedef struct PhaseTime {
+	double wall;
+	double cpu;
+	PerfCounts hw;
+} PhaseTime;
+
+/* What `?s` and `?h` report for a line */
+typedef struct LineStats {
+	PhaseTime parse;
+	PhaseTime eval;
+	StatCounters counts;
+} LineStats;
+
+
+#ifndef SC_NO_STATS
+THREAD_LOCAL StatCounters sc_stats;
+#endif
+
+/* The line being measured on this thread, or the last one finished */
+static THREAD_LOCAL LineStats line_stats;
+
+/* Counter values and clocks when the current phase started */
+static THREAD_LOCAL StatCounters phase_counts;
+static THREAD_LOCAL PhaseTime phase_start;
+static THREAD_LOCAL bool phase_hw;
+
+
+static double clockSeconds(clockid_t clock);
+static void startPhase(VERBOSITY v);
+static void endPhase(PhaseTime* phase);
+static void printPhase(StrBuf* sb, const char* name, const PhaseTime* phase, bool json);
+static void printHardware(StrBuf* sb, const char* name, const PhaseTime* phase, bool json);
+static void printStats(StrBuf* sb, const LineStats* st, bool json);
+static void printPerf(StrBuf* sb, const LineStats* st, bool json);
+
+
+static double clockSeconds(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void startPhase(VERBOSITY v) {
+#ifndef SC_NO_STATS
+	phase_counts = sc_stats;
+#endif
+	
+	phase_start.wall = clockSeconds(CLOCK_MONOTONIC);
+	phase_start.cpu = clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+	
+	/* Read last, so as little as possible besides the phase itself is counted */
+	phase_hw = v & V_PERF;
+	if(phase_hw) {
+		Perf_read(&phase_start.hw);
+	}
+}
+
+static void endPhase(PhaseTime* phase) {
+	if(phase_hw) {
+		PerfCounts now;
+		Perf_read(&now);
+		Perf_diff(&phase_start.hw, &now, &phase->hw);
+	}
+	
+	phase->wall = clockSeconds(CLOCK_MONOTONIC) - phase_start.wall;
+	phase->cpu = clockSeconds(CLOCK_THREAD_CPUTIME_ID) - phase_start.cpu;
+
+#ifndef SC_NO_STATS
+	/* Both phases add to the same totals for the line */
+	line_stats.counts.nodes += sc_stats.nodes - phase_counts.nodes;
+	line_stats.counts.values += sc_stats.values - phase_counts.values;
+	line_stats.counts.funcCalls += sc_stats.funcCalls - phase_counts.funcCalls;
+	line_stats.counts.builtinCalls += sc_stats.builtinCalls - phase_counts.builtinCalls;
+	line_stats.counts.templates += sc_stats.templates - phase_counts.templates;
+#endif
+}
+
+static void printPhase(StrBuf* sb, const char* name, const PhaseTime* phase, bool json) {
+	if(json) {
+		StrBuf_printf(sb, "\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}",
+		              name, phase->wall * 1e3, phase->cpu * 1e3);
+	}
+	else {
+		StrBuf_printf(sb, "%-6s %.3f ms wall, %.3f ms CPU\n",
+		              name, phase->wall * 1e3, phase->cpu * 1e3);
+	}
+}
+
+/* Without counters, only the wall time is left */
+static void printHardware(StrBuf* sb, const char* name, const PhaseTime* phase, bool json) {
+	if(json) {
+		StrBuf_printf(sb, "\"%s\":{\"wall_ms\":%.3f", name, phase->wall * 1e3);
+		if(phase->hw.valid) {
+			StrBuf_putc(sb, ',');
+			Perf_print(&phase->hw, 1, sb, true);
+		}
+		StrBuf_putc(sb, '}');
+		return;
+	}
+	
+	StrBuf_printf(sb, "%-6s ", name);
+	if(phase->hw.valid) {
+		Perf_print(&phase->hw, 1, sb, false);
+		StrBuf_printf(sb, " in %.3f ms\n", phase->wall * 1e3);
+	}
+	else {
+		StrBuf_printf(sb, "%.3f ms, hardware counters unavailable\n", phase->wall * 1e3);
+	}
+}
+
+static void printStats(StrBuf* sb, const LineStats* st, bool json) {
+	if(json) {
+		StrBuf_append(sb, "{\"stats\":{");
+		printPhase(sb, "parse", &st->parse, true);
+		StrBuf_putc(sb, ',');
+		printPhase(sb, "eval", &st->eval, true);
+#ifndef SC_NO_STATS
+		StrBuf_printf(sb, ",\"nodes\":%lu,\"values\":%lu,\"function_calls\":%lu,"
+		              "\"builtin_calls\":%lu,\"templates\":%lu",
+		              st->counts.nodes, st->counts.values, st->counts.funcCalls,
+		              st->counts.builtinCalls, st->counts.templates);
+#endif
+		StrBuf_append(sb, "}}\n");
+		return;
+	}
+	
+	printPhase(sb, "Parse:", &st->parse, false);
+	printPhase(sb, "Eval:", &st->eval, false);
+
+#ifdef SC_NO_STATS
+	StrBuf_append(sb, "Counters were disabled when configuring\n");
+#else
+	StrBuf_printf(sb, "Nodes: %lu, values: %lu, function calls: %lu, builtin calls: %lu, templates: %lu\n",
+	              st->counts.nodes, st->counts.values, st->counts.funcCalls,
+	              st->counts.builtinCalls, st->counts.templates);
+#endif
+}
+
+static void printPerf(StrBuf* sb, const LineStats* st, bool json) {
+	if(json) {
+		StrBuf_append(sb, "{\"perf\":{");
+		printHardware(sb, "parse", &st->parse, true);
+		StrBuf_putc(sb, ',');
+		printHardware(sb, "eval", &st->eval, true);
+		StrBuf_append(sb, "}}\n");
+		return;
+	}
+	
+	printHardware(sb, "Parse:", &st->parse, false);
+	printHardware(sb, "Eval:", &st->eval, false);
+}
+
+
+void Stats_beginParse(VERBOSITY v) {
+	memset(&line_stats, 0, sizeof(line_stats));
+	startPhase(v);
+}
+
+void Stats_endParse(void) {
+	endPhase(&line_stats.parse);
+}
+
+void Stats_beginEval(VERBOSITY v) {
+	startPhase(v);
+}
+
+void Stats_endEval(void) {
+	endPhase(&line_stats.eval);
+}
+
+void Stats_print(const SuperCalc* sc, VERBOSITY v) {
+	StrBuf sb;
+	StrBuf_initFile(&sb, sc->fout);
+	
+	/* Set apart from the result printed just before */
+	if(sc->interactive && !(v & V_JSON)) {
+		StrBuf_putc(&sb, '\n');
+	}
+	
+	if(v & V_STATS) {
+		printStats(&sb, &line_stats, v & V_JSON);
+	}
+	
+	if(v & V_PERF) {
+		printPerf(&sb, &line_stats, v & V_JSON);
+	}
+}
@@ -0,0 +1,49 @@
+/*
+  stats.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_STATS_H_
+#define _SC_STATS_H_
+
+#include "support.h"
+
+typedef struct SuperCalc SuperCalc;
+#include "generic.h"
+
+/* Running totals of the work done by the current thread */
+typedef struct StatCounters {
+	unsigned long nodes;
+	unsigned long values;
+	unsigned long funcCalls;
+	unsigned long builtinCalls;
+	unsigned long templates;
+} StatCounters;
+
+/* Configuring with --disable-stats removes the counters entirely */
+#ifdef SC_NO_STATS
+# define STAT_INC(field) ((void)0)
+#else
+extern THREAD_LOCAL StatCounters sc_stats;
+# define STAT_INC(field) ((void)sc_stats.field++)
+#endif
+
+
+/*
+ For `?s` and `?h`, these bracket the work done for one line on the current
+ thread. Stats_beginParse starts over, and Stats_endEval finishes the line.
+ Lines whose parse is skipped only need the eval half. Hardware counters are
+ only read when `v` has V_PERF.
+*/
+void Stats_beginParse(VERBOSITY v);
+void Stats_endParse(void);
+void Stats_beginEval(VERBOSITY v);
+void Stats_endEval(void);
+
+/* Prints what `v` asks for about the line most recently finished on this thread */
+void Stats_print(const SuperCalc* sc, VERBOSITY v);
+
+#endif /* _SC_STATS_H_ */
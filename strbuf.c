@@ -0,0 +1,176 @@
+/*
+  strbuf.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#define MEM_TAG MEM_PRINTING
+
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "generic.h"
+#include "dtoa.h"
+
+/* Most printed values are short */
+#define INITIAL_CAP 64
+
+
+static void reserve(StrBuf* sb, size_t extra);
+
+
+/* Makes room for extra more characters plus the terminator */
+static void reserve(StrBuf* sb, size_t extra) {
+	size_t need = sb->len + extra + 1;
+	if(need <= sb->cap) {
+		return;
+	}
+	
+	/* Doubling keeps appending linear overall */
+	size_t cap = sb->cap ?: INITIAL_CAP;
+	while(cap < need) {
+		cap *= 2;
+	}
+	
+	sb->str = frealloc(sb->str, cap);
+	sb->cap = cap;
+}
+
+
+void StrBuf_init(StrBuf* sb) {
+	sb->str = NULL;
+	sb->len = 0;
+	sb->cap = 0;
+	sb->fp = NULL;
+}
+
+void StrBuf_initFile(StrBuf* sb, FILE* fp) {
+	StrBuf_init(sb);
+	sb->fp = fp;
+}
+
+char* StrBuf_finish(StrBuf* sb) {
+	if(sb->fp != NULL) {
+		return NULL;
+	}
+	
+	/* An empty buffer still returns an empty string */
+	reserve(sb, 0);
+	sb->str[sb->len] = '\0';
+	
+	char* ret = sb->str;
+	StrBuf_init(sb);
+	return ret;
+}
+
+void StrBuf_append(StrBuf* sb, const char* str) {
+	StrBuf_appendn(sb, str, strlen(str));
+}
+
+void StrBuf_appendn(StrBuf* sb, const char* str, size_t len) {
+	if(sb->fp != NULL) {
+		fwrite(str, 1, len, sb->fp);
+		return;
+	}
+	
+	reserve(sb, len);
+	memcpy(sb->str + sb->len, str, len);
+	sb->len += len;
+}
+
+void StrBuf_putc(StrBuf* sb, char c) {
+	if(sb->fp != NULL) {
+		fputc(c, sb->fp);
+		return;
+	}
+	
+	reserve(sb, 1);
+	sb->str[sb->len++] = c;
+}
+
+void StrBuf_printf(StrBuf* sb, const char* fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	
+	if(sb->fp != NULL) {
+		vfprintf(sb->fp, fmt, args);
+		va_end(args);
+		return;
+	}
+	
+	/* Try formatting into the space that's left, then again with enough */
+	va_list again;
+	va_copy(again, args);
+	
+	size_t room = sb->cap > sb->len ? sb->cap - sb->len : 0;
+	int len = vsnprintf(room ? sb->str + sb->len : NULL, room, fmt, args);
+	if(len >= 0 && (size_t)len >= room) {
+		reserve(sb, len);
+		vsnprintf(sb->str + sb->len, len + 1, fmt, again);
+	}
+	
+	if(len > 0) {
+		sb->len += len;
+	}
+	
+	va_end(again);
+	va_end(args);
+}
+
+void StrBuf_real(StrBuf* sb, double val) {
+	char buf[SHORTEST_MAX];
+	StrBuf_appendn(sb, buf, formatShortest(buf, val));
+}
+
+void StrBuf_newline(StrBuf* sb, unsigned indent) {
+	StrBuf_putc(sb, '\n');
+	StrBuf_append(sb, indentation(indent));
+}
+
+void StrBuf_jsonString(StrBuf* sb, const char* str) {
+	StrBuf_putc(sb, '"');
+	
+	/* Copy runs of characters that don't need escaping all at once */
+	while(*str != '\0') {
+		const char* start = str;
+		while((unsigned char)*str >= ' ' && *str != '"' && *str != '\\') {
+			str++;
+		}
+		
+		StrBuf_appendn(sb, start, str - start);
+		
+		switch(*str) {
+			case '\0': break;
+			case '"':  StrBuf_append(sb, "\\\""); break;
+			case '\\': StrBuf_append(sb, "\\\\"); break;
+			case '\n': StrBuf_append(sb, "\\n"); break;
+			case '\t': StrBuf_append(sb, "\\t"); break;
+			default:   StrBuf_printf(sb, "\\u%04x", (unsigned char)*str); break;
+		}
+		
+		if(*str != '\0') {
+			str++;
+		}
+	}
+	
+	StrBuf_putc(sb, '"');
+}
+
+void StrBuf_jsonReal(StrBuf* sb, double val) {
+	/* JSON has no infinities or NaN, so they're written as strings */
+	if(isnan(val)) {
+		StrBuf_append(sb, "\"nan\"");
+	}
+	else if(isinf(val)) {
+		StrBuf_append(sb, val < 0 ? "\"-inf\"" : "\"inf\"");
+	}
+	else {
+		StrBuf_real(sb, val);
+	}
+}
@@ -0,0 +1,55 @@
+/*
+  strbuf.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_STRBUF_H_
+#define _SC_STRBUF_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+typedef struct StrBuf StrBuf;
+
+/*
+ Output for the printers. A buffer either grows a string in memory or writes
+ straight through to a stream, so a tree can be printed in one pass without
+ every node building a copy of its children's text.
+*/
+struct StrBuf {
+	char* str;
+	size_t len;
+	size_t cap;
+	FILE* fp;
+};
+
+
+/* Constructors */
+void StrBuf_init(StrBuf* sb);
+void StrBuf_initFile(StrBuf* sb, FILE* fp);
+
+/* Returns the built string, which the caller must free, or NULL for a stream */
+char* StrBuf_finish(StrBuf* sb);
+
+/* Appending */
+void StrBuf_append(StrBuf* sb, const char* str);
+void StrBuf_appendn(StrBuf* sb, const char* str, size_t len);
+void StrBuf_putc(StrBuf* sb, char c);
+void StrBuf_printf(StrBuf* sb, const char* fmt, ...);
+
+/* Shortest decimal that reads back as the same double */
+void StrBuf_real(StrBuf* sb, double val);
+
+/* Starts a new line indented to the given level */
+void StrBuf_newline(StrBuf* sb, unsigned indent);
+
+/* JSON string literal with quotes, backslashes and control characters escaped */
+void StrBuf_jsonString(StrBuf* sb, const char* str);
+
+/* Shortest decimal that reads back as the same double, or "inf", "-inf" or "nan" */
+void StrBuf_jsonReal(StrBuf* sb, double val);
+
+#endif /* _SC_STRBUF_H_ */
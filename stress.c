@@ -0,0 +1,241 @@
+/*
+  stress.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+/*
+ Runs the same script on many threads at once, each with its own SuperCalc
+ instance, plus one instance evaluating in parallel with --jobs. Every run
+ must produce exactly the output of a single-threaded run. All threads also
+ share one prepared handle. Build with -fsanitize=thread to also catch races
+ that happen not to change the output.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "supercalc.h"
+#include "generic.h"
+
+#define THREADS    32
+#define ITERATIONS 8
+#define NESTING    100
+#define PREP_EVALS 200
+
+typedef struct Output {
+	char* out;
+	size_t outlen;
+	char* err;
+	size_t errlen;
+} Output;
+
+
+static const char* script_base =
+	"(2 / 7) ^ 2\n"
+	"-(3 + 4!/7)^3\n"
+	"sqrt(16) + sqrt(2/9)\n"
+	"exp(1) - e\n"
+	"|<3, 4>| + abs(-7/3)\n"
+	"norm(<3, 4, 12>)\n"
+	"<1, 2, 3>[1] + <4, 5, 6>[2]\n"
+	"cross(<1, 0, 0>, <0, 1, 0>)\n"
+	"f(x) = 3x + 4\n"
+	"map(f, <1, 2, 3, 4>)\n"
+	"g(x, y) = f(x) * y + sqrt(x)\n"
+	"?r g(9, 2)\n"
+	"?p g(4, 1/3)\n"
+	"?t f(2) + <1, f(3)>[0]\n"
+	"?x sqrt(f(4))\n"
+	"a = 5\n"
+	"a * 3 + ans\n"
+	"missing + 1\n"
+	"1 / 0\n"
+	"sqrt(1, 2)\n"
+	"3 +* 4\n"
+	"dot(<1, 2>, <3, 4>) + mag(<6, 8>)\n";
+
+static char* script = NULL;
+static Output reference;
+
+static Output* results[THREADS + 1];
+
+static Prepared* shared = NULL;
+static double expected[PREP_EVALS];
+static bool prepFailed[THREADS + 1];
+
+
+static void buildScript(void);
+static Output* runScript(unsigned jobs);
+static void freeOutput(Output* o);
+static bool sameOutput(const Output* a, const Output* b);
+static void* threadMain(void* arg);
+static void prepArgs(unsigned n, double args[2]);
+
+
+/* Deep nesting pushes the verbose printers past the preallocated indentation */
+static void buildScript(void) {
+	size_t size = strlen(script_base) + 2 * (3 * NESTING + 8);
+	script = malloc(size);
+	
+	strcpy(script, script_base);
+	
+	const char* prefixes[] = {"?t ", "?x "};
+	unsigned p;
+	for(p = 0; p < 2; p++) {
+		strcat(script, prefixes[p]);
+		
+		unsigned i;
+		for(i = 0; i < NESTING; i++) {
+			strcat(script, "-(");
+		}
+		strcat(script, "1");
+		for(i = 0; i < NESTING; i++) {
+			strcat(script, ")");
+		}
+		strcat(script, "\n");
+	}
+}
+
+static Output* runScript(unsigned jobs) {
+	Output* ret = calloc(1, sizeof(*ret));
+	
+	FILE* fin = fmemopen(script, strlen(script), "r");
+	FILE* fout = open_memstream(&ret->out, &ret->outlen);
+	FILE* ferr = open_memstream(&ret->err, &ret->errlen);
+	
+	SuperCalc* sc = SC_new(fout);
+	sc->ferr = ferr;
+	SC_setJobs(sc, jobs);
+	
+	Value* last = SC_runFile(sc, fin, "");
+	if(last) {
+		Value_free(last);
+	}
+	
+	SC_free(sc);
+	fclose(fin);
+	fclose(fout);
+	fclose(ferr);
+	
+	return ret;
+}
+
+static void freeOutput(Output* o) {
+	free(o->out);
+	free(o->err);
+	free(o);
+}
+
+static bool sameOutput(const Output* a, const Output* b) {
+	return a->outlen == b->outlen && memcmp(a->out, b->out, a->outlen) == 0
+	    && a->errlen == b->errlen && memcmp(a->err, b->err, a->errlen) == 0;
+}
+
+static void prepArgs(unsigned n, double args[2]) {
+	args[0] = n % 17 + 0.5;
+	args[1] = n % 5;
+}
+
+static void* threadMain(void* arg) {
+	unsigned index = (unsigned)(size_t)arg;
+	
+	unsigned n;
+	for(n = 0; n < PREP_EVALS; n++) {
+		double args[2];
+		double result;
+		prepArgs(n, args);
+		
+		if(Prepared_eval(shared, args, &result, NULL) != SC_OK || result != expected[n]) {
+			prepFailed[index] = true;
+			break;
+		}
+	}
+	
+	/* The extra thread shares its work out to a pool of its own */
+	unsigned jobs = index == THREADS ? 8 : 1;
+	
+	unsigned i;
+	for(i = 0; i < ITERATIONS; i++) {
+		Output* o = runScript(jobs);
+		
+		if(!sameOutput(o, &reference)) {
+			results[index] = o;
+			break;
+		}
+		
+		freeOutput(o);
+	}
+	
+	return NULL;
+}
+
+int main(void) {
+	buildScript();
+	
+	/* Everything must match what a lone thread produces */
+	Output* ref = runScript(1);
+	reference = *ref;
+	free(ref);
+	
+	SuperCalc* sc = SC_new(NULL);
+	SC_exec(sc, "f(x, y) = 3x^2 + y/7", NULL, NULL);
+	
+	const char* params[] = {"x", "y"};
+	shared = SC_prepare(sc, "f(x, y) + sqrt(x) * <x, y, 3>[1] + y!", params, 2, NULL);
+	SC_free(sc);
+	
+	unsigned n;
+	for(n = 0; n < PREP_EVALS; n++) {
+		double args[2];
+		prepArgs(n, args);
+		Prepared_eval(shared, args, &expected[n], NULL);
+	}
+	
+	pthread_t threads[THREADS + 1];
+	
+	unsigned i;
+	for(i = 0; i <= THREADS; i++) {
+		if(pthread_create(&threads[i], NULL, &threadMain, (void*)(size_t)i) != 0) {
+			fprintf(stderr, "Unable to create thread %u.\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+	
+	for(i = 0; i <= THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	
+	int status = EXIT_SUCCESS;
+	for(i = 0; i <= THREADS; i++) {
+		if(results[i] == NULL) {
+			continue;
+		}
+		
+		fprintf(stderr, "Thread %u output differs.\n"
+		                "Expected:\n%s%s\n"
+		                "Got:\n%s%s\n",
+		        i, reference.out, reference.err, results[i]->out, results[i]->err);
+		freeOutput(results[i]);
+		status = EXIT_FAILURE;
+	}
+	
+	for(i = 0; i <= THREADS; i++) {
+		if(prepFailed[i]) {
+			fprintf(stderr, "Thread %u got a wrong prepared result.\n", i);
+			status = EXIT_FAILURE;
+		}
+	}
+	
+	Prepared_free(shared);
+	free(reference.out);
+	free(reference.err);
+	free(script);
+	
+	return status;
+}
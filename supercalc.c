@@ -11,33 +11,119 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <ctype.h>
 
 #include "error.h"
 #include "generic.h"
 #include "value.h"
 #include "context.h"
 #include "statement.h"
-#include "defaults.h"
+#include "threadpool.h"
+#include "prepared.h"
+#include "image.h"
+#include "parsecache.h"
+#include "resultcache.h"
+#include "reactive.h"
+#include "stats.h"
+#include "trace.h"
+#include "template.h"
+
+
+/* Maximum number of pure statements to hold before evaluating them */
+#define BATCH_MAX 1024
+
+/* Number of distinct lines whose parse trees are kept */
+#define PARSE_CACHE_SIZE 256
+
+/* Number of expressions whose results are kept */
+#define RESULT_CACHE_SIZE 256
+
+typedef struct BatchJob {
+	VERBOSITY v;
+	Statement* stmt;
+	Value* result;
+	bool ans;
+	char* line;
+	
+	/* Output is buffered so it can be written in input order */
+	char* out;
+	size_t outlen;
+	FILE* fout;
+	char* err;
+	size_t errlen;
+	FILE* ferr;
+} BatchJob;
+
+typedef struct Batch {
+	const SuperCalc* sc;
+	BatchJob* jobs;
+	unsigned count;
+} Batch;
+
+
+static char* cleanLine(const char* str);
+static const char* commandArg(const char* p, const char* keyword);
+static char* parsePath(const char* p);
+static const char* profileArg(const char* p);
+static bool profileAction(const char* arg, const char* action);
+static bool isCommand(const char* p);
+static VERBOSITY lineVerbosity(const SuperCalc* sc, const char** p);
+static bool runCommand(const SuperCalc* sc, const char* p);
+static bool replyCommand(const SuperCalc* sc, const char* p, VERBOSITY v);
+static Statement* parseLine(const SuperCalc* sc, const char* code, VERBOSITY v);
+static Value* evalCached(const SuperCalc* sc, Statement* stmt, VERBOSITY v);
+static Value* evalStatement(const SuperCalc* sc, Statement* stmt, const char* code, VERBOSITY v);
+static Value* runStatement(const SuperCalc* sc, Statement* stmt, const char* code, VERBOSITY v);
+static Value* runBatch(SuperCalc* sc, const char* prompt);
+static void runJob(unsigned index, void* data);
+static Value* flushBatch(SuperCalc* sc, Batch* batch, Value* ret);
 
 
 SuperCalc* SC_new(FILE* fout) {
 	SuperCalc* ret = fmalloc(sizeof(*ret));
 	
-	/* Create context */
+	/* Builtins live in a static table shared by every context */
 	ret->ctx = Context_new();
 	
-	/* Register modules */
-	register_math(ret->ctx);
-	register_vector(ret->ctx);
-	
+	ret->interactive = false;
+	ret->json = false;
+	ret->perf = false;
 	ret->fin = NULL;
 	ret->fout = fout;
+	ret->ferr = stderr;
+	ret->jobs = 1;
+	ret->pool = NULL;
+	ret->cache = ParseCache_new(PARSE_CACHE_SIZE);
+	ret->results = ResultCache_new(RESULT_CACHE_SIZE);
+	ret->profile = Profile_new();
 	return ret;
 }
 
 void SC_free(SuperCalc* sc) {
+	if(sc->pool) {
+		ThreadPool_free(sc->pool);
+	}
+	
+	ParseCache_free(sc->cache);
+	ResultCache_free(sc->results);
+	Profile_free(sc->profile);
 	Context_free(sc->ctx);
-	free(sc);
+	ffree(sc);
+}
+
+void SC_cleanup(void) {
+	Template_freeStatic();
+	Error_freePool();
+}
+
+void SC_setJobs(SuperCalc* sc, unsigned jobs) {
+	sc->jobs = MAX(jobs, 1);
+	
+	if(sc->pool && ThreadPool_size(sc->pool) != sc->jobs) {
+		ThreadPool_free(sc->pool);
+		sc->pool = NULL;
+	}
 }
 
 Value* SC_run(SuperCalc* sc, FILE* fin) {
@@ -61,28 +147,49 @@ Value* SC_runFile(SuperCalc* sc, FILE* fin, const char* prompt) {
 	const char* p;
 	sc->fin = fin;
 	
-	while((p = readLine(sc->fout, prompt, sc->fin))) {
+	FILE* ferr = Error_setStream(sc->ferr);
+	const char* crashLine = Error_setLine(sc->line);
+	bool json = Error_setJson(sc->json);
+	
+	/* Interactive sessions must respond to each line as it's entered */
+	if(sc->jobs > 1 && !sc->interactive) {
+		ret = runBatch(sc, prompt);
+		
+		Error_setJson(json);
+		Error_setLine(crashLine);
+		Error_setStream(ferr);
+		return ret;
+	}
+	
+	while((p = readLine(sc->line, sizeof(sc->line), sc->fout, prompt, sc->fin))) {
 		if(ret) {
 			Value_free(ret);
 			ret = NULL;
 		}
 		
-		VERBOSITY v = getVerbosity(&p);
+		VERBOSITY v = lineVerbosity(sc, &p);
 		if(v & V_ERR) {
 			continue;
 		}
 		
 		ret = SC_runString(sc, p, v);
-		if(ret && ret->type != VAL_VAR) {
+		if(ret && (ret->type != VAL_VAR || (v & V_JSON))) {
 			Value_print(ret, sc, v);
 		}
+		
+		if(ret && HAS_ANY(v, V_STATS | V_PERF)) {
+			Stats_print(sc, v);
+		}
 	}
 	
+	Error_setJson(json);
+	Error_setLine(crashLine);
+	Error_setStream(ferr);
 	return ret;
 }
 
-Value* SC_runString(const SuperCalc* sc, const char* str, VERBOSITY v) {
-	char* code = strdup(str);
+static char* cleanLine(const char* str) {
+	char* code = fstrdup(str);
 	
 	/* Strip trailing newline */
 	char* end;
@@ -90,50 +197,269 @@ Value* SC_runString(const SuperCalc* sc, const char* str, VERBOSITY v) {
 	if((end = strchr(code, '\r')) != NULL) *end = '\0';
 	if((end = strchr(code, '#')) != NULL) *end = '\0';
 	
-	const char* p = code;
+	return code;
+}
+
+/* Returns the start of the quoted argument if `p` is `keyword "..."`, or NULL */
+static const char* commandArg(const char* p, const char* keyword) {
+	size_t len = strlen(keyword);
+	if(strncmp(p, keyword, len) != 0) {
+		return NULL;
+	}
+	
+	p += len;
+	trimSpaces(&p);
+	
+	/* Otherwise it's a statement using a variable with the same name */
+	return *p == '"' ? p : NULL;
+}
+
+static char* parsePath(const char* p) {
+	const char* end = strchr(++p, '"');
+	if(end == NULL) {
+		RAISE(earlyEnd(), false);
+		return NULL;
+	}
+	
+	const char* rest = end + 1;
+	trimSpaces(&rest);
+	if(*rest != '\0') {
+		RAISE(badChar(*rest), false);
+		return NULL;
+	}
+	
+	if(end == p) {
+		RAISE(syntaxError("Expected a file name."), false);
+		return NULL;
+	}
+	
+	return strndup(p, end - p);
+}
+
+/* Returns the word after `profile` if `p` is `profile` followed by one word, or NULL */
+static const char* profileArg(const char* p) {
+	if(strncmp(p, "profile", 7) != 0 || !isspace((unsigned char)p[7])) {
+		return NULL;
+	}
+	
+	p += 7;
 	trimSpaces(&p);
 	
-	if(*p == '~') {
-		/* Variable deletion */
+	const char* word = p;
+	if(!isalpha((unsigned char)*p) && *p != '_') {
+		return NULL;
+	}
+	
+	while(isalnum((unsigned char)*p) || *p == '_') {
 		p++;
-		
-		char* name = nextToken(&p);
-		if(name == NULL) {
-			/* '~~~' means reset interpreter */
-			if(p[0] == '~' && p[1] == '~') {
-				/* Wipe out context */
-				Context_clear(sc->ctx);
-				free(code);
-				return NULL;
+	}
+	
+	trimSpaces(&p);
+	return *p == '\0' ? word : NULL;
+}
+
+/* Returns true if the word at `arg` is exactly `action` */
+static bool profileAction(const char* arg, const char* action) {
+	size_t len = strlen(action);
+	return strncmp(arg, action, len) == 0 && !isalnum((unsigned char)arg[len]) && arg[len] != '_';
+}
+
+static bool isCommand(const char* p) {
+	return *p == '~' || commandArg(p, "save") || commandArg(p, "load") || profileArg(p);
+}
+
+/* The line's own verbosity, plus what sc->json and sc->perf add to every line */
+static VERBOSITY lineVerbosity(const SuperCalc* sc, const char** p) {
+	VERBOSITY v = getVerbosity(p);
+	if(v & V_ERR) {
+		return v;
+	}
+	
+	if(sc->json) {
+		v |= V_JSON;
+	}
+	
+	if(sc->perf) {
+		v |= V_PERF;
+	}
+	
+	return v;
+}
+
+/* Returns true if `p` was a command rather than a statement */
+static bool runCommand(const SuperCalc* sc, const char* p) {
+	const char* arg;
+	char* path;
+	
+	if((arg = commandArg(p, "save")) != NULL) {
+		if((path = parsePath(arg)) != NULL) {
+			Image_save(sc->ctx, path);
+			ffree(path);
+		}
+		return true;
+	}
+	
+	if((arg = commandArg(p, "load")) != NULL) {
+		if((path = parsePath(arg)) != NULL) {
+			SC_loadImage(sc, path);
+			ffree(path);
+		}
+		return true;
+	}
+	
+	if((arg = profileArg(p)) != NULL) {
+		if(profileAction(arg, "on")) {
+			Profile_start(sc->profile);
+		}
+		else if(profileAction(arg, "off")) {
+			Profile_stop(sc->profile);
+		}
+		else if(profileAction(arg, "report") || profileAction(arg, "stacks")) {
+			StrBuf sb;
+			StrBuf_initFile(&sb, sc->fout);
+			if(profileAction(arg, "report")) {
+				Profile_report(sc->profile, &sb);
 			}
-			
-			if(*p == '\0') {
-				free(code);
-				RAISE(earlyEnd(), false);
-				return NULL;
+			else {
+				Profile_stacks(sc->profile, &sb);
 			}
-			
-			RAISE(badChar(*p), false);
-			free(code);
-			return NULL;
+		}
+		else {
+			RAISE(syntaxError("Usage: profile on|off|report|stacks"), false);
+		}
+		return true;
+	}
+	
+	if(*p != '~') {
+		return false;
+	}
+	
+	/* Variable deletion */
+	p++;
+	
+	char* name = nextToken(&p);
+	if(name == NULL) {
+		/* '~~~' means reset interpreter */
+		if(p[0] == '~' && p[1] == '~') {
+			/* Wipe out context, and the lines that were parsed for it */
+			Context_clear(sc->ctx);
+			ParseCache_clear(sc->cache);
+			ResultCache_clear(sc->results);
+			return true;
 		}
 		
-		Context_del(sc->ctx, name);
+		if(*p == '\0') {
+			RAISE(earlyEnd(), false);
+			return true;
+		}
 		
-		free(name);
-		free(code);
-		return NULL;
+		RAISE(badChar(*p), false);
+		return true;
 	}
 	
-	if(*p == '\0') {
-		free(code);
-		return NULL;
+	Context_del(sc->ctx, name);
+	
+	ffree(name);
+	return true;
+}
+
+/* Like runCommand, but with JSON output it also replies with one line, like statements do */
+static bool replyCommand(const SuperCalc* sc, const char* p, VERBOSITY v) {
+	if(!(v & V_JSON)) {
+		return runCommand(sc, p);
+	}
+	
+	if(!isCommand(p)) {
+		return false;
+	}
+	
+	Error* captured = NULL;
+	Error** prevCapture = Error_capture(&captured);
+	runCommand(sc, p);
+	Error_capture(prevCapture);
+	
+	if(captured != NULL) {
+		bool json = Error_setJson(true);
+		Error_raise(captured, false);
+		Error_setJson(json);
+		Error_free(captured);
+		return true;
+	}
+	
+	/* These print their own tables */
+	const char* arg = profileArg(p);
+	if(arg != NULL && (profileAction(arg, "report") || profileAction(arg, "stacks"))) {
+		return true;
+	}
+	
+	StrBuf sb;
+	StrBuf_initFile(&sb, sc->fout);
+	
+	const char* q = p + 1;
+	char* name = *p == '~' ? nextToken(&q) : NULL;
+	if(name != NULL) {
+		StrBuf_printf(&sb, "{\"deleted\":\"%s\"}\n", name);
+		ffree(name);
+	}
+	else {
+		StrBuf_append(&sb, "{\"ok\":true}\n");
+	}
+	
+	return true;
+}
+
+/* Parses the user's input, unless it was seen recently */
+static Statement* parseLine(const SuperCalc* sc, const char* code, VERBOSITY v) {
+	if(HAS_ANY(v, V_STATS | V_PERF)) {
+		Stats_beginParse(v);
+	}
+	
+	Statement* ret = ParseCache_parse(sc->cache, code);
+	
+	if(HAS_ANY(v, V_STATS | V_PERF)) {
+		Stats_endParse();
+	}
+	
+	return ret;
+}
+
+/* Like Statement_eval, but reuses the last result of an expression if nothing it reads changed */
+static Value* evalCached(const SuperCalc* sc, Statement* stmt, VERBOSITY v) {
+	Value* ret = ResultCache_lookup(sc->results, stmt, sc->ctx);
+	if(ret == NULL) {
+		bool ans;
+		ret = Statement_evalPure(stmt, sc->ctx, v, &ans);
+		if(!ans) {
+			return ret;
+		}
+		
+		ResultCache_store(sc->results, stmt, sc->ctx, ret);
 	}
 	
-	/* Parse the user's input */
-	Statement* stmt = Statement_parse(&p);
-	free(code);
+	Context_setGlobal(sc->ctx, "ans", VarValue(NULL, Value_copy(ret)));
+	return ret;
+}
+
+/* Evaluates `stmt` for this instance. `code` is the line's text, which names it in traces */
+static Value* evalStatement(const SuperCalc* sc, Statement* stmt, const char* code, VERBOSITY v) {
+	TRACE_BEGIN(TRACE_STATEMENT, code, 0);
+	Profile* prof = Profile_use(sc->profile);
 	
+	Value* ret;
+	if(ResultCache_accepts(stmt)) {
+		ret = evalCached(sc, stmt, v);
+	}
+	else {
+		ret = Statement_eval(stmt, sc->ctx, v);
+	}
+	
+	Profile_use(prof);
+	TRACE_END(TRACE_STATEMENT);
+	return ret;
+}
+
+/* Consumes `stmt` */
+static Value* runStatement(const SuperCalc* sc, Statement* stmt, const char* code, VERBOSITY v) {
 	/* Print statement depending with specified level of verbosity */
 	Statement_print(stmt, sc, v);
 	
@@ -143,10 +469,368 @@ Value* SC_runString(const SuperCalc* sc, const char* str, VERBOSITY v) {
 		return NULL;
 	}
 	
-	/* Evaluate statement */
-	Value* result = Statement_eval(stmt, sc->ctx, v);
+	StrBuf log;
+	StrBuf* prevLog = NULL;
+	if(v & V_UPDATES) {
+		StrBuf_init(&log);
+		prevLog = Reactive_setLog(&log);
+	}
+	
+	/* Evaluate statement, with errors raised along the way in the same format */
+	bool json = Error_setJson(Error_jsonMode() || HAS_ANY(v, V_JSON));
+	if(HAS_ANY(v, V_STATS | V_PERF)) {
+		Stats_beginEval(v);
+	}
+	
+	Value* result = evalStatement(sc, stmt, code, v);
+	
+	if(HAS_ANY(v, V_STATS | V_PERF)) {
+		Stats_endEval();
+	}
+	
+	Error_setJson(json);
 	Statement_free(stmt);
 	
+	if(v & V_UPDATES) {
+		Reactive_setLog(prevLog);
+		char* names = StrBuf_finish(&log);
+		Statement_printUpdates(names, sc, v);
+		ffree(names);
+	}
+	
 	return result;
 }
 
+Value* SC_runString(const SuperCalc* sc, const char* str, VERBOSITY v) {
+	Value* ret = NULL;
+	char* code = cleanLine(str);
+	
+	FILE* ferr = Error_setStream(sc->ferr);
+	const char* crashLine = Error_setLine(str);
+	
+	const char* p = code;
+	trimSpaces(&p);
+	
+	if(!replyCommand(sc, p, v) && *p != '\0') {
+		Statement* stmt = parseLine(sc, p, v);
+		ret = runStatement(sc, stmt, p, v);
+	}
+	
+	Error_setLine(crashLine);
+	Error_setStream(ferr);
+	
+	ffree(code);
+	return ret;
+}
+
+SC_STATUS SC_exec(SuperCalc* sc, const char* code, double* result, SCError* err) {
+	Value* ret = NULL;
+	char* line = cleanLine(code);
+	
+	/* Nothing gets printed, errors included */
+	Error* captured = NULL;
+	Error** prevCapture = Error_capture(&captured);
+	const char* crashLine = Error_setLine(code);
+	
+	const char* p = line;
+	trimSpaces(&p);
+	
+	if(!runCommand(sc, p) && *p != '\0') {
+		Statement* stmt = ParseCache_parse(sc->cache, p);
+		
+		if(Statement_didError(stmt)) {
+			ret = ValErr(Error_copy(stmt->var->err));
+		}
+		else {
+			ret = evalStatement(sc, stmt, p, 0);
+		}
+		
+		Statement_free(stmt);
+	}
+	
+	Error_setLine(crashLine);
+	Error_capture(prevCapture);
+	
+	SC_STATUS status = SC_OK;
+	if(ret) {
+		status = Value_export(ret, captured, result, err);
+		Value_free(ret);
+	}
+	else if(captured) {
+		/* Commands like ~name report errors by raising them */
+		status = Error_status(captured);
+		Error_export(captured, err);
+	}
+	
+	if(captured) {
+		Error_free(captured);
+	}
+	
+	ffree(line);
+	return status;
+}
+
+bool SC_loadImage(const SuperCalc* sc, const char* path) {
+	Image* img = Image_open(path);
+	if(img == NULL) {
+		return false;
+	}
+	
+	Context_attachImage(sc->ctx, img);
+	return true;
+}
+
+bool SC_compile(SuperCalc* sc, const char* src, const char* dst) {
+	FILE* fp = fopen(src, "r");
+	if(fp == NULL) {
+		RAISE(nameError("Unable to open '%s': %s.", src, strerror(errno)), false);
+		return false;
+	}
+	
+	unsigned lineno = 0;
+	unsigned failed = 0;
+	
+	while(fgets(sc->line, sizeof(sc->line), fp) != NULL) {
+		lineno++;
+		
+		/* Results aren't printed, so only errors matter */
+		Error* captured = NULL;
+		Error** prevCapture = Error_capture(&captured);
+		
+		const char* p = sc->line;
+		Value* ret = NULL;
+		if(!(getVerbosity(&p) & V_ERR)) {
+			ret = SC_runString(sc, p, 0);
+		}
+		
+		Error_capture(prevCapture);
+		
+		if(ret != NULL) {
+			if(ret->type == VAL_ERR && captured == NULL) {
+				captured = Error_copy(ret->err);
+			}
+			Value_free(ret);
+		}
+		
+		if(captured != NULL) {
+			FILE* ferr = Error_setStream(sc->ferr);
+			fprintf(sc->ferr, "%s:%u: ", src, lineno);
+			Error_raise(captured, false);
+			Error_setStream(ferr);
+			
+			Error_free(captured);
+			failed++;
+		}
+	}
+	
+	fclose(fp);
+	
+	if(failed > 0) {
+		return false;
+	}
+	
+	FILE* ferr = Error_setStream(sc->ferr);
+	bool ok = Image_save(sc->ctx, dst);
+	Error_setStream(ferr);
+	return ok;
+}
+
+Prepared* SC_prepare(const SuperCalc* sc, const char* expr,
+                     const char* const* params, unsigned count, SCError* err) {
+	Error* bad;
+	Prepared* ret = Prepared_new(sc->ctx, expr, params, count, &bad);
+	
+	if(ret == NULL) {
+		Error_export(bad, err);
+		Error_free(bad);
+	}
+	
+	return ret;
+}
+
+Prepared* SC_prepareFunc(const SuperCalc* sc, const char* name, SCError* err) {
+	Error* bad;
+	Prepared* ret = Prepared_fromFunc(sc->ctx, name, &bad);
+	
+	if(ret == NULL) {
+		Error_export(bad, err);
+		Error_free(bad);
+	}
+	
+	return ret;
+}
+
+static Value* runBatch(SuperCalc* sc, const char* prompt) {
+	Value* ret = NULL;
+	const char* p;
+	
+	if(sc->pool == NULL) {
+		sc->pool = ThreadPool_new(sc->jobs);
+	}
+	
+	Batch batch = {sc, fmalloc(BATCH_MAX * sizeof(*batch.jobs)), 0};
+	
+	while((p = readLine(sc->line, sizeof(sc->line), sc->fout, prompt, sc->fin))) {
+		BatchJob* job = &batch.jobs[batch.count];
+		memset(job, 0, sizeof(*job));
+		job->fout = open_memstream(&job->out, &job->outlen);
+		job->ferr = open_memstream(&job->err, &job->errlen);
+		
+		/* Errors while parsing belong to this line's output */
+		FILE* ferr = Error_setStream(job->ferr);
+		
+		job->v = lineVerbosity(sc, &p);
+		if(!(job->v & V_ERR)) {
+			char* code = cleanLine(p);
+			const char* q = code;
+			trimSpaces(&q);
+			
+			if(isCommand(q)) {
+				/* Commands are barriers, so finish everything before them */
+				Error_setStream(ferr);
+				ret = flushBatch(sc, &batch, ret);
+				
+				replyCommand(sc, q, job->v);
+				ffree(code);
+				
+				fclose(job->fout);
+				fclose(job->ferr);
+				ffree(job->out);
+				ffree(job->err);
+				continue;
+			}
+			
+			if(*q != '\0') {
+				job->stmt = parseLine(sc, q, job->v);
+			}
+			
+			/* Kept around in case evaluating this line crashes */
+			job->line = code;
+		}
+		
+		Error_setStream(ferr);
+		
+		/* Lines that list what they recompute or measure themselves have to be evaluated in order */
+		if(job->stmt == NULL || (!HAS_ANY(job->v, V_UPDATES | V_STATS | V_PERF) && Statement_isPure(job->stmt, sc->ctx))) {
+			/* Hold onto it until a barrier or the batch is full */
+			if(++batch.count == BATCH_MAX) {
+				ret = flushBatch(sc, &batch, ret);
+			}
+			continue;
+		}
+		
+		/* Statements that modify the context run alone, after everything before them */
+		Statement* stmt = job->stmt;
+		char* code = job->line;
+		job->stmt = NULL;
+		job->line = NULL;
+		batch.count++;
+		ret = flushBatch(sc, &batch, ret);
+		
+		Value* result = runStatement(sc, stmt, code, job->v);
+		ffree(code);
+		if(result) {
+			if(ret) {
+				Value_free(ret);
+			}
+			
+			ret = result;
+			if(ret->type != VAL_VAR || (job->v & V_JSON)) {
+				Value_print(ret, sc, job->v);
+			}
+			
+			if(HAS_ANY(job->v, V_STATS | V_PERF)) {
+				Stats_print(sc, job->v);
+			}
+		}
+	}
+	
+	ret = flushBatch(sc, &batch, ret);
+	ffree(batch.jobs);
+	return ret;
+}
+
+static void runJob(unsigned index, void* data) {
+	Batch* batch = data;
+	BatchJob* job = &batch->jobs[index];
+	
+	if(job->stmt == NULL) {
+		return;
+	}
+	
+	/* Same as runStatement but writing into this job's buffers */
+	SuperCalc local = *batch->sc;
+	local.fout = job->fout;
+	FILE* ferr = Error_setStream(job->ferr);
+	const char* crashLine = Error_setLine(job->line);
+	bool json = Error_setJson(HAS_ANY(job->v, V_JSON));
+	
+	Statement_print(job->stmt, &local, job->v);
+	
+	if(!Statement_didError(job->stmt)) {
+		TRACE_BEGIN(TRACE_STATEMENT, job->line, 0);
+		Profile* prof = Profile_use(local.profile);
+		job->result = Statement_evalPure(job->stmt, local.ctx, job->v, &job->ans);
+		Profile_use(prof);
+		TRACE_END(TRACE_STATEMENT);
+		if(job->result->type != VAL_VAR || (job->v & V_JSON)) {
+			Value_print(job->result, &local, job->v);
+		}
+	}
+	
+	Error_setJson(json);
+	Error_setLine(crashLine);
+	Error_setStream(ferr);
+}
+
+/* Evaluates all held jobs and returns the most recent result */
+static Value* flushBatch(SuperCalc* sc, Batch* batch, Value* ret) {
+	/* The context is only read from until every job is done */
+	ThreadPool_run(sc->pool, batch->count, &runJob, batch);
+	
+	FILE* ferr = Error_stream();
+	
+	unsigned i;
+	unsigned ans = batch->count;
+	for(i = 0; i < batch->count; i++) {
+		BatchJob* job = &batch->jobs[i];
+		
+		fclose(job->fout);
+		fclose(job->ferr);
+		fwrite(job->out, 1, job->outlen, sc->fout);
+		fwrite(job->err, 1, job->errlen, ferr);
+		ffree(job->out);
+		ffree(job->err);
+		ffree(job->line);
+		
+		if(job->stmt) {
+			Statement_free(job->stmt);
+		}
+		
+		if(job->ans) {
+			ans = i;
+		}
+	}
+	
+	/* None of the jobs read ans, so it only needs to be updated once */
+	if(ans < batch->count) {
+		Context_setGlobal(sc->ctx, "ans", VarValue(NULL, Value_copy(batch->jobs[ans].result)));
+	}
+	
+	for(i = 0; i < batch->count; i++) {
+		BatchJob* job = &batch->jobs[i];
+		if(job->result == NULL) {
+			continue;
+		}
+		
+		if(ret) {
+			Value_free(ret);
+		}
+		
+		ret = job->result;
+	}
+	
+	batch->count = 0;
+	return ret;
+}
+
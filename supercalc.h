@@ -12,22 +12,75 @@
 #include <stdio.h>
 #include <stdbool.h>
 
-typedef struct SuperCalc SuperCalc;
+/* Declares SuperCalc along with the rest of the public interface */
+#include "libsupercalc.h"
 #include "value.h"
 #include "context.h"
 #include "generic.h"
+#include "threadpool.h"
+#include "parsecache.h"
+#include "resultcache.h"
+#include "profile.h"
 
 struct SuperCalc {
 	Context* ctx;
 	bool interactive;
+	bool json;
+	bool perf;
 	FILE* fin;
 	FILE* fout;
+	FILE* ferr;
+	unsigned jobs;
+	ThreadPool* pool;
+	ParseCache* cache;
+	ResultCache* results;
+	Profile* profile;
+	char line[LINE_MAX_LEN];
 };
 
+/*
+ Each instance owns all of the state it evaluates with, so separate instances
+ may run on separate threads at the same time. Errors go to `ferr`, which
+ starts out as stderr. Setting `json` prints every line as if it began with
+ `?j`, and errors as JSON too. Setting `perf` adds `?h` to every line the
+ same way. Parsed lines are kept in `cache`, whose size
+ can be changed with ParseCache_setCapacity, and the results of expressions
+ whose inputs haven't changed are kept in `results`. The `profile` command
+ counts calls made by this instance's statements in `profile`.
+*/
 SuperCalc* SC_new(FILE* fout);
 void SC_free(SuperCalc* sc);
+
+/*
+ Frees what every instance shares and keeps for reuse, like the templates
+ behind some builtins and this thread's spare errors. Only call this once
+ nothing is being evaluated anymore, such as right before exiting.
+*/
+void SC_cleanup(void);
+
+/* SC_exec, SC_prepare and SC_prepareFunc are declared in libsupercalc.h */
+
+/*
+ With more than one job, non-interactive input evaluates runs of statements
+ that don't modify the context in parallel. Output is still in input order.
+*/
+void SC_setJobs(SuperCalc* sc, unsigned jobs);
+
 Value* SC_run(SuperCalc* sc, FILE* fp);
 Value* SC_runFile(SuperCalc* sc, FILE* fp, const char* prompt);
 Value* SC_runString(const SuperCalc* sc, const char* str, VERBOSITY v);
 
+/*
+ Makes the definitions saved in an image visible, as with `load "path"`.
+ Raises an error and returns false if the image can't be used.
+*/
+bool SC_loadImage(const SuperCalc* sc, const char* path);
+
+/*
+ Runs the script at `src` without printing anything, then saves what it defined
+ to an image at `dst`, as with `save "dst"`. Every line that fails is reported
+ as "src:line: error", and the image is only written if none did.
+*/
+bool SC_compile(SuperCalc* sc, const char* src, const char* dst);
+
 #endif
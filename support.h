@@ -14,9 +14,11 @@
 #ifdef _MSC_VER
 # define NORETURN __declspec("noreturn")
 # define UNREACHABLE() __assume(false)
+# define THREAD_LOCAL __declspec(thread)
 #else
 # define NORETURN __attribute__((__noreturn__))
 # define UNREACHABLE() __builtin_unreachable()
+# define THREAD_LOCAL __thread
 #endif
 
 #ifdef _MSC_VER
@@ -6,6 +6,8 @@
   Copyright (c) 2015 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_PARSER
+
 #include "template.h"
 #include <ctype.h>
 #include <stdlib.h>
@@ -16,17 +18,26 @@
 #include "generic.h"
 #include "error.h"
 #include "placeholder.h"
+#include "stats.h"
+#include "trace.h"
 
 struct Template {
 	Value* tree;
 	unsigned num_placeholders;
 	unsigned capacity;
 	Value** placeholders;
+	
+	/* Templates made for TP_FILL and TP_EVAL are listed along with where they're cached */
+	Template* nextStatic;
+	Template** slot;
 };
 
+/* Every template made by staticTemplate, so they can be freed at exit */
+static Template* static_templates = NULL;
+
 /*
  Example: "@1i*4 + @1i - @2f"
- 
+
        Value* tree;
              -          unsigned num_placeholders = 2;
            /   \        unsigned capacity = 4;
@@ -46,6 +57,16 @@ struct Template {
  +------------+-------------+
 */
 
+
+static Value* parse_internalName(const char** expr);
+static Value* parse_extra(const char** expr, void* data);
+static Value* next_value(PLACETYPE type, va_list args);
+static ArgList* fillArgs(const Template* tp, const ArgList* arglist, Value** args);
+static Value* fillTree(const Template* tp, const Value* val, Value** args);
+static void dropPlaceholders(Value** slot);
+static Template* staticTemplate(Template** ptp, const char* fmt);
+
+
 static Value* parse_internalName(const char** expr) {
 	if(**expr != '@') {
 		RAISE(badChar(**expr), true);
@@ -63,11 +84,11 @@ static Value* parse_internalName(const char** expr) {
 	char* token = nextToken(expr);
 	char* varname;
 	asprintf(&varname, "@%s", token);
-	free(token);
+	ffree(token);
 	
 	/* Wrap in Value object */
 	Value* ret = ValVar(varname);
-	free(varname);
+	ffree(varname);
 	return ret;
 }
 
@@ -140,11 +161,32 @@ Template* Template_create(const char* fmt) {
 }
 
 void Template_free(Template* tp) {
+	dropPlaceholders(&tp->tree);
 	Value_free(tp->tree);
 	
-	/* Call release on these */
-	free(tp->placeholders);
-	free(tp);
+	unsigned i;
+	for(i = 0; i < tp->num_placeholders; i++) {
+		if(tp->placeholders[i] != NULL) {
+			Placeholder_free(tp->placeholders[i]->ph);
+			Value_free(tp->placeholders[i]);
+		}
+	}
+	
+	ffree(tp->placeholders);
+	ffree(tp);
+}
+
+void Template_freeStatic(void) {
+	Template* tp = __atomic_exchange_n(&static_templates, NULL, __ATOMIC_ACQ_REL);
+	while(tp != NULL) {
+		Template* next = tp->nextStatic;
+		
+		/* The next use makes it again */
+		__atomic_store_n(tp->slot, NULL, __ATOMIC_RELEASE);
+		Template_free(tp);
+		
+		tp = next;
+	}
 }
 
 Value* Template_fill(const Template* tp, ...) {
@@ -165,22 +207,109 @@ static Value* next_value(PLACETYPE type, va_list args) {
 		case PH_EXPR:  return ValExpr(va_arg(args, BinOp*));
 		case PH_UNARY: return ValUnary(va_arg(args, UnOp*));
 		case PH_CALL:  return ValCall(va_arg(args, FuncCall*));
-		case PH_VAR:   return ValVar(strdup(va_arg(args, const char*)));
+		case PH_VAR:   return ValVar(va_arg(args, const char*));
 		case PH_VEC:   return ValVec(va_arg(args, Vector*));
 		case PH_VAL:   return va_arg(args, Value*);
-			
+		
 		default:
 			return ValErr(typeError("Unexpected placeholder type", type));
 	}
 }
 
+static ArgList* fillArgs(const Template* tp, const ArgList* arglist, Value** args) {
+	ArgList* ret = ArgList_new(arglist->count);
+	
+	unsigned i;
+	for(i = 0; i < arglist->count; i++) {
+		ret->args[i] = fillTree(tp, arglist->args[i], args);
+	}
+	
+	return ret;
+}
+
+/*
+ Copies the template's tree, substituting a copy of the matching argument for
+ each placeholder. The shared tree is never modified, so any number of threads
+ may fill the same template at once.
+*/
+static Value* fillTree(const Template* tp, const Value* val, Value** args) {
+	switch(val->type) {
+		case VAL_PLACE: {
+			unsigned i;
+			for(i = 0; i < tp->num_placeholders; i++) {
+				if(tp->placeholders[i] == val) {
+					return Value_copy(args[i]);
+				}
+			}
+			
+			badValType(val->type);
+		}
+		
+		case VAL_EXPR:
+			return ValExpr(BinOp_new(val->expr->type,
+			                         fillTree(tp, val->expr->a, args),
+			                         fillTree(tp, val->expr->b, args)));
+		
+		case VAL_UNARY:
+			return ValUnary(UnOp_new(val->term->type,
+			                         fillTree(tp, val->term->a, args)));
+		
+		case VAL_CALL:
+			return ValCall(FuncCall_new(fillTree(tp, val->call->func, args),
+			                            fillArgs(tp, val->call->arglist, args)));
+		
+		case VAL_VEC:
+			return ValVec(Vector_new(fillArgs(tp, val->vec->vals, args)));
+		
+		default:
+			return Value_copy(val);
+	}
+}
+
+/* Placeholders can appear more than once, so they're cut out of the tree and freed separately */
+static void dropPlaceholders(Value** slot) {
+	Value* val = *slot;
+	unsigned i;
+	
+	switch(val->type) {
+		case VAL_PLACE:
+			*slot = NULL;
+			break;
+		
+		case VAL_EXPR:
+			dropPlaceholders(&val->expr->a);
+			dropPlaceholders(&val->expr->b);
+			break;
+		
+		case VAL_UNARY:
+			dropPlaceholders(&val->term->a);
+			break;
+		
+		case VAL_CALL:
+			dropPlaceholders(&val->call->func);
+			for(i = 0; i < val->call->arglist->count; i++) {
+				dropPlaceholders(&val->call->arglist->args[i]);
+			}
+			break;
+		
+		case VAL_VEC:
+			for(i = 0; i < val->vec->vals->count; i++) {
+				dropPlaceholders(&val->vec->vals->args[i]);
+			}
+			break;
+		
+		default:
+			break;
+	}
+}
+
 Value* Template_fillv(const Template* tp, va_list args) {
-	Value* ret = NULL;
+	STAT_INC(templates);
 	
-	/* Backup placeholder array */
-	Placeholder** orig = fmalloc(tp->num_placeholders * sizeof(*orig));
+	Value* ret = NULL;
+	Value** vals = fcalloc(tp->num_placeholders, sizeof(*vals));
 	
-	/* Fill in placeholders */
+	/* Collect arguments */
 	unsigned i;
 	for(i = 0; i < tp->num_placeholders; i++) {
 		Value* cur = tp->placeholders[i];
@@ -193,29 +322,43 @@ Value* Template_fillv(const Template* tp, va_list args) {
 			badValType(cur->type);
 		}
 		
-		/* Replace the placeholder with the value of the argument */
-		orig[i] = cur->ph;
-		Value* arg = next_value(cur->ph->type, args);
-		memcpy(cur, arg, sizeof(*cur));
-		free(arg);
+		vals[i] = next_value(cur->ph->type, args);
 	}
 	
 	/* Only copy tree when there's no error */
 	if(ret == NULL) {
-		ret = Value_copy(tp->tree);
+		ret = fillTree(tp, tp->tree, vals);
 	}
 	
-	/* Undo placeholder replacement */
 	for(i = 0; i < tp->num_placeholders; i++) {
-		Value* cur = tp->placeholders[i];
-		if(cur->type != VAL_PLACE) {
-			/* Hack. Allocate a new value just to delete its contents */
-			Value* onDeathRow = fmalloc(sizeof(*onDeathRow));
-			memcpy(onDeathRow, cur, sizeof(*onDeathRow));
-			Value_free(onDeathRow);
+		if(vals[i] != NULL) {
+			Value_free(vals[i]);
+		}
+	}
+	
+	ffree(vals);
+	return ret;
+}
+
+/*
+ The first thread to use a static template publishes it. Anyone who loses the
+ race to create it throws theirs away and uses the winner's.
+*/
+static Template* staticTemplate(Template** ptp, const char* fmt) {
+	Template* ret = __atomic_load_n(ptp, __ATOMIC_ACQUIRE);
+	if(ret == NULL) {
+		Template* created = Template_create(fmt);
+		if(__atomic_compare_exchange_n(ptp, &ret, created, false,
+		                               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			ret = created;
 			
-			cur->type = VAL_PLACE;
-			cur->ph = orig[i];
+			created->slot = ptp;
+			created->nextStatic = __atomic_load_n(&static_templates, __ATOMIC_RELAXED);
+			while(!__atomic_compare_exchange_n(&static_templates, &created->nextStatic, created, true,
+			                                   __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		}
+		else {
+			Template_free(created);
 		}
 	}
 	
@@ -223,14 +366,12 @@ Value* Template_fillv(const Template* tp, va_list args) {
 }
 
 Value* Template_staticFill(Template** ptp, const char* fmt, ...) {
-	if(*ptp == NULL) {
-		*ptp = Template_create(fmt);
-	}
+	Template* tp = staticTemplate(ptp, fmt);
 	
 	va_list args;
 	va_start(args, fmt);
 	
-	Value* ret = Template_fillv(*ptp, args);
+	Value* ret = Template_fillv(tp, args);
 	
 	va_end(args);
 	return ret;
@@ -247,21 +388,23 @@ Value* Template_eval(const Template* tp, const Context* ctx, ...) {
 }
 
 Value* Template_evalv(const Template* tp, const Context* ctx, va_list args) {
+	TRACE_BEGIN(TRACE_TEMPLATE, "template", tp->num_placeholders);
+	
 	Value* filled = Template_fillv(tp, args);
 	Value* ret = Value_eval(filled, ctx);
 	Value_free(filled);
+	
+	TRACE_END(TRACE_TEMPLATE);
 	return ret;
 }
 
 Value* Template_staticEval(Template** ptp, const Context* ctx, const char* fmt, ...) {
-	if(*ptp == NULL) {
-		*ptp = Template_create(fmt);
-	}
+	Template* tp = staticTemplate(ptp, fmt);
 	
 	va_list args;
 	va_start(args, fmt);
 	
-	Value* ret = Template_evalv(*ptp, ctx, args);
+	Value* ret = Template_evalv(tp, ctx, args);
 	
 	va_end(args);
 	return ret;
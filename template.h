@@ -30,6 +30,9 @@ Template* Template_create(const char* fmt);
 /* Destructor */
 void Template_free(Template* tp);
 
+/* Frees the templates cached by TP_FILL and TP_EVAL. Nothing may be using them */
+void Template_freeStatic(void);
+
 /* Fill in placeholders but do not evaluate result */
 Value* Template_fill(const Template* tp, ...);
 Value* Template_fillv(const Template* tp, va_list args);
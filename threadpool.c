@@ -0,0 +1,211 @@
+/*
+  threadpool.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "threadpool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "generic.h"
+#include "error.h"
+
+
+typedef struct QueuedTask {
+	pool_task_t task;
+	void* data;
+	struct QueuedTask* next;
+} QueuedTask;
+
+struct ThreadPool {
+	unsigned nthreads;
+	pthread_t* workers;
+	
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	
+	/* Bumped for every call to ThreadPool_run so sleeping workers notice new work */
+	unsigned long generation;
+	bool shutdown;
+	
+	/* Current batch of work */
+	pool_task_t task;
+	void* data;
+	unsigned count;
+	unsigned next;
+	unsigned busy;
+	
+	/* Tasks from ThreadPool_submit */
+	QueuedTask* head;
+	QueuedTask* tail;
+};
+
+
+static void drain(ThreadPool* pool);
+static void* workerMain(void* arg);
+
+
+static void drain(ThreadPool* pool) {
+	while(1) {
+		unsigned index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+		if(index >= pool->count) {
+			break;
+		}
+		
+		pool->task(index, pool->data);
+	}
+}
+
+static void* workerMain(void* arg) {
+	ThreadPool* pool = arg;
+	unsigned long seen = 0;
+	
+	pthread_mutex_lock(&pool->lock);
+	while(1) {
+		while(pool->generation == seen && pool->head == NULL && !pool->shutdown) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+		
+		if(pool->shutdown) {
+			break;
+		}
+		
+		if(pool->generation == seen) {
+			/* No new batch, so there must be a queued task */
+			QueuedTask* cur = pool->head;
+			pool->head = cur->next;
+			if(pool->head == NULL) {
+				pool->tail = NULL;
+			}
+			pthread_mutex_unlock(&pool->lock);
+			
+			cur->task(0, cur->data);
+			ffree(cur);
+			
+			pthread_mutex_lock(&pool->lock);
+			continue;
+		}
+		
+		seen = pool->generation;
+		pool->busy++;
+		pthread_mutex_unlock(&pool->lock);
+		
+		drain(pool);
+		
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->busy == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	
+	return NULL;
+}
+
+ThreadPool* ThreadPool_new(unsigned nthreads) {
+	ThreadPool* ret = fcalloc(1, sizeof(*ret));
+	
+	ret->nthreads = MAX(nthreads, 1);
+	pthread_mutex_init(&ret->lock, NULL);
+	pthread_cond_init(&ret->wake, NULL);
+	pthread_cond_init(&ret->done, NULL);
+	
+	/* The thread calling ThreadPool_run counts as one of the workers */
+	ret->workers = fcalloc(ret->nthreads, sizeof(*ret->workers));
+	
+	unsigned i;
+	for(i = 1; i < ret->nthreads; i++) {
+		if(pthread_create(&ret->workers[i], NULL, &workerMain, ret) != 0) {
+			DIE("Unable to create worker thread.");
+		}
+	}
+	
+	return ret;
+}
+
+void ThreadPool_free(ThreadPool* pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	
+	unsigned i;
+	for(i = 1; i < pool->nthreads; i++) {
+		pthread_join(pool->workers[i], NULL);
+	}
+	
+	while(pool->head) {
+		QueuedTask* next = pool->head->next;
+		ffree(pool->head);
+		pool->head = next;
+	}
+	
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	ffree(pool->workers);
+	ffree(pool);
+}
+
+unsigned ThreadPool_size(const ThreadPool* pool) {
+	return pool->nthreads;
+}
+
+void ThreadPool_run(ThreadPool* pool, unsigned count, pool_task_t task, void* data) {
+	if(count == 0) {
+		return;
+	}
+	
+	pthread_mutex_lock(&pool->lock);
+	
+	/* A worker that woke up late for the previous batch may still be looking at it */
+	while(pool->busy > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	
+	pool->task = task;
+	pool->data = data;
+	pool->count = count;
+	pool->next = 0;
+	pool->generation++;
+	
+	/* Don't bother waking up threads that would have nothing to do */
+	if(count > 1) {
+		pthread_cond_broadcast(&pool->wake);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	
+	drain(pool);
+	
+	/* Wait for workers that are still finishing their last task */
+	pthread_mutex_lock(&pool->lock);
+	while(pool->busy > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void ThreadPool_submit(ThreadPool* pool, pool_task_t task, void* data) {
+	QueuedTask* item = fmalloc(sizeof(*item));
+	item->task = task;
+	item->data = data;
+	item->next = NULL;
+	
+	pthread_mutex_lock(&pool->lock);
+	
+	if(pool->tail) {
+		pool->tail->next = item;
+	}
+	else {
+		pool->head = item;
+	}
+	pool->tail = item;
+	
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,42 @@
+/*
+  threadpool.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_THREADPOOL_H_
+#define _SC_THREADPOOL_H_
+
+typedef struct ThreadPool ThreadPool;
+
+/* Called once for each index in [0, count) */
+typedef void (*pool_task_t)(unsigned index, void* data);
+
+
+/* Constructor */
+/* The calling thread also does work in ThreadPool_run, so `nthreads` - 1 workers are spawned */
+ThreadPool* ThreadPool_new(unsigned nthreads);
+
+/* Destructor */
+void ThreadPool_free(ThreadPool* pool);
+
+/* Number of threads that share the work, including the caller */
+unsigned ThreadPool_size(const ThreadPool* pool);
+
+/*
+ Runs `task` for every index in [0, count) and waits for all of them to finish.
+ Idle threads claim the next unstarted index, so uneven tasks still balance out.
+*/
+void ThreadPool_run(ThreadPool* pool, unsigned count, pool_task_t task, void* data);
+
+/*
+ Queues `task` to be called once with an index of 0 and returns right away.
+ Queued tasks are started in the order they were submitted, but only by the
+ spawned workers, so the pool needs at least 2 threads. Tasks that haven't
+ started yet are dropped by ThreadPool_free.
+*/
+void ThreadPool_submit(ThreadPool* pool, pool_task_t task, void* data);
+
+#endif /* _SC_THREADPOOL_H_ */
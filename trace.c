@@ -0,0 +1,311 @@
+/*
+  trace.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "support.h"
+#include "generic.h"
+#include "error.h"
+#include "strbuf.h"
+
+/* Events each thread can have waiting to be written. Must be a power of two */
+#define RING_EVENTS 8192
+
+/* Longest name kept in an event, counting the terminator */
+#define NAME_LEN 48
+
+/* How often the rings are emptied when nothing asks sooner */
+#define FLUSH_MS 10
+
+typedef struct TraceEvent {
+	/* Nanoseconds since the trace started */
+	uint64_t ts;
+	unsigned args;
+	unsigned char kind;
+	char phase;
+	char name[NAME_LEN];
+} TraceEvent;
+
+/*
+ Only the thread that owns a ring moves `head`, and only the flusher moves
+ `tail`, so neither side needs a lock
+*/
+typedef struct TraceRing {
+	TraceEvent events[RING_EVENTS];
+	unsigned long head;
+	unsigned long tail;
+	unsigned tid;
+	struct TraceRing* next;
+} TraceRing;
+
+bool trace_enabled = false;
+
+static FILE* trace_file = NULL;
+static StrBuf trace_out;
+static bool trace_wrote = false;
+static uint64_t trace_start = 0;
+static int trace_pid = 0;
+
+/* Bumped by every Trace_start, so rings from an earlier trace aren't reused */
+static unsigned trace_generation = 0;
+static unsigned trace_tids = 0;
+
+/* Every thread's ring, pushed without locking */
+static TraceRing* trace_rings = NULL;
+
+static pthread_t flusher;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_wake = PTHREAD_COND_INITIALIZER;
+static bool flush_stop = false;
+
+static THREAD_LOCAL TraceRing* own_ring = NULL;
+static THREAD_LOCAL unsigned own_generation = 0;
+
+static const char* const kind_names[TRACE_KIND_COUNT] = {
+	"statement",
+	"function",
+	"builtin",
+	"template"
+};
+
+
+static uint64_t nowNanos(void);
+static TraceRing* ownRing(void);
+static void record(TRACEKIND kind, char phase, const char* name, unsigned args);
+static char* putText(char* p, const char* text);
+static char* putNumber(char* p, uint64_t n);
+static void writeEvent(const TraceRing* ring, const TraceEvent* ev);
+static void drainRings(void);
+static void* flusherMain(void* arg);
+
+
+static uint64_t nowNanos(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static TraceRing* ownRing(void) {
+	if(own_ring != NULL && own_generation == trace_generation) {
+		return own_ring;
+	}
+	
+	TraceRing* ring = fcalloc(1, sizeof(*ring));
+	ring->tid = __atomic_add_fetch(&trace_tids, 1, __ATOMIC_RELAXED);
+	
+	ring->next = __atomic_load_n(&trace_rings, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&trace_rings, &ring->next, ring, true,
+	                                   __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	
+	own_ring = ring;
+	own_generation = trace_generation;
+	return ring;
+}
+
+static void record(TRACEKIND kind, char phase, const char* name, unsigned args) {
+	TraceRing* ring = ownRing();
+	unsigned long head = ring->head;
+	
+	/* Waiting on the flusher is better than a trace with events missing */
+	while(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= RING_EVENTS) {
+		pthread_cond_signal(&flush_wake);
+		sched_yield();
+	}
+	
+	TraceEvent* ev = &ring->events[head & (RING_EVENTS - 1)];
+	ev->ts = nowNanos() - trace_start;
+	ev->args = args;
+	ev->kind = kind;
+	ev->phase = phase;
+	
+	if(name != NULL) {
+		size_t len = strnlen(name, NAME_LEN - 1);
+		
+		/* Don't cut a UTF-8 sequence in half, backing up to its lead byte */
+		if(len == NAME_LEN - 1) {
+			while(len > 0 && (name[len] & 0xc0) == 0x80) {
+				len--;
+			}
+		}
+		
+		memcpy(ev->name, name, len);
+		ev->name[len] = '\0';
+	}
+	
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static char* putText(char* p, const char* text) {
+	size_t len = strlen(text);
+	memcpy(p, text, len);
+	return p + len;
+}
+
+static char* putNumber(char* p, uint64_t n) {
+	char digits[20];
+	unsigned count = 0;
+	do {
+		digits[count++] = '0' + n % 10;
+		n /= 10;
+	} while(n > 0);
+	
+	while(count > 0) {
+		*p++ = digits[--count];
+	}
+	
+	return p;
+}
+
+/* Formatted by hand, since this is most of the flusher's work and printf is slow */
+static void writeEvent(const TraceRing* ring, const TraceEvent* ev) {
+	StrBuf_append(&trace_out, trace_wrote ? ",\n{" : "\n{");
+	trace_wrote = true;
+	
+	/* Ends are matched to begins by nesting, so they need no name */
+	if(ev->phase == 'B') {
+		StrBuf_append(&trace_out, "\"name\":");
+		StrBuf_jsonString(&trace_out, ev->name);
+		StrBuf_putc(&trace_out, ',');
+	}
+	
+	/* Timestamps are in microseconds */
+	char buf[160];
+	char* p = putText(buf, "\"cat\":\"");
+	p = putText(p, kind_names[ev->kind]);
+	p = putText(p, "\",\"ph\":\"");
+	*p++ = ev->phase;
+	p = putText(p, "\",\"ts\":");
+	p = putNumber(p, ev->ts / 1000);
+	*p++ = '.';
+	*p++ = '0' + ev->ts / 100 % 10;
+	*p++ = '0' + ev->ts / 10 % 10;
+	*p++ = '0' + ev->ts % 10;
+	p = putText(p, ",\"pid\":");
+	p = putNumber(p, trace_pid);
+	p = putText(p, ",\"tid\":");
+	p = putNumber(p, ring->tid);
+	
+	if(ev->phase == 'B') {
+		p = putText(p, ",\"args\":{\"args\":");
+		p = putNumber(p, ev->args);
+		*p++ = '}';
+	}
+	
+	*p++ = '}';
+	StrBuf_appendn(&trace_out, buf, p - buf);
+}
+
+/* Only ever called by one thread at a time */
+static void drainRings(void) {
+	TraceRing* ring;
+	for(ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+		unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		unsigned long tail = ring->tail;
+		
+		for(; tail != head; tail++) {
+			writeEvent(ring, &ring->events[tail & (RING_EVENTS - 1)]);
+		}
+		
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+static void* flusherMain(void* arg) {
+	(void)arg;
+	
+	while(1) {
+		pthread_mutex_lock(&flush_lock);
+		if(!flush_stop) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += FLUSH_MS * 1000000L;
+			if(deadline.tv_nsec >= 1000000000L) {
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000L;
+			}
+			
+			pthread_cond_timedwait(&flush_wake, &flush_lock, &deadline);
+		}
+		
+		bool stop = flush_stop;
+		pthread_mutex_unlock(&flush_lock);
+		
+		/* Whatever was recorded before stopping still gets written */
+		drainRings();
+		fflush(trace_file);
+		if(stop) {
+			break;
+		}
+	}
+	
+	return NULL;
+}
+
+
+bool Trace_start(const char* path) {
+	FILE* fp = fopen(path, "w");
+	if(fp == NULL) {
+		RAISE(nameError("Unable to write '%s': %s.", path, strerror(errno)), false);
+		return false;
+	}
+	
+	trace_file = fp;
+	StrBuf_initFile(&trace_out, fp);
+	
+	/* The closing bracket is optional, so a trace cut short by ^C still loads */
+	StrBuf_append(&trace_out, "[");
+	trace_wrote = false;
+	trace_start = nowNanos();
+	trace_pid = (int)getpid();
+	trace_generation++;
+	flush_stop = false;
+	
+	if(pthread_create(&flusher, NULL, &flusherMain, NULL) != 0) {
+		DIE("Unable to create trace thread.");
+	}
+	
+	trace_enabled = true;
+	return true;
+}
+
+void Trace_begin(TRACEKIND kind, const char* name, unsigned args) {
+	record(kind, 'B', name, args);
+}
+
+void Trace_end(TRACEKIND kind) {
+	record(kind, 'E', NULL, 0);
+}
+
+void Trace_stop(void) {
+	trace_enabled = false;
+	
+	pthread_mutex_lock(&flush_lock);
+	flush_stop = true;
+	pthread_cond_signal(&flush_wake);
+	pthread_mutex_unlock(&flush_lock);
+	pthread_join(flusher, NULL);
+	
+	StrBuf_append(&trace_out, "\n]\n");
+	fclose(trace_file);
+	trace_file = NULL;
+	
+	TraceRing* ring = __atomic_exchange_n(&trace_rings, NULL, __ATOMIC_ACQ_REL);
+	while(ring != NULL) {
+		TraceRing* next = ring->next;
+		ffree(ring);
+		ring = next;
+	}
+}
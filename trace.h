@@ -0,0 +1,62 @@
+/*
+  trace.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_TRACE_H_
+#define _SC_TRACE_H_
+
+#include <stdbool.h>
+
+typedef enum {
+	TRACE_STATEMENT,
+	TRACE_FUNCTION,
+	TRACE_BUILTIN,
+	TRACE_TEMPLATE,
+	TRACE_KIND_COUNT
+} TRACEKIND;
+
+/* Set while a trace is being recorded */
+extern bool trace_enabled;
+
+/* Records an event only while tracing, so the check stays inline */
+#define TRACE_BEGIN(kind, name, args) do { \
+	if(trace_enabled) { \
+		Trace_begin((kind), (name), (args)); \
+	} \
+} while(0)
+
+#define TRACE_END(kind) do { \
+	if(trace_enabled) { \
+		Trace_end(kind); \
+	} \
+} while(0)
+
+
+/*
+ Starts recording begin and end events from every thread into `path`, in the
+ Chrome trace event format that chrome://tracing and Perfetto load. Each
+ thread writes into a ring of its own without locking, and a background
+ thread moves events from the rings to the file. Raises an error and returns
+ false if the file can't be created.
+*/
+bool Trace_start(const char* path);
+
+/*
+ Marks the start of something named `name` on the calling thread. Names
+ longer than an event holds are cut short. `args` is how many arguments it
+ was given. Every begin needs a matching end of the same kind.
+*/
+void Trace_begin(TRACEKIND kind, const char* name, unsigned args);
+void Trace_end(TRACEKIND kind);
+
+/*
+ Writes out every event still in a ring and closes the file. Nothing may be
+ evaluating while this runs.
+*/
+void Trace_stop(void);
+
+#endif /* _SC_TRACE_H_ */
@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "unop.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -21,14 +23,15 @@ typedef Value* (*unop_t)(const Context*, const Value*);
 
 static long long fact(long long n);
 static Value* unop_fact(const Context* ctx, const Value* a);
+static bool needsParens(const UnOp* term);
 
-static unop_t _unop_table[] = {
+static const unop_t _unop_table[] = {
 	&unop_fact
 };
-static const char* _unop_repr[] = {
+static const char* const _unop_repr[] = {
 	"!"
 };
-static const char* _unop_xml[] = {
+static const char* const _unop_xml[] = {
 	"fact"
 };
 
@@ -70,7 +73,7 @@ void UnOp_free(UnOp* term) {
 		Value_free(term->a);
 	}
 	
-	free(term);
+	ffree(term);
 }
 
 UnOp* UnOp_copy(const UnOp* term) {
@@ -87,76 +90,87 @@ Value* UnOp_eval(const UnOp* term, const Context* ctx) {
 		return a;
 	}
 	
-	Value* ret = _unop_table[term->type](ctx, a);
+	Value* ret = UnOp_apply(term->type, ctx, a);
 	
 	Value_free(a);
 	return ret;
 }
 
-static char* unopToString(const UnOp* term, char* val) {
-	char* ret;
-	if(term->a->type == VAL_FRAC || term->a->type == VAL_EXPR) {
-		char* tmp;
-		asprintf(&tmp, "(%s)", val);
-		free(val);
-		val = tmp;
-	}
-	
-	asprintf(&ret, "%s%s", val, _unop_repr[term->type]);
-	
-	free(val);
-	return ret;
+Value* UnOp_apply(UNTYPE type, const Context* ctx, const Value* a) {
+	return _unop_table[type](ctx, a);
 }
 
-char* UnOp_repr(const UnOp* term, bool pretty) {
-	return unopToString(term, Value_repr(term->a, pretty, false));
+/* Whether the operand needs parentheses before the postfix operator */
+static bool needsParens(const UnOp* term) {
+	return term->a->type == VAL_FRAC || term->a->type == VAL_EXPR;
 }
 
-char* UnOp_wrap(const UnOp* term) {
-	return unopToString(term, Value_wrap(term->a, false));
+void UnOp_repr(const UnOp* term, StrBuf* sb, bool pretty) {
+	bool paren = needsParens(term);
+	if(paren) {
+		StrBuf_putc(sb, '(');
+	}
+	
+	Value_repr(term->a, sb, pretty, false);
+	
+	if(paren) {
+		StrBuf_putc(sb, ')');
+	}
+	
+	StrBuf_append(sb, _unop_repr[term->type]);
 }
 
-char* UnOp_verbose(const UnOp* term, unsigned indent) {
-	char* ret;
-	char* a = Value_verbose(term->a, indent + 1);
+void UnOp_wrap(const UnOp* term, StrBuf* sb) {
+	bool paren = needsParens(term);
+	if(paren) {
+		StrBuf_putc(sb, '(');
+	}
 	
-	asprintf(&ret,
-			 "%3$s (\n"       /* Type */
-				 "%2$s%4$s\n" /* a */
-			 "%1$s)",
-			 indentation(indent), indentation(indent + 1),
-			 _unop_repr[term->type],
-			 a);
+	Value_wrap(term->a, sb, false);
 	
-	free(a);
-	return ret;
+	if(paren) {
+		StrBuf_putc(sb, ')');
+	}
+	
+	StrBuf_append(sb, _unop_repr[term->type]);
+}
+
+void UnOp_verbose(const UnOp* term, StrBuf* sb, unsigned indent) {
+	StrBuf_printf(sb, "%s (", _unop_repr[term->type]);
+	StrBuf_newline(sb, indent + 1);
+	Value_verbose(term->a, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_putc(sb, ')');
 }
 
-char* UnOp_xml(const UnOp* term, unsigned indent) {
+void UnOp_xml(const UnOp* term, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x (3 - 1)!
-	 
+	
 	 <fact>
 	   <sub>
 	     <int>3</int>
 	     <int>1</int>
 	   </sub>
 	 </fact>
-	 
+	
 	 2
 	*/
-	char* ret;
-	char* a = Value_xml(term->a, indent + 1);
-	
-	asprintf(&ret,
-			 "<%1$s>\n"
-				 "%3$s%4$s\n" /* a */
-			 "%2$s</%1$s>",
-			 _unop_xml[term->type],
-			 indentation(indent), indentation(indent + 1),
-			 a);
-	
-	free(a);
-	return ret;
+	StrBuf_printf(sb, "<%s>", _unop_xml[term->type]);
+	StrBuf_newline(sb, indent + 1);
+	Value_xml(term->a, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_printf(sb, "</%s>", _unop_xml[term->type]);
+}
+
+void UnOp_json(const UnOp* term, StrBuf* sb) {
+	/*
+	 sc> ?jt (3 - 1)!
+	 {"tree":{"op":"fact","a":{"op":"sub","a":3,"b":1}}}
+	 {"result":2}
+	*/
+	StrBuf_printf(sb, "{\"op\":\"%s\",\"a\":", _unop_xml[term->type]);
+	Value_json(term->a, sb);
+	StrBuf_putc(sb, '}');
 }
 
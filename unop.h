@@ -41,10 +41,14 @@ UnOp* UnOp_copy(const UnOp* term);
 /* Evaluation */
 Value* UnOp_eval(const UnOp* term, const Context* ctx);
 
+/* Applies the operator to an operand that is already evaluated */
+Value* UnOp_apply(UNTYPE type, const Context* ctx, const Value* a);
+
 /* Printing */
-char* UnOp_repr(const UnOp* term, bool pretty);
-char* UnOp_wrap(const UnOp* term);
-char* UnOp_verbose(const UnOp* term, unsigned indent);
-char* UnOp_xml(const UnOp* term, unsigned indent);
+void UnOp_repr(const UnOp* term, StrBuf* sb, bool pretty);
+void UnOp_wrap(const UnOp* term, StrBuf* sb);
+void UnOp_verbose(const UnOp* term, StrBuf* sb, unsigned indent);
+void UnOp_xml(const UnOp* term, StrBuf* sb, unsigned indent);
+void UnOp_json(const UnOp* term, StrBuf* sb);
 
 #endif
@@ -6,15 +6,15 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_VALUES
+
 #include "value.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
-#include <errno.h>
 #include <math.h>
-#include <float.h>
 
 #include "support.h"
 #include "error.h"
@@ -24,29 +24,35 @@
 #include "unop.h"
 #include "funccall.h"
 #include "vector.h"
+#include "matrix.h"
 #include "context.h"
 #include "variable.h"
 #include "arglist.h"
 #include "supercalc.h"
 #include "template.h"
+#include "numlex.h"
+#include "stats.h"
 
 
 static Value* allocValue(VALTYPE type);
 static void treeAddValue(BinOp** tree, BinOp** prev, BINTYPE op, Value* val);
 static Value* parseNum(const char** expr);
-static Value* subscriptVector(Value* val, const char** expr, parser_cb* cb);
-static Value* callFunc(Value* val, const char** expr, parser_cb* cb);
-static Value* parseToken(const char** expr, parser_cb* cb);
+static Value* subscriptVector(Value* val, const char** expr, const parser_cb* cb);
+static Value* callFunc(Value* val, const char** expr, const parser_cb* cb);
+static Value* parseToken(const char** expr, const parser_cb* cb);
+static bool visitArgs(const ArgList* arglist, name_visitor visit, void* data);
 
 
 /* By default, the '@' character is illegal */
 Value* _default_cb(const char** expr, void* data) {
 	return ValErr(badChar(**expr));
 }
-parser_cb default_cb = {&_default_cb, NULL};
+const parser_cb default_cb = {&_default_cb, NULL};
 
 
 static Value* allocValue(VALTYPE type) {
+	STAT_INC(values);
+	
 	Value* ret = fcalloc(1, sizeof(*ret));
 	ret->type = type;
 	return ret;
@@ -105,7 +111,7 @@ Value* ValCall(FuncCall* call) {
 
 Value* ValVar(const char* name) {
 	Value* ret = allocValue(VAL_VAR);
-	ret->name = strdup(name);
+	ret->name = fstrdup(name);
 	return ret;
 }
 
@@ -121,6 +127,12 @@ Value* ValPlace(Placeholder* ph) {
 	return ret;
 }
 
+Value* ValMat(Matrix* mat) {
+	Value* ret = allocValue(VAL_MAT);
+	ret->mat = mat;
+	return ret;
+}
+
 void Value_free(Value* val) {
 	if(!val) return;
 	
@@ -142,13 +154,17 @@ void Value_free(Value* val) {
 			break;
 		
 		case VAL_VAR:
-			free(val->name);
+			ffree(val->name);
 			break;
 		
 		case VAL_VEC:
 			Vector_free(val->vec);
 			break;
 		
+		case VAL_MAT:
+			Matrix_free(val->mat);
+			break;
+		
 		case VAL_ERR:
 			Error_free(val->err);
 			break;
@@ -158,7 +174,7 @@ void Value_free(Value* val) {
 			break;
 	}
 	
-	free(val);
+	ffree(val);
 }
 
 Value* Value_copy(const Value* val) {
@@ -197,6 +213,10 @@ Value* Value_copy(const Value* val) {
 			ret = ValVec(Vector_copy(val->vec));
 			break;
 		
+		case VAL_MAT:
+			ret = ValMat(Matrix_copy(val->mat));
+			break;
+		
 		case VAL_NEG:
 			/* Shouldn't be reached, but so easy to code */
 			ret = ValNeg();
@@ -218,8 +238,10 @@ Value* Value_copy(const Value* val) {
 Value* Value_eval(const Value* val, const Context* ctx) {
 	if(val == NULL) return ValErr(nullError());
 	
+	STAT_INC(nodes);
+	
 	Value* ret;
-	Variable* var;
+	const Variable* var;
 	
 	switch(val->type) {
 		/* These can be evaluated to a simpler form */
@@ -254,6 +276,10 @@ Value* Value_eval(const Value* val, const Context* ctx) {
 			ret = Vector_eval(val->vec, ctx);
 			break;
 		
+		case VAL_MAT:
+			ret = Matrix_eval(val->mat, ctx);
+			break;
+		
 		/* These can't be simplified, so just copy them */
 		case VAL_INT:
 		case VAL_REAL:
@@ -274,7 +300,7 @@ Value* Value_coerce(const Value* val, const Context* ctx) {
 	Value* ret = Value_eval(val, ctx);
 	
 	if(ret->type == VAL_VAR) {
-		Variable* var = Variable_get(ctx, ret->name);
+		const Variable* var = Variable_get(ctx, ret->name);
 		
 		if(var == NULL) {
 			Value* tmp = ValErr(varNotFound(ret->name));
@@ -314,7 +340,98 @@ double Value_asReal(const Value* val) {
 	return ret;
 }
 
-Value* Value_parse(const char** expr, char sep, char end, parser_cb* cb) {
+SC_STATUS Value_export(const Value* val, const Error* raised, double* result, SCError* err) {
+	SC_STATUS ret = SC_OK;
+	Error* bad = NULL;
+	
+	switch(val->type) {
+		case VAL_INT:
+		case VAL_REAL:
+		case VAL_FRAC:
+			if(result) {
+				*result = Value_asReal(val);
+			}
+			break;
+		
+		case VAL_VAR:
+			/* Defined a function, so there's no number */
+			break;
+		
+		case VAL_ERR:
+			/* An ignored error means the real one was already raised */
+			if(val->err->type == ERR_IGN && raised != NULL) {
+				Error_export(raised, err);
+				return Error_status(raised);
+			}
+			
+			Error_export(val->err, err);
+			return Error_status(val->err);
+		
+		default:
+			bad = typeError("Result is not a number.");
+			break;
+	}
+	
+	if(bad) {
+		ret = Error_status(bad);
+		Error_export(bad, err);
+		Error_free(bad);
+	}
+	
+	return ret;
+}
+
+static bool visitArgs(const ArgList* arglist, name_visitor visit, void* data) {
+	unsigned i;
+	for(i = 0; i < arglist->count; i++) {
+		if(!Value_visitNames(arglist->args[i], visit, data)) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+bool Value_visitNames(const Value* val, name_visitor visit, void* data) {
+	if(val == NULL) return true;
+	
+	switch(val->type) {
+		case VAL_VAR:
+			/* Internal names like "@elem" refer to the builtin "elem" */
+			return visit(val->name[0] == '@' ? &val->name[1] : val->name, data);
+		
+		case VAL_EXPR:
+			return Value_visitNames(val->expr->a, visit, data)
+			    && Value_visitNames(val->expr->b, visit, data);
+		
+		case VAL_UNARY:
+			return Value_visitNames(val->term->a, visit, data);
+		
+		case VAL_CALL:
+			return Value_visitNames(val->call->func, visit, data)
+			    && visitArgs(val->call->arglist, visit, data);
+		
+		case VAL_VEC:
+			return visitArgs(val->vec->vals, visit, data);
+		
+		case VAL_MAT:
+			if(val->mat->kind == MAT_BOXED) {
+				size_t i, count = (size_t)val->mat->rows * val->mat->cols;
+				for(i = 0; i < count; i++) {
+					if(!Value_visitNames(val->mat->vals[i], visit, data)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		
+		default:
+			/* Constants don't reference anything */
+			return true;
+	}
+}
+
+Value* Value_parse(const char** expr, char sep, char end, const parser_cb* cb) {
 	Value* val;
 	BINTYPE op = BIN_UNK;
 	BinOp* tree = NULL;
@@ -442,42 +559,29 @@ static void treeAddValue(BinOp** tree, BinOp** prev, BINTYPE op, Value* val) {
 }
 
 static Value* parseNum(const char** expr) {
-	Value* ret;
-	char* end1;
-	char* end2;
-	
-	errno = 0;
-	double dbl = strtod(*expr, &end1);
-	if(errno != 0 || *expr == end1) {
-		/* An error occurred (EINVAL, ERANGE) */
-		end1 = NULL;
-	}
+	long long ival;
+	double rval;
 	
-	long long ll = strtoll(*expr, &end2, 10);
-	if(errno != 0 || *expr == end2) {
-		/* An error occurred (EINVAL, ERANGE) */
-		end2 = NULL;
-	}
-	
-	if(end1 > end2) {
-		/* Must be a double because more of the string was parsed as double than long long */
-		ret = ValReal(dbl);
-		*expr = end1;
-	}
-	else if(end2 != NULL) {
-		/* Must be an integer */
-		ret = ValInt(ll);
-		*expr = end2;
-	}
-	else {
-		/* Both failed to convert the data */
-		ret = ValErr(badChar(**expr));
+	switch(lexNumber(expr, &ival, &rval)) {
+		case NUM_INT:
+			return ValInt(ival);
+		
+		case NUM_REAL:
+			return ValReal(rval);
+		
+		case NUM_RANGE:
+			return ValErr(syntaxError("Integer literal is too large."));
+		
+		case NUM_REAL_RANGE:
+			return ValErr(syntaxError("Real literal is out of range."));
+		
+		default:
+			/* Not a number at all */
+			return ValErr(badChar(**expr));
 	}
-	
-	return ret;
 }
 
-static Value* subscriptVector(Value* val, const char** expr, parser_cb* cb) {
+static Value* subscriptVector(Value* val, const char** expr, const parser_cb* cb) {
 	/* Move past the '[' character */
 	(*expr)++;
 	
@@ -493,7 +597,7 @@ static Value* subscriptVector(Value* val, const char** expr, parser_cb* cb) {
 	return TP_FILL(tp, "@elem(@@, @@)", val, index);
 }
 
-static Value* callFunc(Value* val, const char** expr, parser_cb* cb) {
+static Value* callFunc(Value* val, const char** expr, const parser_cb* cb) {
 	/* Ugly, but parses better. Only variables and the results of calls can be funcs */
 	if(val->type != VAL_VAR && val->type != VAL_CALL && val->type != VAL_PLACE) {
 		return val;
@@ -511,7 +615,7 @@ static Value* callFunc(Value* val, const char** expr, parser_cb* cb) {
 	return ValCall(FuncCall_new(val, args));
 }
 
-static Value* parseToken(const char** expr, parser_cb* cb) {
+static Value* parseToken(const char** expr, const parser_cb* cb) {
 	Value* ret;
 	
 	char* token = nextToken(expr);
@@ -525,7 +629,7 @@ static Value* parseToken(const char** expr, parser_cb* cb) {
 		ArgList* arglist = ArgList_parse(expr, ',', ')', cb);
 		if(arglist == NULL) {
 			/* Parse error occurred and has already been raised */
-			free(token);
+			ffree(token);
 			return ValErr(ignoreError());
 		}
 		
@@ -535,11 +639,11 @@ static Value* parseToken(const char** expr, parser_cb* cb) {
 		ret = ValVar(token);
 	}
 	
-	free(token);
+	ffree(token);
 	return ret;
 }
 
-Value* Value_next(const char** expr, char end, parser_cb* cb) {
+Value* Value_next(const char** expr, char end, const parser_cb* cb) {
 	Value* ret;
 	
 	trimSpaces(expr);
@@ -565,6 +669,10 @@ Value* Value_next(const char** expr, char end, parser_cb* cb) {
 		(*expr)++;
 		ret = Vector_parse(expr, cb);
 	}
+	else if(**expr == '[') {
+		(*expr)++;
+		ret = Matrix_parse(expr, cb);
+	}
 	else if(**expr == '|') {
 		(*expr)++;
 		Value* val = Value_parse(expr, 0, '|', cb);
@@ -627,228 +735,298 @@ Value* Value_next(const char** expr, char end, parser_cb* cb) {
 		trimSpaces(expr);
 		ret = ValUnary(UnOp_new(UN_FACT, ret));
 	}
-
+	
 	return ret;
 }
 
-char* Value_repr(const Value* val, bool pretty, bool top) {
-	char* ret;
-	
+void Value_repr(const Value* val, StrBuf* sb, bool pretty, bool top) {
 	switch(val->type) {
 		case VAL_INT:
-			asprintf(&ret, "%lld", val->ival);
+			StrBuf_printf(sb, "%lld", val->ival);
 			break;
-			
+		
 		case VAL_REAL:
 			if(pretty && isinf(val->rval)) {
-				ret = strdup(val->rval < 0 ? "-∞" : "∞");
+				StrBuf_append(sb, val->rval < 0 ? "-∞" : "∞");
 			}
 			else {
-				asprintf(&ret, "%.*g", DBL_DIG, approx(val->rval));
+				StrBuf_real(sb, val->rval);
 			}
 			break;
-			
+		
 		case VAL_FRAC:
-			ret = Fraction_repr(val->frac, top);
+			Fraction_repr(val->frac, sb, top);
 			break;
-			
+		
 		case VAL_UNARY:
-			ret = UnOp_repr(val->term, pretty);
+			UnOp_repr(val->term, sb, pretty);
 			break;
-			
+		
 		case VAL_EXPR:
-			ret = BinOp_repr(val->expr, pretty);
+			BinOp_repr(val->expr, sb, pretty);
 			break;
-			
+		
 		case VAL_CALL:
-			ret = FuncCall_repr(val->call, pretty);
+			FuncCall_repr(val->call, sb, pretty);
 			break;
-			
+		
 		case VAL_VAR:
-			ret = strdup(pretty ? getPretty(val->name) : val->name);
+			StrBuf_append(sb, pretty ? getPretty(val->name) : val->name);
 			break;
-			
+		
 		case VAL_VEC:
-			ret = Vector_repr(val->vec, pretty);
+			Vector_repr(val->vec, sb, pretty);
 			break;
-			
+		
+		case VAL_MAT:
+			Matrix_repr(val->mat, sb, pretty);
+			break;
+		
 		case VAL_PLACE:
-			ret = Placeholder_repr(val->ph);
+			Placeholder_repr(val->ph, sb);
 			break;
-			
+		
 		default:
 			/* Shouldn't be reached */
 			badValType(val->type);
 	}
-	
-	return ret;
 }
 
-char* Value_wrap(const Value* val, bool top) {
-	char* ret;
-	
+void Value_wrap(const Value* val, StrBuf* sb, bool top) {
 	switch(val->type) {
 		case VAL_INT:
-			asprintf(&ret, "%lld", val->ival);
+			StrBuf_printf(sb, "%lld", val->ival);
 			break;
-			
+		
 		case VAL_REAL:
-			asprintf(&ret, "%.*g", DBL_DIG, approx(val->rval));
+			StrBuf_real(sb, val->rval);
 			break;
-			
+		
 		case VAL_FRAC:
-			ret = Fraction_repr(val->frac, top);
+			Fraction_repr(val->frac, sb, top);
 			break;
-			
+		
 		case VAL_UNARY:
-			ret = UnOp_wrap(val->term);
+			UnOp_wrap(val->term, sb);
 			break;
-			
+		
 		case VAL_EXPR:
-			ret = BinOp_wrap(val->expr);
+			BinOp_wrap(val->expr, sb);
 			break;
-			
+		
 		case VAL_CALL:
-			ret = FuncCall_wrap(val->call);
+			FuncCall_wrap(val->call, sb);
 			break;
-			
+		
 		case VAL_VAR:
-			ret = strdup(val->name);
+			StrBuf_append(sb, val->name);
 			break;
-			
+		
 		case VAL_VEC:
-			ret = Vector_wrap(val->vec);
+			Vector_wrap(val->vec, sb);
 			break;
-			
+		
+		case VAL_MAT:
+			Matrix_wrap(val->mat, sb);
+			break;
+		
 		case VAL_PLACE:
-			ret = Placeholder_repr(val->ph);
+			Placeholder_repr(val->ph, sb);
 			break;
-			
+		
 		default:
 			/* Shouldn't be reached */
 			badValType(val->type);
 	}
-	
-	return ret;
 }
 
-char* Value_verbose(const Value* val, unsigned indent) {
-	char* ret;
-	
+void Value_verbose(const Value* val, StrBuf* sb, unsigned indent) {
 	switch(val->type) {
 		case VAL_INT:
-			asprintf(&ret, "%lld", val->ival);
+			StrBuf_printf(sb, "%lld", val->ival);
 			break;
 		
 		case VAL_REAL:
-			asprintf(&ret, "%.*g", DBL_DIG, approx(val->rval));
+			StrBuf_real(sb, val->rval);
 			break;
 		
 		case VAL_FRAC:
-			ret = Fraction_repr(val->frac, indent == 0);
+			Fraction_repr(val->frac, sb, indent == 0);
 			break;
 		
 		case VAL_UNARY:
-			ret = UnOp_verbose(val->term, indent);
+			UnOp_verbose(val->term, sb, indent);
 			break;
 		
 		case VAL_EXPR:
-			ret = BinOp_verbose(val->expr, indent);
+			BinOp_verbose(val->expr, sb, indent);
 			break;
 		
 		case VAL_CALL:
-			ret = FuncCall_verbose(val->call, indent);
+			FuncCall_verbose(val->call, sb, indent);
 			break;
 		
 		case VAL_VAR:
-			ret = strdup(val->name);
+			StrBuf_append(sb, val->name);
 			break;
 		
 		case VAL_VEC:
-			ret = Vector_verbose(val->vec, indent);
+			Vector_verbose(val->vec, sb, indent);
+			break;
+		
+		case VAL_MAT:
+			Matrix_verbose(val->mat, sb, indent);
 			break;
 		
 		case VAL_PLACE:
-			ret = Placeholder_repr(val->ph);
+			Placeholder_repr(val->ph, sb);
 			break;
 		
 		default:
 			badValType(val->type);
 	}
-	
-	return ret;
 }
 
-char* Value_xml(const Value* val, unsigned indent) {
-	char* ret;
-	
+void Value_xml(const Value* val, StrBuf* sb, unsigned indent) {
 	switch(val->type) {
 		case VAL_INT:
-			asprintf(&ret, "<int>%lld</int>", val->ival);
+			StrBuf_printf(sb, "<int>%lld</int>", val->ival);
 			break;
-			
+		
 		case VAL_REAL:
-			asprintf(&ret, "<real>%.*g</real>", DBL_DIG, val->rval);
+			StrBuf_append(sb, "<real>");
+			StrBuf_real(sb, val->rval);
+			StrBuf_append(sb, "</real>");
 			break;
-			
+		
 		case VAL_FRAC:
-			ret = Fraction_xml(val->frac);
+			Fraction_xml(val->frac, sb);
 			break;
-			
+		
 		case VAL_UNARY:
-			ret = UnOp_xml(val->term, indent);
+			UnOp_xml(val->term, sb, indent);
 			break;
-			
+		
 		case VAL_EXPR:
-			ret = BinOp_xml(val->expr, indent);
+			BinOp_xml(val->expr, sb, indent);
 			break;
-			
+		
 		case VAL_CALL:
-			ret = FuncCall_xml(val->call, indent);
+			FuncCall_xml(val->call, sb, indent);
 			break;
-			
+		
 		case VAL_VAR:
 			if(val->name[0] == '@') {
-				asprintf(&ret,
-						 "<var name=\"%s\" internal=\"true\"/>",
-						 &val->name[1]);
+				StrBuf_printf(sb,
+							  "<var name=\"%s\" internal=\"true\"/>",
+							  &val->name[1]);
 			}
 			else {
-				asprintf(&ret,
-						 "<var name=\"%s\"/>",
-						 val->name);
+				StrBuf_printf(sb,
+							  "<var name=\"%s\"/>",
+							  val->name);
 			}
 			break;
-			
+		
 		case VAL_VEC:
-			ret = Vector_xml(val->vec, indent);
+			Vector_xml(val->vec, sb, indent);
 			break;
-			
+		
+		case VAL_MAT:
+			Matrix_xml(val->mat, sb, indent);
+			break;
+		
 		case VAL_PLACE:
-			ret = Placeholder_xml(val->ph, indent);
+			Placeholder_xml(val->ph, sb, indent);
 			break;
-			
+		
+		default:
+			badValType(val->type);
+	}
+}
+
+void Value_json(const Value* val, StrBuf* sb) {
+	switch(val->type) {
+		case VAL_INT:
+			StrBuf_printf(sb, "%lld", val->ival);
+			break;
+		
+		case VAL_REAL:
+			StrBuf_jsonReal(sb, val->rval);
+			break;
+		
+		case VAL_FRAC:
+			Fraction_json(val->frac, sb);
+			break;
+		
+		case VAL_UNARY:
+			UnOp_json(val->term, sb);
+			break;
+		
+		case VAL_EXPR:
+			BinOp_json(val->expr, sb);
+			break;
+		
+		case VAL_CALL:
+			FuncCall_json(val->call, sb);
+			break;
+		
+		case VAL_VAR:
+			StrBuf_append(sb, "{\"var\":");
+			if(val->name[0] == '@') {
+				StrBuf_jsonString(sb, &val->name[1]);
+				StrBuf_append(sb, ",\"internal\":true}");
+			}
+			else {
+				StrBuf_jsonString(sb, val->name);
+				StrBuf_putc(sb, '}');
+			}
+			break;
+		
+		case VAL_VEC:
+			Vector_json(val->vec, sb);
+			break;
+		
+		case VAL_MAT:
+			Matrix_json(val->mat, sb);
+			break;
+		
+		case VAL_PLACE:
+			Placeholder_json(val->ph, sb);
+			break;
+		
 		default:
 			badValType(val->type);
 	}
-	
-	return ret;
 }
 
 void Value_print(const Value* val, const SuperCalc* sc, VERBOSITY v) {
 	if(val->type == VAL_ERR) {
 		/* An error occurred, so print it and continue. */
+		bool json = Error_setJson(Error_jsonMode() || HAS_ANY(v, V_JSON));
 		Error_raise(val->err, false);
+		Error_setJson(json);
 		return;
 	}
 	
-	/* Print the value */
-	char* valString = Value_repr(val, v & V_PRETTY, true);
-	if(valString) {
-		fprintf(sc->fout, "%s", valString);
-		free(valString);
+	/* Print the value straight to the output */
+	StrBuf sb;
+	StrBuf_initFile(&sb, sc->fout);
+	
+	if(v & V_JSON) {
+		/* Function definitions reply with the name, so every line gets a line back */
+		if(val->type == VAL_VAR) {
+			StrBuf_printf(&sb, "{\"defined\":\"%s\"}\n", val->name);
+			return;
+		}
+		
+		StrBuf_append(&sb, "{\"result\":");
+		Value_json(val, &sb);
+		StrBuf_append(&sb, "}\n");
+		return;
 	}
 	
-	fputc('\n', sc->fout);
+	Value_repr(val, &sb, v & V_PRETTY, true);
+	StrBuf_putc(&sb, '\n');
 }
 
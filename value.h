@@ -20,6 +20,10 @@ typedef struct parser_cb {
 	void* data;
 } parser_cb;
 
+/* Called for each variable name in a tree. Return false to stop visiting */
+typedef bool (*name_visitor)(const char* name, void* data);
+
+#include "strbuf.h"
 #include "fraction.h"
 #include "unop.h"
 #include "binop.h"
@@ -29,6 +33,7 @@ typedef struct parser_cb {
 #include "error.h"
 #include "generic.h"
 #include "vector.h"
+#include "matrix.h"
 #include "placeholder.h"
 #include "supercalc.h"
 
@@ -45,7 +50,8 @@ typedef enum {
 	VAL_CALL,
 	VAL_VAR,
 	VAL_VEC,
-	VAL_PLACE
+	VAL_PLACE,
+	VAL_MAT
 } VALTYPE;
 
 
@@ -56,6 +62,7 @@ struct Value {
 		double       rval;
 		Fraction*    frac;
 		Vector*      vec;
+		Matrix*      mat;
 		UnOp*        term;
 		BinOp*       expr;
 		FuncCall*    call;
@@ -66,7 +73,7 @@ struct Value {
 };
 
 /* Default parser callback errors on '@' */
-extern parser_cb default_cb;
+extern const parser_cb default_cb;
 
 /* Value constructors */
 /* Each method which takes an object pointer as an argument consumes it */
@@ -82,6 +89,7 @@ Value* ValCall(FuncCall* call);
 Value* ValVar(const char* name);
 Value* ValVec(Vector* vec);
 Value* ValPlace(Placeholder* ph);
+Value* ValMat(Matrix* mat);
 
 /* Destructor */
 void Value_free(Value* val);
@@ -96,15 +104,26 @@ Value* Value_coerce(const Value* val, const Context* ctx);
 /* Conversion */
 double Value_asReal(const Value* val);
 
+/*
+ Converts a result for the library interface. `raised` is the first error that
+ was raised rather than returned while evaluating, or NULL.
+*/
+SC_STATUS Value_export(const Value* val, const Error* raised, double* result, SCError* err);
+
+/* Dependency analysis */
+/* Returns false if `visit` stopped early */
+bool Value_visitNames(const Value* val, name_visitor visit, void* data);
+
 /* Parsing */
-Value* Value_parse(const char** expr, char sep, char end, parser_cb* cb);
-Value* Value_next(const char** expr, char end, parser_cb* cb);
+Value* Value_parse(const char** expr, char sep, char end, const parser_cb* cb);
+Value* Value_next(const char** expr, char end, const parser_cb* cb);
 
 /* Printing */
-char* Value_repr(const Value* val, bool pretty, bool top);
-char* Value_wrap(const Value* val, bool top);
-char* Value_verbose(const Value* val, unsigned indent);
-char* Value_xml(const Value* val, unsigned indent);
+void Value_repr(const Value* val, StrBuf* sb, bool pretty, bool top);
+void Value_wrap(const Value* val, StrBuf* sb, bool top);
+void Value_verbose(const Value* val, StrBuf* sb, unsigned indent);
+void Value_xml(const Value* val, StrBuf* sb, unsigned indent);
+void Value_json(const Value* val, StrBuf* sb);
 void Value_print(const Value* val, const SuperCalc* sc, VERBOSITY v);
 
 #endif
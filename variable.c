@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker. All rights reserved.
 */
 
+#define MEM_TAG MEM_CONTEXT
+
 #include "variable.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -21,6 +23,7 @@
 #include "builtin.h"
 #include "variable.h"
 #include "arglist.h"
+#include "reactive.h"
 
 
 static Variable* allocVar(VARTYPE type, char* name) {
@@ -33,7 +36,7 @@ static Variable* allocVar(VARTYPE type, char* name) {
 }
 
 Variable* VarErr(Error* err) {
-	Variable* ret = allocVar(VAR_ERR, strdup("error"));
+	Variable* ret = allocVar(VAR_ERR, fstrdup("error"));
 	ret->err = err;
 	return ret;
 }
@@ -62,6 +65,12 @@ Variable* VarFunc(char* name, Function* func) {
 	return ret;
 }
 
+Variable* VarReactive(char* name, Reactive* rx) {
+	Variable* ret = allocVar(VAR_REACTIVE, name);
+	ret->rx = rx;
+	return ret;
+}
+
 void Variable_free(Variable* var) {
 	if(!var) {
 		return;
@@ -81,6 +90,10 @@ void Variable_free(Variable* var) {
 			Function_free(var->func);
 			break;
 		
+		case VAR_REACTIVE:
+			Reactive_free(var->rx);
+			break;
+		
 		case VAR_ERR:
 			Error_free(var->err);
 			break;
@@ -89,13 +102,13 @@ void Variable_free(Variable* var) {
 			badVarType(var->type);
 	}
 	
-	free(var->name);
-	free(var);
+	ffree(var->name);
+	ffree(var);
 }
 
 Variable* Variable_copy(const Variable* var) {
 	Variable* ret;
-	char* name = var->name ? strdup(var->name) : NULL;
+	char* name = var->name ? fstrdup(var->name) : NULL;
 	
 	switch(var->type) {
 		case VAR_BUILTIN:
@@ -113,6 +126,10 @@ Variable* Variable_copy(const Variable* var) {
 			ret = VarFunc(name, Function_copy(var->func));
 			break;
 		
+		case VAR_REACTIVE:
+			ret = VarReactive(name, Reactive_copy(var->rx));
+			break;
+		
 		case VAR_ERR:
 			ret = VarErr(Error_copy(var->err));
 			break;
@@ -141,6 +158,10 @@ Value* Variable_eval(const Variable* var, const Context* ctx) {
 			ret = ValVar(var->name);
 			break;
 		
+		case VAR_REACTIVE:
+			ret = Reactive_eval(var->rx, var->name, ctx);
+			break;
+		
 		case VAR_ERR:
 			ret = ValErr(var->err);
 			break;
@@ -161,6 +182,9 @@ Value* Variable_coerce(const Variable* var, const Context* ctx) {
 	else if(var->type == VAR_FUNC) {
 		ret = ValErr(typeError("Variable '%s' is a function.", var->name));
 	}
+	else if(var->type == VAR_REACTIVE) {
+		ret = Reactive_eval(var->rx, var->name, ctx);
+	}
 	else if(var->type == VAR_BUILTIN && !var->blt->isFunction) {
 		ArgList* noArgs = ArgList_new(0);
 		ret = Builtin_eval(var->blt, ctx, noArgs, false);
@@ -173,11 +197,11 @@ Value* Variable_coerce(const Variable* var, const Context* ctx) {
 	return ret;
 }
 
-Variable* Variable_get(const Context* ctx, const char* name) {
+const Variable* Variable_get(const Context* ctx, const char* name) {
 	return Context_get(ctx, name);
 }
 
-Variable* Variable_getAbove(const Context* ctx, const char* name) {
+const Variable* Variable_getAbove(const Context* ctx, const char* name) {
 	return Context_getAbove(ctx, name);
 }
 
@@ -200,6 +224,10 @@ void Variable_update(Variable* dst, Variable* src) {
 			Value_free(dst->val);
 			break;
 		
+		case VAR_REACTIVE:
+			Reactive_free(dst->rx);
+			break;
+		
 		default:
 			badVarType(dst->type);
 	}
@@ -225,121 +253,106 @@ void Variable_update(Variable* dst, Variable* src) {
 			src->val = NULL;
 			break;
 		
+		case VAR_REACTIVE:
+			dst->rx = src->rx;
+			src->rx = NULL;
+			break;
+		
 		default:
 			badVarType(src->type);
 	}
 	
 	dst->type = src->type;
-	free(src->name);
-	free(src);
+	ffree(src->name);
+	ffree(src);
 }
 
-char* Variable_repr(const Variable* var, bool pretty) {
-	char* ret;
-	
+void Variable_repr(const Variable* var, StrBuf* sb, bool pretty) {
 	const char* name = var->name;
 	if(pretty) {
 		name = getPretty(name);
 	}
 	
 	if(var->type == VAR_FUNC) {
-		char* func = Function_repr(var->func, pretty);
-		asprintf(&ret, "%s%s", name, func);
-		free(func);
+		StrBuf_append(sb, name);
+		Function_repr(var->func, sb, pretty);
+		return;
 	}
-	else if(var->type == VAR_BUILTIN) {
-		char* blt = Builtin_repr(var->blt, pretty);
-		if(name == NULL) {
-			ret = blt;
-		}
-		else {
-			asprintf(&ret, "%s = %s", name, blt);
-			free(blt);
-		}
+	
+	if(var->type == VAR_REACTIVE) {
+		StrBuf_append(sb, name);
+		Reactive_repr(var->rx, sb, pretty);
+		return;
 	}
-	else {
-		char* val = Value_repr(var->val, pretty, false);
-		if(name == NULL) {
-			ret = val;
-		}
-		else {
-			asprintf(&ret, "%s = %s", name, val);
-			free(val);
-		}
+	
+	if(name != NULL) {
+		StrBuf_printf(sb, "%s = ", name);
 	}
 	
-	return ret;
+	if(var->type == VAR_BUILTIN) {
+		Builtin_repr(var->blt, sb, pretty);
+	}
+	else {
+		Value_repr(var->val, sb, pretty, false);
+	}
 }
 
-char* Variable_wrap(const Variable* var) {
-	char* ret;
+void Variable_wrap(const Variable* var, StrBuf* sb) {
 	const char* name = var->name;
 	
 	if(var->type == VAR_FUNC) {
-		char* func = Function_wrap(var->func);
-		asprintf(&ret, "%s%s", name, func);
-		free(func);
+		StrBuf_append(sb, name);
+		Function_wrap(var->func, sb);
+		return;
 	}
-	else if(var->type == VAR_BUILTIN) {
-		char* blt = Builtin_repr(var->blt, false);
-		if(name == NULL) {
-			ret = blt;
-		}
-		else {
-			asprintf(&ret, "%s = %s", name, blt);
-			free(blt);
-		}
+	
+	if(var->type == VAR_REACTIVE) {
+		StrBuf_append(sb, name);
+		Reactive_wrap(var->rx, sb);
+		return;
 	}
-	else {
-		char* val = Value_wrap(var->val, true);
-		if(name == NULL) {
-			ret = val;
-		}
-		else {
-			asprintf(&ret, "%s = %s", name, val);
-			free(val);
-		}
+	
+	if(name != NULL) {
+		StrBuf_printf(sb, "%s = ", name);
 	}
 	
-	return ret;
+	if(var->type == VAR_BUILTIN) {
+		Builtin_repr(var->blt, sb, false);
+	}
+	else {
+		Value_wrap(var->val, sb, true);
+	}
 }
 
-char* Variable_verbose(const Variable* var) {
-	char* ret;
-	
+void Variable_verbose(const Variable* var, StrBuf* sb) {
 	if(var->type == VAR_FUNC) {
-		char* func = Function_verbose(var->func);
-		asprintf(&ret, "%s%s", var->name, func);
-		free(func);
+		StrBuf_append(sb, var->name);
+		Function_verbose(var->func, sb);
+		return;
 	}
-	else if(var->type == VAR_BUILTIN) {
-		char* blt = Builtin_verbose(var->blt, 0);
-		if(var->name == NULL) {
-			ret = blt;
-		}
-		else {
-			asprintf(&ret, "%s = %s", var->name, blt);
-			free(blt);
-		}
+	
+	if(var->type == VAR_REACTIVE) {
+		StrBuf_append(sb, var->name);
+		Reactive_verbose(var->rx, sb);
+		return;
 	}
-	else {
-		char* val = Value_verbose(var->val, 0);
-		if(var->name == NULL) {
-			ret = val;
-		}
-		else {
-			asprintf(&ret, "%s = %s", var->name, val);
-			free(val);
-		}
+	
+	if(var->name != NULL) {
+		StrBuf_printf(sb, "%s = ", var->name);
 	}
 	
-	return ret;
+	if(var->type == VAR_BUILTIN) {
+		Builtin_verbose(var->blt, sb, 0);
+	}
+	else {
+		Value_verbose(var->val, sb, 0);
+	}
 }
 
-char* Variable_xml(const Variable* var) {
+void Variable_xml(const Variable* var, StrBuf* sb) {
 	/*
 	 sc> ?x f(x) = 3x + 4
-	 
+	
 	 <vardata name="f">
 	   <func>
 	     <argnames>
@@ -357,34 +370,53 @@ char* Variable_xml(const Variable* var) {
 	   </func>
 	 </vardata>
 	*/
-	char* ret;
-	char* val;
-	
 	unsigned indent = var->name == NULL ? 0 : 1;
 	
+	if(var->name != NULL) {
+		StrBuf_printf(sb, "<vardata name=\"%s\">", var->name);
+		StrBuf_newline(sb, indent);
+	}
+	
 	if(var->type == VAR_FUNC) {
-		val = Function_xml(var->func, indent);
+		Function_xml(var->func, sb, indent);
+	}
+	else if(var->type == VAR_REACTIVE) {
+		Reactive_xml(var->rx, sb, indent);
 	}
 	else if(var->type == VAR_BUILTIN) {
-		val = Builtin_xml(var->blt, indent);
+		Builtin_xml(var->blt, sb, indent);
 	}
 	else {
-		val = Value_xml(var->val, indent);
+		Value_xml(var->val, sb, indent);
 	}
 	
-	if(var->name == NULL) {
-		return val;
+	if(var->name != NULL) {
+		StrBuf_append(sb, "\n</vardata>");
+	}
+}
+
+void Variable_json(const Variable* var, StrBuf* sb) {
+	if(var->name != NULL) {
+		StrBuf_append(sb, "{\"name\":");
+		StrBuf_jsonString(sb, var->name);
+		StrBuf_append(sb, ",\"value\":");
 	}
 	
-	asprintf(&ret,
-			 "<vardata name=\"%2$s\">\n" /* name */
-				 "%1$s%3$s\n"            /* value */
-			 "</vardata>",
-			 indentation(1),
-			 var->name,
-			 val);
+	if(var->type == VAR_FUNC) {
+		Function_json(var->func, sb);
+	}
+	else if(var->type == VAR_REACTIVE) {
+		Reactive_json(var->rx, sb);
+	}
+	else if(var->type == VAR_BUILTIN) {
+		Builtin_json(var->blt, sb);
+	}
+	else {
+		Value_json(var->val, sb);
+	}
 	
-	free(val);
-	return ret;
+	if(var->name != NULL) {
+		StrBuf_putc(sb, '}');
+	}
 }
 
@@ -16,6 +16,7 @@ typedef struct Variable Variable;
 #include "builtin.h"
 #include "value.h"
 #include "function.h"
+#include "reactive.h"
 #include "error.h"
 
 
@@ -24,7 +25,8 @@ typedef enum {
 	VAR_BUILTIN = 0,
 	VAR_CONSTANT,
 	VAR_VALUE,
-	VAR_FUNC
+	VAR_FUNC,
+	VAR_REACTIVE
 } VARTYPE;
 
 struct Variable {
@@ -35,6 +37,7 @@ struct Variable {
 		Builtin* blt;
 		Value* val;
 		Function* func;
+		Reactive* rx;
 	};
 };
 
@@ -46,6 +49,7 @@ Variable* VarBuiltin(char* name, Builtin* blt);
 Variable* VarConstant(char* name, Builtin* blt);
 Variable* VarValue(char* name, Value* val);
 Variable* VarFunc(char* name, Function* func);
+Variable* VarReactive(char* name, Reactive* rx);
 
 /* Destructor */
 void Variable_free(Variable* var);
@@ -58,8 +62,8 @@ Value* Variable_eval(const Variable* var, const Context* ctx);
 Value* Variable_coerce(const Variable* var, const Context* ctx);
 
 /* Variable accessing */
-Variable* Variable_get(const Context* ctx, const char* name);
-Variable* Variable_getAbove(const Context* ctx, const char* name);
+const Variable* Variable_get(const Context* ctx, const char* name);
+const Variable* Variable_getAbove(const Context* ctx, const char* name);
 
 /*
  This method basically frees the content of `dst`, moves
@@ -69,9 +73,10 @@ Variable* Variable_getAbove(const Context* ctx, const char* name);
 void Variable_update(Variable* dst, Variable* src);
 
 /* Printing */
-char* Variable_repr(const Variable* var, bool pretty);
-char* Variable_wrap(const Variable* var);
-char* Variable_verbose(const Variable* var);
-char* Variable_xml(const Variable* var);
+void Variable_repr(const Variable* var, StrBuf* sb, bool pretty);
+void Variable_wrap(const Variable* var, StrBuf* sb);
+void Variable_verbose(const Variable* var, StrBuf* sb);
+void Variable_xml(const Variable* var, StrBuf* sb);
+void Variable_json(const Variable* var, StrBuf* sb);
 
 #endif
@@ -6,6 +6,8 @@
   Copyright (c) 2013 C0deH4cker and Silas Schwarz. All rights reserved.
 */
 
+#define MEM_TAG MEM_VECTORS
+
 #include "vector.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -58,14 +60,14 @@ Vector* Vector_vcreate(unsigned count, va_list args) {
 
 void Vector_free(Vector* vec) {
 	ArgList_free(vec->vals);
-	free(vec);
+	ffree(vec);
 }
 
 Vector* Vector_copy(const Vector* vec) {
 	return Vector_new(ArgList_copy(vec->vals));
 }
 
-Value* Vector_parse(const char** expr, parser_cb* cb) {
+Value* Vector_parse(const char** expr, const parser_cb* cb) {
 	ArgList* vals = ArgList_parse(expr, ',', '>', cb);
 	
 	if(vals == NULL) {
@@ -312,45 +314,30 @@ Value* Vector_elem(const Vector* vec, const Value* index, const Context* ctx) {
 	return Value_copy(vec->vals->args[index->ival]);
 }
 
-char* Vector_repr(const Vector* vec, bool pretty) {
-	char* ret;
-	char* vals = ArgList_repr(vec->vals, pretty);
-	
-	asprintf(&ret, "<%s>", vals);
-	
-	free(vals);
-	return ret;
+void Vector_repr(const Vector* vec, StrBuf* sb, bool pretty) {
+	StrBuf_putc(sb, '<');
+	ArgList_repr(vec->vals, sb, pretty);
+	StrBuf_putc(sb, '>');
 }
 
-char* Vector_wrap(const Vector* vec) {
-	char* ret;
-	char* vals = ArgList_wrap(vec->vals);
-	
-	asprintf(&ret, "<%s>", vals);
-	
-	free(vals);
-	return ret;
+void Vector_wrap(const Vector* vec, StrBuf* sb) {
+	StrBuf_putc(sb, '<');
+	ArgList_wrap(vec->vals, sb);
+	StrBuf_putc(sb, '>');
 }
 
-char* Vector_verbose(const Vector* vec, unsigned indent) {
-	char* ret;
-	char* vals = ArgList_verbose(vec->vals, indent + 1);
-	
-	asprintf(&ret,
-			 "Vector <\n"
-				 "%2$s%3$s\n" /* vals */
-			 "%1$s>",
-			 indentation(indent), indentation(indent + 1),
-			 vals);
-	
-	free(vals);
-	return ret;
+void Vector_verbose(const Vector* vec, StrBuf* sb, unsigned indent) {
+	StrBuf_append(sb, "Vector <");
+	StrBuf_newline(sb, indent + 1);
+	ArgList_verbose(vec->vals, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_putc(sb, '>');
 }
 
-char* Vector_xml(const Vector* vec, unsigned indent) {
+void Vector_xml(const Vector* vec, StrBuf* sb, unsigned indent) {
 	/*
 	 sc> ?x <pi, 7 - 3, 4!>
-	 
+	
 	 <vec>
 	   <var name="pi"/>
 	   <sub>
@@ -361,20 +348,20 @@ char* Vector_xml(const Vector* vec, unsigned indent) {
 	     <int>4</int>
 	   </fact>
 	 </vec>
-	 
+	
 	 <3.14159265358979, 4, 24>
 	*/
-	char* ret;
-	char* vals = ArgList_xml(vec->vals, indent + 1);
-	
-	asprintf(&ret,
-			 "<vec>\n"
-				 "%2$s\n" /* vals */
-			 "%1$s</vec>",
-			 indentation(indent),
-			 vals);
-	
-	free(vals);
-	return ret;
+	StrBuf_append(sb, "<vec>\n");
+	ArgList_xml(vec->vals, sb, indent + 1);
+	StrBuf_newline(sb, indent);
+	StrBuf_append(sb, "</vec>");
+}
+
+void Vector_json(const Vector* vec, StrBuf* sb) {
+	/*
+	 sc> ?j <pi, 7 - 3, 1/3>
+	 {"result":[3.141592653589793,4,{"num":1,"den":3,"approx":0.3333333333333333}]}
+	*/
+	ArgList_json(vec->vals, sb);
 }
 
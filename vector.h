@@ -35,7 +35,7 @@ void Vector_free(Vector* vec);
 Vector* Vector_copy(const Vector* vec);
 
 /* Parsing */
-Value* Vector_parse(const char** expr, parser_cb* cb);
+Value* Vector_parse(const char** expr, const parser_cb* cb);
 
 /* Evaluation */
 Value* Vector_eval(const Vector* vec, const Context* ctx);
@@ -58,9 +58,10 @@ Value* Vector_normalize(const Vector* vec, const Context* ctx);
 Value* Vector_elem(const Vector* vec, const Value* index, const Context* ctx);
 
 /* Printing */
-char* Vector_repr(const Vector* vec, bool pretty);
-char* Vector_wrap(const Vector* vec);
-char* Vector_verbose(const Vector* vec, unsigned indent);
-char* Vector_xml(const Vector* vec, unsigned indent);
+void Vector_repr(const Vector* vec, StrBuf* sb, bool pretty);
+void Vector_wrap(const Vector* vec, StrBuf* sb);
+void Vector_verbose(const Vector* vec, StrBuf* sb, unsigned indent);
+void Vector_xml(const Vector* vec, StrBuf* sb, unsigned indent);
+void Vector_json(const Vector* vec, StrBuf* sb);
 
 #endif
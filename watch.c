@@ -0,0 +1,1053 @@
+/*
+  watch.c
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#include "watch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "generic.h"
+#include "error.h"
+#include "value.h"
+#include "variable.h"
+#include "function.h"
+#include "reactive.h"
+#include "context.h"
+#include "statement.h"
+#include "builtin.h"
+#include "strbuf.h"
+#include "trace.h"
+
+/* How often the watched file is checked for changes */
+#define POLL_MS 100
+
+/* More edits than this in one update count as replacing every line between the first and last */
+#define DIFF_MAX 1024
+
+typedef enum {
+	LINE_BLANK = 0,
+	LINE_BADV,
+	LINE_STMT,
+	LINE_DEL,
+	LINE_CLEAR,
+	LINE_LOAD,
+	LINE_SAVE
+} LINEKIND;
+
+/* A name read by a line, and the stamp of the line that defined it back then */
+typedef struct WatchDep {
+	char* name;
+	unsigned long stamp;
+} WatchDep;
+
+typedef struct WatchLine {
+	/* Without comments or surrounding whitespace, which is what edits are compared by */
+	char* text;
+	LINEKIND kind;
+	Statement* stmt;
+	
+	/* Name assigned by a statement or deleted by `~name` */
+	char* name;
+	
+	/* What the line left in the context the last time it was evaluated */
+	Variable* def;
+	Variable* ans;
+	
+	WatchDep* deps;
+	unsigned ndeps;
+	
+	/* Changes whenever evaluating the line changes what it defines. 0 means never evaluated */
+	unsigned long stamp;
+	
+	char* out;
+	size_t outlen;
+} WatchLine;
+
+/* A name's stamp, and for definitions, the variable the line left behind */
+typedef struct Binding {
+	const char* name;
+	unsigned long stamp;
+	const Variable* var;
+} Binding;
+
+/* Open addressing, with slots holding indices into binds plus one */
+typedef struct BindTable {
+	Binding* binds;
+	unsigned count;
+	unsigned cap;
+	unsigned* slots;
+	unsigned nslots;
+	
+	/* Whether names are copied, for tables that outlive the lines */
+	bool owned;
+} BindTable;
+
+struct Watch {
+	SuperCalc* sc;
+	WatchLine** lines;
+	unsigned count;
+	unsigned long stamps;
+	unsigned updates;
+	
+	/* Where names that no line defines come from, before and after `~~~` */
+	Context* start;
+	Context* empty;
+	const Context* base;
+	
+	/* What the lines so far define, as of the line being looked at */
+	BindTable defs;
+	
+	/* Which definition of each name sc->ctx holds right now */
+	BindTable applied;
+	
+	/* Set when `~~~` or `load` changed sc->ctx in ways `applied` can't describe */
+	bool tainted;
+	
+	/* What stat said about the watched file on the last poll, and when it was last read */
+	struct stat polled;
+	struct stat loaded;
+	bool hasPolled;
+	bool hasLoaded;
+};
+
+struct DepCollect {
+	Watch* w;
+	WatchDep* deps;
+	unsigned count;
+	unsigned cap;
+	/* Function bodies and reactive formulas already visited */
+	const Value** seen;
+	unsigned nseen;
+	unsigned capseen;
+};
+
+
+static double now(void);
+static unsigned hashName(const char* name);
+static Binding* findBinding(const BindTable* table, const char* name);
+static void bind(BindTable* table, const char* name, unsigned long stamp, const Variable* var);
+static void clearBindings(BindTable* table);
+static void clearButAns(BindTable* table);
+static char* normalizeLine(const char* line, size_t len);
+static WatchLine* newLine(char* text);
+static void freeLine(WatchLine* line);
+static void matchLines(WatchLine* const* old, unsigned n, char* const* texts, unsigned m, int* match);
+static bool collectName(const char* name, void* data);
+static void collectDeps(Watch* w, WatchLine* line);
+static bool depsChanged(const Watch* w, const WatchLine* line);
+static bool sameVar(const Variable* a, const Variable* b);
+static void install(Watch* w, const char* name);
+static void installAll(Watch* w);
+static void evalLine(Watch* w, WatchLine* line);
+static void applyLine(Watch* w, const WatchLine* line);
+static char* readFile(const char* path);
+static bool sameStat(const struct stat* a, const struct stat* b);
+
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* FNV-1a */
+static unsigned hashName(const char* name) {
+	unsigned hash = 2166136261u;
+	
+	while(*name != '\0') {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	
+	return hash;
+}
+
+static Binding* findBinding(const BindTable* table, const char* name) {
+	if(table->nslots == 0) {
+		return NULL;
+	}
+	
+	unsigned i = hashName(name) & (table->nslots - 1);
+	while(table->slots[i] != 0) {
+		Binding* b = &table->binds[table->slots[i] - 1];
+		if(strcmp(b->name, name) == 0) {
+			return b;
+		}
+		
+		i = (i + 1) & (table->nslots - 1);
+	}
+	
+	return NULL;
+}
+
+/* A NULL `var` in defs means the name was deleted */
+static void bind(BindTable* table, const char* name, unsigned long stamp, const Variable* var) {
+	Binding* b = findBinding(table, name);
+	if(b != NULL) {
+		b->stamp = stamp;
+		b->var = var;
+		return;
+	}
+	
+	if(table->count >= table->cap) {
+		table->cap = table->cap ? table->cap * 2 : 64;
+		table->binds = frealloc(table->binds, table->cap * sizeof(*table->binds));
+	}
+	
+	/* Keep the table at most half full */
+	if((table->count + 1) * 2 > table->nslots) {
+		ffree(table->slots);
+		table->nslots = table->nslots ? table->nslots * 2 : 128;
+		table->slots = fcalloc(table->nslots, sizeof(*table->slots));
+		
+		unsigned i;
+		for(i = 0; i < table->count; i++) {
+			unsigned j = hashName(table->binds[i].name) & (table->nslots - 1);
+			while(table->slots[j] != 0) {
+				j = (j + 1) & (table->nslots - 1);
+			}
+			table->slots[j] = i + 1;
+		}
+	}
+	
+	unsigned j = hashName(name) & (table->nslots - 1);
+	while(table->slots[j] != 0) {
+		j = (j + 1) & (table->nslots - 1);
+	}
+	
+	table->binds[table->count] = (Binding){table->owned ? fstrdup(name) : name, stamp, var};
+	table->slots[j] = ++table->count;
+}
+
+static void clearBindings(BindTable* table) {
+	if(table->owned) {
+		unsigned i;
+		for(i = 0; i < table->count; i++) {
+			ffree((char*)table->binds[i].name);
+		}
+	}
+	
+	table->count = 0;
+	
+	if(table->slots != NULL) {
+		memset(table->slots, 0, table->nslots * sizeof(*table->slots));
+	}
+}
+
+/* `~~~` leaves ans alone */
+static void clearButAns(BindTable* table) {
+	Binding* b = findBinding(table, "ans");
+	if(b == NULL) {
+		clearBindings(table);
+		return;
+	}
+	
+	unsigned long stamp = b->stamp;
+	const Variable* var = b->var;
+	clearBindings(table);
+	bind(table, "ans", stamp, var);
+}
+
+/* Same cleanup as the other ways of running a line, plus leading whitespace */
+static char* normalizeLine(const char* line, size_t len) {
+	/* Only look within the line, since the rest of the script follows it */
+	const char* cut = line;
+	while(cut < line + len && *cut != '\r' && *cut != '#') {
+		cut++;
+	}
+	len = cut - line;
+	
+	while(len > 0 && isspace((unsigned char)*line)) {
+		line++;
+		len--;
+	}
+	
+	while(len > 0 && isspace((unsigned char)line[len - 1])) {
+		len--;
+	}
+	
+	return strndup(line, len);
+}
+
+/* Works out what kind of line `text` is and parses it. Consumes `text` */
+static WatchLine* newLine(char* text) {
+	WatchLine* ret = fcalloc(1, sizeof(*ret));
+	ret->text = text;
+	
+	/* Verbosity errors are raised again when the line is evaluated */
+	Error* ignored = NULL;
+	Error** prevCapture = Error_capture(&ignored);
+	const char* p = text;
+	VERBOSITY v = getVerbosity(&p);
+	Error_capture(prevCapture);
+	Error_free(ignored);
+	
+	trimSpaces(&p);
+	
+	if(v & V_ERR) {
+		ret->kind = LINE_BADV;
+	}
+	else if(*p == '\0') {
+		ret->kind = LINE_BLANK;
+	}
+	else if(*p == '~') {
+		/* Commands are run by SC_runString, this only needs to know what they do */
+		p++;
+		ret->name = nextToken(&p);
+		ret->kind = ret->name == NULL && p[0] == '~' && p[1] == '~' ? LINE_CLEAR : LINE_DEL;
+	}
+	else if(strncmp(p, "load", 4) == 0 && p[4 + strspn(p + 4, " \t")] == '"') {
+		ret->kind = LINE_LOAD;
+	}
+	else if(strncmp(p, "save", 4) == 0 && p[4 + strspn(p + 4, " \t")] == '"') {
+		ret->kind = LINE_SAVE;
+	}
+	else {
+		ret->kind = LINE_STMT;
+		ret->stmt = Statement_parse(&p);
+		
+		if(!Statement_didError(ret->stmt) && ret->stmt->var->name != NULL) {
+			ret->name = fstrdup(ret->stmt->var->name);
+		}
+	}
+	
+	return ret;
+}
+
+static void freeLine(WatchLine* line) {
+	unsigned i;
+	for(i = 0; i < line->ndeps; i++) {
+		ffree(line->deps[i].name);
+	}
+	
+	if(line->stmt) Statement_free(line->stmt);
+	if(line->def) Variable_free(line->def);
+	if(line->ans) Variable_free(line->ans);
+	
+	ffree(line->deps);
+	ffree(line->name);
+	ffree(line->out);
+	ffree(line->text);
+	ffree(line);
+}
+
+/* Records a name, and the names read by the function or reactive binding it refers to */
+/*
+ Pairs up the lines an edit left alone using Myers' diff, so edits far apart
+ only cost the lines they touched. Sets match[j] to the index in `old` of new
+ line j, or -1 when it was added or edited.
+*/
+static void matchLines(WatchLine* const* old, unsigned n, char* const* texts, unsigned m, int* match) {
+	int i, x, y, k, d;
+	for(i = 0; i < (int)m; i++) {
+		match[i] = -1;
+	}
+	
+	if(n == 0 || m == 0) {
+		return;
+	}
+	
+	unsigned* oldHash = fmalloc(n * sizeof(*oldHash));
+	unsigned* newHash = fmalloc(m * sizeof(*newHash));
+	for(i = 0; i < (int)n; i++) {
+		oldHash[i] = hashName(old[i]->text);
+	}
+	for(i = 0; i < (int)m; i++) {
+		newHash[i] = hashName(texts[i]);
+	}
+	
+	/* V[k] is the furthest x reached on diagonal k = x - y */
+	int limit = (int)MIN(n + m, DIFF_MAX);
+	int* v = fmalloc((2 * limit + 3) * sizeof(*v));
+	int* V = v + limit + 1;
+	V[1] = 0;
+	
+	/* Row d of the trace holds V[-d..d] after d edits, starting at d*d */
+	int* trace = NULL;
+	int found = -1;
+	
+	for(d = 0; d <= limit && found < 0; d++) {
+		trace = frealloc(trace, (size_t)(d + 1) * (d + 1) * sizeof(*trace));
+		
+		for(k = -d; k <= d; k += 2) {
+			if(k == -d || (k != d && V[k - 1] < V[k + 1])) {
+				x = V[k + 1];
+			}
+			else {
+				x = V[k - 1] + 1;
+			}
+			
+			y = x - k;
+			while(x < (int)n && y < (int)m && oldHash[x] == newHash[y] && strcmp(old[x]->text, texts[y]) == 0) {
+				x++;
+				y++;
+			}
+			
+			V[k] = trace[d * d + k + d] = x;
+			
+			if(x >= (int)n && y >= (int)m) {
+				found = d;
+				break;
+			}
+		}
+	}
+	
+	if(found >= 0) {
+		/* Walk back from the end, matching the lines on each diagonal run */
+		x = n;
+		y = m;
+		for(d = found; d > 0; d--) {
+			const int* prev = trace + (d - 1) * (d - 1) + (d - 1);
+			k = x - y;
+			
+			int pk = (k == -d || (k != d && prev[k - 1] < prev[k + 1])) ? k + 1 : k - 1;
+			int px = prev[pk];
+			int py = px - pk;
+			
+			while(x > px && y > py) {
+				match[--y] = --x;
+			}
+			
+			x = px;
+			y = py;
+		}
+		
+		while(x > 0 && y > 0) {
+			match[--y] = --x;
+		}
+	}
+	
+	ffree(trace);
+	ffree(v);
+	ffree(oldHash);
+	ffree(newHash);
+}
+
+static bool collectName(const char* name, void* data) {
+	struct DepCollect* dc = data;
+	
+	unsigned i;
+	for(i = 0; i < dc->count; i++) {
+		if(strcmp(dc->deps[i].name, name) == 0) {
+			return true;
+		}
+	}
+	
+	if(dc->count >= dc->cap) {
+		dc->cap = dc->cap ? dc->cap * 2 : 4;
+		dc->deps = frealloc(dc->deps, dc->cap * sizeof(*dc->deps));
+	}
+	
+	Binding* b = findBinding(&dc->w->defs, name);
+	dc->deps[dc->count++] = (WatchDep){fstrdup(name), b ? b->stamp : 0};
+	
+	/* Function bodies look their names up when they're called, and reactive formulas when they're read */
+	const Variable* var = b ? b->var : Variable_get(dc->w->base, name);
+	const Value* body;
+	if(var != NULL && var->type == VAR_FUNC) {
+		body = var->func->body;
+	}
+	else if(var != NULL && var->type == VAR_REACTIVE) {
+		body = var->rx->formula;
+	}
+	else {
+		return true;
+	}
+	
+	for(i = 0; i < dc->nseen; i++) {
+		if(dc->seen[i] == body) {
+			return true;
+		}
+	}
+	
+	if(dc->nseen >= dc->capseen) {
+		dc->capseen = dc->capseen ? dc->capseen * 2 : 4;
+		dc->seen = frealloc(dc->seen, dc->capseen * sizeof(*dc->seen));
+	}
+	dc->seen[dc->nseen++] = body;
+	
+	return Value_visitNames(body, &collectName, dc);
+}
+
+static void collectDeps(Watch* w, WatchLine* line) {
+	unsigned i;
+	for(i = 0; i < line->ndeps; i++) {
+		ffree(line->deps[i].name);
+	}
+	ffree(line->deps);
+	
+	struct DepCollect dc = {w, NULL, 0, 0, NULL, 0, 0};
+	
+	if(line->kind == LINE_DEL) {
+		/* Whether deleting fails depends on what was there */
+		if(line->name != NULL) {
+			collectName(line->name, &dc);
+		}
+	}
+	else if(line->stmt->var->type == VAR_VALUE) {
+		/* Defining a function doesn't read anything until it's called */
+		Value_visitNames(line->stmt->var->val, &collectName, &dc);
+	}
+	else if(line->stmt->var->type == VAR_REACTIVE) {
+		/* Binding one is checked for cycles and evaluated right away */
+		collectName(line->name, &dc);
+		Value_visitNames(line->stmt->var->rx->formula, &collectName, &dc);
+	}
+	
+	ffree(dc.seen);
+	line->deps = dc.deps;
+	line->ndeps = dc.count;
+}
+
+static bool depsChanged(const Watch* w, const WatchLine* line) {
+	unsigned i;
+	for(i = 0; i < line->ndeps; i++) {
+		Binding* b = findBinding(&w->defs, line->deps[i].name);
+		if((b ? b->stamp : 0) != line->deps[i].stamp) {
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/* Whether a definition came out the same, so lines reading it can be skipped */
+static bool sameVar(const Variable* a, const Variable* b) {
+	if(a == NULL || b == NULL) {
+		return a == b;
+	}
+	
+	if(a->type != b->type) {
+		return false;
+	}
+	
+	StrBuf sa, sb;
+	StrBuf_init(&sa);
+	StrBuf_init(&sb);
+	Variable_repr(a, &sa, false);
+	Variable_repr(b, &sb, false);
+	char* stra = StrBuf_finish(&sa);
+	char* strb = StrBuf_finish(&sb);
+	
+	bool ret = strcmp(stra, strb) == 0;
+	ffree(stra);
+	ffree(strb);
+	return ret;
+}
+
+/* Makes sc->ctx hold the definition of `name` that the current line would see */
+static void install(Watch* w, const char* name) {
+	/* Builtins can't be redefined, so they never need it */
+	if(Builtin_find(name) != NULL) {
+		return;
+	}
+	
+	Binding* def = findBinding(&w->defs, name);
+	unsigned long stamp = def ? def->stamp : 0;
+	
+	Binding* applied = findBinding(&w->applied, name);
+	if((applied ? applied->stamp : 0) == stamp) {
+		return;
+	}
+	
+	Context* ctx = w->sc->ctx;
+	const Variable* var = def ? def->var : Context_get(w->base, name);
+	
+	if(var != NULL) {
+		/* A reactive result was worked out from what its own line saw, which may not match now */
+		Variable* copy = Variable_copy(var);
+		if(copy->type == VAR_REACTIVE) {
+			Reactive_forget(copy->rx);
+		}
+		
+		Context_setGlobal(ctx, name, copy);
+	}
+	else if(strcmp(name, "ans") != 0 && Context_get(ctx, name) != NULL) {
+		Context_del(ctx, name);
+	}
+	
+	bind(&w->applied, name, stamp, NULL);
+}
+
+/* Rebuilds sc->ctx with every definition so far, for commands that see all of it */
+static void installAll(Watch* w) {
+	Context_free(w->sc->ctx);
+	Context* ctx = w->sc->ctx = Context_copy(w->base);
+	clearBindings(&w->applied);
+	
+	unsigned i;
+	for(i = 0; i < w->defs.count; i++) {
+		const Binding* b = &w->defs.binds[i];
+		
+		if(b->var == NULL) {
+			/* Deleted, which only matters if the base context has it */
+			if(Builtin_find(b->name) == NULL && Context_get(ctx, b->name) != NULL) {
+				Context_del(ctx, b->name);
+			}
+		}
+		else if(strcmp(b->name, "ans") == 0 || Context_get(w->base, b->name) != NULL) {
+			Context_setGlobal(ctx, b->name, Variable_copy(b->var));
+		}
+		else {
+			/* Each name is defined once here, so there's no need to search the globals */
+			Context_addGlobal(ctx, Variable_copy(b->var));
+		}
+		
+		bind(&w->applied, b->name, b->stamp, NULL);
+	}
+}
+
+static void evalLine(Watch* w, WatchLine* line) {
+	if(line->kind == LINE_STMT || line->kind == LINE_DEL) {
+		/* Only what the line reads has to be brought up to date */
+		collectDeps(w, line);
+		
+		unsigned i;
+		for(i = 0; i < line->ndeps; i++) {
+			install(w, line->deps[i].name);
+		}
+	}
+	else if(line->kind == LINE_SAVE) {
+		installAll(w);
+	}
+	
+	SuperCalc* sc = w->sc;
+	
+	/* Output and errors are kept together so they can be printed in order */
+	ffree(line->out);
+	line->out = NULL;
+	line->outlen = 0;
+	FILE* out = open_memstream(&line->out, &line->outlen);
+	
+	SuperCalc local = *sc;
+	local.fout = out;
+	local.ferr = out;
+	
+	FILE* ferr = Error_setStream(out);
+	const char* crashLine = Error_setLine(line->text);
+	
+	const char* p = line->text;
+	VERBOSITY v = getVerbosity(&p);
+	if(sc->json && !(v & V_ERR)) {
+		v |= V_JSON;
+	}
+	
+	bool json = Error_setJson(sc->json || HAS_ANY(v, V_JSON));
+	
+	if(line->kind != LINE_STMT) {
+		if(line->kind != LINE_BADV) {
+			/* Commands don't print anything unless they fail */
+			SC_runString(&local, p, v);
+		}
+		
+		line->stamp = ++w->stamps;
+		
+		switch(line->kind) {
+			case LINE_DEL:
+				if(line->name != NULL) {
+					bind(&w->applied, line->name, line->stamp, NULL);
+				}
+				break;
+			
+			case LINE_CLEAR:
+				/* What's left matches an empty base, which applyLine switches to */
+				clearButAns(&w->applied);
+				w->tainted = true;
+				break;
+			
+			case LINE_LOAD:
+				w->tainted = true;
+				break;
+			
+			default:
+				break;
+		}
+	}
+	else {
+		Variable* def = NULL;
+		Variable* ans = NULL;
+		
+		Statement_print(line->stmt, &local, v);
+		
+		if(!Statement_didError(line->stmt)) {
+			StrBuf log;
+			StrBuf* prevLog = NULL;
+			if(v & V_UPDATES) {
+				StrBuf_init(&log);
+				prevLog = Reactive_setLog(&log);
+			}
+			
+			TRACE_BEGIN(TRACE_STATEMENT, line->text, 0);
+			Profile* prof = Profile_use(sc->profile);
+			Value* ret = Statement_eval(line->stmt, sc->ctx, v);
+			Profile_use(prof);
+			TRACE_END(TRACE_STATEMENT);
+			
+			if(v & V_UPDATES) {
+				Reactive_setLog(prevLog);
+				char* names = StrBuf_finish(&log);
+				Statement_printUpdates(names, &local, v);
+				ffree(names);
+			}
+			
+			const Variable* var = line->name ? Variable_get(sc->ctx, line->name) : NULL;
+			if(line->stmt->var->type == VAR_REACTIVE) {
+				/* The binding stays even when its formula fails, unless it was refused */
+				if(var != NULL && sameVar(var, line->stmt->var)) {
+					def = Variable_copy(var);
+				}
+			}
+			else if(ret->type != VAL_ERR && var != NULL && var->type != VAR_BUILTIN) {
+				def = Variable_copy(var);
+			}
+			
+			/* Plain values are what get stored in ans */
+			if(ret->type != VAL_ERR && ret->type != VAL_VAR && line->stmt->var->type != VAR_FUNC) {
+				ans = Variable_copy(Variable_get(sc->ctx, "ans"));
+			}
+			
+			if(ret->type != VAL_VAR) {
+				Value_print(ret, &local, v);
+			}
+			
+			Value_free(ret);
+		}
+		
+		/* Lines that read this one only need another look if it came out different */
+		if(line->stamp == 0 || !sameVar(line->def, def) || !sameVar(line->ans, ans)) {
+			line->stamp = ++w->stamps;
+		}
+		
+		if(line->def) Variable_free(line->def);
+		if(line->ans) Variable_free(line->ans);
+		line->def = def;
+		line->ans = ans;
+		
+		if(def != NULL) {
+			bind(&w->applied, line->name, line->stamp, NULL);
+		}
+		if(ans != NULL) {
+			bind(&w->applied, "ans", line->stamp, NULL);
+		}
+	}
+	
+	Error_setJson(json);
+	Error_setLine(crashLine);
+	Error_setStream(ferr);
+	fclose(out);
+}
+
+/* Records what the line defines for the lines after it */
+static void applyLine(Watch* w, const WatchLine* line) {
+	switch(line->kind) {
+		case LINE_STMT:
+			if(line->def != NULL) {
+				bind(&w->defs, line->name, line->stamp, line->def);
+			}
+			if(line->ans != NULL) {
+				bind(&w->defs, "ans", line->stamp, line->ans);
+			}
+			break;
+		
+		case LINE_DEL:
+			if(line->name != NULL) {
+				bind(&w->defs, line->name, line->stamp, NULL);
+			}
+			break;
+		
+		case LINE_CLEAR:
+			/* Everything is gone, including what the context started with */
+			clearButAns(&w->defs);
+			w->base = w->empty;
+			break;
+		
+		default:
+			break;
+	}
+}
+
+static char* readFile(const char* path) {
+	FILE* fp = fopen(path, "r");
+	if(fp == NULL) {
+		return NULL;
+	}
+	
+	StrBuf sb;
+	StrBuf_init(&sb);
+	
+	char buf[4096];
+	size_t len;
+	while((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		StrBuf_appendn(&sb, buf, len);
+	}
+	
+	fclose(fp);
+	return StrBuf_finish(&sb);
+}
+
+static bool sameStat(const struct stat* a, const struct stat* b) {
+	return a->st_ino == b->st_ino && a->st_size == b->st_size
+	    && a->st_mtim.tv_sec == b->st_mtim.tv_sec
+	    && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+
+Watch* Watch_new(SuperCalc* sc) {
+	Watch* ret = fcalloc(1, sizeof(*ret));
+	
+	ret->sc = sc;
+	ret->start = Context_copy(sc->ctx);
+	ret->empty = Context_new();
+	ret->base = ret->start;
+	ret->applied.owned = true;
+	
+	return ret;
+}
+
+void Watch_free(Watch* w) {
+	unsigned i;
+	for(i = 0; i < w->count; i++) {
+		freeLine(w->lines[i]);
+	}
+	
+	Context_free(w->start);
+	Context_free(w->empty);
+	ffree(w->lines);
+	clearBindings(&w->applied);
+	ffree(w->defs.binds);
+	ffree(w->defs.slots);
+	ffree(w->applied.binds);
+	ffree(w->applied.slots);
+	ffree(w);
+}
+
+unsigned Watch_update(Watch* w, const char* code) {
+	/* Split into lines */
+	unsigned count = 0;
+	unsigned cap = 64;
+	char** texts = fmalloc(cap * sizeof(*texts));
+	
+	const char* p = code;
+	while(*p != '\0') {
+		size_t len = strcspn(p, "\n");
+		
+		if(count >= cap) {
+			cap *= 2;
+			texts = frealloc(texts, cap * sizeof(*texts));
+		}
+		texts[count++] = normalizeLine(p, len);
+		
+		p += len;
+		if(*p == '\n') {
+			p++;
+		}
+	}
+	
+	/* Edits usually leave the start and end alone, and those lines are kept as they were */
+	unsigned prefix = 0;
+	while(prefix < count && prefix < w->count && strcmp(texts[prefix], w->lines[prefix]->text) == 0) {
+		prefix++;
+	}
+	
+	unsigned suffix = 0;
+	while(suffix < count - prefix && suffix < w->count - prefix
+	      && strcmp(texts[count - 1 - suffix], w->lines[w->count - 1 - suffix]->text) == 0) {
+		suffix++;
+	}
+	
+	/* Lines in between that weren't touched are found too */
+	unsigned oldMid = w->count - prefix - suffix;
+	unsigned newMid = count - prefix - suffix;
+	int* match = fmalloc(MAX(newMid, 1) * sizeof(*match));
+	bool* kept = fcalloc(MAX(oldMid, 1), sizeof(*kept));
+	matchLines(w->lines + prefix, oldMid, texts + prefix, newMid, match);
+	
+	WatchLine** lines = fmalloc(MAX(count, 1) * sizeof(*lines));
+	unsigned i;
+	for(i = 0; i < count; i++) {
+		if(i < prefix) {
+			lines[i] = w->lines[i];
+			ffree(texts[i]);
+		}
+		else if(i >= count - suffix) {
+			lines[i] = w->lines[w->count - (count - i)];
+			ffree(texts[i]);
+		}
+		else if(match[i - prefix] >= 0) {
+			lines[i] = w->lines[prefix + match[i - prefix]];
+			kept[match[i - prefix]] = true;
+			ffree(texts[i]);
+		}
+		else {
+			/* Only edited lines are parsed again */
+			lines[i] = newLine(texts[i]);
+		}
+	}
+	
+	for(i = 0; i < oldMid; i++) {
+		if(!kept[i]) {
+			freeLine(w->lines[prefix + i]);
+		}
+	}
+	
+	ffree(match);
+	ffree(kept);
+	ffree(texts);
+	ffree(w->lines);
+	w->lines = lines;
+	w->count = count;
+	
+	if(w->tainted) {
+		/* Start over from a context that `applied` describes again */
+		Context_free(w->sc->ctx);
+		w->sc->ctx = Context_copy(w->start);
+		clearBindings(&w->applied);
+		w->tainted = false;
+	}
+	
+	/* Walk the script in order, evaluating only lines whose inputs changed */
+	clearBindings(&w->defs);
+	w->base = w->start;
+	
+	bool barrier = false;
+	unsigned evaluated = 0;
+	
+	for(i = 0; i < count; i++) {
+		WatchLine* line = lines[i];
+		bool dirty = line->stamp == 0 || barrier;
+		
+		switch(line->kind) {
+			case LINE_STMT:
+			case LINE_DEL:
+				dirty = dirty || depsChanged(w, line);
+				break;
+			
+			case LINE_CLEAR:
+			case LINE_LOAD:
+			case LINE_SAVE:
+				/* These act on everything, and files can change without the script changing */
+				dirty = true;
+				break;
+			
+			default:
+				break;
+		}
+		
+		if(!dirty) {
+			applyLine(w, line);
+			continue;
+		}
+		
+		evalLine(w, line);
+		applyLine(w, line);
+		evaluated++;
+		
+		/* Nothing after these knows which names they affected */
+		if(line->kind == LINE_LOAD || line->kind == LINE_CLEAR) {
+			barrier = true;
+		}
+		
+		if(w->updates == 0 || w->sc->json) {
+			fwrite(line->out, 1, line->outlen, w->sc->fout);
+			continue;
+		}
+		
+		/* Every line of output is labeled, since trees and errors can take several */
+		const char* out = line->out;
+		const char* end = out + line->outlen;
+		while(out < end) {
+			const char* nl = memchr(out, '\n', end - out) ?: end;
+			fprintf(w->sc->fout, "%u: %.*s\n", i + 1, (int)(nl - out), out);
+			out = nl + 1;
+		}
+	}
+	
+	w->updates++;
+	fflush(w->sc->fout);
+	return evaluated;
+}
+
+unsigned Watch_lines(const Watch* w) {
+	return w->count;
+}
+
+bool Watch_poll(Watch* w, const char* path, unsigned* evaluated) {
+	/* Editors often save by replacing the file, so it may be missing for a moment */
+	struct stat st;
+	if(stat(path, &st) != 0) {
+		w->hasPolled = false;
+		return false;
+	}
+	
+	/* A file that's still being written, or was just truncated to be rewritten, isn't settled yet */
+	bool settled = w->hasPolled && sameStat(&st, &w->polled);
+	w->polled = st;
+	w->hasPolled = true;
+	
+	if(!settled || (w->hasLoaded && sameStat(&st, &w->loaded))) {
+		return false;
+	}
+	
+	char* code = readFile(path);
+	if(code == NULL) {
+		return false;
+	}
+	
+	w->loaded = st;
+	w->hasLoaded = true;
+	*evaluated = Watch_update(w, code);
+	ffree(code);
+	return true;
+}
+
+bool Watch_file(SuperCalc* sc, const char* path) {
+	struct stat st;
+	char* code;
+	if(stat(path, &st) != 0 || (code = readFile(path)) == NULL) {
+		RAISE(nameError("Unable to open '%s': %s.", path, strerror(errno)), false);
+		return false;
+	}
+	
+	Watch* w = Watch_new(sc);
+	w->polled = w->loaded = st;
+	w->hasPolled = w->hasLoaded = true;
+	Watch_update(w, code);
+	ffree(code);
+	
+	struct timespec interval = {0, POLL_MS * 1000000L};
+	
+	for(;;) {
+		nanosleep(&interval, NULL);
+		
+		double start = now();
+		unsigned evaluated;
+		if(!Watch_poll(w, path, &evaluated)) {
+			continue;
+		}
+		
+		double ms = (now() - start) * 1e3;
+		
+		if(sc->json) {
+			fprintf(sc->fout, "{\"watch\":{\"evaluated\":%u,\"lines\":%u,\"ms\":%.3f}}\n",
+			        evaluated, Watch_lines(w), ms);
+		}
+		else {
+			fprintf(sc->fout, "-- %u of %u lines evaluated in %.2f ms --\n",
+			        evaluated, Watch_lines(w), ms);
+		}
+		fflush(sc->fout);
+	}
+	
+	/* Not reached */
+	Watch_free(w);
+	return true;
+}
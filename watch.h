@@ -0,0 +1,54 @@
+/*
+  watch.h
+  SuperCalc
+
+  Created by C0deH4cker on 10/19/26.
+  Copyright (c) 2026 C0deH4cker. All rights reserved.
+*/
+
+#ifndef _SC_WATCH_H_
+#define _SC_WATCH_H_
+
+#include <stdbool.h>
+
+typedef struct Watch Watch;
+#include "supercalc.h"
+
+
+/*
+ Keeps every line of a script along with its parse tree, its output, and the
+ variables it read when it was last evaluated. After an edit, only lines that
+ changed and lines that read a definition that changed are evaluated again.
+ Evaluation happens in `sc`, which must outlive the watch.
+*/
+Watch* Watch_new(SuperCalc* sc);
+
+/* Destructor */
+void Watch_free(Watch* w);
+
+/*
+ Replaces the script with `code` and evaluates what the edit affected. The first
+ update prints every line's output like a normal run. Later ones only print the
+ lines that were evaluated again, each prefixed with its line number unless
+ output is JSON. Returns the number of lines evaluated.
+*/
+unsigned Watch_update(Watch* w, const char* code);
+
+/* Number of lines in the current script */
+unsigned Watch_lines(const Watch* w);
+
+/*
+ Checks the file at `path` once, and updates from it if it changed. A change is
+ only read once two polls in a row see the same size and modification time, so
+ a file that's truncated and then rewritten isn't read in between. Returns true
+ and sets `evaluated` if it updated.
+*/
+bool Watch_poll(Watch* w, const char* path, unsigned* evaluated);
+
+/*
+ Runs the script at `path`, then polls it and updates every time it changes.
+ Only returns, with false, if the file can't be read to begin with.
+*/
+bool Watch_file(SuperCalc* sc, const char* path);
+
+#endif /* _SC_WATCH_H_ */